@@ -4,17 +4,22 @@
 #include "datalib/KinectCalibrationFile.h"
 #include "widgets/CalibrationTypesChoiceDialog.h"
 #include "utils.h"
+#include "Settings.h"
 #include "operations/SequenceReading.h"
 #include "operations/Monitoring.h"
 #include "operations/SequenceRecording.h"
+#include "operations/RecordingPreflight.h"
+#include "operations/WriterBenchmark.h"
 #include "operations/Calibration.h"
 #include "datalib/SequenceFile.h"
+#include "datalib/SequenceIterator.h"
 #include "datalib/TaskProgress.h"
 
 #include <gtkmm/filefilter.h>
 
 #include <glib/gstdio.h>
 
+#include <chrono>
 #include <thread>
 #include <WinBase.h>
 #include <Psapi.h>
@@ -33,6 +38,13 @@ namespace kocca {
 	operations::Operation* Application::currentOperation = NULL;
 	std::mutex Application::currentOperation_mutex;
 	NatNetClient* Application::natNetClient = NULL;
+	ClockSynchronizer Application::natNetClockSynchronizer;
+	operations::PreRollBuffer* Application::preRollBuffer = NULL;
+	FolderReclaimer* Application::folderReclaimer = NULL;
+	std::thread* Application::recordingPreflightThread = NULL;
+	operations::RecordingPreflight* Application::recordingPreflight = NULL;
+	std::mutex Application::recordingPreflight_mutex;
+	double Application::recordingPreflightThroughput = 0;
 	std::vector<std::string> Application::natNetMarkerNames;
 	std::vector<cv::Point3d>* Application::latestsMocapFramePoints = NULL;
 	datalib::Sequence* Application::currentLoadedSequence = NULL;
@@ -63,6 +75,39 @@ namespace kocca {
 			hasUnsavedCalibration = false;
 			hasUnsavedSequence = false;
 
+			// load user settings, if any
+			Settings::loadFromFile(Settings::getDefaultFilePath());
+			kinect.getClockSynchronizer()->setConstantLatency(Settings::getDouble("sync.kinect_latency", 0) * 1000.0);
+			natNetClockSynchronizer.setConstantLatency(Settings::getDouble("sync.natnet_latency", 0) * 1000.0);
+
+			// the folders left for deletion by a previous run are deleted first, in the background
+			folderReclaimer = new FolderReclaimer(Settings::getInt("recording.reclaim_rate", 2000));
+			folderReclaimer->reclaimStaleFolders(baseTempFolder);
+
+			for(int i = 0; i < datalib::Sequence::IMAGE_STREAMS_COUNT; i++) {
+				std::vector<boost::filesystem::path> streamBaseDirectories = datalib::SequenceMetadata::splitDirectoriesList(Settings::getString((std::string("recording.") + datalib::Sequence::STREAM_FOLDER_NAMES[i] + "_directories").c_str(), ""));
+
+				for(int j = 0; j < streamBaseDirectories.size(); j++)
+					folderReclaimer->reclaimStaleFolders(streamBaseDirectories.at(j));
+			}
+
+			unsigned long long preRollDuration = Settings::getInt("recording.preroll_duration", 0);
+
+			if(preRollDuration > 0) {
+				size_t preRollMemory = (size_t)Settings::getInt("recording.preroll_memory", 256) * 1024 * 1024;
+				preRollBuffer = new operations::PreRollBuffer(preRollDuration, preRollMemory, (int)Settings::getInt("recording.jpeg_quality", 100), datalib::JpegFrameEncoder::parseChromaSubsampling(Settings::getString("recording.jpeg_chroma_subsampling", "420")), Settings::getBool("recording.jpeg_fast_dct", false));
+
+				for(int i = 0; i < operations::RECORDED_STREAMS_COUNT; i++)
+					preRollBuffer->setStreamProfile((operations::RecordedStreamType)i, operations::SequenceRecording::getStreamProfileSetting((operations::RecordedStreamType)i));
+
+				if(Settings::getBool("debug.statistics_logs", false))
+					std::cout << "Pre-roll : " << preRollDuration << " ms, " << (preRollBuffer->getArenaSize() / (1024 * 1024)) << " MB of memory" << std::endl;
+			}
+
+			// the disk is benchmarked in the background while the application starts, before the first take (it keeps all the cores busy, so it is opt-in)
+			if(Settings::getBool("recording.preflight", false))
+				recordingPreflightThread = new std::thread(&Application::runRecordingPreflight);
+
 			if(argc > 1) {
 				 std::string argString(argv[argc-1]);
 
@@ -97,6 +142,10 @@ namespace kocca {
 			mainWindow->kinectRGBStreamThumbnail->signal_selected_event().connect(sigc::ptr_fun(Application::onSelectKinectRGBStreamThumbnail));
 			mainWindow->kinectInfraredStreamThumbnail->signal_selected_event().connect(sigc::ptr_fun(Application::onSelectKinectInfraredStreamThumbnail));
 			mainWindow->kinectDepthStreamThumbnail->signal_selected_event().connect(sigc::ptr_fun(Application::onSelectKinectDepthStreamThumbnail));
+			mainWindow->monitor->signal_size_allocate().connect(sigc::ptr_fun(Application::onDisplayWidgetSizeAllocate));
+			mainWindow->kinectRGBStreamThumbnail->signal_size_allocate().connect(sigc::ptr_fun(Application::onDisplayWidgetSizeAllocate));
+			mainWindow->kinectInfraredStreamThumbnail->signal_size_allocate().connect(sigc::ptr_fun(Application::onDisplayWidgetSizeAllocate));
+			mainWindow->kinectDepthStreamThumbnail->signal_size_allocate().connect(sigc::ptr_fun(Application::onDisplayWidgetSizeAllocate));
 			mainWindow->natNetConnectButton->signal_clicked().connect(sigc::ptr_fun(Application::onClickNatNetConnectButton));
 			mainWindow->loadCalibrationFileButton->signal_clicked().connect(sigc::ptr_fun(Application::onClickLoadCalibrationFileButton));
 			mainWindow->saveCalibrationToFileButton->signal_clicked().connect(sigc::ptr_fun(Application::onClickSaveCalibrationToFileButton));
@@ -127,6 +176,9 @@ namespace kocca {
 			mainWindow->signal_shortcuts_Right_event().connect(sigc::ptr_fun(Application::onClickNextButton));
 			mainWindow->signal_shortcuts_PageUp_event().connect(sigc::ptr_fun(Application::onClickGoToBeginingButton));
 			mainWindow->signal_shortcuts_PageDown_event().connect(sigc::ptr_fun(Application::onClickGoToEndButton));
+			mainWindow->signal_shortcuts_Plus_event().connect(sigc::ptr_fun(Application::onMainWindowPlusShortcut));
+			mainWindow->signal_shortcuts_Minus_event().connect(sigc::ptr_fun(Application::onMainWindowMinusShortcut));
+			mainWindow->signal_shortcuts_R_event().connect(sigc::ptr_fun(Application::onMainWindowRShortcut));
 			mainWindow->signal_map_event().connect(sigc::ptr_fun(Application::onShowMainWindow), true);
 			mainWindow->mocapMarkersListView->onSelectedMarkersChanged = Application::on_mocapMarkersListView_selected_markers_changed;
 			mainWindow->monitor->onSelectedMarkersChanged = Application::on_monitor_selected_markers_changed;
@@ -142,9 +194,100 @@ namespace kocca {
 		gtkApplication->run(*mainWindow);
 	}
 
+	int Application::benchmarkPlayback(std::string sequencePath) {
+		Settings::loadFromFile(Settings::getDefaultFilePath());
+		boost::filesystem::path sequenceTempFolder;
+		int returnCode = 0;
+
+		try {
+			datalib::Sequence sequence;
+			datalib::TaskProgress loadProgress;
+
+			if(boost::filesystem::is_directory(sequencePath)) {
+				sequence.setRootDirectory(sequencePath.c_str());
+				sequence.readDataFromRootDirectory(&loadProgress);
+			}
+			else {
+				sequenceTempFolder = getNewSequenceTempFolder();
+				sequence.setRootDirectory(sequenceTempFolder.string().c_str());
+				sequence.readDataFromArchive(sequencePath, &loadProgress);
+			}
+
+			datalib::SequenceIterator sequenceIterator(&sequence, datalib::SEQUENCE_ITERATOR_ALL_STREAMS, (int)Settings::getInt("playback.decoding_threads", 0));
+			datalib::SequenceSample sample;
+			sequenceIterator.start();
+
+			while(sequenceIterator.next(sample)) {
+				// the samples are only decoded
+			}
+
+			std::cout << "Playback benchmark : " << sequenceIterator.getDeliveredSamplesCount() << " samples, " << sequenceIterator.getSamplesPerSecond() << " samples/s, " << sequenceIterator.getFramesPerSecond() << " frames/s" << std::endl;
+		}
+		catch(std::exception& e) {
+			std::cerr << "Playback benchmark : " << e.what() << std::endl;
+			returnCode = 1;
+		}
+
+		if(!sequenceTempFolder.empty()) {
+			boost::system::error_code ec;
+			boost::filesystem::remove_all(sequenceTempFolder, ec);
+		}
+
+		return(returnCode);
+	}
+
+	int Application::benchmarkWriters(std::vector<std::string> folders) {
+		Settings::loadFromFile(Settings::getDefaultFilePath());
+		int returnCode = 0;
+
+		std::vector<boost::filesystem::path> targetDirectories;
+
+		for(int i = 0; i < folders.size(); i++)
+			targetDirectories.push_back(folders.at(i));
+
+		// the same number of threads and the same settings as a recording (see operations::SequenceRecording)
+		operations::WriterBenchmark writerBenchmark(targetDirectories, (int)Settings::getInt("recording.writing_threads", 4));
+		std::vector<std::string> backends;
+		backends.push_back("buffered");
+#ifdef KOCCA_WITH_IO_URING
+		backends.push_back("io_uring");
+#endif
+
+		for(int i = 0; i < backends.size(); i++) {
+			datalib::FrameFileWriter* frameFileWriter = datalib::FrameFileWriter::create(backends.at(i), Settings::getBool("recording.direct_io", false), (int)Settings::getInt("recording.fsync_batch", 0));
+
+			try {
+				// long enough to outlast the disks' caches, although the buffered writes still in the page cache count as written unless "recording.fsync_batch" is set
+				writerBenchmark.run(frameFileWriter, 20000);
+				std::cout << "Writer benchmark (" << frameFileWriter->getName() << ", " << folders.size() << " folder(s)) : " << writerBenchmark.getWrittenFilesCount() << " files, " << writerBenchmark.getWriteThroughput() << " MB/s, latency p50 " << writerBenchmark.getLatencyPercentile(0.5) << " ms, p99 " << writerBenchmark.getLatencyPercentile(0.99) << " ms, max " << writerBenchmark.getMaxLatency() << " ms" << std::endl;
+			}
+			catch(std::exception& e) {
+				std::cerr << "Writer benchmark (" << frameFileWriter->getName() << ") : " << e.what() << std::endl;
+				returnCode = 1;
+			}
+
+			delete frameFileWriter;
+		}
+
+		return(returnCode);
+	}
+
 	Application::~Application() {
 		delete gtkApplication;
 		kinect.stop();
+
+		if(recordingPreflightThread != NULL) {
+			cancelRecordingPreflight();
+
+			if(recordingPreflightThread->joinable())
+				recordingPreflightThread->join();
+
+			delete recordingPreflightThread;
+		}
+
+		if(folderReclaimer != NULL)
+			delete folderReclaimer;
+
 		singletonInstanciated = false;
 	}
 	
@@ -300,6 +443,9 @@ namespace kocca {
 			kinect.stop();
 		else if(!previousUsesKinect && newUsesKinect)
 			kinect.setUp();
+
+		updateMonitorFrameGeometry();
+		updateReadingDisplaySizes();
 	}
 
 	void Application::onCurrentOperationColorImageFrameOutputThread(datalib::TimeCodedFrame* tcFrame) {
@@ -307,13 +453,15 @@ namespace kocca {
 			mainWindow->kinectRGBStreamThumbnail->setNextFrame((*tcFrame).frame);
 
 			if(monitoredKinectStream == KINECT_STREAM_TYPE_RGB) {
-				mainWindow->monitor->setNextFrame((*tcFrame).frame);
+				mainWindow->monitor->setNextFrame((*tcFrame).frame, (*tcFrame).downscale);
 			
 				if (currentOperation->type == operations::KOCCA_READING_OPERATION)
-					mainWindow->setMonitorFrameTime((*tcFrame).time);
+					mainWindow->setMonitorFrameTime((*tcFrame).time, ((operations::SequenceReading*)currentOperation)->getPlaybackStatus(operations::PLAYBACK_STREAM_COLOR));
 				else
-					if (currentOperation->type == operations::KOCCA_RECORDING_OPERATION)
-						mainWindow->monitor->setRecordingTime((*tcFrame).time);
+					if (currentOperation->type == operations::KOCCA_RECORDING_OPERATION) {
+						mainWindow->monitor->setRecordingTime((*tcFrame).time / 1000);
+						mainWindow->monitor->setRemainingRecordingTime(((operations::SequenceRecording*)currentOperation)->getStatistics()->getEstimate().remainingTime);
+					}
 			}
 		}
 		catch(EmptyFrameException& e) {
@@ -332,10 +480,10 @@ namespace kocca {
 			mainWindow->kinectInfraredStreamThumbnail->setNextFrame((*tcFrame).frame);
 
 			if (monitoredKinectStream == KINECT_STREAM_TYPE_INFRARED) {
-				mainWindow->monitor->setNextFrame((*tcFrame).frame);
+				mainWindow->monitor->setNextFrame((*tcFrame).frame, (*tcFrame).downscale);
 
 				if (currentOperation->type == operations::KOCCA_READING_OPERATION)
-					mainWindow->setMonitorFrameTime((*tcFrame).time);
+					mainWindow->setMonitorFrameTime((*tcFrame).time, ((operations::SequenceReading*)currentOperation)->getPlaybackStatus(operations::PLAYBACK_STREAM_INFRARED));
 			}
 		}
 		catch (EmptyFrameException& e) {
@@ -351,14 +499,16 @@ namespace kocca {
 
 	void Application::onCurrentOperationDepthFrameOutputThread(datalib::TimeCodedFrame* tcFrame) {
 		try {
-			cv::normalize((*tcFrame).frame, (*tcFrame).frame, 65535, 0, cv::NORM_MINMAX);
-			mainWindow->kinectDepthStreamThumbnail->setNextFrame((*tcFrame).frame);
+			// the frame data is shared with the operation (and may be being recorded) : it is normalized into a new frame
+			cv::Mat displayFrame;
+			cv::normalize((*tcFrame).frame, displayFrame, 65535, 0, cv::NORM_MINMAX);
+			mainWindow->kinectDepthStreamThumbnail->setNextFrame(displayFrame);
 
 			if (monitoredKinectStream == KINECT_STREAM_TYPE_DEPTH) {
-				mainWindow->monitor->setNextFrame((*tcFrame).frame);
+				mainWindow->monitor->setNextFrame(displayFrame, (*tcFrame).downscale);
 			
 				if((currentOperation != NULL) && (currentOperation->type == operations::KOCCA_READING_OPERATION))
-					mainWindow->setMonitorFrameTime((*tcFrame).time);
+					mainWindow->setMonitorFrameTime((*tcFrame).time, ((operations::SequenceReading*)currentOperation)->getPlaybackStatus(operations::PLAYBACK_STREAM_DEPTH));
 			}
 		}
 		catch(EmptyFrameException& e) {
@@ -491,7 +641,10 @@ namespace kocca {
 
 	// callback function called when data is received from the NatNet Server (Motive)
 	void __cdecl Application::onNatNetData(sFrameOfMocapData* data, void* pUserData) {
-		unsigned long long sysTime = getMSTime();
+		unsigned long long arrivalTime = getUSTime();
+
+		// fTimestamp is in seconds, and fLatency is the delay (in seconds too) between the capture and the sending of the frame by the server
+		unsigned long long captureTime = (data != NULL) ? natNetClockSynchronizer.synchronize(data->fTimestamp * 1000000.0, arrivalTime, data->fLatency * 1000000.0) : arrivalTime;
 		currentOperation_mutex.lock();
 
 		if ((natNetClient != NULL) && (data != NULL) && (currentOperation != NULL) && (currentOperation->type != kocca::operations::KOCCA_READING_OPERATION) && (currentOperation->type != kocca::operations::KOCCA_CALIBRATION_OPERATION)) {
@@ -500,10 +653,7 @@ namespace kocca {
 			if (natNetMarkerNames.empty())
 				updateNatNetMarkersNames();
 
-			// @TODO : utiliser plutot le temps de la frame : data->fTimestamp
-			// -> multiplier par 1000 pour convertir en ms
-			// -> puis appliquer correction de latence mesuree lorsque cette mesure sera implementee
-			datalib::MocapMarkerFrame markerFrame(sysTime);
+			datalib::MocapMarkerFrame markerFrame(captureTime);
 
 			bool allFound = false;
 
@@ -601,6 +751,7 @@ namespace kocca {
 
 			if(natNetServerDescription.HostPresent)
 			{
+				natNetClockSynchronizer.reset();
 				natNetClient->SetDataCallback(onNatNetData);
 				mainWindow->set_natnet_is_connected(true);
 				updateNatNetMarkersNames();
@@ -625,7 +776,7 @@ namespace kocca {
 
 	void Application::activateMonitoring() {
 		connectNatNetClient(false);
- 		operations::Monitoring* newOperation = new operations::Monitoring();
+ 		operations::Monitoring* newOperation = new operations::Monitoring(preRollBuffer);
 		newOperation->onColorImageFrameOutput = onCurrentOperationColorImageFrameOutput;
 		newOperation->onIRImageFrameOutput = onCurrentOperationIRImageFrameOutput;
 		newOperation->onDepthFrameOutput = onCurrentOperationDepthFrameOutput;
@@ -633,6 +784,11 @@ namespace kocca {
 
 		try {
 			setCurrentOperation(newOperation);
+
+			// the previous operation (and the pre-roll of its recording, if any) is over : the pre-roll can start again
+			if(preRollBuffer != NULL)
+				preRollBuffer->clear();
+
 			mainWindow->enableMonitoringWidgets();
 			updateSaveButton();
 		}
@@ -1022,17 +1178,91 @@ namespace kocca {
 		}
 	}
 
+	void Application::runRecordingPreflight() {
+		std::string archiveFolder = Settings::getString("recording.archive_folder");
+
+		// the sequences temp folders are cleared and recovered by name, the benchmark folder must stay out of them
+		boost::filesystem::path benchmarkDirectory = archiveFolder.empty() ? (baseTempFolder.parent_path() / (baseTempFolder.filename().string() + "_recording_preflight")) : (boost::filesystem::path(archiveFolder) / "recording_preflight");
+		operations::RecordingPreflight preflight(benchmarkDirectory);
+
+		recordingPreflight_mutex.lock();
+		recordingPreflight = &preflight;
+		recordingPreflight_mutex.unlock();
+
+		try {
+			preflight.run((unsigned long long)Settings::getInt("recording.preflight_duration", 2000));
+		}
+		catch(std::exception& e) {
+			std::cerr << "Recording preflight error : " << e.what() << std::endl;
+		}
+
+		recordingPreflight_mutex.lock();
+		recordingPreflight = NULL;
+		recordingPreflight_mutex.unlock();
+
+		// a benchmark cancelled by a take measured nothing meaningful
+		if(preflight.isCancelled() || (preflight.getSustainableFrameRate() == 0))
+			return;
+
+		try {
+			if(Settings::getBool("debug.statistics_logs", false))
+				std::cout << preflight.getReport() << std::endl;
+
+			recordingPreflightThroughput = preflight.getWriteThroughput();
+
+			if(!preflight.isSustainable()) {
+				std::ostringstream message;
+				message << "WARNING : the recording disk and the writing threads can't keep up with the Kinect streams at the current recording settings (" << (int)preflight.getSustainableFrameRate()
+					<< " frames per second out of " << operations::RecordingPreflight::SENSOR_FRAME_RATE << ").\nTakes will stop when the recording buffers are full : lower the JPEG quality, set recording profiles or record to a faster disk.";
+				infoMessageBox(message.str());
+			}
+			else if(preflight.getRecordingTime() < Settings::getDouble("recording.disk_warning_time", 300)) {
+				std::ostringstream message;
+				message << "WARNING : the recording disk is almost full : about " << (int)preflight.getRecordingTime() << " seconds of recording left (" << (preflight.getFreeSpace() / 1000000) << " MB free).";
+				infoMessageBox(message.str());
+			}
+		}
+		catch(std::exception& e) {
+			std::cerr << "Recording preflight error : " << e.what() << std::endl;
+		}
+	}
+
+	void Application::cancelRecordingPreflight() {
+		recordingPreflight_mutex.lock();
+
+		if(recordingPreflight != NULL)
+			recordingPreflight->cancel();
+
+		recordingPreflight_mutex.unlock();
+	}
+
+	void Application::onRecordingWarning(std::string message) {
+		infoMessageBox(std::string("WARNING : ") + message);
+	}
+
 	void Application::startRecording() {
 		addWaitMessage("Preparing temp folder for recording ...", &preparingRecordMsgLabel);
 	
 		try {
+			// the preflight benchmark must not compete with the recording for the disk : it is cancelled, without waiting for it
+			cancelRecordingPreflight();
+
 			if(currentLoadedSequence != NULL)
 				delete currentLoadedSequence;
 
 			currentLoadedSequence = new datalib::Sequence();
+
+			// if an archive folder is set, the sequence is recorded straight into a .ksa archive, without any temp folder nor export step
+			std::string archiveFolder = Settings::getString("recording.archive_folder");
+			boost::filesystem::path archiveFilePath;
+
+			// a take recorded into an archive only uses its temp folder if the archive reaches the 4 GB limit of .ksa files
 			boost::filesystem::path sequenceTempFolder = getNewSequenceTempFolder();
 			currentLoadedSequence->setRootDirectory(sequenceTempFolder.string().c_str());
 
+			if(!archiveFolder.empty())
+				archiveFilePath = getNewSequenceArchivePath(archiveFolder);
+
 			if(intrinsicIRCalibRes != NULL)
 				currentLoadedSequence->setIntrinsicIRCalibrationParameters(*intrinsicIRCalibRes);
 
@@ -1045,13 +1275,21 @@ namespace kocca {
 			if(extrinsicRGBCalibRes != NULL)
 				currentLoadedSequence->setExtrinsicRGBCalibrationParameters(*extrinsicRGBCalibRes);
 
-			operations::SequenceRecording* newRecordingOperation = new operations::SequenceRecording(currentLoadedSequence);
+			// the pre-roll is only filled while monitoring
+			currentOperation_mutex.lock();
+			operations::PreRollBuffer* recordingPreRollBuffer = ((currentOperation != NULL) && (currentOperation->type == operations::KOCCA_MONITORING_OPERATION)) ? preRollBuffer : NULL;
+			currentOperation_mutex.unlock();
+
+			operations::SequenceRecording* newRecordingOperation = new operations::SequenceRecording(currentLoadedSequence, archiveFilePath, 1500000000, 4, folderReclaimer);
 			newRecordingOperation->onColorImageFrameOutput = onCurrentOperationColorImageFrameOutput;
 			newRecordingOperation->onIRImageFrameOutput = onCurrentOperationIRImageFrameOutput;
 			newRecordingOperation->onDepthFrameOutput = onCurrentOperationDepthFrameOutput;
 			newRecordingOperation->onMarkersFrameOutput = onCurrentOperationMarkerFrameOutput;
+			newRecordingOperation->onWarning = onRecordingWarning;
+			newRecordingOperation->getStatistics()->setClockSynchronizers(kinect.getClockSynchronizer(), &natNetClockSynchronizer);
+			newRecordingOperation->getStatistics()->setBenchmarkThroughput(recordingPreflightThroughput);
 			setCurrentOperation(newRecordingOperation);
-			newRecordingOperation->startRecording();
+			newRecordingOperation->startRecording(recordingPreRollBuffer);
 			mainWindow->monitor->enterRecordingMode();
 			mainWindow->stopButton->set_sensitive(true); // @TODO: deplacer dans MainWindow avec dispatcher
 		}
@@ -1081,11 +1319,12 @@ namespace kocca {
 	}
 
 	void Application::onCurrentOperationChangePlayheadPosition(unsigned long long position) {
-		mainWindow->set_playhead_position(position);
+		// the sequence time is in microseconds, but the UI works in milliseconds
+		mainWindow->set_playhead_position(position / 1000);
 	}
 
 	void Application::onCurrentOperationUpdateBufferEndingPoint(unsigned long long endingPoint) {
-		mainWindow->setBufferEndingPoint(endingPoint);
+		mainWindow->setBufferEndingPoint(endingPoint / 1000);
 	}
 
 	void Application::onCurrentOperationStopAtTheEnd() {
@@ -1107,7 +1346,7 @@ namespace kocca {
 		newReadingOperation->onChangePlayheadPosition = onCurrentOperationChangePlayheadPosition;
 		newReadingOperation->onUpdateBufferEndingPoint = onCurrentOperationUpdateBufferEndingPoint;
 		newReadingOperation->onStopAtTheEnd = onCurrentOperationStopAtTheEnd;
-		mainWindow->enableSequenceReadingWidgets(currentLoadedSequence->getDuration());
+		mainWindow->enableSequenceReadingWidgets(currentLoadedSequence->getDuration() / 1000);
 		newReadingOperation->setPlayHeadPosition(0);
 		updateSaveButton();
 		setMonitoredKinectStream(KINECT_STREAM_TYPE_RGB);
@@ -1203,6 +1442,39 @@ namespace kocca {
  		removeWaitMessage(&loadingSequenceDataMsgLabel);
 	}
 
+	void Application::openSequenceFromArchive(std::string ksaFileName, boost::filesystem::path sequenceTempFolderPath) {
+		addWaitMessage("Loading sequence data ...", &loadingSequenceDataMsgLabel);
+		datalib::TaskProgress* loadProgress = new datalib::TaskProgress();
+		loadProgress->onSetProgress = onUpdateProgress;
+
+		try {
+			datalib::Sequence* newSequence = new datalib::Sequence();
+
+			try {
+				newSequence->setRootDirectory(sequenceTempFolderPath.string().c_str());
+				newSequence->readDataFromArchive(ksaFileName, loadProgress);
+			}
+			catch(std::exception& e) {
+				// the sequence won't be handed to onSequenceLoaded()
+				delete newSequence;
+				throw;
+			}
+
+			mainWindow->waitMsgPopup->hideProgress();
+			onSequenceLoaded(newSequence);
+		}
+		catch(std::exception& e) {
+			mainWindow->waitMsgPopup->hideProgress();
+			std::ostringstream errorMessage;
+			errorMessage << "Error trying to open sequence : " << e.what() << std::endl;
+			errorMessageBox(errorMessage.str());
+			activateMonitoring();
+		}
+
+		delete loadProgress;
+		removeWaitMessage(&loadingSequenceDataMsgLabel);
+	}
+
 	void Application::unZipSequence(std::string ksaFileName) {
 		addWaitMessage("Unarchiving sequence files to temp folder ...", &unzippingSequenceFileMsgLabel);
 		
@@ -1219,6 +1491,13 @@ namespace kocca {
 				errorMessageBox(e.what());
 			}
 
+			// only the central directory of the archive is read : the first frame is shown right away, whatever the size of the sequence
+			if(Settings::getBool("playback.read_archives_in_place", true)) {
+				removeWaitMessage(&unzippingSequenceFileMsgLabel);
+				openSequenceFromArchive(ksaFileName, sequenceTempFolder);
+				return;
+			}
+
 			try {
 				datalib::SequenceFile sequenceFile(ksaFileName.c_str());
 				datalib::TaskProgress* unzipProgress = new datalib::TaskProgress();
@@ -1297,17 +1576,15 @@ namespace kocca {
 				mainWindow->mocapMarkersListView->clear_items();
 
 				if (currentLoadedSequence != NULL) {
-					boost::filesystem::path sequenceTempFolder = currentLoadedSequence->getRootDirectory();
-
-					delete currentLoadedSequence;
-					currentLoadedSequence = NULL;
-
 					try {
-						boost::filesystem::remove_all(sequenceTempFolder);
+						reclaimSequenceFolders(currentLoadedSequence);
 					}
 					catch (std::exception& e) {
 						errorMessageBox(e.what());
 					}
+
+					delete currentLoadedSequence;
+					currentLoadedSequence = NULL;
 				}
 
 				hasUnsavedSequence = false;
@@ -1324,15 +1601,45 @@ namespace kocca {
 		addWaitMessage("Finishing writing sequence data to disk ...", &writingSequenceDataMsgLabel);
 		currentOperation_mutex.lock();
 
+		operations::SequenceRecording* recordingOperation = (operations::SequenceRecording*)currentOperation;
+		bool archiveCompleted = false;
+		bool takeIsLost = false;
+
 		try {
-			((operations::SequenceRecording*)currentOperation)->stop();
+			recordingOperation->stop();
+			archiveCompleted = true;
 		}
 		catch(std::exception& e) {
-			errorMessageBox(e.what());
+			std::ostringstream errorMessage;
+			errorMessage << e.what();
+
+			// an archive that couldn't be completed can't be read : its frames are recovered into the temp folder instead
+			if(!recordingOperation->getArchiveFilePath().empty()) {
+				try {
+					int recoveredFramesCount = recordingOperation->recoverArchivedTake();
+					errorMessage << std::endl << recoveredFramesCount << " frames of the take have been recovered into the temp folder : the sequence must be exported.";
+				}
+				catch(std::exception& re) {
+					// once the frames are out of the archive, the take is kept even if its calibration or markers data couldn't be written
+					takeIsLost = !recordingOperation->getArchiveFilePath().empty();
+
+					if(takeIsLost)
+						errorMessage << std::endl << "The take couldn't be recovered, and is lost : " << re.what();
+					else
+						errorMessage << std::endl << "The frames of the take have been recovered into the temp folder, but not all of its data : " << re.what();
+				}
+			}
+
+			errorMessageBox(errorMessage.str());
 		}
 
+		// a take whose archive filled up went on as loose files in its temp folder, and must be exported like one
+		std::string archiveFilePath = recordingOperation->getArchiveFilePath();
+		bool recordedToArchive = !archiveFilePath.empty() || takeIsLost;
+		archiveCompleted = archiveCompleted && recordedToArchive;
+
 		mainWindow->monitor->exitRecordingMode();
-		hasUnsavedSequence = true;
+		hasUnsavedSequence = !archiveCompleted && !takeIsLost;
 		currentOperation_mutex.unlock();
 		mainWindow->stopButton->set_sensitive(false);// @TODO : deplacer dans mainwindow avec dispatcher
 
@@ -1343,9 +1650,32 @@ namespace kocca {
 			errorMessageBox(e.what());
 		}
 
-		std::thread readCurrentLoadedSequenceThread(Application::readCurrentLoadedSequence);
-		readCurrentLoadedSequenceThread.detach();
-		removeWaitMessage(&writingSequenceDataMsgLabel);
+		if(recordedToArchive) {
+			// the sequence is already saved in its archive : we go straight back to monitoring
+			mainWindow->disableAllWidgets();
+			activateMonitoring();
+
+			// the temp folder of the take has never been used, or holds nothing that can be read
+			if(archiveCompleted || takeIsLost) {
+				boost::system::error_code ec;
+				boost::filesystem::remove_all(currentLoadedSequence->getRootDirectory(), ec);
+			}
+
+			delete currentLoadedSequence;
+			currentLoadedSequence = NULL;
+			removeWaitMessage(&writingSequenceDataMsgLabel);
+
+			if(archiveCompleted) {
+				std::ostringstream infoMessage;
+				infoMessage << "Sequence succesfully recorded to " << archiveFilePath;
+				infoMessageBox(infoMessage.str());
+			}
+		}
+		else {
+			std::thread readCurrentLoadedSequenceThread(Application::readCurrentLoadedSequence);
+			readCurrentLoadedSequenceThread.detach();
+			removeWaitMessage(&writingSequenceDataMsgLabel);
+		}
 	}
 
 	void Application::onClickStopButton() {
@@ -1387,7 +1717,7 @@ namespace kocca {
 		currentOperation_mutex.lock();
 
 		if((currentOperation != NULL) && (currentOperation->type == operations::KOCCA_READING_OPERATION))
-			((operations::SequenceReading*)currentOperation)->setPlayHeadPosition(new_value);
+			((operations::SequenceReading*)currentOperation)->seek((unsigned long long)(new_value * 1000.0));
 		
 		currentOperation_mutex.unlock();
 		return true;
@@ -1481,6 +1811,29 @@ namespace kocca {
 				for(boost::filesystem::directory_iterator i(depthFramesDirectory); i != end; ++i)
 					if(boost::filesystem::is_regular_file(i->path()))
 						return true;
+
+			// browse the directories where the streams may have been recorded outside of the folder
+			kocca::datalib::Sequence sequence;
+			sequence.setRootDirectory(folderPath);
+
+			try {
+				sequence.readMetadata();
+			}
+			catch(std::exception& e) {
+				return false;
+			}
+
+			for(int i = 0; i < datalib::Sequence::IMAGE_STREAMS_COUNT; i++) {
+				std::vector<boost::filesystem::path> streamDirectories = sequence.getMetadata()->getStreamDirectories(datalib::Sequence::STREAM_FOLDER_NAMES[i]);
+
+				for(int j = 0; j < streamDirectories.size(); j++)
+					if(boost::filesystem::exists(streamDirectories.at(j)) && boost::filesystem::is_directory(streamDirectories.at(j)))
+						for(boost::filesystem::directory_iterator k(streamDirectories.at(j)); k != end; ++k)
+							if(boost::filesystem::is_regular_file(k->path()))
+								return true;
+			}
+
+			return false;
 		}
 		else
 			return false;
@@ -1492,7 +1845,7 @@ namespace kocca {
 			std::vector<boost::filesystem::path> tempChilds;
 
 			for(boost::filesystem::directory_iterator i(baseTempFolder); i != end; ++i) {
-				if(!pidIsARunningKoccaInstance(getPIDFromTempFolderPath(i->path())) && folderContainsSequenceData(i->path()))
+				if(!FolderReclaimer::isReclaimedFolder(i->path()) && !pidIsARunningKoccaInstance(getPIDFromTempFolderPath(i->path())) && folderContainsSequenceData(i->path()))
 					return i->path();
 			}
 		}
@@ -1565,7 +1918,7 @@ namespace kocca {
 			std::vector<boost::filesystem::path> tempChilds;
 
 			for(boost::filesystem::directory_iterator i(baseTempFolder); i != end; ++i) {
-				if(!pidIsARunningKoccaInstance(getPIDFromTempFolderPath(i->path())) && folderContainsSequenceData(i->path()))
+				if(!FolderReclaimer::isReclaimedFolder(i->path()) && !pidIsARunningKoccaInstance(getPIDFromTempFolderPath(i->path())) && folderContainsSequenceData(i->path()))
 					return true;
 			}
 		}
@@ -1580,7 +1933,30 @@ namespace kocca {
 				std::vector<boost::filesystem::path> tempChilds;
 
 				for(boost::filesystem::directory_iterator i(baseTempFolder); i != end; ++i)
-					boost::filesystem::remove_all(i->path());
+					tempChilds.push_back(i->path());
+
+				for(int i = 0; i < tempChilds.size(); i++) {
+					// already queued for deletion
+					if(FolderReclaimer::isReclaimedFolder(tempChilds.at(i)))
+						continue;
+
+					if(boost::filesystem::is_directory(tempChilds.at(i))) {
+						// the streams of the sequence may have been recorded outside of its temp folder
+						kocca::datalib::Sequence sequence;
+						sequence.setRootDirectory(tempChilds.at(i));
+
+						try {
+							sequence.readMetadata();
+						}
+						catch(std::exception& e) {
+							// the metadata can't be read, so there's nothing more than the temp folder to remove
+						}
+
+						reclaimSequenceFolders(&sequence);
+					}
+					else
+						boost::filesystem::remove(tempChilds.at(i));
+				}
 			}
 			else
 				throw TempFolderNotAvailableException("path is not a valid directory");
@@ -1589,9 +1965,23 @@ namespace kocca {
 			throw TempFolderNotAvailableException("path does not exists");
 	}
 
-	void Application::onKinectColorImageThread(cv::Mat* pFrame) {
-		unsigned long long time = getMSTime();
+	void Application::reclaimSequenceFolders(datalib::Sequence* sequence) {
+		for(int i = 0; i < datalib::Sequence::IMAGE_STREAMS_COUNT; i++) {
+			std::vector<boost::filesystem::path> streamDirectories = sequence->getMetadata()->getStreamDirectories(datalib::Sequence::STREAM_FOLDER_NAMES[i]);
+
+			// the parent folder of a stream folder recorded outside of the temp folder was created for this sequence only
+			for(int j = 0; j < streamDirectories.size(); j++)
+				folderReclaimer->reclaim(streamDirectories.at(j).parent_path());
+		}
+
+		// the folders that couldn't be renamed aside are deleted right away
+		sequence->removeExternalStreamDirectories();
 
+		if(!folderReclaimer->reclaim(sequence->getRootDirectory()))
+			boost::filesystem::remove_all(sequence->getRootDirectory());
+	}
+
+	void Application::onKinectColorImageThread(cv::Mat* pFrame, unsigned long long time) {
 		// adjust image brightness and contrats
 		double brightnessScaleValue = mainWindow->rgbBrightnessScale->get_value();
 		double brightnessAdjustment = brightnessScaleValue * 2.55;
@@ -1630,9 +2020,7 @@ namespace kocca {
 		delete pFrame;
 	}
 
-	void Application::onKinectIRImageThread(cv::Mat* pFrame) {
-		unsigned long long time = getMSTime();
-
+	void Application::onKinectIRImageThread(cv::Mat* pFrame, unsigned long long time) {
 		// adjust image brightness and contrast
 		double brightnessScaleValue = mainWindow->irBrightnessScale->get_value();
 		double brightnessAdjustment = brightnessScaleValue * 655.35;
@@ -1671,9 +2059,7 @@ namespace kocca {
 		delete pFrame;
 	}
 
-	void Application::onKinectDepthImageThread(cv::Mat* pFrame) {
-		unsigned long long time = getMSTime();
-
+	void Application::onKinectDepthImageThread(cv::Mat* pFrame, unsigned long long time) {
 		datalib::TimeCodedFrame tcFrame;
 		tcFrame.frame = *pFrame;
 		tcFrame.time = time;
@@ -1701,16 +2087,16 @@ namespace kocca {
 		delete pFrame;
 	}
 
-	void  Application::onKinectColorImage(cv::Mat frame) {
-		new std::thread(&Application::onKinectColorImageThread, new cv::Mat(frame));
+	void  Application::onKinectColorImage(cv::Mat frame, unsigned long long time) {
+		new std::thread(&Application::onKinectColorImageThread, new cv::Mat(frame), time);
 	}
 
-	void Application::onKinectIRImage(cv::Mat frame) {
-		new std::thread(&Application::onKinectIRImageThread, new cv::Mat(frame));
+	void Application::onKinectIRImage(cv::Mat frame, unsigned long long time) {
+		new std::thread(&Application::onKinectIRImageThread, new cv::Mat(frame), time);
 	}
 
-	void  Application::onKinectDepthImage(cv::Mat frame) {
-		new std::thread(&Application::onKinectDepthImageThread, new cv::Mat(frame));
+	void  Application::onKinectDepthImage(cv::Mat frame, unsigned long long time) {
+		new std::thread(&Application::onKinectDepthImageThread, new cv::Mat(frame), time);
 	}
 
 	bool Application::onShowMainWindow(_GdkEventAny* event) {
@@ -1724,9 +2110,7 @@ namespace kocca {
 					boost::filesystem::path oldSequenceTempFolderPath = getFirstTempFolderWithRecoverableSequenceData();
 
 					// rename sequence's temp folder to attach it to current process
-					std::ostringstream newFolderName;
-					newFolderName << getProcessID() << "_" << getMSTime();
-					boost::filesystem::path newSequenceTempFolderPath = baseTempFolder / newFolderName.str();
+					boost::filesystem::path newSequenceTempFolderPath = baseTempFolder / getNewSequenceTempFolderName();
 					boost::filesystem::rename(oldSequenceTempFolderPath, newSequenceTempFolderPath);
 
 					std::thread openUnzippedSequenceFromDirectoryThread(Application::openUnzippedSequenceFromDirectory, newSequenceTempFolderPath);
@@ -1855,6 +2239,39 @@ namespace kocca {
 			currentOperation_mutex.unlock();
 	}
 
+	void Application::onMainWindowPlusShortcut() {
+		currentOperation_mutex.lock();
+
+		if ((currentOperation != NULL) && (currentOperation->type == operations::KOCCA_READING_OPERATION)) {
+			operations::SequenceReading* readingOperation = (operations::SequenceReading*)currentOperation;
+			readingOperation->stepPlaybackRate(true);
+		}
+
+		currentOperation_mutex.unlock();
+	}
+
+	void Application::onMainWindowMinusShortcut() {
+		currentOperation_mutex.lock();
+
+		if ((currentOperation != NULL) && (currentOperation->type == operations::KOCCA_READING_OPERATION)) {
+			operations::SequenceReading* readingOperation = (operations::SequenceReading*)currentOperation;
+			readingOperation->stepPlaybackRate(false);
+		}
+
+		currentOperation_mutex.unlock();
+	}
+
+	void Application::onMainWindowRShortcut() {
+		currentOperation_mutex.lock();
+
+		if ((currentOperation != NULL) && (currentOperation->type == operations::KOCCA_READING_OPERATION)) {
+			operations::SequenceReading* readingOperation = (operations::SequenceReading*)currentOperation;
+			readingOperation->setPlaybackRate(-readingOperation->getPlaybackRate());
+		}
+
+		currentOperation_mutex.unlock();
+	}
+
 	bool Application::onCloseMainWindow(GdkEventAny* event) {
 		if(hasUnsavedSequence || hasUnsavedCalibration) {
 			Gtk::MessageDialog confirmPopup(*mainWindow, "WARNING : you have unsaved data (calibration and/or sequence) !\n If you quit KOCCA now, all unsaved data will be lost", false, Gtk::MESSAGE_QUESTION, Gtk::BUTTONS_OK_CANCEL);
@@ -1863,7 +2280,7 @@ namespace kocca {
 			if(confirmPopup.run() == Gtk::RESPONSE_OK) {
 				if(hasUnsavedSequence && (currentLoadedSequence != NULL)) {
 					try {
-						boost::filesystem::remove_all(currentLoadedSequence->getRootDirectory());
+						reclaimSequenceFolders(currentLoadedSequence);
 					}
 					catch(std::exception& e) {
 						errorMessageBox(e.what());
@@ -1884,14 +2301,18 @@ namespace kocca {
 		return GetCurrentProcessId();
 	}
 
+	std::string Application::getNewSequenceTempFolderName() {
+		std::ostringstream newFolderName;
+		newFolderName << getProcessID() << "_" << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		return(newFolderName.str());
+	}
+
 	boost::filesystem::path Application::getNewSequenceTempFolder() {
 		boost::filesystem::path newFolderPath;
 		bool created = false;
 
 		while(!created) {
-			std::ostringstream newFolderName;
-			newFolderName << getProcessID() << "_" << getMSTime();
-			newFolderPath = baseTempFolder / newFolderName.str();
+			newFolderPath = baseTempFolder / getNewSequenceTempFolderName();
 
 			if(!boost::filesystem::exists(newFolderPath)) {
 				if(boost::filesystem::create_directory(newFolderPath))
@@ -1907,6 +2328,85 @@ namespace kocca {
 		return newFolderPath;
 	}
 
+	/**
+	 * @throws FileArchivingException
+	 */
+	boost::filesystem::path Application::getNewSequenceArchivePath(boost::filesystem::path archiveFolder) {
+		if(!boost::filesystem::exists(archiveFolder)) {
+			boost::system::error_code ec;
+			boost::filesystem::create_directories(archiveFolder, ec);
+
+			if(ec) {
+				std::ostringstream errorMessage;
+				errorMessage << "Failed to create recording archive folder " << archiveFolder.string() << " : " << ec.message();
+				throw FileArchivingException(errorMessage.str().c_str());
+			}
+		}
+
+		char dateTime[32];
+		time_t now = time(NULL);
+		strftime(dateTime, sizeof(dateTime), "%Y-%m-%d_%H-%M-%S", localtime(&now));
+
+		boost::filesystem::path newArchivePath = archiveFolder / (std::string("KOCCA_") + dateTime + ".ksa");
+
+		for(int i = 2; boost::filesystem::exists(newArchivePath); i++) {
+			std::ostringstream newArchiveName;
+			newArchiveName << "KOCCA_" << dateTime << "_" << i << ".ksa";
+			newArchivePath = archiveFolder / newArchiveName.str();
+		}
+
+		return(newArchivePath);
+	}
+
+	void Application::updateMonitorFrameGeometry() {
+		datalib::StreamProfile frameGeometry;
+		cv::Size sensorFrameSize = (monitoredKinectStream == KINECT_STREAM_TYPE_RGB) ? cv::Size(KinectV2Sensor::RGB_FRAME_WIDTH, KinectV2Sensor::RGB_FRAME_HEIGHT) : cv::Size(KinectV2Sensor::DEPTH_FRAME_WIDTH, KinectV2Sensor::DEPTH_FRAME_HEIGHT);
+
+		currentOperation_mutex.lock();
+		bool isReading = (currentOperation != NULL) && (currentOperation->type == operations::KOCCA_READING_OPERATION);
+		currentOperation_mutex.unlock();
+
+		if(isReading && (currentLoadedSequence != NULL)) {
+			if(monitoredKinectStream == KINECT_STREAM_TYPE_RGB)
+				frameGeometry = datalib::StreamProfile::fromMetadata(currentLoadedSequence->getMetadata(), "image");
+			else if(monitoredKinectStream == KINECT_STREAM_TYPE_INFRARED)
+				frameGeometry = datalib::StreamProfile::fromMetadata(currentLoadedSequence->getMetadata(), "infrared");
+			else if(monitoredKinectStream == KINECT_STREAM_TYPE_DEPTH)
+				frameGeometry = datalib::StreamProfile::fromMetadata(currentLoadedSequence->getMetadata(), "depth");
+		}
+
+		mainWindow->monitor->setFrameGeometry(frameGeometry, sensorFrameSize);
+	}
+
+	void Application::updateReadingDisplaySizes() {
+		// indexed like operations::PlaybackStreamType
+		widgets::CvDrawingArea* thumbnails[operations::PLAYBACK_STREAMS_COUNT] = {mainWindow->kinectRGBStreamThumbnail, mainWindow->kinectInfraredStreamThumbnail, mainWindow->kinectDepthStreamThumbnail};
+		kinectStreamType streamTypes[operations::PLAYBACK_STREAMS_COUNT] = {KINECT_STREAM_TYPE_RGB, KINECT_STREAM_TYPE_INFRARED, KINECT_STREAM_TYPE_DEPTH};
+
+		currentOperation_mutex.lock();
+
+		if((currentOperation != NULL) && (currentOperation->type == operations::KOCCA_READING_OPERATION)) {
+			for(int i = 0; i < operations::PLAYBACK_STREAMS_COUNT; i++) {
+				int width = thumbnails[i]->get_allocated_width();
+				int height = thumbnails[i]->get_allocated_height();
+
+				// the frames of the monitored stream are shown in the "Monitor" widget too
+				if(monitoredKinectStream == streamTypes[i]) {
+					width = (mainWindow->monitor->get_allocated_width() > width) ? mainWindow->monitor->get_allocated_width() : width;
+					height = (mainWindow->monitor->get_allocated_height() > height) ? mainWindow->monitor->get_allocated_height() : height;
+				}
+
+				((operations::SequenceReading*)currentOperation)->setDisplaySize((operations::PlaybackStreamType)i, width, height);
+			}
+		}
+
+		currentOperation_mutex.unlock();
+	}
+
+	void Application::onDisplayWidgetSizeAllocate(Gtk::Allocation& allocation) {
+		updateReadingDisplaySizes();
+	}
+
 	void Application::setMonitoredKinectStream(kinectStreamType newMonitoredStream) {
 		monitoredKinectStream = newMonitoredStream;
 
@@ -1938,6 +2438,9 @@ namespace kocca {
 			mainWindow->monitor->setExtrinsicCalibrationParams(extrinsicIRCalibRes);
 		}
 
+		updateMonitorFrameGeometry();
+		updateReadingDisplaySizes();
+
 		currentOperation_mutex.lock();
 
 		if ((currentOperation != NULL) && (currentOperation->type == operations::KOCCA_READING_OPERATION) && !((operations::SequenceReading*)currentOperation)->isPlaying()) {
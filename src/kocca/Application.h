@@ -5,17 +5,22 @@
 
 #include <vector>
 #include <mutex>
+#include <thread>
 #include <atomic>
 #include <opencv2/opencv.hpp>
 #include <gtkmm/main.h>
 #include "NatNetClient.h"
 
 #include "KinectV2Sensor.h"
+#include "ClockSynchronizer.h"
+#include "FolderReclaimer.h"
 #include "widgets/MainWindow.h"
 #include "datalib/IntrinsicCalibrationParametersSet.h"
 #include "datalib/ExtrinsicCalibrationParametersSet.h"
 #include "datalib/Sequence.h"
 #include "operations/Operation.h"
+#include "operations/PreRollBuffer.h"
+#include "operations/RecordingPreflight.h"
 #include "datalib/MocapMarkerFrame.h"
 
 #include "boost/filesystem.hpp"
@@ -77,23 +82,40 @@ namespace kocca {
 		 */
 		static void run();
 
+		/**
+		 * Decodes all the frames of a sequence as fast as possible, without any user interface, and prints the decoding throughput (see datalib::SequenceIterator). Implementation of the "--benchmark-playback <sequence>" command line.
+		 * @param sequencePath the path of a .ksa archive, read in place, or of an unarchived sequence folder
+		 * @return 0 if the whole sequence was decoded, 1 otherwise
+		 */
+		static int benchmarkPlayback(std::string sequencePath);
+
+		/**
+		 * Benchmarks each frame files writer backend on the same folders, without any user interface, and prints its sustained write throughput and its write latencies (see operations::WriterBenchmark). The writers get the "recording.direct_io" and "recording.fsync_batch" settings, and as many threads as the writing pool starts with. Implementation of the "--benchmark-writers <folder> [<folder> ...]" command line.
+		 * @param folders the folders to write into, in turn (ex : one per disk, or the folders of a stream in "recording.<stream>_folders")
+		 * @return 0 if all the backends were benchmarked, 1 otherwise
+		 */
+		static int benchmarkWriters(std::vector<std::string> folders);
+
 		/**
 		 * Callback function triggered by the KinectV2Sensor instance in a separate thread, each time a frame is available from the color stream
 		 * @param frame the newly available color frame
+		 * @param time the capture time of the frame, on the local system clock, in microseconds
 		 */
-		static void onKinectColorImage(cv::Mat frame);
+		static void onKinectColorImage(cv::Mat frame, unsigned long long time);
 
 		/**
 		 * Callback function triggered by the KinectV2Sensor instance in a separate thread, each time a frame is available from the infrared stream
 		 * @param frame the newly available infrared frame
+		 * @param time the capture time of the frame, on the local system clock, in microseconds
 		 */
-		static void onKinectIRImage(cv::Mat frame);
+		static void onKinectIRImage(cv::Mat frame, unsigned long long time);
 
 		/**
 		 * Callback function triggered by the KinectV2Sensor instance in a separate thread, each time a frame is available from the depth stream
 		 * @param frame the newly available depth frame
+		 * @param time the capture time of the frame, on the local system clock, in microseconds
 		 */
-		static void onKinectDepthImage(cv::Mat frame);
+		static void onKinectDepthImage(cv::Mat frame, unsigned long long time);
 
 	private:
 
@@ -125,20 +147,23 @@ namespace kocca {
 		/**
 		 * Thread implementation used for each new thread that is created when the kinect object emits a color frame.
 		 * @param pFrame a pointer to the cv::Mat object corresponding to the new color frame.
+		 * @param time the capture time of the frame, on the local system clock, in microseconds
 		 */
-		static void onKinectColorImageThread(cv::Mat* pFrame);
+		static void onKinectColorImageThread(cv::Mat* pFrame, unsigned long long time);
 
 		/**
 		 * Thread implementation used for each new thread that is created when the kinect object emits an infrared frame.
 		 * @param pFrame a pointer to the cv::Mat object corresponding to the new infrared frame.
+		 * @param time the capture time of the frame, on the local system clock, in microseconds
 		 */
-		static void onKinectIRImageThread(cv::Mat* pFrame);
+		static void onKinectIRImageThread(cv::Mat* pFrame, unsigned long long time);
 
 		/**
 		 * Thread implementation used for each new thread that is created when the kinect object emits a depth frame.
 		 * @param pFrame a pointer to the cv::Mat object corresponding to the new depth frame.
+		 * @param time the capture time of the frame, on the local system clock, in microseconds
 		 */
-		static void onKinectDepthImageThread(cv::Mat* pFrame);
+		static void onKinectDepthImageThread(cv::Mat* pFrame, unsigned long long time);
 
 		/**
 		 * This will be set to true if a kinect sensor has actually been found and if it is available, false otherwise.
@@ -181,6 +206,37 @@ namespace kocca {
 		 */
 		static NatNetClient* natNetClient;
 
+		/**
+		 * Maps the timestamps of the NatNet frames (in the mocap system's clock) to the local system clock.
+		 */
+		static ClockSynchronizer natNetClockSynchronizer;
+
+		/**
+		 * The buffer where the frames received while monitoring are kept, so the next recording starts with the seconds before the record button was pressed (see "recording.preroll_duration"), or NULL if there's no pre-roll.
+		 */
+		static operations::PreRollBuffer* preRollBuffer;
+
+		/**
+		 * The reclaimer that deletes the folders of the closed sequences in the background, so closing a sequence or starting a recording never waits for their files to be deleted (see "recording.reclaim_rate").
+		 */
+		static FolderReclaimer* folderReclaimer;
+
+		/**
+		 * The thread that runs the recording preflight at startup (see runRecordingPreflight()), or NULL if it is disabled.
+		 */
+		static std::thread* recordingPreflightThread;
+
+		/**
+		 * The recording preflight while it runs, so it can be cancelled when a take starts, or NULL, and a lock to protect it from threads access conflicts.
+		 */
+		static operations::RecordingPreflight* recordingPreflight;
+		static std::mutex recordingPreflight_mutex;
+
+		/**
+		 * The write throughput measured by the recording preflight, in megabytes per second, or 0 if it hasn't run.
+		 */
+		static double recordingPreflightThroughput;
+
 		/**
 		 * NatNet markers names
 		 */
@@ -525,6 +581,23 @@ namespace kocca {
 		 */
 		static void onClickNatNetConnectButton();
 
+		/**
+		 * Runs a short benchmark of the disk the sequences are recorded to (the archive folder if one is set, the temp folder otherwise) at the current recording settings, and warns the user if it can't sustain the Kinect streams or if it is almost full. Implementation of the recordingPreflightThread.
+		 * The benchmark writes into a folder next to the temp folder rather than in it, so it is never taken for a sequence folder.
+		 */
+		static void runRecordingPreflight();
+
+		/**
+		 * Cancels the recording preflight if it is running, without waiting for it to end.
+		 */
+		static void cancelRecordingPreflight();
+
+		/**
+		 * Callback function triggered by the recording operation when the recording is likely to stop soon (see SequenceRecording::onWarning).
+		 * @param message the warning message
+		 */
+		static void onRecordingWarning(std::string message);
+
 		/**
 		 * Starts recording. It prepares the "temp" folder, creates a new "Sequence" object, creates a new "SequenceRecording" operation object, sets it as the currentOperation and tells it to start recording frames.
 		 */
@@ -542,13 +615,13 @@ namespace kocca {
 
 		/**
 		 * Callback function triggered during a sequence reading operation, each time the playhead moves.
-		 * @param position the new position for the playhead (in milliseconds, within the sequence timemline).
+		 * @param position the new position for the playhead (in microseconds, within the sequence timemline).
 		 */
 		static void onCurrentOperationChangePlayheadPosition(unsigned long long position);
 
 		/**
 		 * Callback function triggered during a sequence reading operation, each time the reading buffer grows.
-		 * @param endingPoint the new end for the buffer (in milliseconds, within the sequence timemline).
+		 * @param endingPoint the new end for the buffer (in microseconds, within the sequence timemline).
 		 */
 		static void onCurrentOperationUpdateBufferEndingPoint(unsigned long long endingPoint);
 
@@ -582,7 +655,14 @@ namespace kocca {
 		static void openUnzippedSequenceFromDirectory(boost::filesystem::path sequenceRootDirectoryPath);
 
 		/**
-		 * Prepares a "temp" sub-folder and extracts a .ksa archive file content to it.
+		 * Loads a sequence straight from its .ksa archive file, without extracting its frames (see Sequence::readDataFromArchive()).
+		 * @param ksaFileName the .ksa file path on the filesystem.
+		 * @param sequenceTempFolderPath the sequence temp directory, where the files generated while reading the sequence (like its proxies) are written.
+		 */
+		static void openSequenceFromArchive(std::string ksaFileName, boost::filesystem::path sequenceTempFolderPath);
+
+		/**
+		 * Prepares a "temp" sub-folder and extracts a .ksa archive file content to it. Unless the "playback.read_archives_in_place" setting is false, the frames aren't extracted, but read straight from the archive (see openSequenceFromArchive()).
 		 * @param ksaFileName the .ksa file path on the filesystem.
 		 */
 		static void unZipSequence(std::string ksaFileName);
@@ -615,7 +695,7 @@ namespace kocca {
 		/**
 		 * Callback function called when the user manually moves the "playhead" slider.
 		 * @param scroll ??? Not shure what it is : check the GTK documentation. We don't use it anyway.
-		 * @param new_value the new value for the playhead, in milliseconds within the sequence timeline.
+		 * @param new_value the new value for the playhead, in milliseconds within the sequence timeline (the UI works in milliseconds, the sequence in microseconds).
 		 */
 		static bool onMoveVideoTimeSliderScale(Gtk::ScrollType scroll, double new_value);
 
@@ -710,6 +790,21 @@ namespace kocca {
 		 */
 		static void onMainWindowSpaceShortcut();
 
+		/**
+		 * Callback function triggered when the user hits the "+" key on the keyboard : steps the playback rate of the sequence being read up, see SequenceReading::stepPlaybackRate().
+		 */
+		static void onMainWindowPlusShortcut();
+
+		/**
+		 * Callback function triggered when the user hits the "-" key on the keyboard : steps the playback rate of the sequence being read down, see SequenceReading::stepPlaybackRate().
+		 */
+		static void onMainWindowMinusShortcut();
+
+		/**
+		 * Callback function triggered when the user hits the "r" key on the keyboard : reverses the playback direction of the sequence being read.
+		 */
+		static void onMainWindowRShortcut();
+
 		/**
 		 * Callback function triggered when the user closes the main window.
 		 * @see Gtk::Window::signal_delete_event()
@@ -722,22 +817,57 @@ namespace kocca {
 		static unsigned long getProcessID();
 
 		/**
-		 * Creates a new sub-folder in the "temp" directory and returns it's path. To avoid duplicates, sub folder name is created with the form PID_TIME where "PID" is the current process PID and "TIME" is a local timestamp in milliseconds.
+		 * Gets a name for a new sub-folder of the "temp" directory, of the form PID_TIME where "PID" is the current process PID and "TIME" is the wall clock time in milliseconds (the monotonic clock of getMSTime() starts over at each boot, so it could give the name of a folder left by a previous session).
+		 */
+		static std::string getNewSequenceTempFolderName();
+
+		/**
+		 * Creates a new sub-folder in the "temp" directory and returns it's path. To avoid duplicates, sub folder name is created by getNewSequenceTempFolderName(), and a new name is taken if it already exists.
 		 * @return the path to ne newly created sub-folder.
 		 */
 		static boost::filesystem::path getNewSequenceTempFolder();
 
 		/**
-		 * Deletes any file and sub-folder that resides in the "temp" directory.
+		 * Gets the path of a new .ksa archive to record a sequence straight into, in a given folder. To avoid duplicates, the file name is created with the form KOCCA_DATE_TIME.ksa, with an additional numeric suffix if needed.
+		 * @param archiveFolder the folder where the archive will be created. It is created if it doesn't exist.
+		 * @return the path of the new archive
+		 * @throws FileArchivingException if archiveFolder doesn't exist and couldn't be created
+		 */
+		static boost::filesystem::path getNewSequenceArchivePath(boost::filesystem::path archiveFolder);
+
+		/**
+		 * Deletes any file and sub-folder that resides in the "temp" directory. The folders are renamed aside right away, and deleted in the background by the folderReclaimer.
 		 */
 		static void clearTempFolder();
 
+		/**
+		 * Deletes the temp folder of a sequence, along with the folders where its streams have been recorded outside of it. The folders are renamed aside right away, and deleted in the background by the folderReclaimer (or right away if they can't be renamed).
+		 * @param sequence the sequence, whose metadata must have been read
+		 */
+		static void reclaimSequenceFolders(datalib::Sequence* sequence);
+
 		/**
 		 * Switches the monitored kinect stream, so the application shows its frames in the "Monitor" widget. Note this is not only available in "Monitoring" mode, but also in "Calibration", "SequenceRecording" and "SequenceReading" modes.
 		 * @param newMonitoredStream the kinect stream type to monitor from now
 		 */
 		static void setMonitoredKinectStream(kinectStreamType newMonitoredStream);
 
+		/**
+		 * Gives the "Monitor" widget the geometry of the frames of the monitored stream, so the MoCap markers get mapped onto them : the recording profile of the stream when reading a sequence (see datalib::StreamProfile), the full sensor frames otherwise.
+		 */
+		static void updateMonitorFrameGeometry();
+
+		/**
+		 * Gives the current "SequenceReading" operation the size of the widgets each stream is displayed in (its thumbnail, and the "Monitor" widget for the monitored stream), so its frames aren't decoded larger than shown (see operations::SequenceReading::setDisplaySize()).
+		 */
+		static void updateReadingDisplaySizes();
+
+		/**
+		 * Callback function triggered when the "Monitor" widget or a stream thumbnail is resized, so the frames of a sequence being read are decoded at the size they are displayed.
+		 * @param allocation the new size of the widget
+		 */
+		static void onDisplayWidgetSizeAllocate(Gtk::Allocation& allocation);
+
 		/**
 		 * Callback function triggered when the user clicks the "RGB stream" thumbnail.
 		 */
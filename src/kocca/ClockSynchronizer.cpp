@@ -0,0 +1,175 @@
+#include "ClockSynchronizer.h"
+#include <cmath>
+#include <vector>
+
+namespace kocca {
+	namespace {
+		/**
+		 * The maximum drift we accept between the two clocks (quartz oscillators are way below this). Beyond, the fit is considered not reliable yet, and the clocks are assumed to run at the same rate.
+		 */
+		const double MAX_DRIFT = 0.001;
+
+		/**
+		 * The number of segments the window is split into to find its lower envelope.
+		 */
+		const size_t ENVELOPE_SEGMENTS = 10;
+	}
+
+	const double ClockSynchronizer::MAX_CLOCK_JUMP = 1000000;
+
+	ClockSynchronizer::ClockSynchronizer(size_t _windowSize, double _constantLatency) {
+		windowSize = (_windowSize >= 2) ? _windowSize : 2;
+		constantLatency = _constantLatency;
+		clear();
+	}
+
+	void ClockSynchronizer::clear() {
+		samples.clear();
+		hasOrigin = false;
+		deviceOrigin = 0;
+		hostOrigin = 0;
+		slope = 1;
+		intercept = 0;
+		drift = 0;
+		fitError = 0;
+		meanCorrection = 0;
+		samplesCount = 0;
+	}
+
+	unsigned long long ClockSynchronizer::synchronize(double deviceTime, unsigned long long hostTime, double deviceLatency) {
+		samples_mutex.lock();
+
+		// the arrival time the frame would have if it had been received as soon as it was timestamped
+		double adjustedHostTime = (double)hostTime - deviceLatency;
+
+		if(hasOrigin) {
+			double relativeDeviceTime = deviceTime - deviceOrigin;
+			double predictedHostTime = intercept + (slope * relativeDeviceTime);
+
+			// the streams of a device send their frames from different threads, so their device times interleave slightly out of order :
+			// only a device time that goes far backwards, or that is far away from the fit, means that the device clock has been reset
+			if(!samples.empty() && ((relativeDeviceTime < (samples.back().deviceTime - MAX_CLOCK_JUMP)) || (std::fabs((adjustedHostTime - hostOrigin) - predictedHostTime) > MAX_CLOCK_JUMP)))
+				clear();
+		}
+
+		if(!hasOrigin) {
+			deviceOrigin = deviceTime;
+			hostOrigin = adjustedHostTime;
+			hasOrigin = true;
+		}
+
+		Sample sample;
+		sample.deviceTime = deviceTime - deviceOrigin;
+		sample.hostTime = adjustedHostTime - hostOrigin;
+		samples.push_back(sample);
+
+		if(samples.size() > windowSize)
+			samples.pop_front();
+
+		samplesCount++;
+		updateFit();
+
+		double correctedTime = hostOrigin + intercept + (slope * sample.deviceTime) - constantLatency;
+		samples_mutex.unlock();
+
+		return((correctedTime > 0) ? (unsigned long long)std::llround(correctedTime) : 0);
+	}
+
+	void ClockSynchronizer::updateFit() {
+		size_t samplesNumber = samples.size();
+		double newSlope = 1;
+
+		// the drift is fitted on the lower envelope of the samples : the fastest arrival of each segment of the window, which is much less noisy than the arrival times themselves
+		size_t segmentsNumber = (samplesNumber < ENVELOPE_SEGMENTS) ? samplesNumber : ENVELOPE_SEGMENTS;
+
+		if(segmentsNumber >= 2) {
+			double meanDeviceTime = 0, meanHostTime = 0;
+			std::vector<Sample> envelope(segmentsNumber);
+
+			for(size_t i = 0; i < segmentsNumber; i++) {
+				size_t segmentStart = (i * samplesNumber) / segmentsNumber;
+				size_t segmentEnd = ((i + 1) * samplesNumber) / segmentsNumber;
+				envelope[i] = samples[segmentStart];
+
+				for(size_t j = segmentStart + 1; j < segmentEnd; j++) {
+					if((samples[j].hostTime - samples[j].deviceTime) < (envelope[i].hostTime - envelope[i].deviceTime))
+						envelope[i] = samples[j];
+				}
+
+				meanDeviceTime += envelope[i].deviceTime;
+				meanHostTime += envelope[i].hostTime;
+			}
+
+			meanDeviceTime /= segmentsNumber;
+			meanHostTime /= segmentsNumber;
+
+			double covariance = 0, variance = 0;
+
+			for(size_t i = 0; i < segmentsNumber; i++) {
+				double deviceDelta = envelope[i].deviceTime - meanDeviceTime;
+				covariance += deviceDelta * (envelope[i].hostTime - meanHostTime);
+				variance += deviceDelta * deviceDelta;
+			}
+
+			if(variance > 0) {
+				newSlope = covariance / variance;
+
+				if(std::fabs(newSlope - 1) > MAX_DRIFT)
+					newSlope = 1;
+			}
+		}
+
+		// the offset is given by the lower envelope of the samples : the frames that arrived the fastest
+		double newIntercept = samples[0].hostTime - (newSlope * samples[0].deviceTime);
+
+		for(size_t i = 1; i < samplesNumber; i++)
+			newIntercept = std::fmin(newIntercept, samples[i].hostTime - (newSlope * samples[i].deviceTime));
+
+		double squaredResidualsSum = 0, correctionsSum = 0, meanResidual = 0;
+
+		for(size_t i = 0; i < samplesNumber; i++)
+			meanResidual += samples[i].hostTime - (newIntercept + (newSlope * samples[i].deviceTime));
+
+		meanResidual /= samplesNumber;
+
+		for(size_t i = 0; i < samplesNumber; i++) {
+			double correction = samples[i].hostTime - (newIntercept + (newSlope * samples[i].deviceTime));
+			correctionsSum += correction;
+			squaredResidualsSum += (correction - meanResidual) * (correction - meanResidual);
+		}
+
+		slope = newSlope;
+		intercept = newIntercept;
+		drift = (slope - 1) * 1000000;
+		fitError = std::sqrt(squaredResidualsSum / samplesNumber) / 1000.0;
+		meanCorrection = ((correctionsSum / samplesNumber) + constantLatency) / 1000.0;
+	}
+
+	void ClockSynchronizer::reset() {
+		samples_mutex.lock();
+		clear();
+		samples_mutex.unlock();
+	}
+
+	void ClockSynchronizer::setConstantLatency(double _constantLatency) {
+		samples_mutex.lock();
+		constantLatency = _constantLatency;
+		samples_mutex.unlock();
+	}
+
+	double ClockSynchronizer::getDrift() {
+		return(drift);
+	}
+
+	double ClockSynchronizer::getFitError() {
+		return(fitError);
+	}
+
+	double ClockSynchronizer::getMeanCorrection() {
+		return(meanCorrection);
+	}
+
+	unsigned long long ClockSynchronizer::getSamplesCount() {
+		return(samplesCount);
+	}
+} // namespace kocca
@@ -0,0 +1,148 @@
+#ifndef KOCCA_CLOCK_SYNCHRONIZER_H
+#define KOCCA_CLOCK_SYNCHRONIZER_H
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+namespace kocca {
+
+	/**
+	 * Maps the timestamps of a device's clock (ex : Kinect frames RelativeTime, NatNet frames fTimestamp) to the host's clock (the one of getUSTime()).
+	 * Each time a frame arrives, its device timestamp and its host arrival time are added to a sliding window of samples. The drift between the two clocks is estimated by a linear least squares fit over the lower envelope of the window (the fastest arrivals of each part of the window), and the offset by the lowest sample (the fastest arrivals), so the scheduling and transport delays of the host don't end up in the frames timestamps.
+	 * All the streams of a same device should share the same synchronizer, as their timestamps are in the same clock domain.
+	 * The latest estimates can be read from any thread without any lock.
+	 */
+	class ClockSynchronizer {
+	protected:
+
+		/**
+		 * A (device time, host time) sample, both relative to the origin of the synchronizer and in microseconds.
+		 */
+		struct Sample {
+			double deviceTime;
+			double hostTime;
+		};
+
+		/**
+		 * The samples of the sliding window, from the oldest to the newest.
+		 */
+		std::deque<Sample> samples;
+
+		/**
+		 * The maximum number of samples of the sliding window.
+		 */
+		size_t windowSize;
+
+		/**
+		 * A constant latency (in microseconds) between the device timestamps and the actual capture, that the device doesn't report by itself.
+		 */
+		double constantLatency;
+
+		/**
+		 * Whether or not the origins have been set (by the first sample).
+		 */
+		bool hasOrigin;
+
+		/**
+		 * The device time and host time of the first sample, that all the samples are relative to (to keep precision with double values).
+		 */
+		double deviceOrigin, hostOrigin;
+
+		/**
+		 * The current fit : hostTime = intercept + slope * deviceTime (relative to the origins).
+		 */
+		double slope, intercept;
+
+		/**
+		 * A lock to prevent access conflicts to the samples and the fit, as the streams of a device send their frames from different threads.
+		 */
+		std::mutex samples_mutex;
+
+		/**
+		 * The latest estimated drift of the device clock relative to the host clock, in parts per million.
+		 */
+		std::atomic<double> drift;
+
+		/**
+		 * The root mean square of the distances from the samples of the window to the fitted line, in milliseconds. This is the jitter of the arrival times around the fit, hence an estimation of the error of the corrected times.
+		 */
+		std::atomic<double> fitError;
+
+		/**
+		 * The mean difference between the host arrival times and the corrected times of the samples of the window, in milliseconds. This is how much stamping frames with their arrival time would have delayed them.
+		 */
+		std::atomic<double> meanCorrection;
+
+		/**
+		 * The number of samples received since the latest reset.
+		 */
+		std::atomic<unsigned long long> samplesCount;
+
+		/**
+		 * Fits the line to the samples of the window and updates the published estimates.
+		 */
+		void updateFit();
+
+		/**
+		 * Clears the samples and the fit. The samples_mutex must be locked by the caller.
+		 */
+		void clear();
+
+	public:
+
+		/**
+		 * The maximum difference (in microseconds) between a sample and the current fit, or between a sample and the previous one when the device time goes backwards, before we consider that the device clock has been reset.
+		 */
+		static const double MAX_CLOCK_JUMP;
+
+		/**
+		 * Constructor.
+		 * @param _windowSize the number of samples of the sliding window. It should span a few tens of seconds, for the drift to stand out of the timestamps quantization and jitter.
+		 * @param _constantLatency a constant latency (in microseconds) between the device timestamps and the actual capture, that is subtracted from all the corrected times
+		 */
+		ClockSynchronizer(size_t _windowSize = 3000, double _constantLatency = 0);
+
+		/**
+		 * Adds a sample and gets the corrected time of the frame it belongs to.
+		 * @param deviceTime the timestamp of the frame in the device clock, in microseconds
+		 * @param hostTime the arrival time of the frame in the host clock (as returned by getUSTime()), in microseconds
+		 * @param deviceLatency a latency between the capture and the timestamp of the frame reported by the device (if any), in microseconds
+		 * @return the capture time of the frame in the host clock, in microseconds
+		 */
+		unsigned long long synchronize(double deviceTime, unsigned long long hostTime, double deviceLatency = 0);
+
+		/**
+		 * Forgets all the samples, typically when the device has been restarted.
+		 */
+		void reset();
+
+		/**
+		 * Sets the constant latency between the device timestamps and the actual capture.
+		 * @param _constantLatency the latency, in microseconds
+		 */
+		void setConstantLatency(double _constantLatency);
+
+		/**
+		 * Gets the latest estimated drift of the device clock relative to the host clock, in parts per million.
+		 */
+		double getDrift();
+
+		/**
+		 * Gets the latest estimated error of the corrected times (see fitError), in milliseconds.
+		 */
+		double getFitError();
+
+		/**
+		 * Gets the mean correction applied to the arrival times (see meanCorrection), in milliseconds.
+		 */
+		double getMeanCorrection();
+
+		/**
+		 * Gets the number of samples received since the latest reset.
+		 */
+		unsigned long long getSamplesCount();
+	};
+} // namespace kocca
+
+#endif // KOCCA_CLOCK_SYNCHRONIZER_H
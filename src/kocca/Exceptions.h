@@ -98,6 +98,11 @@ public:
 	FileWritingException(const char* _message): std::runtime_error(_message){}
 };
 
+class FrameEncodingException: public std::runtime_error {
+public:
+	FrameEncodingException(const char* _message): std::runtime_error(_message){}
+};
+
 class DuplicateMarkerNameException: public std::runtime_error {
 public:
 	DuplicateMarkerNameException(const char* _message): std::runtime_error(_message){}
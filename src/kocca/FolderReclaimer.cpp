@@ -0,0 +1,196 @@
+#include "FolderReclaimer.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+	#include <Windows.h>
+#else
+	#include <sys/resource.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif // _WIN32
+
+namespace kocca {
+	namespace {
+		/**
+		 * The duration of the throttling periods, in milliseconds : the deletions are spread over each period rather than bursting at its beginning.
+		 */
+		const long long THROTTLING_PERIOD = 100;
+	}
+
+	const char* FolderReclaimer::RECLAIMED_FOLDER_PREFIX = "reclaimed_";
+
+	FolderReclaimer::FolderReclaimer(unsigned long long _maxFilesPerSecond) {
+		maxFilesPerSecond = _maxFilesPerSecond;
+		stopRequested = false;
+		deletedFilesCount = 0;
+		throttlingPeriodFilesCount = 0;
+		throttlingPeriodStartTime = std::chrono::steady_clock::now();
+		reclaimingThread = new std::thread(&FolderReclaimer::reclaimingThreadLoop, this);
+	}
+
+	FolderReclaimer::~FolderReclaimer() {
+		// the flag is set under the lock, so the thread can't miss the notification between its check and its wait
+		pendingFolders_mutex.lock();
+		stopRequested = true;
+		pendingFolders_mutex.unlock();
+		pendingFolders_condition.notify_all();
+
+		if(reclaimingThread->joinable())
+			reclaimingThread->join();
+
+		delete reclaimingThread;
+	}
+
+	bool FolderReclaimer::reclaim(const boost::filesystem::path& folder, boost::filesystem::path reclaimDirectory) {
+		boost::system::error_code ec;
+
+		if(!boost::filesystem::exists(folder, ec) || isReclaimedFolder(folder))
+			return(false);
+
+		// the folder stays on the same disk, so the renaming is atomic and doesn't move any data
+		if(reclaimDirectory.empty())
+			reclaimDirectory = folder.parent_path();
+
+		boost::filesystem::path reclaimedFolder;
+
+		for(int i = 0; reclaimedFolder.empty() || boost::filesystem::exists(reclaimedFolder, ec); i++) {
+			std::ostringstream reclaimedFolderName;
+			reclaimedFolderName << RECLAIMED_FOLDER_PREFIX << folder.filename().string() << "_" << i;
+			reclaimedFolder = reclaimDirectory / reclaimedFolderName.str();
+		}
+
+		boost::filesystem::rename(folder, reclaimedFolder, ec);
+
+		if(ec)
+			return(false);
+
+		pendingFolders_mutex.lock();
+		pendingFolders.push_back(reclaimedFolder);
+		pendingFolders_mutex.unlock();
+		pendingFolders_condition.notify_all();
+
+		return(true);
+	}
+
+	void FolderReclaimer::reclaimStaleFolders(const boost::filesystem::path& directory) {
+		boost::system::error_code ec;
+
+		if(!boost::filesystem::is_directory(directory, ec))
+			return;
+
+		boost::filesystem::directory_iterator end;
+
+		pendingFolders_mutex.lock();
+
+		for(boost::filesystem::directory_iterator i(directory, ec); !ec && (i != end); i.increment(ec)) {
+			if(isReclaimedFolder(i->path()) && (std::find(pendingFolders.begin(), pendingFolders.end(), i->path()) == pendingFolders.end()))
+				pendingFolders.push_back(i->path());
+		}
+
+		pendingFolders_mutex.unlock();
+		pendingFolders_condition.notify_all();
+	}
+
+	bool FolderReclaimer::isReclaimedFolder(const boost::filesystem::path& folder) {
+		return(folder.filename().string().compare(0, strlen(RECLAIMED_FOLDER_PREFIX), RECLAIMED_FOLDER_PREFIX) == 0);
+	}
+
+	size_t FolderReclaimer::getPendingFoldersCount() {
+		pendingFolders_mutex.lock();
+		size_t pendingFoldersCount = pendingFolders.size();
+		pendingFolders_mutex.unlock();
+		return(pendingFoldersCount);
+	}
+
+	unsigned long long FolderReclaimer::getDeletedFilesCount() {
+		return(deletedFilesCount);
+	}
+
+	void FolderReclaimer::lowerCurrentThreadPriority() {
+#ifdef _WIN32
+		// the background mode lowers the I/O and memory priorities along with the CPU one
+		SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#else
+		setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+
+#ifdef SYS_ioprio_set
+		// IOPRIO_WHO_PROCESS, IOPRIO_CLASS_IDLE : the thread only gets the disk when nobody else needs it
+		syscall(SYS_ioprio_set, 1, (int)syscall(SYS_gettid), 3 << 13);
+#endif // SYS_ioprio_set
+#endif // _WIN32
+	}
+
+	void FolderReclaimer::throttle() {
+		if(maxFilesPerSecond == 0)
+			return;
+
+		throttlingPeriodFilesCount++;
+
+		if(throttlingPeriodFilesCount >= ((maxFilesPerSecond * THROTTLING_PERIOD) / 1000) + 1) {
+			std::chrono::steady_clock::time_point throttlingPeriodEndTime = throttlingPeriodStartTime + std::chrono::milliseconds(THROTTLING_PERIOD);
+
+			std::unique_lock<std::mutex> pendingFoldersLock(pendingFolders_mutex);
+			pendingFolders_condition.wait_until(pendingFoldersLock, throttlingPeriodEndTime, [this] { return(stopRequested.load()); });
+			pendingFoldersLock.unlock();
+
+			throttlingPeriodFilesCount = 0;
+			throttlingPeriodStartTime = std::chrono::steady_clock::now();
+		}
+	}
+
+	bool FolderReclaimer::deleteFolder(const boost::filesystem::path& folder) {
+		boost::system::error_code ec;
+		boost::filesystem::directory_iterator end;
+		std::vector<boost::filesystem::path> childs;
+
+		// the childs are listed first, as deleting them while iterating over the folder is not portable
+		for(boost::filesystem::directory_iterator i(folder, ec); !ec && (i != end); i.increment(ec))
+			childs.push_back(i->path());
+
+		for(size_t i = 0; i < childs.size(); i++) {
+			if(stopRequested)
+				return(false);
+
+			if(boost::filesystem::is_directory(childs.at(i), ec)) {
+				if(!deleteFolder(childs.at(i)))
+					return(false);
+			}
+			else {
+				// a file that can't be deleted (ex : it is still open) is left, the folder will be retried at the next start
+				if(boost::filesystem::remove(childs.at(i), ec))
+					deletedFilesCount++;
+
+				throttle();
+			}
+		}
+
+		if(boost::filesystem::remove(folder, ec))
+			deletedFilesCount++;
+
+		return(true);
+	}
+
+	void FolderReclaimer::reclaimingThreadLoop() {
+		lowerCurrentThreadPriority();
+
+		while(!stopRequested) {
+			std::unique_lock<std::mutex> pendingFoldersLock(pendingFolders_mutex);
+			pendingFolders_condition.wait(pendingFoldersLock, [this] { return(stopRequested || !pendingFolders.empty()); });
+
+			if(stopRequested)
+				break;
+
+			boost::filesystem::path folder = pendingFolders.front();
+			pendingFoldersLock.unlock();
+
+			if(deleteFolder(folder)) {
+				pendingFolders_mutex.lock();
+				pendingFolders.pop_front();
+				pendingFolders_mutex.unlock();
+			}
+		}
+	}
+} // namespace kocca
@@ -0,0 +1,136 @@
+#ifndef KOCCA_FOLDER_RECLAIMER_H
+#define KOCCA_FOLDER_RECLAIMER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "boost/filesystem.hpp"
+
+namespace kocca {
+
+	/**
+	 * Deletes folders in the background, so removing the 100k+ frames files of a take never blocks the user interface nor delays the next recording.
+	 * A folder to reclaim is first renamed aside (which is atomic and instant, as it stays in the same parent folder), so its original path can be reused right away. Its content is then deleted by a low priority thread (both for the CPU and for the I/O), at a limited rate so the writers of a recording keep the disk bandwidth.
+	 * Reclaimed folders that are not deleted yet when the application quits (or crashes) keep their RECLAIMED_FOLDER_PREFIX name, so they can be found and deleted at the next start (see reclaimStaleFolders()).
+	 */
+	class FolderReclaimer {
+	protected:
+
+		/**
+		 * The renamed folders waiting to be deleted, from the oldest to the newest.
+		 */
+		std::deque<boost::filesystem::path> pendingFolders;
+
+		/**
+		 * A lock to prevent access conflicts to pendingFolders.
+		 */
+		std::mutex pendingFolders_mutex;
+
+		/**
+		 * Notified when a folder is queued or when the reclaimingThread must stop, so the thread sleeps while there's nothing to delete, and wakes up from its throttling pauses to stop.
+		 */
+		std::condition_variable pendingFolders_condition;
+
+		/**
+		 * The maximum number of files deleted per second, 0 for no limit.
+		 */
+		unsigned long long maxFilesPerSecond;
+
+		/**
+		 * The thread that deletes the pending folders.
+		 */
+		std::thread* reclaimingThread;
+
+		/**
+		 * Whether or not the reclaimingThread must stop as soon as possible.
+		 */
+		std::atomic<bool> stopRequested;
+
+		/**
+		 * The number of files and folders deleted so far.
+		 */
+		std::atomic<unsigned long long> deletedFilesCount;
+
+		/**
+		 * The number of files deleted since the beginning of the current throttling period, and the beginning of this period.
+		 */
+		unsigned long long throttlingPeriodFilesCount;
+		std::chrono::steady_clock::time_point throttlingPeriodStartTime;
+
+		/**
+		 * Lowers the priority of the calling thread, for the CPU and for the I/O.
+		 */
+		static void lowerCurrentThreadPriority();
+
+		/**
+		 * Deletes a folder and all its content, in the reclaimingThread.
+		 * @param folder the folder to delete
+		 * @return false if the deletion was interrupted by a stop request
+		 */
+		bool deleteFolder(const boost::filesystem::path& folder);
+
+		/**
+		 * Waits as long as needed for the deletions not to exceed maxFilesPerSecond, or until a stop is requested.
+		 */
+		void throttle();
+
+	public:
+
+		/**
+		 * The prefix of the names of the folders renamed aside for deletion.
+		 */
+		static const char* RECLAIMED_FOLDER_PREFIX;
+
+		/**
+		 * Constructor. Starts the reclaimingThread.
+		 * @param _maxFilesPerSecond the maximum number of files deleted per second, 0 for no limit
+		 */
+		FolderReclaimer(unsigned long long _maxFilesPerSecond = 2000);
+
+		/**
+		 * Destructor. Stops the reclaimingThread : the folders that are not deleted yet are left on the disk, for the next reclaimStaleFolders().
+		 */
+		~FolderReclaimer();
+
+		/**
+		 * Renames a folder aside, and queues it for deletion.
+		 * @param folder the folder to reclaim
+		 * @param reclaimDirectory the directory the folder is renamed into, which must be on the same disk. If empty, the folder stays in its parent folder.
+		 * @return false if the folder doesn't exist or couldn't be renamed (ex : one of its files is still open), in which case it is left untouched
+		 */
+		bool reclaim(const boost::filesystem::path& folder, boost::filesystem::path reclaimDirectory = boost::filesystem::path());
+
+		/**
+		 * Queues for deletion the folders of a directory that were renamed aside but not deleted yet, typically by a previous instance of the application.
+		 * @param directory the directory the reclaimed folders are in
+		 */
+		void reclaimStaleFolders(const boost::filesystem::path& directory);
+
+		/**
+		 * Whether or not a folder has been renamed aside for deletion.
+		 * @param folder the folder
+		 */
+		static bool isReclaimedFolder(const boost::filesystem::path& folder);
+
+		/**
+		 * Gets the number of folders waiting to be deleted (including the one being deleted).
+		 */
+		size_t getPendingFoldersCount();
+
+		/**
+		 * Gets the number of files and folders deleted so far.
+		 */
+		unsigned long long getDeletedFilesCount();
+
+		/**
+		 * Implementation of the reclaimingThread, that deletes the pending folders one after the other.
+		 */
+		void reclaimingThreadLoop();
+	};
+} // namespace kocca
+
+#endif // KOCCA_FOLDER_RECLAIMER_H
@@ -1,6 +1,7 @@
 #include "KinectV2Sensor.h"
 
 #include "Exceptions.h"
+#include "utils.h"
 
 namespace kocca {
 	KinectV2Sensor::KinectV2Sensor() {
@@ -18,6 +19,9 @@ namespace kocca {
 	}
 
 	void KinectV2Sensor::setUp() {
+		// the Kinect's clock may restart with the device
+		clockSynchronizer.reset();
+
 		if (SUCCEEDED(GetDefaultKinectSensor(&pSensor)) && (pSensor != NULL)) {
 			if (SUCCEEDED(pSensor->Open())) {
 				// set up color stream
@@ -106,9 +110,15 @@ namespace kocca {
 							IColorFrame* frame = NULL;
 
 							if (SUCCEEDED(frameReference->AcquireFrame(&frame))) {
+								unsigned long long arrivalTime = getUSTime();
+								TIMESPAN relativeTime = 0;
+								frame->get_RelativeTime(&relativeTime);
 								frameReference->Release();
 								frameEventArgs->Release();
 
+								// RelativeTime is in 100 ns units
+								unsigned long long captureTime = clockSynchronizer.synchronize(relativeTime / 10.0, arrivalTime);
+
 								// build cv::Mat from Kinect frame data
 								IFrameDescription* pFrameDescription = NULL;
 								int frameWidth = 0;
@@ -128,14 +138,14 @@ namespace kocca {
 
 								frame->CopyConvertedFrameDataToArray(frameWidth * frameHeight * 4, cvFrameDataPtr, ColorImageFormat_Bgra);
 								frame->Release();
-								cv::cvtColor(cvFrame, cvFrame, CV_BGRA2RGB);
 
+								// the frame is kept in the BGRA layout of the sensor : the JPEG encoder reads it as is, and it is only converted to RGB when it is displayed
 								// At this point, Kinect image is mirror-flipped (not sure why ?), so we flip it back
 								cv::Mat flippedCVFrame;
 								cv::flip(cvFrame, flippedCVFrame, 1);
 								// ---
 
-								onRGBFrame(flippedCVFrame);
+								onRGBFrame(flippedCVFrame, captureTime);
 							}
 						}
 					}
@@ -144,6 +154,10 @@ namespace kocca {
 		}
 	}
 
+	ClockSynchronizer* KinectV2Sensor::getClockSynchronizer() {
+		return(&clockSynchronizer);
+	}
+
 	void KinectV2Sensor::infraredThreadFunc() {
 		while (keepThreadsRunning) {
 			if (onIRFrame != NULL) {
@@ -159,9 +173,15 @@ namespace kocca {
 							IInfraredFrame* frame = NULL;
 
 							if (SUCCEEDED(frameReference->AcquireFrame(&frame))) {
+								unsigned long long arrivalTime = getUSTime();
+								TIMESPAN relativeTime = 0;
+								frame->get_RelativeTime(&relativeTime);
 								frameReference->Release();
 								frameEventArgs->Release();
 
+								// RelativeTime is in 100 ns units
+								unsigned long long captureTime = clockSynchronizer.synchronize(relativeTime / 10.0, arrivalTime);
+
 								IFrameDescription* pFrameDescription = NULL;
 								int frameWidth = 0;
 								int frameHeight = 0;
@@ -182,7 +202,7 @@ namespace kocca {
 								cv::Mat flippedCVFrame;
 								cv::flip(cvFrame, flippedCVFrame, 1);
 
-								onIRFrame(flippedCVFrame);
+								onIRFrame(flippedCVFrame, captureTime);
 							}
 						}
 					}
@@ -206,8 +226,14 @@ namespace kocca {
 							IDepthFrame* frame = NULL;
 
 							if (SUCCEEDED(frameReference->AcquireFrame(&frame))) {
+								unsigned long long arrivalTime = getUSTime();
+								TIMESPAN relativeTime = 0;
+								frame->get_RelativeTime(&relativeTime);
 								frameReference->Release();
 								frameEventArgs->Release();
+
+								// RelativeTime is in 100 ns units
+								unsigned long long captureTime = clockSynchronizer.synchronize(relativeTime / 10.0, arrivalTime);
 								
 								IFrameDescription* pFrameDescription = NULL;
 								int frameWidth = 0;
@@ -229,7 +255,7 @@ namespace kocca {
 								cv::Mat flippedCVFrame;
 								cv::flip(cvFrame, flippedCVFrame, 1);
 
-								onDepthFrame(flippedCVFrame);
+								onDepthFrame(flippedCVFrame, captureTime);
 							}
 						}
 					}
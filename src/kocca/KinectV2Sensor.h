@@ -8,6 +8,8 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "ClockSynchronizer.h"
+
 namespace kocca {
 
 	/**
@@ -17,6 +19,14 @@ namespace kocca {
 
 	public:
 
+		/**
+		 * The size of the frames of the RGB stream, and of the InfraRed and depth streams.
+		 */
+		static const int RGB_FRAME_WIDTH = 1920;
+		static const int RGB_FRAME_HEIGHT = 1080;
+		static const int DEPTH_FRAME_WIDTH = 512;
+		static const int DEPTH_FRAME_HEIGHT = 424;
+
 		/**
 		 * Constructor.
 		 */
@@ -44,21 +54,29 @@ namespace kocca {
 
 		/**
 		 * Callback function that will be asynchronously called to notify other objects of the availability of a new frame from the RGB stream.
-		 * @param cv::Mat the new RGB frame.
+		 * @param cv::Mat the new RGB frame, in the BGRA layout of the sensor (CV_8UC4).
+		 * @param unsigned long long the capture time of the frame, in microseconds on the local system clock (see getUSTime()), corrected by the clock synchronizer.
 		 */
-		void(*onRGBFrame)(cv::Mat);
+		void(*onRGBFrame)(cv::Mat, unsigned long long);
 
 		/**
 		 * Callback function that will be asynchronously called to notify other objects of the availability of a new frame from the InfraRed stream.
 		 * @param cv::Mat the new InfraRed frame.
+		 * @param unsigned long long the capture time of the frame, in microseconds on the local system clock (see getUSTime()), corrected by the clock synchronizer.
 		 */
-		void(*onIRFrame)(cv::Mat);
+		void(*onIRFrame)(cv::Mat, unsigned long long);
 
 		/**
 		 * Callback function that will be asynchronously called to notify other objects of the availability of a new frame from the depth stream.
 		 * @param cv::Mat the new depth frame.
+		 * @param unsigned long long the capture time of the frame, in microseconds on the local system clock (see getUSTime()), corrected by the clock synchronizer.
+		 */
+		void(*onDepthFrame)(cv::Mat, unsigned long long);
+
+		/**
+		 * Gets the clock synchronizer that maps the Kinect frames timestamps to the local system clock, to read its statistics or adjust its latency.
 		 */
-		void(*onDepthFrame)(cv::Mat);
+		ClockSynchronizer* getClockSynchronizer();
 
 		/**
 		 * Destructor. It calls stop() to stop the kinect device and terminate the threads that extract images.
@@ -123,6 +141,11 @@ namespace kocca {
 		 */
 		std::atomic<bool> keepThreadsRunning;
 
+		/**
+		 * Maps the timestamps of the frames (their RelativeTime, in the Kinect's clock) to the local system clock. It is shared by the 3 streams, as they are timestamped by the same clock.
+		 */
+		ClockSynchronizer clockSynchronizer;
+
 		/**
 		 * Implementation for the pColorThread thread.
 		 */
@@ -0,0 +1,113 @@
+#include "Settings.h"
+#include "utils.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace kocca {
+	std::map<std::string, std::string> Settings::values;
+	std::mutex Settings::values_mutex;
+
+	bool Settings::loadFromFile(boost::filesystem::path filePath) {
+		std::ifstream fileStream(filePath.string());
+
+		if(!fileStream.is_open())
+			return(false);
+
+		values_mutex.lock();
+		parseValues(fileStream, values);
+		values_mutex.unlock();
+		return(true);
+	}
+
+	void Settings::parseValues(std::istream& stream, std::map<std::string, std::string>& parsedValues) {
+		std::string line;
+
+		while(std::getline(stream, line)) {
+			line = trim(line);
+
+			if(!line.empty() && (line.at(0) != '#')) {
+				size_t separatorPos = line.find('=');
+
+				if(separatorPos != std::string::npos) {
+					std::string key = trim(line.substr(0, separatorPos));
+					std::string value = trim(line.substr(separatorPos + 1));
+
+					if(!key.empty())
+						parsedValues[key] = value;
+				}
+			}
+		}
+	}
+
+	std::string Settings::trim(const std::string& str) {
+		size_t first = str.find_first_not_of(" \t\r\n");
+
+		if(first == std::string::npos)
+			return(std::string(""));
+
+		size_t last = str.find_last_not_of(" \t\r\n");
+		return(str.substr(first, last - first + 1));
+	}
+
+	boost::filesystem::path Settings::getDefaultFilePath() {
+		return(get_application_base_path() / "kocca.conf");
+	}
+
+	bool Settings::has(const char* key) {
+		values_mutex.lock();
+		bool found = (values.find(key) != values.end());
+		values_mutex.unlock();
+		return(found);
+	}
+
+	std::string Settings::getString(const char* key, const char* defaultValue) {
+		std::string value(defaultValue);
+		values_mutex.lock();
+		std::map<std::string, std::string>::iterator i = values.find(key);
+
+		if(i != values.end())
+			value = i->second;
+
+		values_mutex.unlock();
+		return(value);
+	}
+
+	long long Settings::getInt(const char* key, long long defaultValue) {
+		std::istringstream valueStream(getString(key));
+		long long value;
+
+		if((valueStream >> value) && valueStream.eof())
+			return(value);
+		else
+			return(defaultValue);
+	}
+
+	double Settings::getDouble(const char* key, double defaultValue) {
+		std::istringstream valueStream(getString(key));
+		double value;
+
+		if((valueStream >> value) && valueStream.eof())
+			return(value);
+		else
+			return(defaultValue);
+	}
+
+	bool Settings::getBool(const char* key, bool defaultValue) {
+		std::string value = getString(key);
+		std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+
+		if((value == "true") || (value == "yes") || (value == "on") || (value == "1"))
+			return(true);
+		else if((value == "false") || (value == "no") || (value == "off") || (value == "0"))
+			return(false);
+		else
+			return(defaultValue);
+	}
+
+	void Settings::set(const char* key, std::string value) {
+		values_mutex.lock();
+		values[key] = value;
+		values_mutex.unlock();
+	}
+} // namespace kocca
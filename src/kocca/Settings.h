@@ -0,0 +1,102 @@
+#ifndef KOCCA_SETTINGS_H
+#define KOCCA_SETTINGS_H
+
+#include <istream>
+#include <map>
+#include <mutex>
+#include <string>
+#include "boost/filesystem.hpp"
+
+namespace kocca {
+
+	/**
+	 * Application settings, read from the "kocca.conf" file found in KOCCA's base folder.
+	 * The file is made of "key = value" lines, empty lines and lines starting with '#' are ignored. Every setting has a default value, so the file (or any of its keys) may be missing.
+	 * It is a static class (all it's members and methods are static).
+	 */
+	class Settings {
+	protected:
+
+		/**
+		 * The settings values, by key.
+		 */
+		static std::map<std::string, std::string> values;
+
+		/**
+		 * A lock to prevent access conflicts to values.
+		 */
+		static std::mutex values_mutex;
+
+	public:
+
+		/**
+		 * Loads settings from a file. Keys that were already loaded are overwritten.
+		 * @param filePath the path of the settings file
+		 * @return true if the file was found and read, false otherwise
+		 */
+		static bool loadFromFile(boost::filesystem::path filePath);
+
+		/**
+		 * Gets the path of the default settings file ("kocca.conf" in KOCCA's base folder).
+		 */
+		static boost::filesystem::path getDefaultFilePath();
+
+		/**
+		 * Checks if a setting has been defined.
+		 * @param key the key of the setting
+		 * @return true if the setting has a value, false otherwise
+		 */
+		static bool has(const char* key);
+
+		/**
+		 * Gets a setting as a string.
+		 * @param key the key of the setting
+		 * @param defaultValue the value to return if the setting is not defined
+		 */
+		static std::string getString(const char* key, const char* defaultValue = "");
+
+		/**
+		 * Gets a setting as an integer.
+		 * @param key the key of the setting
+		 * @param defaultValue the value to return if the setting is not defined or is not a valid integer
+		 */
+		static long long getInt(const char* key, long long defaultValue);
+
+		/**
+		 * Gets a setting as a floating point number.
+		 * @param key the key of the setting
+		 * @param defaultValue the value to return if the setting is not defined or is not a valid number
+		 */
+		static double getDouble(const char* key, double defaultValue);
+
+		/**
+		 * Gets a setting as a boolean ("true", "yes", "on" and "1" are true values, "false", "no", "off" and "0" are false values).
+		 * @param key the key of the setting
+		 * @param defaultValue the value to return if the setting is not defined or is not a valid boolean
+		 */
+		static bool getBool(const char* key, bool defaultValue);
+
+		/**
+		 * Sets (or overrides) a setting for the current session. It isn't written to the settings file.
+		 * @param key the key of the setting
+		 * @param value the new value of the setting
+		 */
+		static void set(const char* key, std::string value);
+
+		/**
+		 * Parses "key = value" lines, in the format of the settings file, into a map. Keys that are already in the map are overwritten.
+		 * @param stream the stream to read the lines from
+		 * @param parsedValues the map the values are added to
+		 */
+		static void parseValues(std::istream& stream, std::map<std::string, std::string>& parsedValues);
+
+		/**
+		 * Removes the leading and trailing whitespaces of a string.
+		 * @param str the string to trim
+		 * @return the trimmed string
+		 */
+		static std::string trim(const std::string& str);
+	};
+} // namespace kocca
+
+#endif // KOCCA_SETTINGS_H
@@ -0,0 +1,106 @@
+#include "FrameFileWriter.h"
+#include "UringFrameFileWriter.h"
+#include "../Exceptions.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif // _WIN32
+
+namespace kocca {
+	namespace datalib {
+		FrameFileWriter::FrameFileWriter() {
+			listener = NULL;
+		}
+
+		void FrameFileWriter::setListener(FrameFileWriterListener* _listener) {
+			listener = _listener;
+		}
+
+		FrameFileWriter* FrameFileWriter::create(const std::string& backend, bool directIO, int fsyncBatchSize) {
+			if(backend == "io_uring") {
+#ifdef KOCCA_WITH_IO_URING
+				try {
+					return(new UringFrameFileWriter(directIO, fsyncBatchSize));
+				}
+				catch(std::exception& e) {
+					std::cerr << "io_uring frame writer not available (" << e.what() << "), falling back to buffered writer" << std::endl;
+				}
+#else
+				std::cerr << "KOCCA was built without io_uring support, falling back to buffered frame writer" << std::endl;
+#endif
+			}
+			else if(backend != "buffered")
+				std::cerr << "Unknown frame writer backend \"" << backend << "\", falling back to buffered writer" << std::endl;
+
+			return(new BufferedFrameFileWriter());
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void BufferedFrameFileWriter::writeFile(const boost::filesystem::path& filePath, const unsigned char* data, size_t size, int tag) {
+			std::chrono::steady_clock::time_point writingStartTime = std::chrono::steady_clock::now();
+			std::ofstream outputFile(filePath.string(), std::ios::out | std::ios::binary);
+			outputFile.write((const char*)data, size);
+			outputFile.close();
+
+			if(outputFile.fail()) {
+				std::ostringstream errMsg;
+				errMsg << "Failed to write frame file " << filePath.string();
+				throw FileWritingException(errMsg.str().c_str());
+			}
+
+			unsyncedFilePaths_mutex.lock();
+			unsyncedFilePaths.push_back(filePath.string());
+			unsyncedFilePaths_mutex.unlock();
+
+			if(listener != NULL)
+				listener->onFileWritten(tag, size, (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - writingStartTime).count());
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void BufferedFrameFileWriter::flush(bool sync) {
+			unsyncedFilePaths_mutex.lock();
+			std::vector<std::string> filePaths;
+			filePaths.swap(unsyncedFilePaths);
+			unsyncedFilePaths_mutex.unlock();
+
+			if(!sync)
+				return;
+
+			// std::ofstream can't sync its file : each one is reopened to be synced
+			for(int i = 0; i < filePaths.size(); i++) {
+				FILE* file = fopen(filePaths.at(i).c_str(), "r+b");
+				bool synced = (file != NULL);
+
+#ifdef _WIN32
+				synced = synced && (_commit(_fileno(file)) == 0);
+#else
+				synced = synced && (fsync(fileno(file)) == 0);
+#endif // _WIN32
+
+				if(file != NULL)
+					fclose(file);
+
+				if(!synced) {
+					std::ostringstream errMsg;
+					errMsg << "Failed to sync frame file " << filePaths.at(i);
+					throw FileWritingException(errMsg.str().c_str());
+				}
+			}
+		}
+
+		const char* BufferedFrameFileWriter::getName() {
+			return("buffered");
+		}
+	} // namespace datalib
+} // namespace kocca
@@ -0,0 +1,138 @@
+#ifndef KOCCA_DATALIB_FRAME_FILE_WRITER_H
+#define KOCCA_DATALIB_FRAME_FILE_WRITER_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem.hpp"
+
+namespace kocca {
+	namespace datalib {
+
+		/**
+		 * Receives the completions of the files written by a FrameFileWriter.
+		 */
+		class FrameFileWriterListener {
+		public:
+
+			/**
+			 * Destructor.
+			 */
+			virtual ~FrameFileWriterListener() {}
+
+			/**
+			 * Called once a file has been completely written, from the thread that completes the write : the calling thread with synchronous writers, a completion thread with asynchronous ones. It isn't called for the writes that fail.
+			 * @param tag the tag the file was written with (see FrameFileWriter::writeFile())
+			 * @param size the size of the file, in bytes
+			 * @param writingLatency the time from the call to writeFile() to the completion of the write, in microseconds
+			 */
+			virtual void onFileWritten(int tag, size_t size, unsigned long long writingLatency) = 0;
+		};
+
+		/**
+		 * The storage backend that writes the encoded frames files of a sequence recorded into a folder.
+		 * Writers may be asynchronous : writeFile() may return before the data is actually on disk, and the errors of a write may only be reported by a later call or by flush(). The completion of each write is reported to the listener, if any. Files can be written from several threads at the same time.
+		 */
+		class FrameFileWriter {
+		protected:
+
+			/**
+			 * The listener of the completed writes, or NULL.
+			 */
+			FrameFileWriterListener* listener;
+
+		public:
+
+			/**
+			 * Constructor.
+			 */
+			FrameFileWriter();
+
+			/**
+			 * Destructor. Implementations wait for their pending writes.
+			 */
+			virtual ~FrameFileWriter() {}
+
+			/**
+			 * Sets the listener of the completed writes. It must be set before the first write.
+			 * @param _listener the listener, or NULL
+			 */
+			void setListener(FrameFileWriterListener* _listener);
+
+			/**
+			 * Writes a file, overwriting it if it already exists.
+			 * @param filePath the path of the file
+			 * @param data the content of the file. The writer doesn't keep any reference to it once the call returns.
+			 * @param size the size of the content, in bytes
+			 * @param tag a value passed back to the listener once the file is written (ex : the stream of the frame)
+			 * @throws FileWritingException if the file couldn't be written (or if a previous asynchronous write failed)
+			 */
+			virtual void writeFile(const boost::filesystem::path& filePath, const unsigned char* data, size_t size, int tag = 0) = 0;
+
+			/**
+			 * Waits until all the files written so far are complete, and makes them durable if the writer syncs its files or if asked to.
+			 * @param sync whether or not the files must be made durable, whatever the writer's own syncing (ex : before the journal lists them as synced, see RecordingJournal::sync())
+			 * @throws FileWritingException if any pending write failed, or if the files couldn't be synced
+			 */
+			virtual void flush(bool sync = false) = 0;
+
+			/**
+			 * Gets the name of the backend, as used in the "recording.writer_backend" setting.
+			 */
+			virtual const char* getName() = 0;
+
+			/**
+			 * Creates a writer.
+			 * @param backend the name of the backend : "buffered", or "io_uring" (Linux only, when built with KOCCA_WITH_IO_URING). Unknown or unavailable backends fall back to "buffered".
+			 * @param directIO whether the files should be written with O_DIRECT, bypassing the page cache (io_uring backend only)
+			 * @param fsyncBatchSize the number of files after which the written files are synced to disk, or 0 to leave it to the system (io_uring backend only)
+			 * @return the new writer, to be deleted by the caller
+			 */
+			static FrameFileWriter* create(const std::string& backend, bool directIO = false, int fsyncBatchSize = 0);
+		};
+
+		/**
+		 * The portable frame files writer : each file is written synchronously through a buffered std::ofstream, and left to the system to sync, unless a flush asks for it.
+		 */
+		class BufferedFrameFileWriter : public FrameFileWriter {
+		protected:
+
+			/**
+			 * The paths of the files written since the latest flush, to sync them if it is asked to.
+			 */
+			std::vector<std::string> unsyncedFilePaths;
+
+			/**
+			 * A lock to prevent access conflicts to unsyncedFilePaths.
+			 */
+			std::mutex unsyncedFilePaths_mutex;
+
+		public:
+
+			/**
+			 * Writes a file synchronously.
+			 * @param filePath the path of the file
+			 * @param data the content of the file
+			 * @param size the size of the content, in bytes
+			 * @param tag a value passed back to the listener once the file is written
+			 * @throws FileWritingException if the file couldn't be written
+			 */
+			void writeFile(const boost::filesystem::path& filePath, const unsigned char* data, size_t size, int tag = 0);
+
+			/**
+			 * Syncs the files written since the latest flush if asked to, as files are already complete when writeFile() returns.
+			 * @param sync whether or not the files must be made durable
+			 * @throws FileWritingException if a file couldn't be synced
+			 */
+			void flush(bool sync = false);
+
+			/**
+			 * Gets the name of the backend ("buffered").
+			 */
+			const char* getName();
+		};
+	} // namespace datalib
+} // namespace kocca
+
+#endif // KOCCA_DATALIB_FRAME_FILE_WRITER_H
@@ -6,15 +6,36 @@ namespace kocca {
 		FramePath::FramePath() {
 			path = std::string("");
 			time = 0;
+			archiveEntryIndex = -1;
 		}
 
 		FramePath::FramePath(boost::filesystem::path boostPath) {
 			path = boostPath.string();
 			std::stringstream(boostPath.stem().string()) >> time;
+			archiveEntryIndex = -1;
 		}
 
 		bool FramePath::compareFramePaths(FramePath framePathA, FramePath framePathB) {
 			return (framePathA.time < framePathB.time);
 		}
+
+		int FramePath::getFirstFrameRank(const std::vector<FramePath>& framesList, long long time, bool strictlyAfter) {
+			int first = 0;
+			int count = (int)framesList.size();
+
+			while(count > 0) {
+				int step = count / 2;
+				long long frameTime = framesList.at(first + step).time;
+
+				if((frameTime < time) || (strictlyAfter && (frameTime == time))) {
+					first += step + 1;
+					count -= step + 1;
+				}
+				else
+					count = step;
+			}
+
+			return(first);
+		}
 	} // namespace datalib
 } // namespace kocca
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define KOCCA_DATALIB_FRAME_PATH_H
 
 #include <string>
+#include <vector>
 #include "boost/filesystem.hpp"
 
 namespace kocca {
@@ -19,10 +20,15 @@ namespace kocca {
 			std::string path;
 
 			/**
-			 * The frame time
+			 * The frame time, as found in the file name (in the sequence's time unit, see SequenceMetadata)
 			 */
 			long long time;
 
+			/**
+			 * The index of the frame's entry in the archive the sequence is read from (see Sequence::readDataFromArchive()), or -1 if the frame is a file
+			 */
+			int archiveEntryIndex;
+
 			/**
 			 * Constructor
 			 */
@@ -41,6 +47,15 @@ namespace kocca {
 			 * @return true if the time of framePathA is strictly inferior to the time of framePathB, false otherwise
 			 */
 			static bool compareFramePaths(FramePath framePathA, FramePath framePathB);
+
+			/**
+			 * Gets the rank of the first frame of a list sorted by time whose time is not before a given one (or after it, if strictlyAfter is true), or the size of the list if there's none.
+			 * The lists of long sequences hold tens of thousands of frames, and are searched at each step of the playhead, so it is a binary search.
+			 * @param framesList the frames, sorted by time
+			 * @param time the time to search for
+			 * @param strictlyAfter whether the frames at that very time are skipped or not
+			 */
+			static int getFirstFrameRank(const std::vector<FramePath>& framesList, long long time, bool strictlyAfter);
 		};
 	} // namespace datalib
 } // namespace kocca
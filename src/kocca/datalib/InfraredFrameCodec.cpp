@@ -0,0 +1,306 @@
+#include "InfraredFrameCodec.h"
+#include "../Exceptions.h"
+#include "boost/filesystem.hpp"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+namespace kocca {
+	namespace datalib {
+		namespace {
+			const unsigned char KIR_MAGIC[4] = { 'K', 'I', 'R', '1' };
+
+			/**
+			 * Size of the .kir header : magic number, frame width, frame height and size of the run-length coded high bytes plane, as 32 bits little-endian integers
+			 */
+			const size_t KIR_HEADER_SIZE = 16;
+
+			/**
+			 * Maximum length of a literal sequence in the run-length coded plane
+			 */
+			const size_t RLE_MAX_LITERALS = 128;
+
+			/**
+			 * Minimum and maximum length of a repeated bytes run in the run-length coded plane
+			 */
+			const size_t RLE_MIN_RUN = 3;
+			const size_t RLE_MAX_RUN = 130;
+
+			/**
+			 * Predicts a pixel from the average of its left neighbour and its upper neighbour (only the left one on the first row, only the upper one on the first column)
+			 */
+			inline int predict(const uint16_t* row, const uint16_t* upperRow, int x) {
+				if(upperRow == NULL)
+					return((x > 0) ? row[x - 1] : 0);
+				else if(x == 0)
+					return(upperRow[0]);
+				else
+					return((row[x - 1] + upperRow[x]) >> 1);
+			}
+
+			inline unsigned int zigzag(int residual) {
+				return((((unsigned int)residual << 1) ^ (unsigned int)(residual >> 31)) & 0xFFFF);
+			}
+
+			inline int unzigzag(unsigned int z) {
+				return((int)(z >> 1) ^ -(int)(z & 1));
+			}
+
+			inline void flushLiterals(const unsigned char* input, size_t from, size_t to, std::vector<unsigned char>& output) {
+				while(from < to) {
+					size_t count = std::min(to - from, RLE_MAX_LITERALS);
+					output.push_back((unsigned char)(count - 1));
+					output.insert(output.end(), input + from, input + from + count);
+					from += count;
+				}
+			}
+
+			/**
+			 * Run-length codes a bytes plane : a control byte below 128 announces (c + 1) literal bytes, a control byte c from 128 announces a run of (c - 125) times the next byte.
+			 */
+			void encodeRunLength(const unsigned char* input, size_t size, std::vector<unsigned char>& output) {
+				size_t i = 0;
+				size_t literalsStart = 0;
+
+				while(i < size) {
+					size_t runLength = 1;
+
+					while(((i + runLength) < size) && (runLength < RLE_MAX_RUN) && (input[i + runLength] == input[i]))
+						runLength++;
+
+					if(runLength >= RLE_MIN_RUN) {
+						flushLiterals(input, literalsStart, i, output);
+						output.push_back((unsigned char)(runLength - RLE_MIN_RUN + 128));
+						output.push_back(input[i]);
+						i += runLength;
+						literalsStart = i;
+					}
+					else
+						i++;
+				}
+
+				flushLiterals(input, literalsStart, size, output);
+			}
+
+			/**
+			 * @throws FileReadingException if the coded data is invalid or doesn't decode to exactly size bytes
+			 */
+			void decodeRunLength(const unsigned char* input, size_t inputSize, unsigned char* output, size_t size) {
+				const unsigned char* inputEnd = input + inputSize;
+				unsigned char* outputEnd = output + size;
+
+				while((input < inputEnd) && (output < outputEnd)) {
+					unsigned char control = *(input++);
+
+					if(control < 128) {
+						size_t count = control + 1;
+
+						if(((size_t)(inputEnd - input) < count) || ((size_t)(outputEnd - output) < count))
+							throw FileReadingException("Invalid infrared frame data");
+
+						memcpy(output, input, count);
+						input += count;
+						output += count;
+					}
+					else {
+						size_t count = control - 128 + RLE_MIN_RUN;
+
+						if((input >= inputEnd) || ((size_t)(outputEnd - output) < count))
+							throw FileReadingException("Invalid infrared frame data");
+
+						memset(output, *(input++), count);
+						output += count;
+					}
+				}
+
+				if(output != outputEnd)
+					throw FileReadingException("Truncated infrared frame data");
+			}
+
+			inline void writeUInt32(std::vector<unsigned char>& output, uint32_t value) {
+				output.push_back((unsigned char)(value));
+				output.push_back((unsigned char)(value >> 8));
+				output.push_back((unsigned char)(value >> 16));
+				output.push_back((unsigned char)(value >> 24));
+			}
+
+			inline void writeUInt32(unsigned char* output, uint32_t value) {
+				output[0] = (unsigned char)(value);
+				output[1] = (unsigned char)(value >> 8);
+				output[2] = (unsigned char)(value >> 16);
+				output[3] = (unsigned char)(value >> 24);
+			}
+
+			inline uint32_t readUInt32(const unsigned char* data) {
+				return((uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+			}
+		}
+
+		const char* InfraredFrameCodec::FILE_EXTENSION = ".kir";
+
+		/**
+		 * @throws std::invalid_argument
+		 */
+		void InfraredFrameCodec::encode(const cv::Mat& frame, std::vector<unsigned char>& output) {
+			if(frame.empty() || (frame.type() != CV_16UC1))
+				throw std::invalid_argument("Infrared frame codec only encodes non-empty CV_16UC1 frames");
+
+			size_t pixelsCount = frame.total();
+
+			// residuals planes are kept from one frame to the next, per encoding thread
+			static thread_local std::vector<unsigned char> lowBytes;
+			static thread_local std::vector<unsigned char> highBytes;
+			lowBytes.resize(pixelsCount);
+			highBytes.resize(pixelsCount);
+
+			size_t i = 0;
+
+			for(int y = 0; y < frame.rows; y++) {
+				const uint16_t* row = frame.ptr<uint16_t>(y);
+				const uint16_t* upperRow = (y > 0) ? frame.ptr<uint16_t>(y - 1) : NULL;
+
+				// borders are handled apart, so the inner loop doesn't need any branch
+				int x = (upperRow == NULL) ? 0 : 1;
+
+				if(upperRow != NULL) {
+					unsigned int z = zigzag((int16_t)(uint16_t)(row[0] - upperRow[0]));
+					lowBytes[i] = (unsigned char)z;
+					highBytes[i++] = (unsigned char)(z >> 8);
+				}
+
+				for(; x < frame.cols; x++, i++) {
+					unsigned int z = zigzag((int16_t)(uint16_t)(row[x] - predict(row, upperRow, x)));
+					lowBytes[i] = (unsigned char)z;
+					highBytes[i] = (unsigned char)(z >> 8);
+				}
+			}
+
+			output.clear();
+			output.reserve(KIR_HEADER_SIZE + (pixelsCount * 2));
+			output.insert(output.end(), KIR_MAGIC, KIR_MAGIC + 4);
+			writeUInt32(output, frame.cols);
+			writeUInt32(output, frame.rows);
+			writeUInt32(output, 0); // high bytes plane size, updated once it is coded
+
+			encodeRunLength(highBytes.data(), pixelsCount, output);
+			writeUInt32(&output[12], (uint32_t)(output.size() - KIR_HEADER_SIZE));
+
+			output.insert(output.end(), lowBytes.begin(), lowBytes.end());
+		}
+
+		/**
+		 * @throws FileReadingException
+		 */
+		cv::Mat InfraredFrameCodec::decode(const unsigned char* data, size_t size, bool toneMapTo8Bits) {
+			if((size < KIR_HEADER_SIZE) || (memcmp(data, KIR_MAGIC, 4) != 0))
+				throw FileReadingException("Invalid infrared frame header");
+
+			uint32_t width = readUInt32(data + 4);
+			uint32_t height = readUInt32(data + 8);
+			uint32_t highBytesSize = readUInt32(data + 12);
+
+			if((width == 0) || (height == 0) || (width > 65536) || (height > 65536))
+				throw FileReadingException("Invalid infrared frame dimensions");
+
+			size_t pixelsCount = (size_t)width * height;
+
+			if((size - KIR_HEADER_SIZE) < ((size_t)highBytesSize + pixelsCount))
+				throw FileReadingException("Truncated infrared frame data");
+
+			static thread_local std::vector<unsigned char> highBytes;
+			highBytes.resize(pixelsCount);
+			decodeRunLength(data + KIR_HEADER_SIZE, highBytesSize, highBytes.data(), pixelsCount);
+
+			const unsigned char* lowBytes = data + KIR_HEADER_SIZE + highBytesSize;
+			cv::Mat frame(height, width, (toneMapTo8Bits ? CV_8UC1 : CV_16UC1));
+
+			// when tone-mapping, 16 bits rows are only kept in two alternating buffers (current and upper rows)
+			std::vector<uint16_t> rowsBuffer;
+
+			if(toneMapTo8Bits)
+				rowsBuffer.resize(width * 2);
+
+			size_t i = 0;
+
+			for(int y = 0; y < (int)height; y++) {
+				uint16_t* row;
+				const uint16_t* upperRow = NULL;
+
+				if(toneMapTo8Bits) {
+					row = &rowsBuffer[(y % 2) * width];
+
+					if(y > 0)
+						upperRow = &rowsBuffer[((y - 1) % 2) * width];
+				}
+				else {
+					row = frame.ptr<uint16_t>(y);
+
+					if(y > 0)
+						upperRow = frame.ptr<uint16_t>(y - 1);
+				}
+
+				if(upperRow == NULL) {
+					int previous = 0;
+
+					for(int x = 0; x < (int)width; x++, i++) {
+						previous = (uint16_t)(previous + unzigzag(lowBytes[i] | (highBytes[i] << 8)));
+						row[x] = (uint16_t)previous;
+					}
+				}
+				else {
+					int previous = (uint16_t)(upperRow[0] + unzigzag(lowBytes[i] | (highBytes[i] << 8)));
+					row[0] = (uint16_t)previous;
+					i++;
+
+					// this inner loop is the hot path of the decoding, it has no branch and only one byte of each plane to read per pixel
+					for(int x = 1; x < (int)width; x++, i++) {
+						previous = (uint16_t)(((previous + upperRow[x]) >> 1) + unzigzag(lowBytes[i] | (highBytes[i] << 8)));
+						row[x] = (uint16_t)previous;
+					}
+				}
+
+				if(toneMapTo8Bits) {
+					uint8_t* outputRow = frame.ptr<uint8_t>(y);
+
+					for(int x = 0; x < (int)width; x++)
+						outputRow[x] = (uint8_t)(row[x] >> 8);
+				}
+			}
+
+			return(frame);
+		}
+
+		cv::Mat InfraredFrameCodec::readFrameFile(const std::string& filePath, bool toneMapTo8Bits) {
+			if(isEncodedFile(filePath)) {
+				std::ifstream fileStream(filePath, std::ios::binary | std::ios::ate);
+				std::streamsize fileStreamSize = fileStream.tellg();
+
+				if(fileStreamSize <= 0)
+					return(cv::Mat());
+
+				std::vector<unsigned char> fileContent((size_t)fileStreamSize);
+				fileStream.seekg(0, std::ios::beg);
+
+				if(fileStream.read((char*)fileContent.data(), fileStreamSize)) {
+					try {
+						return(decode(fileContent.data(), fileContent.size(), toneMapTo8Bits));
+					}
+					catch(FileReadingException& fre) {
+						std::cerr << "Error while decoding infrared frame " << filePath << " : " << fre.what() << std::endl;
+					}
+				}
+
+				return(cv::Mat());
+			}
+			else
+				return(cv::imread(filePath, (toneMapTo8Bits ? cv::IMREAD_GRAYSCALE : cv::IMREAD_ANYDEPTH)));
+		}
+
+		bool InfraredFrameCodec::isEncodedFile(const std::string& filePath) {
+			return(boost::filesystem::path(filePath).extension() == FILE_EXTENSION);
+		}
+	} // namespace datalib
+} // namespace kocca
@@ -0,0 +1,61 @@
+#ifndef KOCCA_DATALIB_INFRARED_FRAME_CODEC_H
+#define KOCCA_DATALIB_INFRARED_FRAME_CODEC_H
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace kocca {
+	namespace datalib {
+
+		/**
+		 * A fast lossless codec for the 16 bits infrared frames (.kir files).
+		 * Each pixel is predicted from the average of its left and upper neighbours, and the zigzagged 16 bits prediction residuals are split in two byte planes : the low bytes are stored as they are, the high bytes (mostly zeros) are run-length coded.
+		 * Unlike PNG, there is no deflate stage nor any checksum to compute, so both encoding and decoding are a single pass over the pixels.
+		 * The decoder can also directly emit a 8 bits tone-mapped frame, which is what the display widgets need, without an intermediate 16 bits frame.
+		 */
+		class InfraredFrameCodec {
+		public:
+
+			/**
+			 * The file extension of the infrared frames encoded with this codec.
+			 */
+			static const char* FILE_EXTENSION;
+
+			/**
+			 * Encodes a 16 bits, single channel frame.
+			 * @param frame the frame to encode. It must be of type CV_16UC1
+			 * @param output the buffer where the encoded data will be written. It is cleared first, but its capacity is reused.
+			 * @throws std::invalid_argument if frame is empty or is not a CV_16UC1 frame
+			 */
+			static void encode(const cv::Mat& frame, std::vector<unsigned char>& output);
+
+			/**
+			 * Decodes an encoded frame from a memory buffer.
+			 * @param data the encoded data
+			 * @param size the size of the encoded data, in bytes
+			 * @param toneMapTo8Bits if true, the decoded frame is directly converted to a 8 bits frame (CV_8UC1), the same way cv::IMREAD_GRAYSCALE does for 16 bits PNG files. Otherwise, the original CV_16UC1 frame is returned.
+			 * @return the decoded frame
+			 * @throws FileReadingException if the data is not a valid encoded infrared frame
+			 */
+			static cv::Mat decode(const unsigned char* data, size_t size, bool toneMapTo8Bits = false);
+
+			/**
+			 * Reads an infrared frame file. Both .kir files and image files of older sequences (16 bits PNG) are supported.
+			 * @param filePath the path of the file to read
+			 * @param toneMapTo8Bits if true, a 8 bits frame (CV_8UC1) is returned, otherwise the original 16 bits frame is returned
+			 * @return the decoded frame, or an empty frame if the file couldn't be read
+			 */
+			static cv::Mat readFrameFile(const std::string& filePath, bool toneMapTo8Bits = false);
+
+			/**
+			 * Checks if a file path has the extension of the files encoded with this codec.
+			 * @param filePath the file path to check
+			 * @return true if filePath is a .kir file, false otherwise
+			 */
+			static bool isEncodedFile(const std::string& filePath);
+		};
+	} // namespace datalib
+} // namespace kocca
+
+#endif // KOCCA_DATALIB_INFRARED_FRAME_CODEC_H
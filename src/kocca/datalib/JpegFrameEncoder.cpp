@@ -0,0 +1,134 @@
+#include "JpegFrameEncoder.h"
+#include "../Exceptions.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+namespace kocca {
+	namespace datalib {
+		/**
+		 * @throws FrameEncodingException
+		 */
+		JpegFrameEncoder::JpegFrameEncoder(int _quality, int _chromaSubsampling, bool fastDCT) {
+			quality = std::max(1, std::min(100, _quality));
+			chromaSubsampling = _chromaSubsampling;
+			flags = TJFLAG_NOREALLOC;
+
+			if(fastDCT)
+				flags |= TJFLAG_FASTDCT;
+
+			jpegBuffer = NULL;
+			jpegBufferCapacity = 0;
+			jpegSize = 0;
+			encodedFramesCount = 0;
+			encodedBytesCount = 0;
+			encodingTime = 0;
+
+			compressor = tjInitCompress();
+
+			if(compressor == NULL) {
+				std::ostringstream errMsg;
+				errMsg << "Failed to initialize JPEG compressor : " << tjGetErrorStr();
+				throw FrameEncodingException(errMsg.str().c_str());
+			}
+		}
+
+		JpegFrameEncoder::~JpegFrameEncoder() {
+			if(jpegBuffer != NULL)
+				tjFree(jpegBuffer);
+
+			if(compressor != NULL)
+				tjDestroy(compressor);
+		}
+
+		/**
+		 * @throws FrameEncodingException
+		 */
+		void JpegFrameEncoder::encode(const cv::Mat& frame) {
+			int pixelFormat;
+
+			switch(frame.type()) {
+				case CV_8UC3:
+					pixelFormat = TJPF_RGB;
+					break;
+
+				case CV_8UC4:
+					pixelFormat = TJPF_BGRX;
+					break;
+
+				case CV_8UC1:
+					pixelFormat = TJPF_GRAY;
+					break;
+
+				default:
+					throw FrameEncodingException("Unsupported frame format for JPEG encoding");
+			}
+
+			int subsampling = (pixelFormat == TJPF_GRAY) ? TJSAMP_GRAY : chromaSubsampling;
+			unsigned long requiredCapacity = tjBufSize(frame.cols, frame.rows, subsampling);
+
+			if(requiredCapacity > jpegBufferCapacity) {
+				if(jpegBuffer != NULL)
+					tjFree(jpegBuffer);
+
+				jpegBuffer = tjAlloc((int)requiredCapacity);
+
+				if(jpegBuffer == NULL) {
+					jpegBufferCapacity = 0;
+					throw FrameEncodingException("Failed to allocate JPEG encoding buffer");
+				}
+
+				jpegBufferCapacity = requiredCapacity;
+			}
+
+			jpegSize = jpegBufferCapacity;
+			std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+			if(tjCompress2(compressor, frame.data, frame.cols, (int)frame.step, frame.rows, pixelFormat, &jpegBuffer, &jpegSize, subsampling, quality, flags) != 0) {
+				jpegSize = 0;
+				std::ostringstream errMsg;
+				errMsg << "JPEG encoding failed : " << tjGetErrorStr();
+				throw FrameEncodingException(errMsg.str().c_str());
+			}
+
+			encodingTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+			encodedFramesCount++;
+			encodedBytesCount += jpegSize;
+		}
+
+		const unsigned char* JpegFrameEncoder::getEncodedData() {
+			return(jpegBuffer);
+		}
+
+		unsigned long JpegFrameEncoder::getEncodedSize() {
+			return(jpegSize);
+		}
+
+		unsigned long long JpegFrameEncoder::getEncodedFramesCount() {
+			return(encodedFramesCount);
+		}
+
+		unsigned long long JpegFrameEncoder::getEncodedBytesCount() {
+			return(encodedBytesCount);
+		}
+
+		double JpegFrameEncoder::getEncodingTime() {
+			return(encodingTime);
+		}
+
+		int JpegFrameEncoder::parseChromaSubsampling(const std::string& value, int defaultValue) {
+			if(value == "444")
+				return(TJSAMP_444);
+			else if(value == "422")
+				return(TJSAMP_422);
+			else if(value == "420")
+				return(TJSAMP_420);
+			else if(value == "440")
+				return(TJSAMP_440);
+			else if(value == "gray")
+				return(TJSAMP_GRAY);
+			else
+				return(defaultValue);
+		}
+	} // namespace datalib
+} // namespace kocca
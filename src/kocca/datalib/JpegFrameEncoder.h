@@ -0,0 +1,128 @@
+#ifndef KOCCA_DATALIB_JPEG_FRAME_ENCODER_H
+#define KOCCA_DATALIB_JPEG_FRAME_ENCODER_H
+
+#include <string>
+#include <opencv2/opencv.hpp>
+#include <turbojpeg.h>
+
+namespace kocca {
+	namespace datalib {
+
+		/**
+		 * Encodes color image frames to JPEG through libjpeg-turbo's TurboJPEG API.
+		 * An encoder owns its compressor handle and its output buffer, both are reused from one frame to the next : each writing thread should use its own encoder.
+		 * Frames are encoded straight from their memory layout (RGB, BGRA or grayscale), without any intermediate color conversion.
+		 */
+		class JpegFrameEncoder {
+		protected:
+
+			/**
+			 * The TurboJPEG compressor handle.
+			 */
+			tjhandle compressor;
+
+			/**
+			 * The JPEG quality, from 1 to 100.
+			 */
+			int quality;
+
+			/**
+			 * The chroma subsampling (one of TurboJPEG's TJSAMP_XXX values).
+			 */
+			int chromaSubsampling;
+
+			/**
+			 * The TurboJPEG flags used for compression.
+			 */
+			int flags;
+
+			/**
+			 * The buffer that receives the encoded data. It is allocated once for the largest possible JPEG size of the frames, so TurboJPEG never has to reallocate it.
+			 */
+			unsigned char* jpegBuffer;
+
+			/**
+			 * The allocated size of jpegBuffer, in bytes.
+			 */
+			unsigned long jpegBufferCapacity;
+
+			/**
+			 * The size of the latest encoded frame, in bytes.
+			 */
+			unsigned long jpegSize;
+
+			/**
+			 * The number of frames encoded by this encoder.
+			 */
+			unsigned long long encodedFramesCount;
+
+			/**
+			 * The total size of the frames encoded by this encoder, in bytes.
+			 */
+			unsigned long long encodedBytesCount;
+
+			/**
+			 * The total time spent encoding frames, in milliseconds.
+			 */
+			double encodingTime;
+
+		public:
+
+			/**
+			 * Constructor.
+			 * @param _quality the JPEG quality, from 1 to 100
+			 * @param _chromaSubsampling the chroma subsampling, as one of TurboJPEG's TJSAMP_XXX values
+			 * @param fastDCT whether or not to use the fastest (but less accurate) DCT algorithm
+			 * @throws FrameEncodingException if the TurboJPEG compressor couldn't be initialized
+			 */
+			JpegFrameEncoder(int _quality = 100, int _chromaSubsampling = TJSAMP_420, bool fastDCT = false);
+
+			/**
+			 * Destructor.
+			 */
+			~JpegFrameEncoder();
+
+			/**
+			 * Encodes a frame. The encoded data is then available through getEncodedData() and getEncodedSize(), until the next call to encode().
+			 * @param frame the frame to encode. It must be a CV_8UC3 (RGB), CV_8UC4 (BGRA) or CV_8UC1 (grayscale) frame
+			 * @throws FrameEncodingException if the frame format is not supported or if TurboJPEG failed to encode it
+			 */
+			void encode(const cv::Mat& frame);
+
+			/**
+			 * Gets the data of the latest encoded frame.
+			 */
+			const unsigned char* getEncodedData();
+
+			/**
+			 * Gets the size of the latest encoded frame, in bytes.
+			 */
+			unsigned long getEncodedSize();
+
+			/**
+			 * Gets the number of frames encoded by this encoder.
+			 */
+			unsigned long long getEncodedFramesCount();
+
+			/**
+			 * Gets the total size of the frames encoded by this encoder, in bytes.
+			 */
+			unsigned long long getEncodedBytesCount();
+
+			/**
+			 * Gets the total time spent by this encoder encoding frames, in milliseconds.
+			 */
+			double getEncodingTime();
+
+			/**
+			 * Parses a chroma subsampling setting value ("444", "422", "420", "440" or "gray").
+			 * @param value the setting value
+			 * @param defaultValue the value to return if value is not a valid chroma subsampling
+			 * @return the chroma subsampling, as one of TurboJPEG's TJSAMP_XXX values
+			 */
+			static int parseChromaSubsampling(const std::string& value, int defaultValue = TJSAMP_420);
+		};
+	} // namespace datalib
+} // namespace kocca
+
+#endif // KOCCA_DATALIB_JPEG_FRAME_ENCODER_H
@@ -14,7 +14,7 @@ namespace kocca {
 		public:
 
 			/**
-			 * The time of the frame, in milliseconds
+			 * The time of the frame, in microseconds
 			 */
 			long long time;
 
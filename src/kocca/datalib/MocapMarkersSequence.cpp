@@ -5,6 +5,30 @@
 
 namespace kocca {
 	namespace datalib {
+		namespace {
+			/**
+			 * Gets the rank of the first frame of a list sorted by time whose time is not before a given one (or after it, if strictlyAfter is true), or the size of the list if there's none. It is a binary search, as the MoCap stream is the densest one.
+			 */
+			int getFirstFrameRank(const std::vector<MocapMarkerFrame>& markersData, unsigned long long time, bool strictlyAfter) {
+				int first = 0;
+				int count = (int)markersData.size();
+
+				while(count > 0) {
+					int step = count / 2;
+					unsigned long long frameTime = (unsigned long long)markersData.at(first + step).time;
+
+					if((frameTime < time) || (strictlyAfter && (frameTime == time))) {
+						first += step + 1;
+						count -= step + 1;
+					}
+					else
+						count = step;
+				}
+
+				return(first);
+			}
+		}
+
 		void MocapMarkersSequence::addFrame(MocapMarkerFrame frame) {
 			markersData.push_back(frame);
 		}
@@ -35,9 +59,11 @@ namespace kocca {
 			int rank = -1;
 
 			if(markersData.size() > 1) {
-				for(int i = 1; (rank == -1) && (i < markersData.size()); i++)
-					if(markersData.at(i).time > time)
-						rank = i-1;
+				int nextRank = getFirstFrameRank(markersData, time, true);
+
+				// there's no frame at all after the last one
+				if(nextRank < markersData.size())
+					rank = (nextRank > 1) ? (nextRank - 1) : 0;
 			}
 			else
 				if((markersData.size() == 1) && (markersData.at(0).time <= time))
@@ -49,14 +75,9 @@ namespace kocca {
 		/**
 		 * @throws EmptySequenceStreamException
 		 */
-		int MocapMarkersSequence::getNextFrameTime(unsigned long long time) {
+		unsigned long long MocapMarkersSequence::getNextFrameTime(unsigned long long time) {
 			if(!markersData.empty()) {
-				int i = 0;
-
-				while((i < markersData.size()) && (markersData.at(i).time <= time))
-					i++;
-
-				return(markersData.at(i).time);
+				return(markersData.at(getFirstFrameRank(markersData, time, true)).time);
 			}
 			else
 				throw EmptySequenceStreamException("No image frame available");
@@ -65,14 +86,10 @@ namespace kocca {
 		/**
 		 * @throws EmptySequenceStreamException
 		 */
-		int MocapMarkersSequence::getPreviousFrameTime(unsigned long long time) {
+		unsigned long long MocapMarkersSequence::getPreviousFrameTime(unsigned long long time) {
 			if(!markersData.empty()) 	{
-				int i = 0;
-
-				while((i < markersData.size() - 1) && (markersData.at(i+1).time < time))
-					i++;
-
-				return(markersData.at(i).time);
+				int rank = getFirstFrameRank(markersData, time, false);
+				return(markersData.at((rank > 1) ? (rank - 1) : 0).time);
 			}
 			else
 				throw EmptySequenceStreamException("No image frame available");
@@ -38,7 +38,7 @@ namespace kocca {
 			 * @return the time of the next sequence found after the time argument
 			 * @throws EmptySequenceStreamException if the current MocapMarkersSequence doesn't have any MocapMarkerFrame
 			 */
-			int getNextFrameTime(unsigned long long time);
+			unsigned long long getNextFrameTime(unsigned long long time);
 
 			/**
 			 * Gets the time of the previous frame that occured just before the time in argument. Useful for frame-by-frame navigation.
@@ -46,7 +46,7 @@ namespace kocca {
 			 * @return the time of the previous sequence found before the time argument
 			 * @throws EmptySequenceStreamException if the current MocapMarkersSequence doesn't have any MocapMarkerFrame
 			 */
-			int getPreviousFrameTime(unsigned long long time);
+			unsigned long long getPreviousFrameTime(unsigned long long time);
 
 			/**
 			 * Gets the MocapMarkerFrame that should be displayed at the time given in argument
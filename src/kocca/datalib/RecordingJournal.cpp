@@ -0,0 +1,408 @@
+#include "RecordingJournal.h"
+#include "../Exceptions.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#define MINIZ_HEADER_FILE_ONLY
+#include "miniz.c"
+
+#ifdef _WIN32
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif // _WIN32
+
+namespace kocca {
+	namespace datalib {
+		namespace {
+			/**
+			 * The first bytes of a journal file, followed by its version on 4 bytes.
+			 */
+			const char JOURNAL_MAGIC[8] = {'K', 'O', 'C', 'C', 'A', 'J', 'N', 'L'};
+			const unsigned int JOURNAL_VERSION = 1;
+
+			/**
+			 * The types of the records.
+			 */
+			const unsigned int RECORD_FRAME = 1;
+			const unsigned int RECORD_MARKERS_FRAME = 2;
+			const unsigned int RECORD_SYNC = 3;
+
+			// the values are written in little endian, whatever the platform
+			void putInteger(std::string& output, unsigned long long value, int bytesCount) {
+				for(int i = 0; i < bytesCount; i++)
+					output.push_back((char)((value >> (8 * i)) & 0xFF));
+			}
+
+			void putDouble(std::string& output, double value) {
+				unsigned long long bits;
+				memcpy(&bits, &value, sizeof(bits));
+				putInteger(output, bits, 8);
+			}
+
+			void putString(std::string& output, const std::string& value) {
+				putInteger(output, value.length(), 2);
+				output.append(value, 0, (value.length() < 0xFFFF) ? value.length() : 0xFFFF);
+			}
+
+			/**
+			 * Reads the values of a record, and remembers if the record was too short for them.
+			 */
+			class RecordReader {
+			protected:
+				const unsigned char* data;
+				size_t size;
+				size_t position;
+
+			public:
+				bool overflow;
+
+				RecordReader(const unsigned char* _data, size_t _size) {
+					data = _data;
+					size = _size;
+					position = 0;
+					overflow = false;
+				}
+
+				unsigned long long getInteger(int bytesCount) {
+					if((position + bytesCount) > size) {
+						overflow = true;
+						return(0);
+					}
+
+					unsigned long long value = 0;
+
+					for(int i = 0; i < bytesCount; i++)
+						value |= ((unsigned long long)data[position + i]) << (8 * i);
+
+					position += bytesCount;
+					return(value);
+				}
+
+				double getDouble() {
+					unsigned long long bits = getInteger(8);
+					double value;
+					memcpy(&value, &bits, sizeof(value));
+					return(value);
+				}
+
+				std::string getString() {
+					size_t length = (size_t)getInteger(2);
+
+					if(overflow || ((position + length) > size)) {
+						overflow = true;
+						return(std::string());
+					}
+
+					std::string value((const char*)(data + position), length);
+					position += length;
+					return(value);
+				}
+			};
+
+			unsigned int getChecksum(const unsigned char* data, size_t size) {
+				return((unsigned int)mz_crc32(MZ_CRC32_INIT, data, size));
+			}
+		}
+
+		const char* RecordingJournal::FILE_NAME = "recording.journal";
+
+		/**
+		 * @throws FileWritingException
+		 */
+		RecordingJournal::RecordingJournal(boost::filesystem::path _rootDirectory, FrameFileWriter* _frameFileWriter, int _batchSize) {
+			rootDirectory = _rootDirectory;
+			frameFileWriter = _frameFileWriter;
+			batchSize = (_batchSize > 0) ? _batchSize : 1;
+			pendingRecordsCount = 0;
+
+			boost::filesystem::path filePath = rootDirectory / FILE_NAME;
+			file = fopen(filePath.string().c_str(), "wb");
+
+			if(file == NULL) {
+				std::ostringstream errMsg;
+				errMsg << "Unable to create recording journal " << filePath.string();
+				throw FileWritingException(errMsg.str().c_str());
+			}
+
+			std::string header(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+			putInteger(header, JOURNAL_VERSION, 4);
+
+			if(fwrite(header.data(), 1, header.length(), file) != header.length()) {
+				fclose(file);
+				file = NULL;
+				std::ostringstream errMsg;
+				errMsg << "Unable to write recording journal " << filePath.string();
+				throw FileWritingException(errMsg.str().c_str());
+			}
+		}
+
+		RecordingJournal::~RecordingJournal() {
+			try {
+				sync();
+			}
+			catch(std::exception& e) {
+				std::cerr << e.what() << std::endl;
+			}
+
+			if(file != NULL)
+				fclose(file);
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void RecordingJournal::appendRecord(unsigned int type, const std::string& payload) {
+			std::string record;
+			putInteger(record, type, 4);
+			putInteger(record, payload.length(), 4);
+			record.append(payload);
+			putInteger(record, getChecksum((const unsigned char*)record.data(), record.length()), 4);
+
+			pendingRecords_mutex.lock();
+
+			if(file == NULL) {
+				pendingRecords_mutex.unlock();
+				return;
+			}
+
+			pendingRecords.append(record);
+			bool batchIsFull = (++pendingRecordsCount >= batchSize);
+			pendingRecords_mutex.unlock();
+
+			if(batchIsFull)
+				sync();
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void RecordingJournal::appendFrame(const char* streamFolderName, unsigned long long time, const boost::filesystem::path& framePath, const unsigned char* data, size_t size) {
+			// the paths inside the root directory are relative, so the journal still applies once the folder is renamed
+			std::string rootDirectoryString = rootDirectory.string();
+			std::string framePathString = framePath.string();
+
+			if((framePathString.length() > (rootDirectoryString.length() + 1)) && (framePathString.compare(0, rootDirectoryString.length(), rootDirectoryString) == 0))
+				framePathString = framePathString.substr(rootDirectoryString.length() + 1);
+
+			std::string payload;
+			putString(payload, streamFolderName);
+			putInteger(payload, time, 8);
+			putString(payload, framePathString);
+			putInteger(payload, size, 8);
+			putInteger(payload, getChecksum(data, size), 4);
+			appendRecord(RECORD_FRAME, payload);
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void RecordingJournal::appendMarkersFrame(MocapMarkerFrame& markersFrame) {
+			std::string payload;
+			putInteger(payload, (unsigned long long)markersFrame.time, 8);
+			putInteger(payload, markersFrame.getMarkersCount(), 4);
+
+			for(int i = 0; i < markersFrame.getMarkersCount(); i++) {
+				MocapMarker* marker = markersFrame.getMarkerByRank(i);
+				putString(payload, marker->name);
+				putDouble(payload, marker->coords.x);
+				putDouble(payload, marker->coords.y);
+				putDouble(payload, marker->coords.z);
+			}
+
+			appendRecord(RECORD_MARKERS_FRAME, payload);
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void RecordingJournal::sync() {
+			file_mutex.lock();
+
+			pendingRecords_mutex.lock();
+			std::string batch;
+			batch.swap(pendingRecords);
+			int batchRecordsCount = pendingRecordsCount;
+			pendingRecordsCount = 0;
+			pendingRecords_mutex.unlock();
+
+			if((batchRecordsCount > 0) && (file != NULL)) {
+				// the files of the frames of the batch may still be in flight, or in the page cache : they must be durable before the sync record vouches for them
+				if(frameFileWriter != NULL) {
+					try {
+						frameFileWriter->flush(true);
+					}
+					catch(std::exception& e) {
+						file_mutex.unlock();
+						throw;
+					}
+				}
+
+				// the sync record tells the replay that the frames before it were durable
+				std::string syncRecord;
+				putInteger(syncRecord, RECORD_SYNC, 4);
+				putInteger(syncRecord, 0, 4);
+				putInteger(syncRecord, getChecksum((const unsigned char*)syncRecord.data(), syncRecord.length()), 4);
+				batch.append(syncRecord);
+
+				bool written = (fwrite(batch.data(), 1, batch.length(), file) == batch.length()) && (fflush(file) == 0);
+
+#ifdef _WIN32
+				written = written && (_commit(_fileno(file)) == 0);
+#else
+				written = written && (fsync(fileno(file)) == 0);
+#endif // _WIN32
+
+				if(!written) {
+					file_mutex.unlock();
+					throw FileWritingException("Unable to write the recording journal");
+				}
+			}
+
+			file_mutex.unlock();
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void RecordingJournal::complete() {
+			file_mutex.lock();
+
+			try {
+				if(frameFileWriter != NULL)
+					frameFileWriter->flush(true);
+			}
+			catch(std::exception& e) {
+				file_mutex.unlock();
+				throw;
+			}
+
+			// the pending records are dropped with the file : the frames they list are complete and synced
+			pendingRecords_mutex.lock();
+			pendingRecords.clear();
+			pendingRecordsCount = 0;
+
+			if(file != NULL) {
+				fclose(file);
+				file = NULL;
+			}
+
+			pendingRecords_mutex.unlock();
+
+			boost::system::error_code ec;
+			boost::filesystem::remove(rootDirectory / FILE_NAME, ec);
+
+			file_mutex.unlock();
+		}
+
+		bool RecordingJournal::read(const boost::filesystem::path& filePath, std::vector<JournaledFrame>& frames, std::vector<MocapMarkerFrame>& markersFrames) {
+			std::ifstream journalFile(filePath.string().c_str(), std::ios::in | std::ios::binary);
+
+			if(!journalFile.is_open())
+				return(false);
+
+			std::string content((std::istreambuf_iterator<char>(journalFile)), std::istreambuf_iterator<char>());
+			journalFile.close();
+
+			const unsigned char* data = (const unsigned char*)content.data();
+			size_t headerSize = sizeof(JOURNAL_MAGIC) + 4;
+
+			if((content.length() < headerSize) || (memcmp(data, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0))
+				return(false);
+
+			RecordReader headerReader(data + sizeof(JOURNAL_MAGIC), 4);
+
+			if(headerReader.getInteger(4) != JOURNAL_VERSION)
+				return(false);
+
+			size_t position = headerSize;
+			size_t unsyncedFramesIndex = frames.size();
+
+			// the replay stops at the first torn record : the ones after it were written later, and can't be trusted
+			while((position + 12) <= content.length()) {
+				RecordReader recordHeaderReader(data + position, 8);
+				unsigned int type = (unsigned int)recordHeaderReader.getInteger(4);
+				size_t payloadSize = (size_t)recordHeaderReader.getInteger(4);
+
+				if((position + 8 + payloadSize + 4) > content.length())
+					break;
+
+				RecordReader checksumReader(data + position + 8 + payloadSize, 4);
+
+				if(checksumReader.getInteger(4) != getChecksum(data + position, 8 + payloadSize))
+					break;
+
+				RecordReader reader(data + position + 8, payloadSize);
+
+				if(type == RECORD_FRAME) {
+					JournaledFrame frame;
+					frame.streamFolderName = reader.getString();
+					frame.time = reader.getInteger(8);
+					frame.path = reader.getString();
+					frame.size = reader.getInteger(8);
+					frame.checksum = (unsigned int)reader.getInteger(4);
+					frame.synced = false;
+
+					if(reader.overflow)
+						break;
+
+					frames.push_back(frame);
+				}
+				else if(type == RECORD_MARKERS_FRAME) {
+					MocapMarkerFrame markersFrame((long long)reader.getInteger(8));
+					unsigned int markersCount = (unsigned int)reader.getInteger(4);
+
+					for(unsigned int i = 0; (i < markersCount) && !reader.overflow; i++) {
+						std::string name = reader.getString();
+						double x = reader.getDouble();
+						double y = reader.getDouble();
+						double z = reader.getDouble();
+
+						if(!reader.overflow && !markersFrame.hasMarkerWithName(name))
+							markersFrame.add_marker(MocapMarker(x, y, z, name));
+					}
+
+					if(reader.overflow)
+						break;
+
+					markersFrames.push_back(markersFrame);
+				}
+				else if(type == RECORD_SYNC) {
+					for(size_t i = unsyncedFramesIndex; i < frames.size(); i++)
+						frames.at(i).synced = true;
+
+					unsyncedFramesIndex = frames.size();
+				}
+
+				position += 8 + payloadSize + 4;
+			}
+
+			return(true);
+		}
+
+		boost::filesystem::path RecordingJournal::checkFrame(const boost::filesystem::path& rootDirectory, const JournaledFrame& frame, bool checkContent) {
+			boost::filesystem::path framePath(frame.path);
+
+			if(!framePath.is_absolute())
+				framePath = rootDirectory / framePath;
+
+			boost::system::error_code ec;
+			unsigned long long fileSize = boost::filesystem::file_size(framePath, ec);
+
+			if(ec || (fileSize != frame.size))
+				return(boost::filesystem::path());
+
+			if(checkContent) {
+				std::ifstream frameFile(framePath.string().c_str(), std::ios::in | std::ios::binary);
+				std::vector<unsigned char> content((size_t)fileSize);
+
+				if(!frameFile.is_open() || !frameFile.read((char*)content.data(), content.size()) || (getChecksum(content.data(), content.size()) != frame.checksum))
+					return(boost::filesystem::path());
+			}
+
+			return(framePath);
+		}
+	} // namespace datalib
+} // namespace kocca
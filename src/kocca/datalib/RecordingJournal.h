@@ -0,0 +1,153 @@
+#ifndef KOCCA_DATALIB_RECORDING_JOURNAL_H
+#define KOCCA_DATALIB_RECORDING_JOURNAL_H
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem.hpp"
+#include "FrameFileWriter.h"
+#include "MocapMarkerFrame.h"
+
+namespace kocca {
+	namespace datalib {
+
+		/**
+		 * A frame listed in a recording journal.
+		 */
+		struct JournaledFrame {
+			std::string streamFolderName; /**< The folder name of the frame's stream ("image", "infrared" or "depth") */
+			unsigned long long time; /**< The time of the frame in the sequence, in microseconds */
+			std::string path; /**< The path of the frame file, relative to the sequence's root directory if it is inside it, absolute otherwise */
+			unsigned long long size; /**< The size of the frame file, in bytes */
+			unsigned int checksum; /**< The CRC-32 of the frame file's content */
+			bool synced; /**< Whether or not a sync record followed the frame in the journal, see RecordingJournal::read() */
+		};
+
+		/**
+		 * A write-ahead journal of a sequence being recorded as loose files : a frame is appended to it once its file has been handed to the frame files writer, along with its size and checksum, and so is each MoCap markers frame. With an asynchronous writer, the record may precede the completion of the file.
+		 * The journal is an append-only binary file in the sequence's root directory. Records are buffered in memory and written in batches : the frame files writer is flushed and synced first, so the files of the batch are durable, then the batch is written, ending with a sync record, and followed by a fsync. A crash loses at most the latest batch. Each record has a CRC-32, so a record torn by a crash is detected and ends the replay.
+		 * After a crash, the sequence is restored from its journal (see Sequence::readDataFromRootDirectory()) instead of scanning its folders and parsing its frames names : the frames whose file doesn't have the journaled size, or whose content doesn't match its checksum (checked for the frames that followed the latest sync record only), are discarded as torn.
+		 * Records can be appended from several threads at the same time.
+		 */
+		class RecordingJournal {
+		protected:
+
+			/**
+			 * The journal file.
+			 */
+			FILE* file;
+
+			/**
+			 * The root directory of the sequence, to store the frames paths relative to it.
+			 */
+			boost::filesystem::path rootDirectory;
+
+			/**
+			 * The writer of the journaled frames files, flushed before each batch, or NULL.
+			 */
+			FrameFileWriter* frameFileWriter;
+
+			/**
+			 * The records appended since the latest batch was written, and their number.
+			 */
+			std::string pendingRecords;
+			int pendingRecordsCount;
+
+			/**
+			 * The number of records after which a batch is written.
+			 */
+			int batchSize;
+
+			/**
+			 * A lock to prevent access conflicts to pendingRecords and pendingRecordsCount.
+			 */
+			std::mutex pendingRecords_mutex;
+
+			/**
+			 * A lock that serializes the writing of the batches, so they are written in order.
+			 */
+			std::mutex file_mutex;
+
+			/**
+			 * Appends a record to pendingRecords, and writes the batch if it is full.
+			 * @param type the type of the record
+			 * @param payload the content of the record
+			 * @throws FileWritingException if the batch couldn't be written
+			 */
+			void appendRecord(unsigned int type, const std::string& payload);
+
+		public:
+
+			/**
+			 * The name of the journal file, in the sequence's root directory.
+			 */
+			static const char* FILE_NAME;
+
+			/**
+			 * Constructor. Creates the journal file, replacing any previous one.
+			 * @param _rootDirectory the root directory of the sequence
+			 * @param _frameFileWriter the writer of the journaled frames files, which must outlive the journal, or NULL if the frames files are complete and synced before they are journaled
+			 * @param _batchSize the number of records after which a batch is written
+			 * @throws FileWritingException if the journal file couldn't be created
+			 */
+			RecordingJournal(boost::filesystem::path _rootDirectory, FrameFileWriter* _frameFileWriter, int _batchSize = 256);
+
+			/**
+			 * Destructor. Writes the pending records, then closes the journal file, unless complete() has been called.
+			 */
+			~RecordingJournal();
+
+			/**
+			 * Appends a frame whose file has been handed to the frame files writer.
+			 * @param streamFolderName the folder name of the frame's stream
+			 * @param time the time of the frame in the sequence, in microseconds
+			 * @param framePath the path of the frame file
+			 * @param data the content of the frame file, to compute its checksum
+			 * @param size the size of the content, in bytes
+			 * @throws FileWritingException if a batch couldn't be written
+			 */
+			void appendFrame(const char* streamFolderName, unsigned long long time, const boost::filesystem::path& framePath, const unsigned char* data, size_t size);
+
+			/**
+			 * Appends a MoCap markers frame.
+			 * @param markersFrame the markers frame, with its time in the sequence
+			 * @throws FileWritingException if a batch couldn't be written
+			 */
+			void appendMarkersFrame(MocapMarkerFrame& markersFrame);
+
+			/**
+			 * Flushes and syncs the frame files writer, then writes the pending records as a batch, followed by a sync record, and makes them durable.
+			 * @throws FileWritingException if the frames files or the batch couldn't be written
+			 */
+			void sync();
+
+			/**
+			 * Ends the journal of a recording that stopped cleanly : the frames files are synced, then the journal file is closed and deleted, as the sequence no longer needs to be restored from it. The records appended afterwards are ignored.
+			 * @throws FileWritingException if the frames files couldn't be synced
+			 */
+			void complete();
+
+			/**
+			 * Reads a journal, up to its end or to its first torn record.
+			 * @param filePath the path of the journal file
+			 * @param frames receives the journaled frames, in the order of the journal
+			 * @param markersFrames receives the journaled markers frames, in the order of the journal
+			 * @return false if the file is not a readable journal
+			 */
+			static bool read(const boost::filesystem::path& filePath, std::vector<JournaledFrame>& frames, std::vector<MocapMarkerFrame>& markersFrames);
+
+			/**
+			 * Checks that the file of a journaled frame is complete : it must have the journaled size and, if asked, the journaled checksum.
+			 * @param rootDirectory the root directory of the sequence
+			 * @param frame the journaled frame
+			 * @param checkContent whether or not the content of the file is read to check its checksum
+			 * @return the path of the frame file, or an empty path if the frame is torn
+			 */
+			static boost::filesystem::path checkFrame(const boost::filesystem::path& rootDirectory, const JournaledFrame& frame, bool checkContent);
+		};
+	} // namespace datalib
+} // namespace kocca
+
+#endif // KOCCA_DATALIB_RECORDING_JOURNAL_H
@@ -1,15 +1,25 @@
 #include "Sequence.h"
 #include "../Exceptions.h"
+#include "InfraredFrameCodec.h"
+#include "RecordingJournal.h"
 #include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
 
 namespace kocca {
 	namespace datalib {
+		const char* Sequence::STATISTICS_FILE_NAME = "recording_statistics.csv";
+		const char* Sequence::STREAM_FOLDER_NAMES[Sequence::IMAGE_STREAMS_COUNT] = {"image", "infrared", "depth"};
+
 		Sequence::Sequence() {
 			intrinsicIRCalibrationParameters = NULL;
 			intrinsicRGBCalibrationParameters = NULL;
 			extrinsicIRCalibrationParameters = NULL;
 			extrinsicRGBCalibrationParameters = NULL;
 			calibrationFile = new KinectCalibrationFile();
+			archiveReader = NULL;
 		}
 
 		IntrinsicCalibrationParametersSet* Sequence::getIntrinsicIRCalibrationParameters() {
@@ -107,6 +117,42 @@ namespace kocca {
 				taskProgress->incrementProgress(5);
 		}
 
+		/**
+		 * @throws FileReadingException
+		 */
+		void Sequence::readMetadata() {
+			metadata.loadFromFile(rootDirectory / SequenceMetadata::FILE_NAME);
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void Sequence::writeMetadata() {
+			metadata.writeToFile(rootDirectory / SequenceMetadata::FILE_NAME);
+		}
+
+		SequenceMetadata* Sequence::getMetadata() {
+			return(&metadata);
+		}
+
+		void Sequence::convertTimesToMicroseconds(unsigned long long microsecondsPerTimeUnit) {
+			if(microsecondsPerTimeUnit != 1) {
+				for(int i = 0; i < imageFramesList.size(); i++)
+					imageFramesList.at(i).time *= microsecondsPerTimeUnit;
+
+				for(int i = 0; i < irFramesList.size(); i++)
+					irFramesList.at(i).time *= microsecondsPerTimeUnit;
+
+				for(int i = 0; i < depthFramesList.size(); i++)
+					depthFramesList.at(i).time *= microsecondsPerTimeUnit;
+
+				for(int i = 0; i < markersSequence.markersData.size(); i++)
+					markersSequence.markersData.at(i).time *= microsecondsPerTimeUnit;
+			}
+
+			metadata.set(SequenceMetadata::TIME_UNIT_KEY, SequenceMetadata::TIME_UNIT_MICROSECONDS);
+		}
+
 		void Sequence::parseMarkersData(TaskProgress* taskProgress) {
 			boost::filesystem::path markersDataFilePath = rootDirectory / "markersData.csv";
 
@@ -132,6 +178,96 @@ namespace kocca {
 			}
 		}
 
+		void Sequence::indexStreamFrameFiles(const char* streamFolderName, std::vector<FramePath>* framesList, TaskProgress* taskProgress, float progressIncrement) {
+			std::vector<boost::filesystem::path> streamDirectories = getStreamDirectories(streamFolderName);
+
+			for(int i = 0; i < streamDirectories.size(); i++)
+				indexFrameFiles(streamDirectories.at(i), framesList, taskProgress, progressIncrement / streamDirectories.size());
+		}
+
+		bool Sequence::readRecordingJournal(TaskProgress* taskProgress, float progressIncrement) {
+			boost::filesystem::path journalFilePath = rootDirectory / RecordingJournal::FILE_NAME;
+			std::vector<JournaledFrame> journaledFrames;
+			std::vector<MocapMarkerFrame> journaledMarkersFrames;
+
+			if(!boost::filesystem::is_regular_file(journalFilePath) || !RecordingJournal::read(journalFilePath, journaledFrames, journaledMarkersFrames))
+				return(false);
+
+			int tornFramesCount = 0;
+
+			for(int i = 0; i < journaledFrames.size(); i++) {
+				const JournaledFrame& journaledFrame = journaledFrames.at(i);
+
+				// the content of the frames journaled after the latest sync may not have reached the disk : their checksum is checked too
+				boost::filesystem::path framePath = RecordingJournal::checkFrame(rootDirectory, journaledFrame, !journaledFrame.synced);
+
+				if(framePath.empty())
+					tornFramesCount++;
+				else {
+					FramePath frame;
+					frame.path = framePath.string();
+					frame.time = (long long)journaledFrame.time;
+
+					if(journaledFrame.streamFolderName == "image")
+						imageFramesList.push_back(frame);
+					else if(journaledFrame.streamFolderName == "infrared")
+						irFramesList.push_back(frame);
+					else if(journaledFrame.streamFolderName == "depth")
+						depthFramesList.push_back(frame);
+				}
+
+				if(taskProgress != NULL)
+					taskProgress->incrementProgress((progressIncrement * 0.9f) / journaledFrames.size());
+			}
+
+			// the frames of a stream are journaled in the order their writing ends, which isn't always the order of their times
+			std::sort(imageFramesList.begin(), imageFramesList.end(), FramePath::compareFramePaths);
+			std::sort(irFramesList.begin(), irFramesList.end(), FramePath::compareFramePaths);
+			std::sort(depthFramesList.begin(), depthFramesList.end(), FramePath::compareFramePaths);
+
+			std::sort(journaledMarkersFrames.begin(), journaledMarkersFrames.end(), MocapMarkerFrame::compareFrameTimes);
+
+			for(int i = 0; i < journaledMarkersFrames.size(); i++)
+				markersSequence.addFrame(journaledMarkersFrames.at(i));
+
+			if(taskProgress != NULL)
+				taskProgress->incrementProgress(progressIncrement * 0.1f);
+
+			if(tornFramesCount > 0)
+				std::cerr << "Recording journal : " << tornFramesCount << " torn frames discarded out of " << journaledFrames.size() << std::endl;
+
+			return(true);
+		}
+
+		std::vector<boost::filesystem::path> Sequence::getStreamDirectories(const char* streamFolderName) {
+			std::vector<boost::filesystem::path> streamDirectories = metadata.getStreamDirectories(streamFolderName);
+			streamDirectories.insert(streamDirectories.begin(), rootDirectory / streamFolderName);
+			return(streamDirectories);
+		}
+
+		void Sequence::removeExternalStreamDirectories() {
+			for(int i = 0; i < IMAGE_STREAMS_COUNT; i++) {
+				std::vector<boost::filesystem::path> streamDirectories = metadata.getStreamDirectories(STREAM_FOLDER_NAMES[i]);
+
+				for(int j = 0; j < streamDirectories.size(); j++) {
+					try {
+						if(streamDirectories.at(j) != (rootDirectory / STREAM_FOLDER_NAMES[i])) {
+							boost::filesystem::remove_all(streamDirectories.at(j));
+
+							// the parent folder was created for this sequence only
+							boost::filesystem::path sequenceDirectory = streamDirectories.at(j).parent_path();
+
+							if(boost::filesystem::exists(sequenceDirectory) && boost::filesystem::is_empty(sequenceDirectory))
+								boost::filesystem::remove(sequenceDirectory);
+						}
+					}
+					catch(boost::filesystem::filesystem_error fse) {
+						// folder is not available anymore (ex : disk unplugged), we do nothing
+					}
+				}
+			}
+		}
+
 		/**
 		 * @throws InvalidKinectCalibrationFileException
 		 * @throws TempFolderNotAvailableException
@@ -142,20 +278,26 @@ namespace kocca {
 		 */
 		void Sequence::readDataFromRootDirectory(TaskProgress* taskProgress) {
 			if(boost::filesystem::exists(rootDirectory) && boost::filesystem::is_directory(rootDirectory)) {
-				// parse markers data
-				parseMarkersData(taskProgress);
-				taskProgress->incrementProgress(10);
-		
-				// index images frames
-				boost::filesystem::path imageFramesDirectory = rootDirectory / "image";
-				indexFrameFiles(imageFramesDirectory, &imageFramesList, taskProgress, 26);
+				// read metadata, to know the time unit of the data
+				readMetadata();
 
-				boost::filesystem::path irFramesDirectory = rootDirectory / "infrared";
-				indexFrameFiles(irFramesDirectory, &irFramesList, taskProgress, 26);
+				// an interrupted recording is restored from its journal, without scanning its folders
+				if(!readRecordingJournal(taskProgress, 88)) {
+					// parse markers data
+					parseMarkersData(taskProgress);
+					taskProgress->incrementProgress(10);
+
+					// index images frames
+					indexStreamFrameFiles("image", &imageFramesList, taskProgress, 26);
+
+					indexStreamFrameFiles("infrared", &irFramesList, taskProgress, 26);
+
+					// index depth frames
+					indexStreamFrameFiles("depth", &depthFramesList, taskProgress, 26);
+				}
 
-				// index depth frames
-				boost::filesystem::path depthFramesDirectory = rootDirectory / "depth";
-				indexFrameFiles(depthFramesDirectory, &depthFramesList, taskProgress, 26);
+				// legacy sequences are in milliseconds
+				convertTimesToMicroseconds(metadata.getMicrosecondsPerTimeUnit());
 
 				// read calibration data
 				readCalibrationData(taskProgress);
@@ -173,6 +315,167 @@ namespace kocca {
 				throw TempFolderNotAvailableException("Provided sequence root folder path does not exists");
 		}
 
+		/**
+		 * @throws TempFolderNotAvailableException
+		 * @throws FileReadingException
+		 * @throws FileWritingException
+		 * @throws InvalidKinectCalibrationFileException
+		 * @throws InvalidMocapDataFileException
+		 * @throws DuplicateMarkerNameException
+		 */
+		void Sequence::readDataFromArchive(boost::filesystem::path archiveFilePath, TaskProgress* taskProgress) {
+			if(!boost::filesystem::exists(rootDirectory) || !boost::filesystem::is_directory(rootDirectory))
+				throw TempFolderNotAvailableException("Provided sequence root folder path does not exists");
+
+			if(archiveReader != NULL)
+				delete archiveReader;
+
+			archiveReader = NULL;
+			archiveReader = new SequenceArchiveReader(archiveFilePath.string());
+
+			// the few small files are extracted to be read like in a root directory, the frames are left in the archive
+			const char* extractedFileNames[] = {SequenceMetadata::FILE_NAME, "markersData.csv", "kinect_calibration_parameters.kcf", STATISTICS_FILE_NAME};
+
+			for(int i = 0; i < 4; i++)
+				archiveReader->extractEntry(extractedFileNames[i], rootDirectory / extractedFileNames[i]);
+
+			// read metadata, to know the time unit of the data
+			readMetadata();
+
+			// parse markers data
+			parseMarkersData(taskProgress);
+
+			if(taskProgress != NULL)
+				taskProgress->incrementProgress(10);
+
+			// index the frames entries of the archive's central directory
+			indexArchiveFrameEntries(taskProgress, 38);
+
+			// legacy sequences are in milliseconds
+			convertTimesToMicroseconds(metadata.getMicrosecondsPerTimeUnit());
+
+			// read calibration data
+			readCalibrationData(taskProgress);
+
+			// the data is kept in memory, and is exported from it : the extracted files would only make the temp folder look like a recoverable sequence after a crash
+			for(int i = 0; i < 3; i++)
+				boost::filesystem::remove(rootDirectory / extractedFileNames[i]);
+
+			// update sequence duration
+			updateDuration();
+
+			if(taskProgress != NULL)
+				taskProgress->setProgress(100);
+		}
+
+		void Sequence::indexArchiveFrameEntries(TaskProgress* taskProgress, float progressIncrement) {
+			std::vector<FramePath>* framesLists[] = {&imageFramesList, &irFramesList, &depthFramesList};
+			int entriesCount = archiveReader->getEntriesCount();
+
+			for(int i = 0; i < entriesCount; i++) {
+				std::string entryName = archiveReader->getEntryName(i);
+
+				for(int j = 0; j < 3; j++) {
+					size_t folderNameLength = strlen(STREAM_FOLDER_NAMES[j]);
+
+					// directory entries are skipped
+					if((entryName.size() > (folderNameLength + 1)) && (entryName.compare(0, folderNameLength, STREAM_FOLDER_NAMES[j]) == 0) && (entryName.at(folderNameLength) == '/')) {
+						FramePath frame(entryName);
+						frame.archiveEntryIndex = i;
+						framesLists[j]->push_back(frame);
+						break;
+					}
+				}
+			}
+
+			for(int j = 0; j < 3; j++)
+				std::sort(framesLists[j]->begin(), framesLists[j]->end(), FramePath::compareFramePaths);
+
+			if(taskProgress != NULL)
+				taskProgress->incrementProgress(progressIncrement);
+		}
+
+		bool Sequence::isReadFromArchive() {
+			return(archiveReader != NULL);
+		}
+
+		std::string Sequence::getArchiveFilePath() {
+			if(archiveReader != NULL)
+				return(archiveReader->getArchiveFilePath());
+			else
+				return(std::string(""));
+		}
+
+		cv::Mat Sequence::readImageFrame(const FramePath& framePath, int imreadFlags) {
+			if(framePath.archiveEntryIndex < 0)
+				return(cv::imread(framePath.path, imreadFlags));
+
+			try {
+				SequenceArchiveEntryContent content;
+				archiveReader->readEntry(framePath.archiveEntryIndex, content);
+
+				if(content.getSize() > 0) {
+					// the frame is decoded straight from the archive's mapped view
+					cv::Mat encodedFrame(1, (int)content.getSize(), CV_8UC1, (void*)content.getData());
+					return(cv::imdecode(encodedFrame, imreadFlags));
+				}
+			}
+			catch(FileReadingException& fre) {
+				std::cerr << "Error while reading frame " << framePath.path << " : " << fre.what() << std::endl;
+			}
+
+			return(cv::Mat());
+		}
+
+		cv::Mat Sequence::readIRFrame(const FramePath& framePath, bool toneMapTo8Bits) {
+			if(framePath.archiveEntryIndex < 0)
+				return(InfraredFrameCodec::readFrameFile(framePath.path, toneMapTo8Bits));
+
+			try {
+				SequenceArchiveEntryContent content;
+				archiveReader->readEntry(framePath.archiveEntryIndex, content);
+
+				if(content.getSize() > 0) {
+					if(InfraredFrameCodec::isEncodedFile(framePath.path))
+						return(InfraredFrameCodec::decode(content.getData(), content.getSize(), toneMapTo8Bits));
+
+					cv::Mat encodedFrame(1, (int)content.getSize(), CV_8UC1, (void*)content.getData());
+					return(cv::imdecode(encodedFrame, (toneMapTo8Bits ? cv::IMREAD_GRAYSCALE : cv::IMREAD_ANYDEPTH)));
+				}
+			}
+			catch(FileReadingException& fre) {
+				std::cerr << "Error while reading infrared frame " << framePath.path << " : " << fre.what() << std::endl;
+			}
+
+			return(cv::Mat());
+		}
+
+		/**
+		 * @throws FileReadingException
+		 */
+		void Sequence::readFrameFileContent(const FramePath& framePath, std::vector<unsigned char>& content) {
+			if(framePath.archiveEntryIndex >= 0) {
+				SequenceArchiveEntryContent entryContent;
+				archiveReader->readEntry(framePath.archiveEntryIndex, entryContent);
+				content.assign(entryContent.getData(), entryContent.getData() + entryContent.getSize());
+			}
+			else {
+				std::ifstream fileStream(framePath.path, std::ios::binary | std::ios::ate);
+				std::streamsize fileStreamSize = fileStream.tellg();
+
+				if(fileStreamSize >= 0) {
+					content.resize((size_t)fileStreamSize);
+					fileStream.seekg(0, std::ios::beg);
+				}
+
+				if((fileStreamSize < 0) || !fileStream.read((char*)content.data(), fileStreamSize)) {
+					std::ostringstream errMsg;
+					errMsg << "Error while reading frame file content of " << framePath.path;
+					throw FileReadingException(errMsg.str().c_str());
+				}
+			}
+		}
+
 		void Sequence::setRootDirectory(boost::filesystem::path _directory) {
 			rootDirectory = _directory;
 		}
@@ -190,12 +493,7 @@ namespace kocca {
 		 */
 		int Sequence::getImageFrameRank(unsigned long long time) {
 			if(!imageFramesList.empty()) {
-				int i = 0;
-
-				while((i < imageFramesList.size()) && (imageFramesList.at(i).time < time))
-					i++;
-
-				return(i);
+				return(FramePath::getFirstFrameRank(imageFramesList, (long long)time, false));
 			}
 			else
 				throw EmptySequenceStreamException("No image frame available");
@@ -206,12 +504,7 @@ namespace kocca {
 		*/
 		int Sequence::getIRFrameRank(unsigned long long time) {
 			if (!irFramesList.empty()) {
-				int i = 0;
-
-				while ((i < irFramesList.size()) && (irFramesList.at(i).time < time))
-					i++;
-
-				return(i);
+				return(FramePath::getFirstFrameRank(irFramesList, (long long)time, false));
 			}
 			else
 				throw EmptySequenceStreamException("No infrared frame available");
@@ -222,12 +515,7 @@ namespace kocca {
 		 */
 		int Sequence::getDepthFrameRank(unsigned long long time) {
 			if(!depthFramesList.empty()) {
-				int i = 0;
-
-				while((i < depthFramesList.size()) && (depthFramesList.at(i).time < time))
-					i++;
-
-				return(i);
+				return(FramePath::getFirstFrameRank(depthFramesList, (long long)time, false));
 			}
 			else
 				throw EmptySequenceStreamException("No depth frame available");
@@ -238,12 +526,8 @@ namespace kocca {
 		 */
 		FramePath Sequence::getImageFramePathByTime(unsigned long long time) {
 			if(!imageFramesList.empty()) {
-				int i = 1;
-
-				while((i < imageFramesList.size()) && (imageFramesList.at(i).time < time))
-					i++;
-
-				return(imageFramesList.at(i-1));
+				int rank = FramePath::getFirstFrameRank(imageFramesList, (long long)time, false);
+				return(imageFramesList.at((rank > 1) ? (rank - 1) : 0));
 			}
 			else
 				throw EmptySequenceStreamException("No image frame available");
@@ -254,12 +538,8 @@ namespace kocca {
 		*/
 		FramePath Sequence::getIRFramePathByTime(unsigned long long time) {
 			if (!irFramesList.empty()) {
-				int i = 1;
-
-				while ((i < irFramesList.size()) && (irFramesList.at(i).time < time))
-					i++;
-
-				return(irFramesList.at(i - 1));
+				int rank = FramePath::getFirstFrameRank(irFramesList, (long long)time, false);
+				return(irFramesList.at((rank > 1) ? (rank - 1) : 0));
 			}
 			else
 				throw EmptySequenceStreamException("No infrared frame available");
@@ -270,12 +550,7 @@ namespace kocca {
 		 */
 		FramePath Sequence::getNextImageFramePathByTime(unsigned long long time) {
 			if(!imageFramesList.empty()) {
-				int i = 0;
-
-				while((i < imageFramesList.size()) && (imageFramesList.at(i).time <= time))
-					i++;
-
-				return(imageFramesList.at(i));
+				return(imageFramesList.at(FramePath::getFirstFrameRank(imageFramesList, (long long)time, true)));
 			}
 			else
 				throw EmptySequenceStreamException("No image frame available");
@@ -286,12 +561,7 @@ namespace kocca {
 		*/
 		FramePath Sequence::getNextIRFramePathByTime(unsigned long long time) {
 			if (!irFramesList.empty()) {
-				int i = 0;
-
-				while ((i < irFramesList.size()) && (irFramesList.at(i).time <= time))
-					i++;
-
-				return(irFramesList.at(i));
+				return(irFramesList.at(FramePath::getFirstFrameRank(irFramesList, (long long)time, true)));
 			}
 			else
 				throw EmptySequenceStreamException("No infrared frame available");
@@ -302,12 +572,8 @@ namespace kocca {
 		 */
 		FramePath Sequence::getPreviousImageFramePathByTime(unsigned long long time) {
 			if(!imageFramesList.empty()) {
-				int i = 0;
-
-				while((i < (imageFramesList.size() -1)) && (imageFramesList.at(i+1).time < time))
-					i++;
-
-				return(imageFramesList.at(i));
+				int rank = FramePath::getFirstFrameRank(imageFramesList, (long long)time, false);
+				return(imageFramesList.at((rank > 1) ? (rank - 1) : 0));
 			}
 			else
 				throw EmptySequenceStreamException("No image frame available");
@@ -318,12 +584,8 @@ namespace kocca {
 		*/
 		FramePath Sequence::getPreviousIRFramePathByTime(unsigned long long time) {
 			if (!irFramesList.empty()) {
-				int i = 0;
-
-				while ((i < (irFramesList.size() - 1)) && (irFramesList.at(i + 1).time < time))
-					i++;
-
-				return(irFramesList.at(i));
+				int rank = FramePath::getFirstFrameRank(irFramesList, (long long)time, false);
+				return(irFramesList.at((rank > 1) ? (rank - 1) : 0));
 			}
 			else
 				throw EmptySequenceStreamException("No infrared frame available");
@@ -331,12 +593,8 @@ namespace kocca {
 
 		FramePath Sequence::getPreviousDepthFramePathByTime(unsigned long long time) {
 			if(!depthFramesList.empty()) {
-				int i = 0;
-
-				while((i < (depthFramesList.size() -1)) && (depthFramesList.at(i+1).time < time))
-					i++;
-
-				return(depthFramesList.at(i));
+				int rank = FramePath::getFirstFrameRank(depthFramesList, (long long)time, false);
+				return(depthFramesList.at((rank > 1) ? (rank - 1) : 0));
 			}
 			else
 				throw EmptySequenceStreamException("No image frame available");
@@ -347,12 +605,8 @@ namespace kocca {
 		 */
 		FramePath Sequence::getDepthFramePathByTime(unsigned long long time) {
 			if(!depthFramesList.empty()) {
-				int i = 1;
-
-				while((i < depthFramesList.size()) && (depthFramesList.at(i).time < time))
-					i++;
-
-				return(depthFramesList.at(i-1));
+				int rank = FramePath::getFirstFrameRank(depthFramesList, (long long)time, false);
+				return(depthFramesList.at((rank > 1) ? (rank - 1) : 0));
 			}
 			else
 				throw EmptySequenceStreamException("No depth frame available");
@@ -360,12 +614,7 @@ namespace kocca {
 
 		FramePath Sequence::getNextDepthFramePathByTime(unsigned long long time) {
 			if(!depthFramesList.empty()) {
-				int i = 0;
-
-				while((i < depthFramesList.size()) && (depthFramesList.at(i).time <= time))
-					i++;
-
-				return(depthFramesList.at(i));
+				return(depthFramesList.at(FramePath::getFirstFrameRank(depthFramesList, (long long)time, true)));
 			}
 			else
 				throw EmptySequenceStreamException("No image frame available");
@@ -409,7 +658,7 @@ namespace kocca {
 				FramePath tcFramePath = getImageFramePathByTime(time);
 				TimeCodedFrame tcFrame;
 				tcFrame.time = tcFramePath.time;
-				cv::Mat cvFrame = cv::imread(tcFramePath.path, cv::IMREAD_ANYCOLOR);
+				cv::Mat cvFrame = readImageFrame(tcFramePath, cv::IMREAD_ANYCOLOR);
 				cv::cvtColor(cvFrame, cvFrame, CV_BGRA2RGB);
 				tcFrame.frame = cvFrame;
 				return(tcFrame);
@@ -426,7 +675,7 @@ namespace kocca {
 				FramePath tcFramePath = getIRFramePathByTime(time);
 				TimeCodedFrame tcFrame;
 				tcFrame.time = tcFramePath.time;
-				tcFrame.frame = cv::imread(tcFramePath.path, cv::IMREAD_GRAYSCALE);
+				tcFrame.frame = readIRFrame(tcFramePath, true);
 				return(tcFrame);
 			}
 			else
@@ -441,7 +690,7 @@ namespace kocca {
 				FramePath tcFramePath = getNextImageFramePathByTime(time);
 				TimeCodedFrame tcFrame;
 				tcFrame.time = tcFramePath.time;
-				cv::Mat cvFrame = cv::imread(tcFramePath.path, cv::IMREAD_ANYCOLOR);
+				cv::Mat cvFrame = readImageFrame(tcFramePath, cv::IMREAD_ANYCOLOR);
 				cv::cvtColor(cvFrame, cvFrame, CV_BGRA2RGB);
 				tcFrame.frame = cvFrame;
 				return(tcFrame);
@@ -458,7 +707,7 @@ namespace kocca {
 				FramePath tcFramePath = getNextIRFramePathByTime(time);
 				TimeCodedFrame tcFrame;
 				tcFrame.time = tcFramePath.time;
-				tcFrame.frame = cv::imread(tcFramePath.path, cv::IMREAD_GRAYSCALE);
+				tcFrame.frame = readIRFrame(tcFramePath, true);
 				return(tcFrame);
 			}
 			else
@@ -473,7 +722,7 @@ namespace kocca {
 				FramePath tcFramePath = getNextDepthFramePathByTime(time);
 				TimeCodedFrame tcFrame;
 				tcFrame.time = tcFramePath.time;
-				tcFrame.frame = cv::imread(tcFramePath.path, cv::IMREAD_ANYDEPTH);
+				tcFrame.frame = readImageFrame(tcFramePath, cv::IMREAD_ANYDEPTH);
 				return(tcFrame);
 			}
 			else
@@ -488,7 +737,7 @@ namespace kocca {
 				FramePath tcFramePath = getPreviousImageFramePathByTime(time);
 				TimeCodedFrame tcFrame;
 				tcFrame.time = tcFramePath.time;
-				cv::Mat cvFrame = cv::imread(tcFramePath.path, cv::IMREAD_ANYCOLOR);
+				cv::Mat cvFrame = readImageFrame(tcFramePath, cv::IMREAD_ANYCOLOR);
 				cv::cvtColor(cvFrame, cvFrame, CV_BGRA2RGB);
 				tcFrame.frame = cvFrame;
 				return(tcFrame);
@@ -505,7 +754,7 @@ namespace kocca {
 				FramePath tcFramePath = getPreviousIRFramePathByTime(time);
 				TimeCodedFrame tcFrame;
 				tcFrame.time = tcFramePath.time;
-				tcFrame.frame = cv::imread(tcFramePath.path, cv::IMREAD_GRAYSCALE);
+				tcFrame.frame = readIRFrame(tcFramePath, true);
 				return(tcFrame);
 			}
 			else
@@ -520,7 +769,7 @@ namespace kocca {
 				FramePath tcFramePath = getPreviousDepthFramePathByTime(time);
 				TimeCodedFrame tcFrame;
 				tcFrame.time = tcFramePath.time;
-				tcFrame.frame = cv::imread(tcFramePath.path, cv::IMREAD_ANYDEPTH);
+				tcFrame.frame = readImageFrame(tcFramePath, cv::IMREAD_ANYDEPTH);
 				return(tcFrame);
 			}
 			else
@@ -535,7 +784,7 @@ namespace kocca {
 				FramePath tcFramePath = getDepthFramePathByTime(time);
 				TimeCodedFrame tcFrame;
 				tcFrame.time = tcFramePath.time;
-				tcFrame.frame = cv::imread(tcFramePath.path, cv::IMREAD_ANYDEPTH);
+				tcFrame.frame = readImageFrame(tcFramePath, cv::IMREAD_ANYDEPTH);
 				return(tcFrame);
 			}
 			else
@@ -653,6 +902,9 @@ namespace kocca {
 				delete extrinsicRGBCalibrationParameters;
 
 			delete calibrationFile;
+
+			if(archiveReader != NULL)
+				delete archiveReader;
 		}
 
 		/**
@@ -663,21 +915,21 @@ namespace kocca {
 
 			if(!imageFramesList.empty()) {
 				try {
-					eventsTimes.push_back(getNextImageFrameByTime(time).time);
+					eventsTimes.push_back(getNextImageFramePathByTime(time).time);
 				}
 				catch(EmptySequenceStreamException& esse) {} // nothing, we simply don't add an event to the list
 			}
 
 			if (!irFramesList.empty()) {
 				try {
-					eventsTimes.push_back(getNextIRFrameByTime(time).time);
+					eventsTimes.push_back(getNextIRFramePathByTime(time).time);
 				}
 				catch (EmptySequenceStreamException& esse) {} // nothing, we simply don't add an event to the list
 			}
 
 			if(!depthFramesList.empty()) {
 				try {
-					eventsTimes.push_back(getNextDepthFrameByTime(time).time);
+					eventsTimes.push_back(getNextDepthFramePathByTime(time).time);
 				}
 				catch(EmptySequenceStreamException& esse) {} // nothing, we simply don't add an event to the list
 			}
@@ -705,21 +957,21 @@ namespace kocca {
 
 			if(!imageFramesList.empty()) {
 				try {
-					eventsTimes.push_back(getPreviousImageFrameByTime(time).time);
+					eventsTimes.push_back(getPreviousImageFramePathByTime(time).time);
 				}
 				catch(EmptySequenceStreamException& esse) {} // nothing, we simply don't add an event to the list
 			}
 
 			if (!irFramesList.empty()) {
 				try {
-					eventsTimes.push_back(getPreviousIRFrameByTime(time).time);
+					eventsTimes.push_back(getPreviousIRFramePathByTime(time).time);
 				}
 				catch (EmptySequenceStreamException& esse) {} // nothing, we simply don't add an event to the list
 			}
 
 			if(!depthFramesList.empty()) {
 				try {
-					eventsTimes.push_back(getPreviousDepthFrameByTime(time).time);
+					eventsTimes.push_back(getPreviousDepthFramePathByTime(time).time);
 				}
 				catch(EmptySequenceStreamException& esse) {} // nothing, we simply don't add an event to the list
 			}
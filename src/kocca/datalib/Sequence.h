@@ -12,6 +12,8 @@
 #include "ExtrinsicCalibrationParametersSet.h"
 #include "IntrinsicCalibrationParametersSet.h"
 #include "KinectCalibrationFile.h"
+#include "SequenceArchiveReader.h"
+#include "SequenceMetadata.h"
 #include "TaskProgress.h"
 
 namespace kocca {
@@ -22,6 +24,7 @@ namespace kocca {
 		 * A Kocca sequence can have three image streams (image, infrared and depth), a NatNet markers stream and a kinect calibration file
 		 * Each of the three image streams consists of a series of timecoded frames (= individual images associated to a timestamp)
 		 * All this data is stored in a folder with a fixed predefined structure
+		 * All the times of a sequence are in microseconds. Legacy sequences, whose times are in milliseconds (see SequenceMetadata), are converted when they are read.
 		 */
 		class Sequence {
 		public:
@@ -31,6 +34,21 @@ namespace kocca {
 			 */
 			MocapMarkersSequence markersSequence;
 
+			/**
+			 * The name of the recording statistics file (see operations::RecordingStatistics), in the sequence's root folder, which is exported along with the sequence.
+			 */
+			static const char* STATISTICS_FILE_NAME;
+
+			/**
+			 * The number of image streams of a sequence.
+			 */
+			static const int IMAGE_STREAMS_COUNT = 3;
+
+			/**
+			 * The folder names of the image streams ("image", "infrared" and "depth"), which also name the streams in the settings, the metadata, the journal, the proxies files and the recording statistics. They are indexed like operations::RecordedStreamType and operations::PlaybackStreamType.
+			 */
+			static const char* STREAM_FOLDER_NAMES[IMAGE_STREAMS_COUNT];
+
 			/**
 			 * Constructor.
 			 */
@@ -65,12 +83,73 @@ namespace kocca {
 			 */
 			void readDataFromRootDirectory(TaskProgress* taskProgress = NULL);
 
+			/**
+			 * Reads a sequence straight from its .ksa archive, without extracting its frames : only the archive's central directory is indexed, and the frames are read from the archive when they are needed (see readImageFrame(), readIRFrame() and readFrameFileContent()).
+			 * The metadata, markers data and calibration files are extracted to the sequence's root directory (which must be set to an empty temp folder beforehand) to be read, then removed, so the root directory only holds the files generated while reading the sequence, like its proxies.
+			 * @param archiveFilePath the path of the .ksa archive file
+			 * @param taskProgress a TaskProgress pointer, allowing to track the progress of this operation from other objects.
+			 * @throws TempFolderNotAvailableException
+			 * @throws FileReadingException
+			 * @throws FileWritingException
+			 * @throws InvalidKinectCalibrationFileException
+			 * @throws InvalidMocapDataFileException
+			 * @throws DuplicateMarkerNameException
+			 */
+			void readDataFromArchive(boost::filesystem::path archiveFilePath, TaskProgress* taskProgress = NULL);
+
+			/**
+			 * Indexes the frame entries of the archive the sequence is read from ("image/", "infrared/" and "depth/" entries), then sorts them into the frames lists.
+			 * @param taskProgress a TaskProgress pointer, allowing to track the progress of this operation from other objects.
+			 * @param progressIncrement the amount of progress (in percentage) to increment taskProgress of for the operation
+			 */
+			void indexArchiveFrameEntries(TaskProgress* taskProgress = NULL, float progressIncrement = 78.0);
+
+			/**
+			 * Checks if the sequence is read straight from its archive (see readDataFromArchive()).
+			 */
+			bool isReadFromArchive();
+
+			/**
+			 * Gets the path of the archive the sequence is read from, or an empty string if it is read from its root directory.
+			 */
+			std::string getArchiveFilePath();
+
+			/**
+			 * Reads and decodes a color image or depth frame, from its file or from the archive the sequence is read from.
+			 * @param framePath the frame
+			 * @param imreadFlags the flags of cv::imread() (ex : cv::IMREAD_ANYCOLOR for color frames, cv::IMREAD_ANYDEPTH for depth frames)
+			 * @return the decoded frame, or an empty frame if it couldn't be read
+			 */
+			cv::Mat readImageFrame(const FramePath& framePath, int imreadFlags);
+
+			/**
+			 * Reads and decodes an infrared frame, from its file or from the archive the sequence is read from (see InfraredFrameCodec::readFrameFile()).
+			 * @param framePath the frame
+			 * @param toneMapTo8Bits if true, the frame is converted to a 8 bits frame
+			 * @return the decoded frame, or an empty frame if it couldn't be read
+			 */
+			cv::Mat readIRFrame(const FramePath& framePath, bool toneMapTo8Bits = false);
+
+			/**
+			 * Reads the encoded content of a frame, from its file or from the archive the sequence is read from.
+			 * @param framePath the frame
+			 * @param content the vector in which the content is read
+			 * @throws FileReadingException if the frame couldn't be read
+			 */
+			void readFrameFileContent(const FramePath& framePath, std::vector<unsigned char>& content);
+
 			/**
 			 * Reads and parses the Kinect calibration file from the sequence's root directory, if there's any, and loads the data into the current sequence.
 			 * @param taskProgress a TaskProgress pointer, allowing to track the progress of this operation from other objects.
 			 */
 			void readCalibrationData(TaskProgress* taskProgress = NULL);
 
+			/**
+			 * Reads the metadata file from the sequence's root directory. If there isn't any, the sequence is considered to be in the legacy format.
+			 * @throws FileReadingException
+			 */
+			void readMetadata();
+
 			/**
 			 * Reads and parses the MoCap markers data file from the sequence's root directory, if there's any, and loads the data into the current sequence.
 			 * @param taskProgress a TaskProgress pointer, allowing to track the progress of this operation from other objects.
@@ -86,65 +165,93 @@ namespace kocca {
 			 */
 			void indexFrameFiles(boost::filesystem::path framesDirectory, std::vector<FramePath>* framesList, TaskProgress* taskProgress = NULL, float progressIncrement = 40.0);
 
+			/**
+			 * Lists, sorts and merges the image files of all the folders of a stream (see getStreamDirectories()), then puts the sorted list in the framesList vector.
+			 * @param streamFolderName the name of the stream's folder ("image", "infrared" or "depth")
+			 * @param framesList the vector in which to store the sorted list of files.
+			 * @param taskProgress a TaskProgress pointer, allowing to track the progress of this operation from other objects.
+			 * @param progressIncrement the amount of progress (in percentage) to increment taskProgress of for the operation
+			 */
+			void indexStreamFrameFiles(const char* streamFolderName, std::vector<FramePath>* framesList, TaskProgress* taskProgress = NULL, float progressIncrement = 40.0);
+
+			/**
+			 * Restores the frames lists and the MoCap markers data from the recording journal of the root directory (see RecordingJournal), if there's any, instead of scanning the streams folders and parsing the markers data file. The torn frames are discarded.
+			 * @param taskProgress a TaskProgress pointer, allowing to track the progress of this operation from other objects.
+			 * @param progressIncrement the amount of progress (in percentage) to increment taskProgress of for the operation
+			 * @return false if there's no readable journal, in which case the sequence is left untouched
+			 */
+			bool readRecordingJournal(TaskProgress* taskProgress = NULL, float progressIncrement = 88.0);
+
+			/**
+			 * Gets all the folders where the frames of a stream are stored : the stream's folder in the root directory, followed by the ones where the stream has been recorded if it has been spread over other directories or disks (see SequenceMetadata::getStreamDirectories()).
+			 * @param streamFolderName the name of the stream's folder ("image", "infrared" or "depth")
+			 */
+			std::vector<boost::filesystem::path> getStreamDirectories(const char* streamFolderName);
+
+			/**
+			 * Removes the folders of the streams that are outside of the root directory, along with their parent folder if it is left empty. The root directory itself is left untouched.
+			 */
+			void removeExternalStreamDirectories();
+
 			/**
 			 * Gets the color image frame that should be displayed at a certain time of the sequence (= gets the last frame of the color image stream whose timecode is <= to the one in argument)
-			 * @param time the time at wich we want the frame that should be displayed, in milliseconds
+			 * @param time the time at wich we want the frame that should be displayed, in microseconds
 			 * @throws EmptySequenceStreamException if the sequence has no color image frame.
 			 */
 			TimeCodedFrame getImageFrameByTime(unsigned long long time);
 
 			/**
 			 * Gets the first frame of the color image stream whose timecode is > to the one in argument (= gets the next frame that should be displayed after a certain time of the sequence)
-			 * @param time the time (in milliseconds) after wich we want the next frame that should be displayed
+			 * @param time the time (in microseconds) after wich we want the next frame that should be displayed
 			 * @throws EmptySequenceStreamException if the sequence has no color image frame.
 			 */
 			TimeCodedFrame getNextImageFrameByTime(unsigned long long time);
 
 			/**
 			 * Gets the frame BEFORE the last of the color image stream whose timecode is <= to the one in argument
-			 * @param time the time at wich we want the frame before the one that should be displayed, in milliseconds
+			 * @param time the time at wich we want the frame before the one that should be displayed, in microseconds
 			 * @throws EmptySequenceStreamException if the sequence has no color image frame.
 			 */
 			TimeCodedFrame getPreviousImageFrameByTime(unsigned long long time);
 
 			/**
 			 * Gets the infrared image frame that should be displayed at a certain time of the sequence (= gets the last frame of the infrared stream whose timecode is <= to the one in argument)
-			 * @param time the time at wich we want the frame that should be displayed, in milliseconds
+			 * @param time the time at wich we want the frame that should be displayed, in microseconds
 			 * @throws EmptySequenceStreamException if the sequence has no infrared image frame.
 			 */
 			TimeCodedFrame getIRFrameByTime(unsigned long long time);
 
 			/**
 			 * Gets the first frame of the infrared image stream whose timecode is > to the one in argument (= gets the next frame that should be displayed after a certain time of the sequence)
-			 * @param time the time (in milliseconds) after wich we want the next frame that should be displayed
+			 * @param time the time (in microseconds) after wich we want the next frame that should be displayed
 			 * @throws EmptySequenceStreamException if the sequence has no infrared image frame.
 			 */
 			TimeCodedFrame getNextIRFrameByTime(unsigned long long time);
 
 			/**
 			 * Gets the frame BEFORE the last of the infrared stream whose timecode is <= to the one in argument
-			 * @param time the time at wich we want the frame before the one that should be displayed, in milliseconds
+			 * @param time the time at wich we want the frame before the one that should be displayed, in microseconds
 			 * @throws EmptySequenceStreamException if the sequence has no infrared image frame.
 			 */
 			TimeCodedFrame getPreviousIRFrameByTime(unsigned long long time);
 
 			/**
 			 * Gets the depth image frame that should be displayed at a certain time of the sequence (= gets the last frame of the depth stream whose timecode is <= to the one in argument)
-			 * @param time the time at wich we want the frame that should be displayed, in milliseconds
+			 * @param time the time at wich we want the frame that should be displayed, in microseconds
 			 * @throws EmptySequenceStreamException if the sequence has no depth image frame.
 			 */
 			TimeCodedFrame getDepthFrameByTime(unsigned long long time);
 
 			/**
 			 * Gets the first frame of the depth image stream whose timecode is > to the one in argument (= gets the next frame that should be displayed after a certain time of the sequence)
-			 * @param time the time (in milliseconds) after wich we want the next frame that should be displayed
+			 * @param time the time (in microseconds) after wich we want the next frame that should be displayed
 			 * @throws EmptySequenceStreamException if the sequence has no depth image frame.
 			 */
 			TimeCodedFrame getNextDepthFrameByTime(unsigned long long time);
 
 			/**
 			 * Gets the frame BEFORE the last of the depth stream whose timecode is <= to the one in argument
-			 * @param time the time at wich we want the frame before the one that should be displayed, in milliseconds
+			 * @param time the time at wich we want the frame before the one that should be displayed, in microseconds
 			 * @throws EmptySequenceStreamException if the sequence has no depth image frame.
 			 */
 			TimeCodedFrame getPreviousDepthFrameByTime(unsigned long long time);
@@ -211,63 +318,63 @@ namespace kocca {
 
 			/**
 			 * Gets the file path of the last frame of the image stream who's timecode is <= to the one specified (= the frame that should currently be displayed at a certain time of the sequence)
-			 * @param time the time at wich we want the path of the frame that should be displayed, in milliseconds
+			 * @param time the time at wich we want the path of the frame that should be displayed, in microseconds
 			 * @throws EmptySequenceStreamException if the sequence has no color image frame.
 			 */
 			FramePath getImageFramePathByTime(unsigned long long time);
 
 			/**
 			 * Gets the file path of the first frame of the color image stream whose timecode is > to the one in argument (= gets the next frame that should be displayed after a certain time of the sequence)
-			 * @param time the time (in milliseconds) after wich we want the path of the next frame that should be displayed
+			 * @param time the time (in microseconds) after wich we want the path of the next frame that should be displayed
 			 * @throws EmptySequenceStreamException if the sequence has no color image frame.
 			 */
 			FramePath getNextImageFramePathByTime(unsigned long long time);
 
 			/**
 			 * Gets the file path of the frame BEFORE the last of the color image stream whose timecode is <= to the one in argument
-			 * @param time the time at wich we want the path of the frame before the one that should be displayed, in milliseconds
+			 * @param time the time at wich we want the path of the frame before the one that should be displayed, in microseconds
 			 * @throws EmptySequenceStreamException if the sequence has no color image frame.
 			 */
 			FramePath getPreviousImageFramePathByTime(unsigned long long time);
 
 			/**
 			 * Gets the file path of the last frame of the infrared stream who's timecode is <= to the one specified (= the frame that should currently be displayed at a certain time of the sequence)
-			 * @param time the time at wich we want the path of the frame that should be displayed, in milliseconds
+			 * @param time the time at wich we want the path of the frame that should be displayed, in microseconds
 			 * @throws EmptySequenceStreamException if the sequence has no infrared frame.
 			 */
 			FramePath getIRFramePathByTime(unsigned long long time);
 
 			/**
 			 * Gets the file path of the first frame of the infrared stream whose timecode is > to the one in argument (= gets the next frame that should be displayed after a certain time of the sequence)
-			 * @param time the time (in milliseconds) after wich we want the path of the next frame that should be displayed
+			 * @param time the time (in microseconds) after wich we want the path of the next frame that should be displayed
 			 * @throws EmptySequenceStreamException if the sequence has no infrared frame.
 			 */
 			FramePath getNextIRFramePathByTime(unsigned long long time);
 
 			/**
 			 * Gets the file path of the frame BEFORE the last of the infrared stream whose timecode is <= to the one in argument
-			 * @param time the time at wich we want the path of the frame before the one that should be displayed, in milliseconds
+			 * @param time the time at wich we want the path of the frame before the one that should be displayed, in microseconds
 			 * @throws EmptySequenceStreamException if the sequence has no infrared frame.
 			 */
 			FramePath getPreviousIRFramePathByTime(unsigned long long time);
 
 			/**
 			 * Gets the file path of the last frame of the depth stream who's timecode is <= to the one specified (= the frame that should currently be displayed at a certain time of the sequence)
-			 * @param time the time at wich we want the path of the frame that should be displayed, in milliseconds
+			 * @param time the time at wich we want the path of the frame that should be displayed, in microseconds
 			 * @throws EmptySequenceStreamException if the sequence has no depth frame.
 			 */
 			FramePath getDepthFramePathByTime(unsigned long long time);
 
 			/**
 			 * Gets the file path of the first frame of the depth stream whose timecode is > to the one in argument (= gets the next frame that should be displayed after a certain time of the sequence)
-			 * @param time the time (in milliseconds) after wich we want the path of the next frame that should be displayed
+			 * @param time the time (in microseconds) after wich we want the path of the next frame that should be displayed
 			 * @throws EmptySequenceStreamException if the sequence has no depth frame.
 			 */
 			FramePath getNextDepthFramePathByTime(unsigned long long time);
 
 			/**
 			 * Gets the file path of the frame BEFORE the last of the depth stream whose timecode is <= to the one in argument
-			 * @param time the time at wich we want the path of the frame before the one that should be displayed, in milliseconds
+			 * @param time the time at wich we want the path of the frame before the one that should be displayed, in microseconds
 			 * @throws EmptySequenceStreamException if the sequence has no depth frame.
 			 */
 			FramePath getPreviousDepthFramePathByTime(unsigned long long time);
@@ -294,23 +401,23 @@ namespace kocca {
 			FramePath getDepthFramePathByRank(int rank);
 
 			/**
-			 * Get the total sequence duration, in milliseconds
+			 * Get the total sequence duration, in microseconds
 			 */
 			unsigned long long getDuration();
 
 			/**
 			 * Gets the time of the first frame (wether it's color image, infrared, depth or Mocap markers frame) whose time is after the time in argument.
-			 * @param time the time after which we want the first frame time, in milliseconds.
+			 * @param time the time after which we want the first frame time, in microseconds.
 			 * @throws NoNextEventException if the sequence has no frame after time
-			 * @return the time of the first frame after time, in milliseconds.
+			 * @return the time of the first frame after time, in microseconds.
 			 */
 			unsigned long long getNextEventTime(unsigned long long time);
 
 			/**
 			 * Gets the time of the last frame (wether it's color image, infrared, depth or Mocap markers frame) whose time is before the time in argument.
-			 * @param time the time before which we want the first frame time, in milliseconds.
+			 * @param time the time before which we want the first frame time, in microseconds.
 			 * @throws NoNextEventException if the sequence has no frame before time
-			 * @return the time of the last frame before time, in milliseconds.
+			 * @return the time of the last frame before time, in microseconds.
 			 */
 			unsigned long long getPreviousEventTime(unsigned long long time);
 
@@ -324,6 +431,17 @@ namespace kocca {
 			 */
 			void writeMarkersData();
 
+			/**
+			 * Writes the sequence's metadata in the metadata file (see SequenceMetadata::FILE_NAME) in the sequence's root folder.
+			 * @throws FileWritingException
+			 */
+			void writeMetadata();
+
+			/**
+			 * Gets a pointer to the sequence's metadata.
+			 */
+			SequenceMetadata* getMetadata();
+
 			/**
 			 * Checks if the sequence has any calibration data.
 			 * @return true if the sequence has any calibration data, false otherwise.
@@ -453,7 +571,7 @@ namespace kocca {
 			std::vector<FramePath> depthFramesList;
 
 			/**
-			 * Sequence duration, in milliseconds
+			 * Sequence duration, in microseconds
 			 */
 			long long duration;
 
@@ -481,6 +599,22 @@ namespace kocca {
 			 * A pointer to the sequence's Kinect calibration file.
 			 */
 			KinectCalibrationFile* calibrationFile;
+
+			/**
+			 * The sequence's metadata.
+			 */
+			SequenceMetadata metadata;
+
+			/**
+			 * The reader of the archive the sequence is read from, or NULL if it is read from its root directory.
+			 */
+			SequenceArchiveReader* archiveReader;
+
+			/**
+			 * Converts all the times of the sequence (frames and markers) to microseconds, after the data of a sequence in another time unit has been read.
+			 * @param microsecondsPerTimeUnit the number of microseconds per unit of the times that have been read
+			 */
+			void convertTimesToMicroseconds(unsigned long long microsecondsPerTimeUnit);
 		};
 	} // namespace datalib
 } // namespace kocca
@@ -0,0 +1,387 @@
+#include "SequenceArchiveReader.h"
+#include "../Exceptions.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#define MINIZ_HEADER_FILE_ONLY
+#include "miniz.c"
+
+#ifdef _WIN32
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif // _WIN32
+
+namespace kocca {
+	namespace datalib {
+		namespace {
+			/**
+			 * The signature of a local file header, its size, and the offsets of the lengths of the file name and of the extra field it is followed by.
+			 */
+			const unsigned int LOCAL_HEADER_SIGNATURE = 0x04034b50;
+			const unsigned long long LOCAL_HEADER_SIZE = 30;
+			const int LOCAL_HEADER_NAME_LENGTH_OFFSET = 26;
+			const int LOCAL_HEADER_EXTRA_LENGTH_OFFSET = 28;
+
+			/**
+			 * The offsets of the flags, the compression method, the CRC-32 and the compressed and uncompressed sizes in a local header, and the flag telling that the sizes follow the data instead.
+			 */
+			const int LOCAL_HEADER_FLAGS_OFFSET = 6;
+			const int LOCAL_HEADER_METHOD_OFFSET = 8;
+			const int LOCAL_HEADER_CRC_OFFSET = 14;
+			const int LOCAL_HEADER_COMPRESSED_SIZE_OFFSET = 18;
+			const int LOCAL_HEADER_UNCOMPRESSED_SIZE_OFFSET = 22;
+			const unsigned int DATA_DESCRIPTOR_FLAG = 0x8;
+
+			/**
+			 * The maximum size of the file name and extra field of a local header : they are mapped along with the header and the data, as their actual lengths are only known once the header is read.
+			 */
+			const unsigned long long LOCAL_HEADER_MAX_VARIABLE_SIZE = 2 * 0xFFFF;
+
+			/**
+			 * Reads a little endian integer from a header.
+			 */
+			unsigned int readLittleEndian(const unsigned char* p, int bytesCount) {
+				unsigned int value = 0;
+
+				for(int i = bytesCount - 1; i >= 0; i--)
+					value = (value << 8) | p[i];
+
+				return(value);
+			}
+
+			/**
+			 * Unmaps a view of a file.
+			 */
+			void unmapView(void* view, size_t viewSize) {
+#ifdef _WIN32
+				UnmapViewOfFile(view);
+#else
+				munmap(view, viewSize);
+#endif // _WIN32
+			}
+		}
+
+		SequenceArchiveEntryContent::SequenceArchiveEntryContent() {
+			mappedView = NULL;
+			mappedViewSize = 0;
+			data = NULL;
+			size = 0;
+		}
+
+		SequenceArchiveEntryContent::~SequenceArchiveEntryContent() {
+			release();
+		}
+
+		void SequenceArchiveEntryContent::release() {
+			if(mappedView != NULL) {
+				unmapView(mappedView, mappedViewSize);
+				mappedView = NULL;
+				mappedViewSize = 0;
+			}
+
+			inflatedData.clear();
+			data = NULL;
+			size = 0;
+		}
+
+		const unsigned char* SequenceArchiveEntryContent::getData() {
+			return(data);
+		}
+
+		size_t SequenceArchiveEntryContent::getSize() {
+			return(size);
+		}
+
+		/**
+		 * @throws FileReadingException
+		 */
+		SequenceArchiveReader::SequenceArchiveReader(const std::string& _archiveFilePath) {
+			archiveFilePath = _archiveFilePath;
+
+			// miniz only reads the central directory of the archive
+			mz_zip_archive zip_archive;
+			memset(&zip_archive, 0, sizeof(zip_archive));
+
+			if(!mz_zip_reader_init_file(&zip_archive, archiveFilePath.c_str(), 0)) {
+				std::ostringstream errMsg;
+				errMsg << "Error trying to open archive " << archiveFilePath;
+				throw FileReadingException(errMsg.str().c_str());
+			}
+
+			int entriesCount = (int)mz_zip_reader_get_num_files(&zip_archive);
+
+			for(int i = 0; i < entriesCount; i++) {
+				mz_zip_archive_file_stat fileStat;
+
+				if(mz_zip_reader_file_stat(&zip_archive, i, &fileStat)) {
+					entryNames.push_back(fileStat.m_filename);
+					entryLocalHeaderOffsets.push_back(fileStat.m_local_header_ofs);
+					entryCompressedSizes.push_back(fileStat.m_comp_size);
+					entryUncompressedSizes.push_back(fileStat.m_uncomp_size);
+					entryMethods.push_back(fileStat.m_method);
+				}
+			}
+
+			mz_zip_reader_end(&zip_archive);
+
+			bool isOpen = false;
+
+#ifdef _WIN32
+			fileMappingHandle = NULL;
+			fileHandle = CreateFileA(archiveFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+
+			if(fileHandle != INVALID_HANDLE_VALUE) {
+				LARGE_INTEGER fileSize;
+				SYSTEM_INFO systemInfo;
+				GetSystemInfo(&systemInfo);
+				viewAlignment = systemInfo.dwAllocationGranularity;
+
+				if(GetFileSizeEx(fileHandle, &fileSize)) {
+					archiveFileSize = (unsigned long long)fileSize.QuadPart;
+					fileMappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+					isOpen = (fileMappingHandle != NULL);
+				}
+
+				if(!isOpen)
+					CloseHandle(fileHandle);
+			}
+#else
+			fileDescriptor = open(archiveFilePath.c_str(), O_RDONLY);
+
+			if(fileDescriptor >= 0) {
+				struct stat fileStat;
+				viewAlignment = (unsigned long long)sysconf(_SC_PAGESIZE);
+
+				if(fstat(fileDescriptor, &fileStat) == 0) {
+					archiveFileSize = (unsigned long long)fileStat.st_size;
+					isOpen = true;
+				}
+				else
+					close(fileDescriptor);
+			}
+#endif // _WIN32
+
+			if(!isOpen) {
+				std::ostringstream errMsg;
+				errMsg << "Error trying to map archive " << archiveFilePath << " in memory";
+				throw FileReadingException(errMsg.str().c_str());
+			}
+		}
+
+		SequenceArchiveReader::~SequenceArchiveReader() {
+#ifdef _WIN32
+			CloseHandle(fileMappingHandle);
+			CloseHandle(fileHandle);
+#else
+			close(fileDescriptor);
+#endif // _WIN32
+		}
+
+		std::string SequenceArchiveReader::getArchiveFilePath() {
+			return(archiveFilePath);
+		}
+
+		int SequenceArchiveReader::getEntriesCount() {
+			return((int)entryNames.size());
+		}
+
+		std::string SequenceArchiveReader::getEntryName(int entryIndex) {
+			return(entryNames.at(entryIndex));
+		}
+
+		int SequenceArchiveReader::findEntry(const std::string& entryName) {
+			for(int i = 0; i < entryNames.size(); i++)
+				if(entryNames.at(i) == entryName)
+					return(i);
+
+			return(-1);
+		}
+
+		const unsigned char* SequenceArchiveReader::mapView(unsigned long long offset, unsigned long long length, SequenceArchiveEntryContent& content) {
+			content.release();
+
+			if((offset + length) > archiveFileSize)
+				return(NULL);
+
+			// views must start at a multiple of the allocation granularity (or of the page size)
+			unsigned long long viewOffset = offset - (offset % viewAlignment);
+			size_t viewSize = (size_t)(offset + length - viewOffset);
+
+#ifdef _WIN32
+			void* view = MapViewOfFile(fileMappingHandle, FILE_MAP_READ, (DWORD)(viewOffset >> 32), (DWORD)(viewOffset & 0xFFFFFFFF), viewSize);
+
+			if(view == NULL)
+				return(NULL);
+#else
+			void* view = mmap(NULL, viewSize, PROT_READ, MAP_SHARED, fileDescriptor, (off_t)viewOffset);
+
+			if(view == MAP_FAILED)
+				return(NULL);
+#endif // _WIN32
+
+			content.mappedView = view;
+			content.mappedViewSize = viewSize;
+			return((const unsigned char*)view + (offset - viewOffset));
+		}
+
+		/**
+		 * @throws FileReadingException
+		 */
+		void SequenceArchiveReader::readEntry(int entryIndex, SequenceArchiveEntryContent& content) {
+			unsigned long long localHeaderOffset = entryLocalHeaderOffsets.at(entryIndex);
+			unsigned long long compressedSize = entryCompressedSizes.at(entryIndex);
+			unsigned long long uncompressedSize = entryUncompressedSizes.at(entryIndex);
+
+			// the local header, the data and at most the longest file name and extra field are mapped at once
+			unsigned long long viewLength = LOCAL_HEADER_SIZE + LOCAL_HEADER_MAX_VARIABLE_SIZE + compressedSize;
+
+			if((localHeaderOffset < archiveFileSize) && (viewLength > (archiveFileSize - localHeaderOffset)))
+				viewLength = archiveFileSize - localHeaderOffset;
+
+			const unsigned char* localHeader = mapView(localHeaderOffset, viewLength, content);
+			const unsigned char* entryData = NULL;
+
+			if((localHeader != NULL) && (viewLength >= LOCAL_HEADER_SIZE) && (readLittleEndian(localHeader, 4) == LOCAL_HEADER_SIGNATURE)) {
+				unsigned long long dataOffset = LOCAL_HEADER_SIZE + readLittleEndian(localHeader + LOCAL_HEADER_NAME_LENGTH_OFFSET, 2) + readLittleEndian(localHeader + LOCAL_HEADER_EXTRA_LENGTH_OFFSET, 2);
+
+				if((dataOffset + compressedSize) <= viewLength)
+					entryData = localHeader + dataOffset;
+			}
+
+			if(entryData == NULL) {
+				content.release();
+				std::ostringstream errMsg;
+				errMsg << "Error while reading " << entryNames.at(entryIndex) << " from archive " << archiveFilePath;
+				throw FileReadingException(errMsg.str().c_str());
+			}
+
+			if((entryMethods.at(entryIndex) == 0) && (compressedSize == uncompressedSize)) {
+				// stored entries are read in place
+				content.data = entryData;
+				content.size = (size_t)uncompressedSize;
+			}
+			else if(entryMethods.at(entryIndex) == MZ_DEFLATED) {
+				content.inflatedData.resize((size_t)uncompressedSize);
+				size_t inflatedSize = tinfl_decompress_mem_to_mem(content.inflatedData.data(), content.inflatedData.size(), entryData, (size_t)compressedSize, 0);
+
+				// the view isn't needed anymore once the entry is inflated
+				unmapView(content.mappedView, content.mappedViewSize);
+				content.mappedView = NULL;
+				content.mappedViewSize = 0;
+
+				if(inflatedSize != uncompressedSize) {
+					content.release();
+					std::ostringstream errMsg;
+					errMsg << "Error while inflating " << entryNames.at(entryIndex) << " from archive " << archiveFilePath;
+					throw FileReadingException(errMsg.str().c_str());
+				}
+
+				content.data = content.inflatedData.data();
+				content.size = content.inflatedData.size();
+			}
+			else {
+				content.release();
+				std::ostringstream errMsg;
+				errMsg << "Unsupported compression method for " << entryNames.at(entryIndex) << " in archive " << archiveFilePath;
+				throw FileReadingException(errMsg.str().c_str());
+			}
+		}
+
+		/**
+		 * @throws FileReadingException
+		 * @throws FileWritingException
+		 */
+		bool SequenceArchiveReader::extractEntry(const std::string& entryName, const boost::filesystem::path& filePath) {
+			int entryIndex = findEntry(entryName);
+
+			if(entryIndex < 0)
+				return(false);
+
+			SequenceArchiveEntryContent content;
+			readEntry(entryIndex, content);
+
+			std::ofstream file(filePath.string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			file.write((const char*)content.getData(), content.getSize());
+			file.close();
+
+			if(file.fail()) {
+				std::ostringstream errMsg;
+				errMsg << "Error while extracting " << entryName << " from archive " << archiveFilePath << " to " << filePath.string();
+				throw FileWritingException(errMsg.str().c_str());
+			}
+
+			return(true);
+		}
+
+		/**
+		 * @throws FileReadingException
+		 * @throws FileWritingException
+		 */
+		int SequenceArchiveReader::salvageFrames(const std::string& archiveFilePath, const boost::filesystem::path& directory) {
+			std::ifstream archiveFile(archiveFilePath.c_str(), std::ios::in | std::ios::binary);
+
+			if(!archiveFile.is_open()) {
+				std::ostringstream errMsg;
+				errMsg << "Unable to open archive " << archiveFilePath;
+				throw FileReadingException(errMsg.str().c_str());
+			}
+
+			int framesCount = 0;
+			unsigned char header[LOCAL_HEADER_SIZE];
+			std::vector<unsigned char> data;
+
+			// the entries are written one after another by SequenceArchiveWriter, each with its sizes and CRC in its local header
+			while(archiveFile.read((char*)header, LOCAL_HEADER_SIZE)) {
+				if((readLittleEndian(header, 4) != LOCAL_HEADER_SIGNATURE) || (readLittleEndian(header + LOCAL_HEADER_FLAGS_OFFSET, 2) & DATA_DESCRIPTOR_FLAG))
+					break;
+
+				unsigned int method = readLittleEndian(header + LOCAL_HEADER_METHOD_OFFSET, 2);
+				unsigned int checksum = readLittleEndian(header + LOCAL_HEADER_CRC_OFFSET, 4);
+				unsigned int compressedSize = readLittleEndian(header + LOCAL_HEADER_COMPRESSED_SIZE_OFFSET, 4);
+				unsigned int uncompressedSize = readLittleEndian(header + LOCAL_HEADER_UNCOMPRESSED_SIZE_OFFSET, 4);
+				unsigned int nameLength = readLittleEndian(header + LOCAL_HEADER_NAME_LENGTH_OFFSET, 2);
+				unsigned int extraLength = readLittleEndian(header + LOCAL_HEADER_EXTRA_LENGTH_OFFSET, 2);
+
+				std::string entryName(nameLength, '\0');
+
+				if(!archiveFile.read(&entryName[0], nameLength) || !archiveFile.seekg(extraLength, std::ios::cur))
+					break;
+
+				// the frames are stored, the other entries (calibration and markers data) are written again from the sequence
+				if((method != 0) || (compressedSize != uncompressedSize) || (entryName.find('/') == std::string::npos)) {
+					if(!archiveFile.seekg(compressedSize, std::ios::cur))
+						break;
+
+					continue;
+				}
+
+				data.resize(compressedSize);
+
+				if(!archiveFile.read((char*)data.data(), compressedSize) || (mz_crc32(MZ_CRC32_INIT, data.data(), compressedSize) != checksum))
+					break;
+
+				boost::filesystem::path framePath = directory / entryName;
+				boost::filesystem::create_directories(framePath.parent_path());
+
+				std::ofstream frameFile(framePath.string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+				frameFile.write((const char*)data.data(), data.size());
+				frameFile.close();
+
+				if(frameFile.fail()) {
+					std::ostringstream errMsg;
+					errMsg << "Error while extracting " << entryName << " from archive " << archiveFilePath << " to " << framePath.string();
+					throw FileWritingException(errMsg.str().c_str());
+				}
+
+				framesCount++;
+			}
+
+			return(framesCount);
+		}
+	} // namespace datalib
+} // namespace kocca
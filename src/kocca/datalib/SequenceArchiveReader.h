@@ -0,0 +1,192 @@
+#ifndef KOCCA_DATALIB_SEQUENCE_ARCHIVE_READER_H
+#define KOCCA_DATALIB_SEQUENCE_ARCHIVE_READER_H
+
+#include <string>
+#include <vector>
+
+#include "boost/filesystem.hpp"
+
+namespace kocca {
+	namespace datalib {
+
+		/**
+		 * The content of an entry of a sequence archive, as read by SequenceArchiveReader::readEntry() : a stored entry is read in place, in a view of the archive file mapped in memory, without any copy, while a deflated entry is inflated straight from the mapped view into a buffer.
+		 * The view is unmapped when the content is destroyed, so the data must not be used afterwards.
+		 */
+		class SequenceArchiveEntryContent {
+		protected:
+
+			/**
+			 * The start and the size of the mapped view of the archive file, or NULL if no view is mapped.
+			 */
+			void* mappedView;
+			size_t mappedViewSize;
+
+			/**
+			 * The data of the entry, either in the mapped view or in inflatedData.
+			 */
+			const unsigned char* data;
+
+			/**
+			 * The size of the data of the entry, in bytes.
+			 */
+			size_t size;
+
+			/**
+			 * The inflated data of a deflated entry.
+			 */
+			std::vector<unsigned char> inflatedData;
+
+			/**
+			 * Unmaps the view, if any, and frees the inflated data.
+			 */
+			void release();
+
+			friend class SequenceArchiveReader;
+
+		public:
+
+			/**
+			 * Constructor. The content is empty until it is read by SequenceArchiveReader::readEntry().
+			 */
+			SequenceArchiveEntryContent();
+
+			/**
+			 * Destructor. Unmaps the view of the archive file.
+			 */
+			~SequenceArchiveEntryContent();
+
+			/**
+			 * Gets the data of the entry.
+			 */
+			const unsigned char* getData();
+
+			/**
+			 * Gets the size of the data of the entry, in bytes.
+			 */
+			size_t getSize();
+		};
+
+		/**
+		 * Reads the entries of a kocca sequence archive (.ksa) file in place, without extracting them first : only the central directory of the archive is read when it is opened, which takes well under a second even for the largest sequences, then each entry is read from its offset in the archive file when it is needed.
+		 * The archive file is mapped in memory one view per entry read (the whole file may not fit in the address space of a 32 bits process). Entries can be read from several threads at the same time.
+		 * Archives are written without zip64 extensions (see SequenceFile and SequenceArchiveWriter), so they are at most 4 GB.
+		 */
+		class SequenceArchiveReader {
+		protected:
+
+			/**
+			 * The path of the archive file.
+			 */
+			std::string archiveFilePath;
+
+			/**
+			 * The size of the archive file, in bytes.
+			 */
+			unsigned long long archiveFileSize;
+
+			/**
+			 * The alignment of the offsets of the mapped views, in bytes.
+			 */
+			unsigned long long viewAlignment;
+
+#ifdef _WIN32
+			/**
+			 * The opened archive file and its file mapping object.
+			 */
+			void* fileHandle;
+			void* fileMappingHandle;
+#else
+			/**
+			 * The descriptor of the opened archive file.
+			 */
+			int fileDescriptor;
+#endif // _WIN32
+
+			/**
+			 * The name, the offset of the local header, the compressed and uncompressed sizes, and the compression method of each entry, indexed like in the central directory.
+			 */
+			std::vector<std::string> entryNames;
+			std::vector<unsigned long long> entryLocalHeaderOffsets;
+			std::vector<unsigned long long> entryCompressedSizes;
+			std::vector<unsigned long long> entryUncompressedSizes;
+			std::vector<int> entryMethods;
+
+			/**
+			 * Maps a view of the archive file, covering at least a given range.
+			 * @param offset the offset of the range in the archive file
+			 * @param length the length of the range, in bytes
+			 * @param content the entry content that holds the view (any previous view is unmapped)
+			 * @return the start of the range in the view, or NULL if it couldn't be mapped
+			 */
+			const unsigned char* mapView(unsigned long long offset, unsigned long long length, SequenceArchiveEntryContent& content);
+
+		public:
+
+			/**
+			 * Constructor. Opens the archive file and reads its central directory.
+			 * @param _archiveFilePath the path of the .ksa archive file
+			 * @throws FileReadingException if the archive file couldn't be opened, or isn't a valid archive
+			 */
+			SequenceArchiveReader(const std::string& _archiveFilePath);
+
+			/**
+			 * Destructor. Closes the archive file.
+			 */
+			~SequenceArchiveReader();
+
+			/**
+			 * Gets the path of the archive file.
+			 */
+			std::string getArchiveFilePath();
+
+			/**
+			 * Gets the number of entries of the archive.
+			 */
+			int getEntriesCount();
+
+			/**
+			 * Gets the name of an entry, which is its path inside the archive (ex : "image/1234.jpeg").
+			 * @param entryIndex the index of the entry
+			 */
+			std::string getEntryName(int entryIndex);
+
+			/**
+			 * Gets the index of an entry from its name.
+			 * @param entryName the path of the entry inside the archive
+			 * @return the index of the entry, or -1 if there's no such entry
+			 */
+			int findEntry(const std::string& entryName);
+
+			/**
+			 * Reads the content of an entry.
+			 * @param entryIndex the index of the entry
+			 * @param content the entry content in which the data is read
+			 * @throws FileReadingException if the entry couldn't be read, or is compressed with another method than deflate
+			 */
+			void readEntry(int entryIndex, SequenceArchiveEntryContent& content);
+
+			/**
+			 * Extracts an entry to a file.
+			 * @param entryName the path of the entry inside the archive
+			 * @param filePath the path of the file to write
+			 * @return false if there's no such entry in the archive
+			 * @throws FileReadingException if the entry couldn't be read
+			 * @throws FileWritingException if the file couldn't be written
+			 */
+			bool extractEntry(const std::string& entryName, const boost::filesystem::path& filePath);
+
+			/**
+			 * Extracts the frames (the stored entries in a folder, ex : "image/1234.jpeg") of an archive whose writing was interrupted before its central directory was written, so it can't be opened : the local headers are read one after another from the start of the file, up to the first torn entry.
+			 * @param archiveFilePath the path of the archive file
+			 * @param directory the directory in which the frames are extracted, in their folders
+			 * @return the number of frames extracted
+			 * @throws FileReadingException if the archive file couldn't be opened
+			 * @throws FileWritingException if a frame file couldn't be written
+			 */
+			static int salvageFrames(const std::string& archiveFilePath, const boost::filesystem::path& directory);
+		};
+	} // namespace datalib
+} // namespace kocca
+
+#endif // KOCCA_DATALIB_SEQUENCE_ARCHIVE_READER_H
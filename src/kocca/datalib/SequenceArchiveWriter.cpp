@@ -0,0 +1,143 @@
+#include "SequenceArchiveWriter.h"
+#include "../Exceptions.h"
+#include <cstring>
+#include <sstream>
+
+namespace kocca {
+	namespace datalib {
+		namespace {
+			/**
+			 * The limits of a zip archive without zip64 extensions.
+			 */
+			const unsigned long long MAX_ARCHIVE_SIZE = 0xFFFFFFFF;
+			const unsigned long long MAX_ARCHIVE_ENTRIES = 0xFFFF;
+
+			/**
+			 * The size of the local header and of the central directory header of an entry, without its name, and of the end of central directory record.
+			 */
+			const unsigned long long LOCAL_HEADER_SIZE = 30;
+			const unsigned long long CENTRAL_DIRECTORY_HEADER_SIZE = 46;
+			const unsigned long long END_OF_CENTRAL_DIRECTORY_SIZE = 22;
+
+			/**
+			 * A margin for the worst case expansion of deflated contents, in bytes.
+			 */
+			const unsigned long long DEFLATE_MARGIN = 1048576;
+		}
+
+		/**
+		 * @throws FileArchivingException
+		 */
+		SequenceArchiveWriter::SequenceArchiveWriter(const std::string& _archiveFilePath) {
+			archiveFilePath = _archiveFilePath;
+			centralDirectorySize = 0;
+			memset(&zip_archive, 0, sizeof(zip_archive));
+
+			if(!mz_zip_writer_init_file(&zip_archive, archiveFilePath.c_str(), 0)) {
+				std::ostringstream errMsg;
+				errMsg << "Error trying to create archive " << archiveFilePath;
+				throw FileArchivingException(errMsg.str().c_str());
+			}
+
+			isOpen = true;
+		}
+
+		SequenceArchiveWriter::~SequenceArchiveWriter() {
+			try {
+				finalize();
+			}
+			catch(std::exception& e) {
+				// we do nothing, the archive is left as it is
+			}
+		}
+
+		/**
+		 * @throws FileArchivingException
+		 */
+		void SequenceArchiveWriter::addFile(const std::string& archiveRelativePath, const void* data, size_t size, bool compress) {
+			if(!tryAddFile(archiveRelativePath, data, size, compress)) {
+				std::ostringstream errMsg;
+				errMsg << "Can't write " << archiveRelativePath << " to archive " << archiveFilePath << " : archive has reached the 4 GB or 65535 files limit";
+				throw FileArchivingException(errMsg.str().c_str());
+			}
+		}
+
+		bool SequenceArchiveWriter::fitsInArchive(const std::string& archiveRelativePath, size_t size) {
+			if((zip_archive.m_total_files + 1) > MAX_ARCHIVE_ENTRIES)
+				return(false);
+
+			// the central directory is written after the last entry, and must end within the limit too
+			unsigned long long archiveSize = zip_archive.m_archive_size + LOCAL_HEADER_SIZE + archiveRelativePath.length() + size + DEFLATE_MARGIN
+				+ centralDirectorySize + CENTRAL_DIRECTORY_HEADER_SIZE + archiveRelativePath.length() + END_OF_CENTRAL_DIRECTORY_SIZE;
+
+			return(archiveSize <= MAX_ARCHIVE_SIZE);
+		}
+
+		/**
+		 * @throws FileArchivingException
+		 */
+		bool SequenceArchiveWriter::tryAddFile(const std::string& archiveRelativePath, const void* data, size_t size, bool compress) {
+			zip_archive_mutex.lock();
+
+			if(!isOpen) {
+				zip_archive_mutex.unlock();
+				std::ostringstream errMsg;
+				errMsg << "Can't write " << archiveRelativePath << " to archive " << archiveFilePath << " : archive has already been finalized";
+				throw FileArchivingException(errMsg.str().c_str());
+			}
+
+			if(!fitsInArchive(archiveRelativePath, size)) {
+				zip_archive_mutex.unlock();
+				return(false);
+			}
+
+			mz_bool added = mz_zip_writer_add_mem_ex(&zip_archive, archiveRelativePath.c_str(), data, size, "", 0, compress ? MZ_BEST_SPEED : MZ_NO_COMPRESSION, 0, 0);
+
+			if(added)
+				centralDirectorySize += CENTRAL_DIRECTORY_HEADER_SIZE + archiveRelativePath.length();
+
+			zip_archive_mutex.unlock();
+
+			if(!added) {
+				std::ostringstream errMsg;
+				errMsg << "Error while writing " << archiveRelativePath << " to archive " << archiveFilePath;
+				throw FileArchivingException(errMsg.str().c_str());
+			}
+
+			return(true);
+		}
+
+		/**
+		 * @throws FileArchivingException
+		 */
+		void SequenceArchiveWriter::finalize() {
+			zip_archive_mutex.lock();
+
+			if(isOpen) {
+				isOpen = false;
+				bool resFinalize = mz_zip_writer_finalize_archive(&zip_archive);
+				bool resEnd = mz_zip_writer_end(&zip_archive);
+				zip_archive_mutex.unlock();
+
+				if(!resFinalize || !resEnd) {
+					std::ostringstream errMsg;
+					errMsg << "Error trying to finalize archive " << archiveFilePath << std::endl << "Archive may be currupted.";
+					throw FileArchivingException(errMsg.str().c_str());
+				}
+			}
+			else
+				zip_archive_mutex.unlock();
+		}
+
+		bool SequenceArchiveWriter::isFinalized() {
+			zip_archive_mutex.lock();
+			bool finalized = !isOpen;
+			zip_archive_mutex.unlock();
+			return(finalized);
+		}
+
+		std::string SequenceArchiveWriter::getArchiveFilePath() {
+			return(archiveFilePath);
+		}
+	} // namespace datalib
+} // namespace kocca
@@ -0,0 +1,110 @@
+#ifndef KOCCA_DATALIB_SEQUENCE_ARCHIVE_WRITER_H
+#define KOCCA_DATALIB_SEQUENCE_ARCHIVE_WRITER_H
+
+#include <mutex>
+#include <string>
+
+#define MINIZ_HEADER_FILE_ONLY
+#include "miniz.c"
+
+namespace kocca {
+	namespace datalib {
+
+		/**
+		 * Writes a kocca sequence archive (.ksa) file incrementally : files are appended to the archive one by one as soon as they are available, and the archive's central directory is written when it is finalized.
+		 * This allows to record a sequence straight into its archive, instead of writing it to a temp folder first and exporting it afterwards.
+		 * Files can be added from several threads at the same time, the writes to the archive are serialized internally.
+		 * miniz writes archives without zip64 extensions : an archive can't grow past 4 GB nor 65535 entries, tryAddFile() tells when a file wouldn't fit anymore.
+		 */
+		class SequenceArchiveWriter {
+		protected:
+
+			/**
+			 * The path of the archive file.
+			 */
+			std::string archiveFilePath;
+
+			/**
+			 * The zip archive object being written.
+			 */
+			mz_zip_archive zip_archive;
+
+			/**
+			 * Whether or not the archive is still open for writing (it is not anymore once it has been finalized).
+			 */
+			bool isOpen;
+
+			/**
+			 * A lock to prevent simultaneous accesses to the zip archive object in a multi-threaded context.
+			 */
+			std::mutex zip_archive_mutex;
+
+			/**
+			 * The size the central directory of the archive will have once it is written, in bytes.
+			 */
+			unsigned long long centralDirectorySize;
+
+			/**
+			 * Checks if a file still fits in the archive, along with the central directory, without going past the limits of an archive without zip64 extensions. The zip archive object must be locked.
+			 * @param archiveRelativePath the path of the file inside the archive
+			 * @param size the size of the content of the file, in bytes
+			 * @return true if the file fits
+			 */
+			bool fitsInArchive(const std::string& archiveRelativePath, size_t size);
+
+		public:
+
+			/**
+			 * Constructor. Creates the archive file, overwriting it if it already exists.
+			 * @param _archiveFilePath the path of the .ksa archive file to create
+			 * @throws FileArchivingException if the archive file couldn't be created
+			 */
+			SequenceArchiveWriter(const std::string& _archiveFilePath);
+
+			/**
+			 * Destructor. Finalizes the archive if it hasn't been done yet.
+			 */
+			~SequenceArchiveWriter();
+
+			/**
+			 * Appends a file to the archive.
+			 * @param archiveRelativePath the path of the file inside the archive (ex : "image/1234.jpeg")
+			 * @param data the content of the file
+			 * @param size the size of the content, in bytes
+			 * @param compress whether or not the content should be deflated. Already compressed contents (JPEG, PNG or .kir frames) should rather be stored as they are.
+			 * @throws FileArchivingException if the archive has already been finalized, if the file doesn't fit in it anymore, or if the file couldn't be written into the archive
+			 */
+			void addFile(const std::string& archiveRelativePath, const void* data, size_t size, bool compress = false);
+
+			/**
+			 * Appends a file to the archive if it still fits in it.
+			 * @param archiveRelativePath the path of the file inside the archive (ex : "image/1234.jpeg")
+			 * @param data the content of the file
+			 * @param size the size of the content, in bytes
+			 * @param compress whether or not the content should be deflated
+			 * @return false if the file would take the archive past 4 GB or 65535 entries, in which case nothing is written
+			 * @throws FileArchivingException if the archive has already been finalized, or if the file couldn't be written into the archive
+			 */
+			bool tryAddFile(const std::string& archiveRelativePath, const void* data, size_t size, bool compress = false);
+
+			/**
+			 * Writes the central directory of the archive and closes it. Calling it again once the archive is finalized has no effect.
+			 * @throws FileArchivingException if the archive couldn't be finalized
+			 */
+			void finalize();
+
+			/**
+			 * Checks if the archive has been finalized.
+			 * @return true if finalize() has been called, false otherwise
+			 */
+			bool isFinalized();
+
+			/**
+			 * Gets the path of the archive file.
+			 */
+			std::string getArchiveFilePath();
+		};
+	} // namespace datalib
+} // namespace kocca
+
+#endif // KOCCA_DATALIB_SEQUENCE_ARCHIVE_WRITER_H
@@ -25,28 +25,15 @@ namespace kocca {
 				std::ostringstream archiveRelativePath;
 				archiveRelativePath << "image/" << framePath.time << ".jpeg";
 
-				std::ifstream fileStream(framePath.path, std::ios::binary | std::ios::ate);
-				std::streamsize fileStreamSize = fileStream.tellg();
-				fileStream.seekg(0, std::ios::beg);
-				char* fileContent = new char[fileStreamSize];
-
-				if(fileStream.read(fileContent, fileStreamSize)) {
-					if(!mz_zip_writer_add_mem_ex(pzip_archive, archiveRelativePath.str().c_str(), fileContent, fileStreamSize, "", 0, MZ_BEST_SPEED, 0, 0)) {
-						std::ostringstream errMsg;
-						errMsg << "Error while writing image file content to archive as " << archiveRelativePath.str();
-						delete fileContent;
-						throw FileArchivingException(errMsg.str().c_str());
-					}
-				}
-				else {
+				std::vector<unsigned char> fileContent;
+				pSequence->readFrameFileContent(framePath, fileContent);
+
+				// like in the archives written while recording, the frames are already compressed : they are stored as is, so they can be read in place
+				if(!mz_zip_writer_add_mem_ex(pzip_archive, archiveRelativePath.str().c_str(), fileContent.data(), fileContent.size(), "", 0, MZ_NO_COMPRESSION, 0, 0)) {
 					std::ostringstream errMsg;
-					errMsg << "Error while reading image file content of " << framePath.path;
-					delete fileContent;
-					throw FileReadingException(errMsg.str().c_str());
+					errMsg << "Error while writing image file content to archive as " << archiveRelativePath.str();
+					throw FileArchivingException(errMsg.str().c_str());
 				}
-
-				delete fileContent;
-				fileStream.close();
 			}
 		}
 
@@ -61,30 +48,16 @@ namespace kocca {
 				FramePath framePath = irFramesList.at(i);
 
 				std::ostringstream archiveRelativePath;
-				archiveRelativePath << "infrared/" << framePath.time << ".png";
-
-				std::ifstream fileStream(framePath.path, std::ios::binary | std::ios::ate);
-				std::streamsize fileStreamSize = fileStream.tellg();
-				fileStream.seekg(0, std::ios::beg);
-				char* fileContent = new char[fileStreamSize];
-
-				if (fileStream.read(fileContent, fileStreamSize)) {
-					if (!mz_zip_writer_add_mem_ex(pzip_archive, archiveRelativePath.str().c_str(), fileContent, fileStreamSize, "", 0, MZ_BEST_SPEED, 0, 0)) {
-						std::ostringstream errMsg;
-						errMsg << "Error while writing infrared frame content to archive as " << archiveRelativePath.str();
-						delete fileContent;
-						throw FileArchivingException(errMsg.str().c_str());
-					}
-				}
-				else {
+				archiveRelativePath << "infrared/" << framePath.time << boost::filesystem::path(framePath.path).extension().string();
+
+				std::vector<unsigned char> fileContent;
+				pSequence->readFrameFileContent(framePath, fileContent);
+
+				if(!mz_zip_writer_add_mem_ex(pzip_archive, archiveRelativePath.str().c_str(), fileContent.data(), fileContent.size(), "", 0, MZ_NO_COMPRESSION, 0, 0)) {
 					std::ostringstream errMsg;
-					errMsg << "Error while reading image file content of " << framePath.path;
-					delete fileContent;
-					throw FileReadingException(errMsg.str().c_str());
+					errMsg << "Error while writing infrared frame content to archive as " << archiveRelativePath.str();
+					throw FileArchivingException(errMsg.str().c_str());
 				}
-
-				delete fileContent;
-				fileStream.close();
 			}
 		}
 
@@ -101,28 +74,14 @@ namespace kocca {
 				std::ostringstream archiveRelativePath;
 				archiveRelativePath << "depth/" << framePath.time << ".png";
 
-				std::ifstream fileStream(framePath.path, std::ios::binary | std::ios::ate);
-				std::streamsize fileStreamSize = fileStream.tellg();
-				fileStream.seekg(0, std::ios::beg);
-				char* fileContent = new char[fileStreamSize];
-
-				if(fileStream.read(fileContent, fileStreamSize)) {
-					if(!mz_zip_writer_add_mem_ex(pzip_archive, archiveRelativePath.str().c_str(), fileContent, fileStreamSize, "", 0, MZ_BEST_SPEED, 0, 0)) {
-						std::ostringstream errMsg;
-						errMsg << "Error while writing depth file content to archive as " << archiveRelativePath.str();
-						delete fileContent;
-						throw FileArchivingException(errMsg.str().c_str());
-					}
-				}
-				else {
+				std::vector<unsigned char> fileContent;
+				pSequence->readFrameFileContent(framePath, fileContent);
+
+				if(!mz_zip_writer_add_mem_ex(pzip_archive, archiveRelativePath.str().c_str(), fileContent.data(), fileContent.size(), "", 0, MZ_NO_COMPRESSION, 0, 0)) {
 					std::ostringstream errMsg;
-					errMsg << "Error while reading depth file content of " << framePath.path;
-					delete fileContent;
-					throw FileReadingException(errMsg.str().c_str());
+					errMsg << "Error while writing depth file content to archive as " << archiveRelativePath.str();
+					throw FileArchivingException(errMsg.str().c_str());
 				}
-
-				delete fileContent;
-				fileStream.close();
 			}
 		}
 
@@ -152,12 +111,47 @@ namespace kocca {
 			}
 		}
 
+		/**
+		 * @throws FileArchivingException
+		 */
+		void SequenceFile::exportSequenceMetadata(Sequence* pSequence, mz_zip_archive* pzip_archive) {
+			// the frames are gathered into the archive, whatever the folders they have been recorded into
+			SequenceMetadata exportedMetadata = *(pSequence->getMetadata());
+			exportedMetadata.clearStreamDirectories();
+			std::string metadataFileContent = exportedMetadata.getFileContent();
+
+			if(!mz_zip_writer_add_mem_ex(pzip_archive, SequenceMetadata::FILE_NAME, metadataFileContent.c_str(), metadataFileContent.length(), "", 0, MZ_BEST_SPEED, 0, 0))
+				throw FileArchivingException("Error while writing sequence metadata content to archive");
+		}
+
+		/**
+		 * @throws FileArchivingException
+		 */
+		void SequenceFile::exportSequenceStatistics(Sequence* pSequence, mz_zip_archive* pzip_archive) {
+			boost::filesystem::path statisticsFilePath = pSequence->getRootDirectory() / Sequence::STATISTICS_FILE_NAME;
+
+			if(boost::filesystem::is_regular_file(statisticsFilePath)) {
+				std::ifstream statisticsFile(statisticsFilePath.string().c_str(), std::ios::in | std::ios::binary);
+				std::string statisticsFileContent((std::istreambuf_iterator<char>(statisticsFile)), std::istreambuf_iterator<char>());
+
+				if(!statisticsFileContent.empty() && !mz_zip_writer_add_mem_ex(pzip_archive, Sequence::STATISTICS_FILE_NAME, statisticsFileContent.c_str(), statisticsFileContent.length(), "", 0, MZ_BEST_SPEED, 0, 0))
+					throw FileArchivingException("Error while writing recording statistics content to archive");
+			}
+		}
+
 		/**
 		 * @throws FileArchivingException
 		 * @throws FileReadingException
 		 * @throws KinectCalibrationFileExportException
 		 */
 		void SequenceFile::exportSequence(Sequence* pSequence) {
+			// the frames of a sequence read from its archive can't be exported over that same archive
+			if(pSequence->isReadFromArchive() && boost::filesystem::exists(sequenceFilePath) && boost::filesystem::equivalent(sequenceFilePath, pSequence->getArchiveFilePath())) {
+				std::ostringstream errMsg;
+				errMsg << "Unable to export the sequence to " << sequenceFilePath << ", as it is read from this archive";
+				throw FileArchivingException(errMsg.str().c_str());
+			}
+
 			mz_zip_archive zip_archive;
 			memset(&(zip_archive), 0, sizeof(zip_archive));
 
@@ -167,6 +161,8 @@ namespace kocca {
 				exportSequenceDepthFrames(pSequence, &zip_archive);
 				exportSequenceCalibrationFile(pSequence, &zip_archive);
 				exportSequenceMarkers(pSequence, &zip_archive);
+				exportSequenceMetadata(pSequence, &zip_archive);
+				exportSequenceStatistics(pSequence, &zip_archive);
 
 				bool resFinalize = mz_zip_writer_finalize_archive(&zip_archive);
 				bool resEnd = mz_zip_writer_end(&zip_archive);
@@ -107,6 +107,22 @@ namespace kocca {
 			 */
 			void exportSequenceMarkers(Sequence* pSequence, mz_zip_archive* pzip_archive);
 
+			/**
+			 * Exports the metadata of a sequence into a zip archive.
+			 * @param pSequence the sequence to export the metadata from
+			 * @param pzip_archive the zip archive to export the metadata into
+			 * @throws FileArchivingException if an error happens during the writing in the zip archive file
+			 */
+			void exportSequenceMetadata(Sequence* pSequence, mz_zip_archive* pzip_archive);
+
+			/**
+			 * Exports the recording statistics file of a sequence into a zip archive, if it has one (see Sequence::STATISTICS_FILE_NAME).
+			 * @param pSequence the sequence to export the recording statistics from
+			 * @param pzip_archive the zip archive to export the recording statistics into
+			 * @throws FileArchivingException if an error happens during the writing in the zip archive file
+			 */
+			void exportSequenceStatistics(Sequence* pSequence, mz_zip_archive* pzip_archive);
+
 			
 		public:
 
@@ -0,0 +1,273 @@
+#include "SequenceIterator.h"
+#include "../Exceptions.h"
+#include <sstream>
+
+namespace kocca {
+	namespace datalib {
+		SequenceSample::SequenceSample(): markersFrame(0) {
+			rank = -1;
+			time = 0;
+			hasMarkersFrame = false;
+		}
+
+		SequenceIterator::SequenceIterator(Sequence* _sequence, int _streams, int _threadsCount, int _maxBufferedSamples) {
+			sequence = _sequence;
+			streams = _streams;
+
+			if(streams & SEQUENCE_ITERATOR_COLOR)
+				imageFramesList = sequence->getImageFramesList();
+
+			if(streams & SEQUENCE_ITERATOR_INFRARED)
+				irFramesList = sequence->getIRFramesList();
+
+			if(streams & SEQUENCE_ITERATOR_DEPTH)
+				depthFramesList = sequence->getDepthFramesList();
+
+			if((streams & SEQUENCE_ITERATOR_MARKERS) && !sequence->markersSequence.hasData())
+				streams &= ~SEQUENCE_ITERATOR_MARKERS;
+
+			if(streams & SEQUENCE_ITERATOR_COLOR)
+				referenceFramesList = &imageFramesList;
+			else if(streams & SEQUENCE_ITERATOR_INFRARED)
+				referenceFramesList = &irFramesList;
+			else if(streams & SEQUENCE_ITERATOR_DEPTH)
+				referenceFramesList = &depthFramesList;
+			else
+				referenceFramesList = NULL;
+
+			if(referenceFramesList != NULL)
+				samplesCount = (int)referenceFramesList->size();
+			else if(streams & SEQUENCE_ITERATOR_MARKERS)
+				samplesCount = (int)sequence->markersSequence.markersData.size();
+			else
+				samplesCount = 0;
+
+			threadsCount = (_threadsCount > 0) ? _threadsCount : (int)std::thread::hardware_concurrency();
+
+			if(threadsCount < 1)
+				threadsCount = 1;
+
+			maxBufferedSamples = (_maxBufferedSamples > 0) ? _maxBufferedSamples : (2 * threadsCount);
+			active = false;
+			runningThreadsCount = 0;
+			nextDecodedRank = 0;
+			nextDeliveredRank = 0;
+			failedRank = -1;
+			decodedFramesCount = 0;
+			startTime = std::chrono::steady_clock::now();
+		}
+
+		SequenceIterator::~SequenceIterator() {
+			stop();
+		}
+
+		void SequenceIterator::start() {
+			stop();
+
+			samples_mutex.lock();
+			nextDecodedRank = 0;
+			nextDeliveredRank = 0;
+			decodedSamples.clear();
+			failedRank = -1;
+			failureMessage = "";
+			decodedFramesCount = 0;
+			startTime = std::chrono::steady_clock::now();
+			active = true;
+			runningThreadsCount = threadsCount;
+			samples_mutex.unlock();
+
+			for(int i = 0; i < threadsCount; i++)
+				decodingThreads.push_back(new std::thread(&SequenceIterator::decodingThreadLoop, this));
+		}
+
+		void SequenceIterator::stop() {
+			samples_mutex.lock();
+			active = false;
+			samples_mutex.unlock();
+			samples_condition.notify_all();
+
+			for(int i = 0; i < decodingThreads.size(); i++) {
+				if(decodingThreads.at(i)->joinable())
+					decodingThreads.at(i)->join();
+
+				delete decodingThreads.at(i);
+			}
+
+			decodingThreads.clear();
+
+			samples_mutex.lock();
+			decodedSamples.clear();
+			samples_mutex.unlock();
+		}
+
+		void SequenceIterator::decodingThreadLoop() {
+			std::unique_lock<std::mutex> lock(samples_mutex);
+
+			while(active && (nextDecodedRank < samplesCount) && (failedRank < 0)) {
+				if(nextDecodedRank >= (nextDeliveredRank + maxBufferedSamples)) {
+					// enough samples are decoded ahead : nothing to do until the next one is delivered
+					samples_condition.wait(lock);
+					continue;
+				}
+
+				int rank = nextDecodedRank++;
+				lock.unlock();
+
+				SequenceSample sample;
+				int framesCount = 0;
+				bool failed = false;
+				std::string errorMessage;
+
+				try {
+					framesCount = decodeSample(rank, sample);
+				}
+				catch(std::exception& e) {
+					failed = true;
+					errorMessage = e.what();
+				}
+
+				lock.lock();
+				decodedFramesCount += framesCount;
+
+				if(failed) {
+					// the samples after the first that failed aren't delivered anyway
+					if((failedRank < 0) || (rank < failedRank)) {
+						failedRank = rank;
+						failureMessage = errorMessage;
+					}
+				}
+				else
+					decodedSamples[rank] = sample;
+
+				samples_condition.notify_all();
+			}
+
+			// once all the threads are done, next() doesn't wait for samples that won't come
+			runningThreadsCount--;
+			samples_condition.notify_all();
+		}
+
+		/**
+		 * @throws FileReadingException
+		 */
+		int SequenceIterator::decodeSample(int rank, SequenceSample& sample) {
+			int framesCount = 0;
+			sample.rank = rank;
+
+			if(referenceFramesList != NULL)
+				sample.time = referenceFramesList->at(rank).time;
+			else
+				sample.time = (unsigned long long)sequence->markersSequence.markersData.at(rank).time;
+
+			if((streams & SEQUENCE_ITERATOR_COLOR) && decodeFrameAtTime(imageFramesList, sample.time, SEQUENCE_ITERATOR_COLOR, sample.imageFrame))
+				framesCount++;
+
+			if((streams & SEQUENCE_ITERATOR_INFRARED) && decodeFrameAtTime(irFramesList, sample.time, SEQUENCE_ITERATOR_INFRARED, sample.irFrame))
+				framesCount++;
+
+			if((streams & SEQUENCE_ITERATOR_DEPTH) && decodeFrameAtTime(depthFramesList, sample.time, SEQUENCE_ITERATOR_DEPTH, sample.depthFrame))
+				framesCount++;
+
+			if(streams & SEQUENCE_ITERATOR_MARKERS) {
+				int markersRank = (referenceFramesList != NULL) ? sequence->markersSequence.getFrameRankAtTime(sample.time) : rank;
+
+				if(markersRank >= 0) {
+					sample.markersFrame = sequence->markersSequence.getFrameAtRank(markersRank);
+					sample.hasMarkersFrame = true;
+				}
+			}
+
+			return(framesCount);
+		}
+
+		/**
+		 * @throws FileReadingException
+		 */
+		bool SequenceIterator::decodeFrameAtTime(const std::vector<FramePath>& framesList, unsigned long long time, SequenceIteratorStream stream, TimeCodedFrame& tcFrame) {
+			// the last frame not after time, if any
+			int rank = FramePath::getFirstFrameRank(framesList, (long long)time, true) - 1;
+
+			if(rank < 0)
+				return(false);
+
+			const FramePath& framePath = framesList.at(rank);
+			tcFrame.time = framePath.time;
+
+			if(stream == SEQUENCE_ITERATOR_COLOR)
+				tcFrame.frame = sequence->readImageFrame(framePath, cv::IMREAD_COLOR);
+			else if(stream == SEQUENCE_ITERATOR_INFRARED)
+				tcFrame.frame = sequence->readIRFrame(framePath);
+			else
+				tcFrame.frame = sequence->readImageFrame(framePath, CV_LOAD_IMAGE_ANYDEPTH);
+
+			if(tcFrame.frame.empty()) {
+				std::ostringstream errMsg;
+				errMsg << "Error while decoding frame " << framePath.path;
+				throw FileReadingException(errMsg.str().c_str());
+			}
+
+			return(true);
+		}
+
+		/**
+		 * @throws FileReadingException
+		 */
+		bool SequenceIterator::next(SequenceSample& sample) {
+			std::unique_lock<std::mutex> lock(samples_mutex);
+
+			while(true) {
+				if(nextDeliveredRank >= samplesCount)
+					return(false);
+
+				std::map<int, SequenceSample>::iterator it = decodedSamples.find(nextDeliveredRank);
+
+				if(it != decodedSamples.end()) {
+					sample = it->second;
+					decodedSamples.erase(it);
+					nextDeliveredRank++;
+					lock.unlock();
+					samples_condition.notify_all();
+					return(true);
+				}
+
+				if(nextDeliveredRank == failedRank) {
+					std::string errorMessage = failureMessage;
+					lock.unlock();
+					throw FileReadingException(errorMessage.c_str());
+				}
+
+				if(!active || (runningThreadsCount == 0))
+					return(false);
+
+				samples_condition.wait(lock);
+			}
+		}
+
+		int SequenceIterator::getSamplesCount() {
+			return(samplesCount);
+		}
+
+		int SequenceIterator::getDeliveredSamplesCount() {
+			samples_mutex.lock();
+			int deliveredSamplesCount = nextDeliveredRank;
+			samples_mutex.unlock();
+			return(deliveredSamplesCount);
+		}
+
+		double SequenceIterator::getSamplesPerSecond() {
+			samples_mutex.lock();
+			double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+			double samplesPerSecond = (elapsedSeconds > 0) ? (nextDeliveredRank / elapsedSeconds) : 0;
+			samples_mutex.unlock();
+			return(samplesPerSecond);
+		}
+
+		double SequenceIterator::getFramesPerSecond() {
+			samples_mutex.lock();
+			double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+			double framesPerSecond = (elapsedSeconds > 0) ? (decodedFramesCount / elapsedSeconds) : 0;
+			samples_mutex.unlock();
+			return(framesPerSecond);
+		}
+	} // namespace datalib
+} // namespace kocca
@@ -0,0 +1,247 @@
+#ifndef KOCCA_DATALIB_SEQUENCE_ITERATOR_H
+#define KOCCA_DATALIB_SEQUENCE_ITERATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FramePath.h"
+#include "MocapMarkerFrame.h"
+#include "Sequence.h"
+#include "TimeCodedFrame.h"
+
+namespace kocca {
+	namespace datalib {
+
+		/**
+		 * The streams a SequenceIterator reads, to be combined as flags.
+		 */
+		enum SequenceIteratorStream {
+			SEQUENCE_ITERATOR_COLOR = 0x1, /**< Color image stream */
+			SEQUENCE_ITERATOR_INFRARED = 0x2, /**< Infrared stream */
+			SEQUENCE_ITERATOR_DEPTH = 0x4, /**< Depth stream */
+			SEQUENCE_ITERATOR_MARKERS = 0x8, /**< MoCap markers stream */
+			SEQUENCE_ITERATOR_ALL_STREAMS = 0xF /**< All the streams */
+		};
+
+		/**
+		 * A synchronized sample of the streams of a sequence, as delivered by SequenceIterator::next() : the frame of the reference stream, along with the frames of the other streams that would be shown with it during the playback (the last ones whose time is <= to its time).
+		 * The frames of the streams that aren't read, or that have no frame yet at the time of the sample, are empty.
+		 */
+		class SequenceSample {
+		public:
+
+			/**
+			 * The rank of the sample, which is the rank of its frame in the reference stream.
+			 */
+			int rank;
+
+			/**
+			 * The time of the sample, in microseconds.
+			 */
+			unsigned long long time;
+
+			/**
+			 * The color frame (BGR, at full resolution), the infrared frame (16 bits, not tone mapped) and the depth frame (16 bits).
+			 */
+			TimeCodedFrame imageFrame;
+			TimeCodedFrame irFrame;
+			TimeCodedFrame depthFrame;
+
+			/**
+			 * Whether or not the sample has a MoCap markers frame.
+			 */
+			bool hasMarkersFrame;
+
+			/**
+			 * The MoCap markers frame, if hasMarkersFrame is true.
+			 */
+			MocapMarkerFrame markersFrame;
+
+			/**
+			 * Constructor. The sample is empty.
+			 */
+			SequenceSample();
+		};
+
+		/**
+		 * Iterates over the synchronized samples of a sequence as fast as they can be decoded, without any playback clock, for offline processing.
+		 * The samples follow the frames of a reference stream : the first of the color, infrared and depth streams that is read, or the MoCap markers stream if no image stream is read. They are decoded by a pool of threads, several at a time, and delivered in order by next(). At most maxBufferedSamples samples are decoded ahead of the last delivered one, which bounds the memory used however slow the processing of the samples is.
+		 * The sequence must not be modified while it is iterated over.
+		 */
+		class SequenceIterator {
+		protected:
+
+			/**
+			 * The sequence.
+			 */
+			Sequence* sequence;
+
+			/**
+			 * The streams that are read, as SequenceIteratorStream flags.
+			 */
+			int streams;
+
+			/**
+			 * The frames of the color, infrared and depth streams, copied from the sequence.
+			 */
+			std::vector<FramePath> imageFramesList;
+			std::vector<FramePath> irFramesList;
+			std::vector<FramePath> depthFramesList;
+
+			/**
+			 * The frames of the reference stream, or NULL if the reference stream is the MoCap markers one.
+			 */
+			std::vector<FramePath>* referenceFramesList;
+
+			/**
+			 * The number of samples.
+			 */
+			int samplesCount;
+
+			/**
+			 * The number of decoding threads, and the maximum number of samples decoded ahead of the last delivered one.
+			 */
+			int threadsCount;
+			int maxBufferedSamples;
+
+			/**
+			 * The decoding threads.
+			 */
+			std::vector<std::thread*> decodingThreads;
+
+			/**
+			 * Whether or not the decoding threads should keep running.
+			 */
+			std::atomic<bool> active;
+
+			/**
+			 * The number of decoding threads that haven't exited their loop yet. Unlike decodingThreads, which only start() and stop() modify, it is read by next().
+			 */
+			int runningThreadsCount;
+
+			/**
+			 * The rank of the next sample to be decoded, and of the next one to be delivered.
+			 */
+			int nextDecodedRank;
+			int nextDeliveredRank;
+
+			/**
+			 * The decoded samples that haven't been delivered yet, by rank.
+			 */
+			std::map<int, SequenceSample> decodedSamples;
+
+			/**
+			 * The rank of the first sample that couldn't be decoded, or -1, and the reason why.
+			 */
+			int failedRank;
+			std::string failureMessage;
+
+			/**
+			 * The number of image frames decoded.
+			 */
+			unsigned long long decodedFramesCount;
+
+			/**
+			 * The time the iteration started at.
+			 */
+			std::chrono::steady_clock::time_point startTime;
+
+			/**
+			 * Locks runningThreadsCount, nextDecodedRank, nextDeliveredRank, decodedSamples, failedRank, failureMessage and decodedFramesCount.
+			 */
+			std::mutex samples_mutex;
+
+			/**
+			 * Notified when a sample is decoded, when one is delivered, and when the iteration stops.
+			 */
+			std::condition_variable samples_condition;
+
+			/**
+			 * Implementation for the decodingThreads threads. Each one decodes the next sample, within maxBufferedSamples of the last delivered one, until there's none left.
+			 */
+			void decodingThreadLoop();
+
+			/**
+			 * Decodes a sample.
+			 * @param rank the rank of the sample
+			 * @param sample the sample in which the frames are decoded
+			 * @return the number of image frames decoded
+			 * @throws FileReadingException if a frame couldn't be read
+			 */
+			int decodeSample(int rank, SequenceSample& sample);
+
+			/**
+			 * Reads and decodes the frame of a stream at the time of a sample.
+			 * @param framesList the frames of the stream
+			 * @param time the time of the sample
+			 * @param stream the stream, SEQUENCE_ITERATOR_COLOR, SEQUENCE_ITERATOR_INFRARED or SEQUENCE_ITERATOR_DEPTH
+			 * @param tcFrame the frame in which the frame is decoded, left empty if the stream has no frame yet at that time
+			 * @return true if a frame was decoded
+			 * @throws FileReadingException if the frame couldn't be read
+			 */
+			bool decodeFrameAtTime(const std::vector<FramePath>& framesList, unsigned long long time, SequenceIteratorStream stream, TimeCodedFrame& tcFrame);
+
+		public:
+
+			/**
+			 * Constructor. No frame is decoded until start() is called.
+			 * @param _sequence the sequence, whose frames lists are copied
+			 * @param _streams the streams to read, as SequenceIteratorStream flags
+			 * @param _threadsCount the number of decoding threads, or 0 for as many as the processor has cores
+			 * @param _maxBufferedSamples the maximum number of samples decoded ahead of the last delivered one, or 0 for twice the number of decoding threads
+			 */
+			SequenceIterator(Sequence* _sequence, int _streams = SEQUENCE_ITERATOR_ALL_STREAMS, int _threadsCount = 0, int _maxBufferedSamples = 0);
+
+			/**
+			 * Destructor. Stops the decoding threads.
+			 */
+			~SequenceIterator();
+
+			/**
+			 * Starts decoding the samples, from the first one.
+			 */
+			void start();
+
+			/**
+			 * Stops decoding the samples. The samples that weren't delivered yet are dropped.
+			 */
+			void stop();
+
+			/**
+			 * Gets the next sample, waiting for it to be decoded if needed.
+			 * @param sample the sample
+			 * @return false if there's no sample left, or if the iteration has been stopped
+			 * @throws FileReadingException if a frame of the sample couldn't be read
+			 */
+			bool next(SequenceSample& sample);
+
+			/**
+			 * Gets the number of samples of the sequence.
+			 */
+			int getSamplesCount();
+
+			/**
+			 * Gets the number of samples delivered so far.
+			 */
+			int getDeliveredSamplesCount();
+
+			/**
+			 * Gets the mean number of samples delivered per second since start() was called.
+			 */
+			double getSamplesPerSecond();
+
+			/**
+			 * Gets the mean number of image frames (of all the streams that are read) decoded per second since start() was called.
+			 */
+			double getFramesPerSecond();
+		};
+	} // namespace datalib
+} // namespace kocca
+
+#endif // KOCCA_DATALIB_SEQUENCE_ITERATOR_H
@@ -0,0 +1,162 @@
+#include "SequenceMetadata.h"
+#include "../Exceptions.h"
+#include "../Settings.h"
+#include <fstream>
+#include <sstream>
+
+namespace kocca {
+	namespace datalib {
+		namespace {
+			std::string getStreamDirectoriesKey(const char* streamFolderName) {
+				return(std::string(streamFolderName) + "_directories");
+			}
+		}
+
+		const char* SequenceMetadata::FILE_NAME = "sequence_metadata.conf";
+		const char* SequenceMetadata::TIME_UNIT_KEY = "time_unit";
+		const char* SequenceMetadata::TIME_UNIT_MICROSECONDS = "us";
+		const char* SequenceMetadata::TIME_UNIT_MILLISECONDS = "ms";
+		const char SequenceMetadata::DIRECTORIES_SEPARATOR = ';';
+
+		SequenceMetadata::SequenceMetadata() {
+			reset();
+		}
+
+		void SequenceMetadata::reset() {
+			values.clear();
+			values[TIME_UNIT_KEY] = TIME_UNIT_MICROSECONDS;
+		}
+
+		void SequenceMetadata::resetToLegacy() {
+			values.clear();
+			values[TIME_UNIT_KEY] = TIME_UNIT_MILLISECONDS;
+		}
+
+		/**
+		 * @throws FileReadingException
+		 */
+		bool SequenceMetadata::loadFromFile(boost::filesystem::path filePath) {
+			if(!boost::filesystem::exists(filePath) || !boost::filesystem::is_regular_file(filePath)) {
+				resetToLegacy();
+				return(false);
+			}
+
+			std::ifstream fileStream(filePath.string());
+
+			if(!fileStream.is_open()) {
+				std::ostringstream errMsg;
+				errMsg << "Unable to read sequence metadata file " << filePath.string();
+				throw FileReadingException(errMsg.str().c_str());
+			}
+
+			std::ostringstream content;
+			content << fileStream.rdbuf();
+			parse(content.str());
+			return(true);
+		}
+
+		void SequenceMetadata::parse(const std::string& content) {
+			// the keys that are missing from the file keep their legacy value
+			resetToLegacy();
+
+			// the metadata file has the same format as the settings file
+			std::istringstream contentStream(content);
+			Settings::parseValues(contentStream, values);
+		}
+
+		std::string SequenceMetadata::getFileContent() {
+			std::ostringstream content;
+
+			for(std::map<std::string, std::string>::iterator i = values.begin(); i != values.end(); i++)
+				content << i->first << " = " << i->second << std::endl;
+
+			return(content.str());
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void SequenceMetadata::writeToFile(boost::filesystem::path filePath) {
+			std::ofstream fileStream(filePath.string(), std::ios::out | std::ios::trunc);
+
+			if(fileStream.is_open())
+				fileStream << getFileContent();
+
+			if(!fileStream.is_open() || !fileStream.good()) {
+				std::ostringstream errMsg;
+				errMsg << "Unable to write sequence metadata file " << filePath.string();
+				throw FileWritingException(errMsg.str().c_str());
+			}
+		}
+
+		std::string SequenceMetadata::get(const char* key, const char* defaultValue) {
+			std::map<std::string, std::string>::iterator i = values.find(key);
+
+			if(i != values.end())
+				return(i->second);
+			else
+				return(std::string(defaultValue));
+		}
+
+		void SequenceMetadata::set(const char* key, std::string value) {
+			values[key] = value;
+		}
+
+		unsigned long long SequenceMetadata::getMicrosecondsPerTimeUnit() {
+			if(get(TIME_UNIT_KEY) == TIME_UNIT_MILLISECONDS)
+				return(1000);
+			else
+				return(1);
+		}
+
+		std::vector<boost::filesystem::path> SequenceMetadata::getStreamDirectories(const char* streamFolderName) {
+			return(splitDirectoriesList(get(getStreamDirectoriesKey(streamFolderName).c_str())));
+		}
+
+		void SequenceMetadata::setStreamDirectories(const char* streamFolderName, const std::vector<boost::filesystem::path>& directories) {
+			std::string key = getStreamDirectoriesKey(streamFolderName);
+
+			if(directories.empty())
+				values.erase(key);
+			else {
+				std::ostringstream directoriesList;
+
+				for(size_t i = 0; i < directories.size(); i++) {
+					if(i > 0)
+						directoriesList << DIRECTORIES_SEPARATOR;
+
+					directoriesList << directories.at(i).generic_string();
+				}
+
+				values[key] = directoriesList.str();
+			}
+		}
+
+		void SequenceMetadata::clearStreamDirectories() {
+			std::string keySuffix = getStreamDirectoriesKey("");
+			std::map<std::string, std::string>::iterator i = values.begin();
+
+			while(i != values.end()) {
+				if((i->first.length() > keySuffix.length()) && (i->first.compare(i->first.length() - keySuffix.length(), keySuffix.length(), keySuffix) == 0))
+					i = values.erase(i);
+				else
+					i++;
+			}
+		}
+
+		std::vector<boost::filesystem::path> SequenceMetadata::splitDirectoriesList(const std::string& directoriesList) {
+			std::vector<boost::filesystem::path> directories;
+			std::istringstream listStream(directoriesList);
+			std::string directory;
+
+			while(std::getline(listStream, directory, DIRECTORIES_SEPARATOR)) {
+				directory = Settings::trim(directory);
+
+				if(!directory.empty())
+					directories.push_back(boost::filesystem::path(directory));
+			}
+
+			return(directories);
+		}
+	} // namespace datalib
+} // namespace kocca
@@ -0,0 +1,142 @@
+#ifndef KOCCA_DATALIB_SEQUENCE_METADATA_H
+#define KOCCA_DATALIB_SEQUENCE_METADATA_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem.hpp"
+
+namespace kocca {
+	namespace datalib {
+
+		/**
+		 * The metadata of a sequence (format of its data), stored in the "sequence_metadata.conf" file of the sequence's root folder, as "key = value" lines.
+		 * Sequences recorded before this file existed don't have it : their metadata is then the one of the legacy format (times in milliseconds).
+		 */
+		class SequenceMetadata {
+		protected:
+
+			/**
+			 * The metadata values, indexed by their keys.
+			 */
+			std::map<std::string, std::string> values;
+
+		public:
+
+			/**
+			 * The name of the metadata file, in the sequence's root folder (or archive).
+			 */
+			static const char* FILE_NAME;
+
+			/**
+			 * The key of the unit of all the times of the sequence (frames files names, markers data), which is either TIME_UNIT_MICROSECONDS or TIME_UNIT_MILLISECONDS.
+			 */
+			static const char* TIME_UNIT_KEY;
+
+			/**
+			 * The time unit of the sequences recorded with a microsecond timebase.
+			 */
+			static const char* TIME_UNIT_MICROSECONDS;
+
+			/**
+			 * The time unit of the legacy sequences.
+			 */
+			static const char* TIME_UNIT_MILLISECONDS;
+
+			/**
+			 * The separator of the directories lists (see getStreamDirectories()). It can't be part of a path on any platform we support.
+			 */
+			static const char DIRECTORIES_SEPARATOR;
+
+			/**
+			 * Constructor. The metadata is initialized to the current format.
+			 */
+			SequenceMetadata();
+
+			/**
+			 * Resets the metadata to the current format (times in microseconds).
+			 */
+			void reset();
+
+			/**
+			 * Resets the metadata to the legacy format (times in milliseconds), for sequences that don't have a metadata file.
+			 */
+			void resetToLegacy();
+
+			/**
+			 * Reads the metadata from a file. If the file doesn't exist, the metadata is reset to the legacy format.
+			 * @param filePath the path of the metadata file
+			 * @return true if the file has been read, false if it doesn't exist
+			 * @throws FileReadingException if the file exists but couldn't be read
+			 */
+			bool loadFromFile(boost::filesystem::path filePath);
+
+			/**
+			 * Parses the content of a metadata file, and replaces the current metadata with it.
+			 * @param content the content of the file
+			 */
+			void parse(const std::string& content);
+
+			/**
+			 * Gets the content of the metadata file.
+			 */
+			std::string getFileContent();
+
+			/**
+			 * Writes the metadata to a file, overwriting it if it already exists.
+			 * @param filePath the path of the metadata file
+			 * @throws FileWritingException if the file couldn't be written
+			 */
+			void writeToFile(boost::filesystem::path filePath);
+
+			/**
+			 * Gets a metadata value.
+			 * @param key the key of the value
+			 * @param defaultValue the value returned if the key is not found
+			 */
+			std::string get(const char* key, const char* defaultValue = "");
+
+			/**
+			 * Sets a metadata value.
+			 * @param key the key of the value
+			 * @param value the new value
+			 */
+			void set(const char* key, std::string value);
+
+			/**
+			 * Gets the number of microseconds per unit of the sequence's times.
+			 * @return 1 for sequences in microseconds, 1000 for (legacy) sequences in milliseconds
+			 */
+			unsigned long long getMicrosecondsPerTimeUnit();
+
+			/**
+			 * Gets the folders outside of the sequence's root folder where some frames of a stream have been recorded (stored under the "<stream>_directories" key).
+			 * @param streamFolderName the name of the stream's folder ("image", "infrared" or "depth")
+			 * @return the absolute paths of the folders, empty if all the frames of the stream are in the root folder
+			 */
+			std::vector<boost::filesystem::path> getStreamDirectories(const char* streamFolderName);
+
+			/**
+			 * Sets the folders outside of the sequence's root folder where some frames of a stream are recorded.
+			 * @param streamFolderName the name of the stream's folder ("image", "infrared" or "depth")
+			 * @param directories the absolute paths of the folders
+			 */
+			void setStreamDirectories(const char* streamFolderName, const std::vector<boost::filesystem::path>& directories);
+
+			/**
+			 * Removes the folders of all the streams, typically once the frames have been gathered into a single folder or archive.
+			 */
+			void clearStreamDirectories();
+
+			/**
+			 * Splits a list of directories separated by DIRECTORIES_SEPARATOR.
+			 * @param directoriesList the list
+			 * @return the directories, without the empty ones
+			 */
+			static std::vector<boost::filesystem::path> splitDirectoriesList(const std::string& directoriesList);
+		};
+	} // namespace datalib
+} // namespace kocca
+
+#endif // KOCCA_DATALIB_SEQUENCE_METADATA_H
@@ -0,0 +1,263 @@
+#include "SequenceProxies.h"
+#include "../Exceptions.h"
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace kocca {
+	namespace datalib {
+		namespace {
+			/**
+			 * The first and last bytes of a proxies file, and the version of its format.
+			 */
+			const char PROXIES_MAGIC[4] = {'K', 'P', 'R', 'X'};
+			const unsigned int PROXIES_VERSION = 1;
+
+			/**
+			 * The size of the trailer : the offset of the index, the number of proxies and the magic.
+			 */
+			const size_t TRAILER_SIZE = sizeof(unsigned long long) + sizeof(unsigned int) + sizeof(PROXIES_MAGIC);
+
+			/**
+			 * The JPEG quality of the color and infrared proxies.
+			 */
+			const int PROXY_JPEG_QUALITY = 75;
+		}
+
+		SequenceProxies::SequenceProxies(Sequence* _sequence, int _proxyWidth) {
+			sequence = _sequence;
+			rootDirectory = sequence->getRootDirectory();
+			proxyWidth = (_proxyWidth > 0) ? _proxyWidth : 480;
+			framesLists[0] = sequence->getImageFramesList();
+			framesLists[1] = sequence->getIRFramesList();
+			framesLists[2] = sequence->getDepthFramesList();
+
+			for(int i = 0; i < STREAMS_COUNT; i++) {
+				proxyFiles[i] = NULL;
+				available[i] = false;
+			}
+		}
+
+		SequenceProxies::~SequenceProxies() {
+			for(int i = 0; i < STREAMS_COUNT; i++) {
+				if(proxyFiles[i] != NULL)
+					delete proxyFiles[i];
+			}
+		}
+
+		int SequenceProxies::getStreamIndex(const char* streamFolderName) {
+			for(int i = 0; i < STREAMS_COUNT; i++)
+				if(strcmp(streamFolderName, Sequence::STREAM_FOLDER_NAMES[i]) == 0)
+					return(i);
+
+			return(-1);
+		}
+
+		boost::filesystem::path SequenceProxies::getProxiesFilePath(const boost::filesystem::path& rootDirectory, const char* streamFolderName) {
+			return(rootDirectory / (std::string(streamFolderName) + "_proxies.kpx"));
+		}
+
+		bool SequenceProxies::openProxiesFile(int streamIndex) {
+			std::ifstream* proxiesFile = new std::ifstream(getProxiesFilePath(rootDirectory, Sequence::STREAM_FOLDER_NAMES[streamIndex]).string().c_str(), std::ios::in | std::ios::binary);
+			bool isComplete = false;
+
+			if(proxiesFile->is_open() && proxiesFile->seekg(0, std::ios::end)) {
+				unsigned long long fileSize = (unsigned long long)proxiesFile->tellg();
+
+				if(fileSize >= (sizeof(PROXIES_MAGIC) + sizeof(PROXIES_VERSION) + TRAILER_SIZE)) {
+					char header[sizeof(PROXIES_MAGIC)];
+					unsigned int version = 0;
+					unsigned long long indexOffset = 0;
+					unsigned int proxiesCount = 0;
+					char trailerMagic[sizeof(PROXIES_MAGIC)];
+
+					proxiesFile->seekg(0);
+					proxiesFile->read(header, sizeof(header));
+					proxiesFile->read((char*)&version, sizeof(version));
+					proxiesFile->seekg(fileSize - TRAILER_SIZE);
+					proxiesFile->read((char*)&indexOffset, sizeof(indexOffset));
+					proxiesFile->read((char*)&proxiesCount, sizeof(proxiesCount));
+					proxiesFile->read(trailerMagic, sizeof(trailerMagic));
+
+					// a file of an older version, interrupted, or of frames that changed since, is generated again
+					isComplete = proxiesFile->good() && (memcmp(header, PROXIES_MAGIC, sizeof(PROXIES_MAGIC)) == 0) && (memcmp(trailerMagic, PROXIES_MAGIC, sizeof(PROXIES_MAGIC)) == 0)
+						&& (version == PROXIES_VERSION) && (proxiesCount == framesLists[streamIndex].size())
+						&& ((indexOffset + (proxiesCount * (sizeof(unsigned long long) + sizeof(unsigned int))) + TRAILER_SIZE) == fileSize);
+
+					if(isComplete) {
+						proxyOffsets[streamIndex].resize(proxiesCount);
+						proxySizes[streamIndex].resize(proxiesCount);
+						proxiesFile->seekg(indexOffset);
+
+						for(unsigned int i = 0; i < proxiesCount; i++) {
+							proxiesFile->read((char*)&proxyOffsets[streamIndex][i], sizeof(unsigned long long));
+							proxiesFile->read((char*)&proxySizes[streamIndex][i], sizeof(unsigned int));
+						}
+
+						isComplete = proxiesFile->good();
+					}
+				}
+			}
+
+			if(isComplete) {
+				proxyFiles_mutex[streamIndex].lock();
+				proxyFiles[streamIndex] = proxiesFile;
+				proxyFiles_mutex[streamIndex].unlock();
+				available[streamIndex] = true;
+			}
+			else
+				delete proxiesFile;
+
+			return(isComplete);
+		}
+
+		cv::Mat SequenceProxies::createProxy(int streamIndex, const FramePath& framePath) {
+			cv::Mat frame;
+
+			if(streamIndex == 0)
+				frame = sequence->readImageFrame(framePath, cv::IMREAD_COLOR);
+			else if(streamIndex == 1)
+				frame = sequence->readIRFrame(framePath, true);
+			else
+				frame = sequence->readImageFrame(framePath, cv::IMREAD_ANYDEPTH);
+
+			if(frame.empty())
+				return(frame);
+
+			cv::Size proxySize;
+
+			if(streamIndex == 0)
+				proxySize = cv::Size(proxyWidth, (frame.rows * proxyWidth) / frame.cols);
+			else
+				proxySize = cv::Size(frame.cols / 2, frame.rows / 2);
+
+			cv::Mat proxy;
+
+			// depth values must not be blended across edges
+			cv::resize(frame, proxy, proxySize, 0, 0, (streamIndex == 2) ? cv::INTER_NEAREST : cv::INTER_AREA);
+			return(proxy);
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void SequenceProxies::generateProxiesFile(int streamIndex, const std::atomic<bool>& isActive) {
+			boost::filesystem::path proxiesFilePath = getProxiesFilePath(rootDirectory, Sequence::STREAM_FOLDER_NAMES[streamIndex]);
+			std::ofstream proxiesFile(proxiesFilePath.string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+			if(!proxiesFile.is_open()) {
+				std::ostringstream errMsg;
+				errMsg << "Unable to create proxies file " << proxiesFilePath.string();
+				throw FileWritingException(errMsg.str().c_str());
+			}
+
+			proxiesFile.write(PROXIES_MAGIC, sizeof(PROXIES_MAGIC));
+			proxiesFile.write((const char*)&PROXIES_VERSION, sizeof(PROXIES_VERSION));
+
+			std::vector<unsigned long long> offsets;
+			std::vector<unsigned int> sizes;
+			std::vector<unsigned char> encodedProxy;
+			std::vector<int> formatParams;
+			const char* formatExtension;
+
+			if(streamIndex == 2) {
+				formatExtension = ".png";
+				formatParams.push_back(CV_IMWRITE_PNG_COMPRESSION);
+				formatParams.push_back(1);
+			}
+			else {
+				formatExtension = ".jpg";
+				formatParams.push_back(CV_IMWRITE_JPEG_QUALITY);
+				formatParams.push_back(PROXY_JPEG_QUALITY);
+			}
+
+			unsigned long long offset = sizeof(PROXIES_MAGIC) + sizeof(PROXIES_VERSION);
+
+			for(int i = 0; (i < framesLists[streamIndex].size()) && isActive; i++) {
+				cv::Mat proxy = createProxy(streamIndex, framesLists[streamIndex].at(i));
+
+				// an unreadable frame gets an empty proxy, so the ranks still match
+				if(proxy.empty() || !cv::imencode(formatExtension, proxy, encodedProxy, formatParams))
+					encodedProxy.clear();
+
+				proxiesFile.write((const char*)encodedProxy.data(), encodedProxy.size());
+				offsets.push_back(offset);
+				sizes.push_back((unsigned int)encodedProxy.size());
+				offset += encodedProxy.size();
+			}
+
+			// without its trailer, an interrupted file is generated again next time
+			if(isActive) {
+				for(int i = 0; i < offsets.size(); i++) {
+					proxiesFile.write((const char*)&offsets[i], sizeof(unsigned long long));
+					proxiesFile.write((const char*)&sizes[i], sizeof(unsigned int));
+				}
+
+				unsigned int proxiesCount = (unsigned int)offsets.size();
+				proxiesFile.write((const char*)&offset, sizeof(offset));
+				proxiesFile.write((const char*)&proxiesCount, sizeof(proxiesCount));
+				proxiesFile.write(PROXIES_MAGIC, sizeof(PROXIES_MAGIC));
+			}
+
+			proxiesFile.close();
+
+			if(proxiesFile.fail()) {
+				std::ostringstream errMsg;
+				errMsg << "Unable to write proxies file " << proxiesFilePath.string();
+				throw FileWritingException(errMsg.str().c_str());
+			}
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void SequenceProxies::generate(const std::atomic<bool>& isActive) {
+			// the color stream comes first, as its full resolution frames are the slowest to decode
+			for(int i = 0; (i < STREAMS_COUNT) && isActive; i++) {
+				if(framesLists[i].empty() || openProxiesFile(i))
+					continue;
+
+				generateProxiesFile(i, isActive);
+
+				if(isActive && !openProxiesFile(i))
+					std::cerr << "Unable to read the generated proxies file of the " << Sequence::STREAM_FOLDER_NAMES[i] << " stream" << std::endl;
+			}
+		}
+
+		bool SequenceProxies::isAvailable(const char* streamFolderName) {
+			int streamIndex = getStreamIndex(streamFolderName);
+			return((streamIndex >= 0) && available[streamIndex]);
+		}
+
+		/**
+		 * @throws FileReadingException
+		 */
+		cv::Mat SequenceProxies::getProxy(const char* streamFolderName, int rank) {
+			int streamIndex = getStreamIndex(streamFolderName);
+
+			if((streamIndex < 0) || !available[streamIndex] || (rank < 0) || (rank >= proxySizes[streamIndex].size()) || (proxySizes[streamIndex][rank] == 0))
+				return(cv::Mat());
+
+			std::vector<unsigned char> encodedProxy(proxySizes[streamIndex][rank]);
+
+			proxyFiles_mutex[streamIndex].lock();
+			proxyFiles[streamIndex]->clear();
+			proxyFiles[streamIndex]->seekg(proxyOffsets[streamIndex][rank]);
+			bool isRead = (bool)proxyFiles[streamIndex]->read((char*)encodedProxy.data(), encodedProxy.size());
+			proxyFiles_mutex[streamIndex].unlock();
+
+			if(!isRead) {
+				std::ostringstream errMsg;
+				errMsg << "Unable to read the proxy of frame " << rank << " of the " << streamFolderName << " stream";
+				throw FileReadingException(errMsg.str().c_str());
+			}
+
+			cv::Mat proxy = cv::imdecode(encodedProxy, (streamIndex == 2) ? cv::IMREAD_ANYDEPTH : cv::IMREAD_UNCHANGED);
+
+			if((streamIndex == 0) && !proxy.empty())
+				cv::cvtColor(proxy, proxy, CV_BGR2RGB);
+
+			return(proxy);
+		}
+	} // namespace datalib
+} // namespace kocca
@@ -0,0 +1,144 @@
+#ifndef KOCCA_DATALIB_SEQUENCE_PROXIES_H
+#define KOCCA_DATALIB_SEQUENCE_PROXIES_H
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include "boost/filesystem.hpp"
+#include "FramePath.h"
+#include "Sequence.h"
+
+namespace kocca {
+	namespace datalib {
+
+		/**
+		 * The low resolution proxies of the image frames of a sequence, shown instead of the full resolution frames while scrubbing.
+		 * The proxies of a stream are packed in a single file of the sequence's root directory, in the order of the stream's frames : the encoded proxies (JPEG for the color and infrared frames, PNG for the depth ones) are followed by their index (offset and size of each one) and by a trailer, written last, so an incomplete file is detected and generated again.
+		 * The color proxies are proxyWidth pixels wide, the infrared and depth ones are half the sensor's resolution. Proxies can be read from several threads at the same time.
+		 */
+		class SequenceProxies {
+		public:
+
+			/**
+			 * The number of image streams of a sequence.
+			 */
+			static const int STREAMS_COUNT = Sequence::IMAGE_STREAMS_COUNT;
+
+		protected:
+
+			/**
+			 * The sequence, whose frames are read to generate the proxies.
+			 */
+			Sequence* sequence;
+
+			/**
+			 * The root directory of the sequence.
+			 */
+			boost::filesystem::path rootDirectory;
+
+			/**
+			 * The frames of each stream, indexed like Sequence::STREAM_FOLDER_NAMES.
+			 */
+			std::vector<FramePath> framesLists[STREAMS_COUNT];
+
+			/**
+			 * The width of the color proxies, in pixels.
+			 */
+			int proxyWidth;
+
+			/**
+			 * The offset in its file and the size of each proxy, by rank, for each stream whose proxies are available.
+			 */
+			std::vector<unsigned long long> proxyOffsets[STREAMS_COUNT];
+			std::vector<unsigned int> proxySizes[STREAMS_COUNT];
+
+			/**
+			 * The opened proxies file of each stream, or NULL if its proxies aren't available yet, and a lock per stream to read them from several threads.
+			 */
+			std::ifstream* proxyFiles[STREAMS_COUNT];
+			std::mutex proxyFiles_mutex[STREAMS_COUNT];
+
+			/**
+			 * Whether or not the proxies of each stream are available.
+			 */
+			std::atomic<bool> available[STREAMS_COUNT];
+
+			/**
+			 * Gets the index of a stream in Sequence::STREAM_FOLDER_NAMES, or -1 if the name is unknown.
+			 * @param streamFolderName the folder name of the stream
+			 */
+			static int getStreamIndex(const char* streamFolderName);
+
+			/**
+			 * Opens the proxies file of a stream and reads its index, if it is complete and lists as many frames as the stream.
+			 * @param streamIndex the index of the stream
+			 * @return true if the proxies of the stream are available
+			 */
+			bool openProxiesFile(int streamIndex);
+
+			/**
+			 * Generates the proxies file of a stream, decoding each of its frames.
+			 * @param streamIndex the index of the stream
+			 * @param isActive the generation is interrupted, leaving an incomplete file, as soon as it is false
+			 * @throws FileWritingException if the proxies file couldn't be written
+			 */
+			void generateProxiesFile(int streamIndex, const std::atomic<bool>& isActive);
+
+			/**
+			 * Reads, decodes and scales down a frame of a stream to its proxy resolution.
+			 * @param streamIndex the index of the stream
+			 * @param framePath the frame
+			 */
+			cv::Mat createProxy(int streamIndex, const FramePath& framePath);
+
+		public:
+
+			/**
+			 * Constructor. No file is read or written until generate() is called.
+			 * @param _sequence the sequence, whose frames lists are copied
+			 * @param _proxyWidth the width of the color proxies, in pixels
+			 */
+			SequenceProxies(Sequence* _sequence, int _proxyWidth = 480);
+
+			/**
+			 * Destructor. Closes the proxies files.
+			 */
+			~SequenceProxies();
+
+			/**
+			 * Makes the proxies of all the streams available : the complete proxies files are opened, the others are generated first. It takes a while for long sequences, so it is meant to run in a background thread.
+			 * @param isActive the generation is interrupted as soon as it is false
+			 * @throws FileWritingException if a proxies file couldn't be written
+			 */
+			void generate(const std::atomic<bool>& isActive);
+
+			/**
+			 * Whether or not the proxies of a stream are available.
+			 * @param streamFolderName the folder name of the stream ("image", "infrared" or "depth")
+			 */
+			bool isAvailable(const char* streamFolderName);
+
+			/**
+			 * Gets the proxy of a frame, in the same format as the full resolution frame as decoded for display (RGB color, 8 bits infrared, 16 bits depth).
+			 * @param streamFolderName the folder name of the stream ("image", "infrared" or "depth")
+			 * @param rank the rank of the frame in its stream
+			 * @return the proxy, or an empty frame if the proxies of the stream aren't available
+			 * @throws FileReadingException if the proxy couldn't be read
+			 */
+			cv::Mat getProxy(const char* streamFolderName, int rank);
+
+			/**
+			 * Gets the path of the proxies file of a stream.
+			 * @param rootDirectory the root directory of the sequence
+			 * @param streamFolderName the folder name of the stream
+			 */
+			static boost::filesystem::path getProxiesFilePath(const boost::filesystem::path& rootDirectory, const char* streamFolderName);
+		};
+	} // namespace datalib
+} // namespace kocca
+
+#endif // KOCCA_DATALIB_SEQUENCE_PROXIES_H
@@ -0,0 +1,123 @@
+#include "StreamProfile.h"
+#include <cstdlib>
+#include <sstream>
+
+namespace kocca {
+	namespace datalib {
+		namespace {
+			std::string getStreamKey(const char* streamFolderName, const char* suffix) {
+				return(std::string(streamFolderName) + suffix);
+			}
+		}
+
+		StreamProfile::StreamProfile(double _scale, cv::Rect _roi, int _decimation) {
+			scale = (_scale >= 1) ? _scale : 1;
+			roi = ((_roi.x >= 0) && (_roi.y >= 0) && (_roi.width > 0) && (_roi.height > 0)) ? _roi : cv::Rect();
+			decimation = (_decimation >= 1) ? _decimation : 1;
+		}
+
+		StreamProfile StreamProfile::parse(const std::string& scaleValue, const std::string& roiValue, const std::string& decimationValue) {
+			double parsedScale = scaleValue.empty() ? 1 : std::strtod(scaleValue.c_str(), NULL);
+			int parsedDecimation = decimationValue.empty() ? 1 : (int)std::strtol(decimationValue.c_str(), NULL, 10);
+
+			cv::Rect parsedROI;
+			std::istringstream roiStream(roiValue);
+			char separator1, separator2, separator3;
+
+			if(!(roiStream >> parsedROI.x >> separator1 >> parsedROI.y >> separator2 >> parsedROI.width >> separator3 >> parsedROI.height) || (separator1 != ',') || (separator2 != ',') || (separator3 != ','))
+				parsedROI = cv::Rect();
+
+			return(StreamProfile(parsedScale, parsedROI, parsedDecimation));
+		}
+
+		StreamProfile StreamProfile::fromMetadata(SequenceMetadata* metadata, const char* streamFolderName) {
+			return(parse(
+				metadata->get(getStreamKey(streamFolderName, "_scale").c_str()),
+				metadata->get(getStreamKey(streamFolderName, "_roi").c_str()),
+				metadata->get(getStreamKey(streamFolderName, "_decimation").c_str())
+			));
+		}
+
+		void StreamProfile::writeToMetadata(SequenceMetadata* metadata, const char* streamFolderName) {
+			std::ostringstream scaleValue;
+			scaleValue << scale;
+			metadata->set(getStreamKey(streamFolderName, "_scale").c_str(), scaleValue.str());
+
+			std::ostringstream roiValue;
+
+			if(roi.area() > 0)
+				roiValue << roi.x << "," << roi.y << "," << roi.width << "," << roi.height;
+
+			metadata->set(getStreamKey(streamFolderName, "_roi").c_str(), roiValue.str());
+
+			std::ostringstream decimationValue;
+			decimationValue << decimation;
+			metadata->set(getStreamKey(streamFolderName, "_decimation").c_str(), decimationValue.str());
+		}
+
+		bool StreamProfile::isFullFrame() {
+			return((scale == 1) && (roi.area() == 0));
+		}
+
+		bool StreamProfile::keepsFrame(unsigned long long frameIndex) {
+			return((frameIndex % decimation) == 0);
+		}
+
+		cv::Rect StreamProfile::getClippedROI(cv::Size frameSize) {
+			// a region of interest that doesn't fit in the frame is clipped to it
+			cv::Rect clippedROI = (roi.area() > 0) ? (roi & cv::Rect(0, 0, frameSize.width, frameSize.height)) : cv::Rect(0, 0, frameSize.width, frameSize.height);
+
+			if(clippedROI.area() == 0)
+				clippedROI = cv::Rect(0, 0, frameSize.width, frameSize.height);
+
+			return(clippedROI);
+		}
+
+		cv::Mat StreamProfile::apply(const cv::Mat& frame, int interpolation) {
+			cv::Mat profiledFrame;
+			return(apply(frame, profiledFrame, interpolation));
+		}
+
+		const cv::Mat& StreamProfile::apply(const cv::Mat& frame, cv::Mat& profiledFrame, int interpolation) {
+			if(isFullFrame() || frame.empty())
+				return(frame);
+
+			cv::Rect clippedROI = getClippedROI(cv::Size(frame.cols, frame.rows));
+
+			if(scale > 1) {
+				cv::Size profiledSize((int)(clippedROI.width / scale), (int)(clippedROI.height / scale));
+
+				if(profiledSize.width < 1)
+					profiledSize.width = 1;
+
+				if(profiledSize.height < 1)
+					profiledSize.height = 1;
+
+				cv::resize(frame(clippedROI), profiledFrame, profiledSize, 0, 0, interpolation);
+			}
+			else {
+				// the crop is copied, so the recording buffers don't keep the whole sensor frames alive
+				frame(clippedROI).copyTo(profiledFrame);
+			}
+
+			return(profiledFrame);
+		}
+
+		cv::Point2d StreamProfile::mapPoint(const cv::Point2d& point, cv::Size sensorFrameSize) {
+			cv::Rect clippedROI = getClippedROI(sensorFrameSize);
+			return(cv::Point2d((point.x - clippedROI.x) / scale, (point.y - clippedROI.y) / scale));
+		}
+
+		double StreamProfile::getScale() {
+			return(scale);
+		}
+
+		cv::Rect StreamProfile::getROI() {
+			return(roi);
+		}
+
+		int StreamProfile::getDecimation() {
+			return(decimation);
+		}
+	} // namespace datalib
+} // namespace kocca
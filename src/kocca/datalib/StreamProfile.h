@@ -0,0 +1,126 @@
+#ifndef KOCCA_DATALIB_STREAM_PROFILE_H
+#define KOCCA_DATALIB_STREAM_PROFILE_H
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+#include "SequenceMetadata.h"
+
+namespace kocca {
+	namespace datalib {
+
+		/**
+		 * The recording profile of a stream : which part of the sensor's frames is recorded (region of interest), at which resolution (downscale factor) and at which rate (decimation).
+		 * The profile of each stream is stored in the sequence's metadata ("<stream>_scale", "<stream>_roi" and "<stream>_decimation" keys), so the recorded frames can be mapped back to the sensor's coordinates, where the calibration parameters are expressed.
+		 * The default profile records the full frames at full rate.
+		 */
+		class StreamProfile {
+		protected:
+
+			/**
+			 * The factor the frames are downscaled by (after cropping), 1 or more.
+			 */
+			double scale;
+
+			/**
+			 * The region of interest of the frames, in sensor coordinates. An empty rectangle means the whole frame.
+			 */
+			cv::Rect roi;
+
+			/**
+			 * Only 1 frame out of decimation is recorded, 1 or more.
+			 */
+			int decimation;
+
+		public:
+
+			/**
+			 * Constructor. Invalid values are replaced by the ones of the default profile.
+			 * @param _scale the downscale factor
+			 * @param _roi the region of interest, in sensor coordinates
+			 * @param _decimation only 1 frame out of _decimation is recorded
+			 */
+			StreamProfile(double _scale = 1, cv::Rect _roi = cv::Rect(), int _decimation = 1);
+
+			/**
+			 * Builds a profile from its textual values, as found in the settings or the metadata. Empty or invalid values are replaced by the ones of the default profile.
+			 * @param scaleValue the downscale factor (ex : "2")
+			 * @param roiValue the region of interest, as "x,y,width,height" in sensor coordinates
+			 * @param decimationValue the decimation (ex : "2" to record 15 fps out of 30)
+			 */
+			static StreamProfile parse(const std::string& scaleValue, const std::string& roiValue, const std::string& decimationValue);
+
+			/**
+			 * Reads the profile of a stream from a sequence's metadata. Sequences recorded without any profile get the default one.
+			 * @param metadata the metadata of the sequence
+			 * @param streamFolderName the name of the stream's folder ("image", "infrared" or "depth")
+			 */
+			static StreamProfile fromMetadata(SequenceMetadata* metadata, const char* streamFolderName);
+
+			/**
+			 * Writes the profile of a stream into a sequence's metadata.
+			 * @param metadata the metadata of the sequence
+			 * @param streamFolderName the name of the stream's folder ("image", "infrared" or "depth")
+			 */
+			void writeToMetadata(SequenceMetadata* metadata, const char* streamFolderName);
+
+			/**
+			 * Whether or not the profile keeps the frames as they are (no region of interest, no downscaling).
+			 */
+			bool isFullFrame();
+
+			/**
+			 * Whether or not a frame is kept by the decimation.
+			 * @param frameIndex the rank of the frame in its stream
+			 */
+			bool keepsFrame(unsigned long long frameIndex);
+
+			/**
+			 * Gets the region of interest as it is applied to the frames of a given size : clipped to the frame, or the whole frame if there's no region of interest or if it is entirely outside of the frame.
+			 * @param frameSize the size of the frames, in sensor coordinates
+			 */
+			cv::Rect getClippedROI(cv::Size frameSize);
+
+			/**
+			 * Crops and downscales a frame. The source frame is never modified.
+			 * @param frame the frame, in sensor coordinates
+			 * @param interpolation the OpenCV interpolation of the downscaling : cv::INTER_AREA suits images, cv::INTER_NEAREST suits depth maps (so no depth is made up on the edges of objects)
+			 * @return the frame as recorded. It is the source frame itself if the profile is a full frame one, and it never shares its data with the source frame otherwise.
+			 */
+			cv::Mat apply(const cv::Mat& frame, int interpolation = cv::INTER_AREA);
+
+			/**
+			 * Crops and downscales a frame into a frame kept from one call to the next, so its data is only allocated once (see PreRollBuffer). The source frame is never modified.
+			 * @param frame the frame, in sensor coordinates
+			 * @param profiledFrame the frame the result is written into, unless the profile is a full frame one. Its data is reused if it has the size and the type of the result.
+			 * @param interpolation the OpenCV interpolation of the downscaling (see apply())
+			 * @return the frame as recorded : the source frame itself if the profile is a full frame one, profiledFrame otherwise
+			 */
+			const cv::Mat& apply(const cv::Mat& frame, cv::Mat& profiledFrame, int interpolation = cv::INTER_AREA);
+
+			/**
+			 * Maps a point from the sensor coordinates (ex : a marker projected with the calibration parameters) to the coordinates of the recorded frames.
+			 * @param point the point, in sensor coordinates
+			 * @param sensorFrameSize the size of the sensor's frames, to clip the region of interest the way apply() does
+			 */
+			cv::Point2d mapPoint(const cv::Point2d& point, cv::Size sensorFrameSize);
+
+			/**
+			 * Gets the downscale factor.
+			 */
+			double getScale();
+
+			/**
+			 * Gets the region of interest, in sensor coordinates (empty for the whole frame).
+			 */
+			cv::Rect getROI();
+
+			/**
+			 * Gets the decimation.
+			 */
+			int getDecimation();
+		};
+	} // namespace datalib
+} // namespace kocca
+
+#endif // KOCCA_DATALIB_STREAM_PROFILE_H
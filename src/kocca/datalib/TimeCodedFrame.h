@@ -6,13 +6,23 @@
 namespace kocca {
 	namespace datalib {
 
+		/**
+		 * Makes a frame safe to draw on or to modify in place (copy-on-write) : if its data is shared with other cv::Mat objects, or is not owned by OpenCV, it is replaced by a private copy. Otherwise the frame is left untouched.
+		 * @param frame the frame to make writable
+		 */
+		inline void makeFrameWritable(cv::Mat& frame) {
+			if(!frame.empty() && ((frame.u == NULL) || (frame.u->refcount > 1)))
+				frame = frame.clone();
+		}
+
 		/**
 		 * This structure associates a cv::Mat frame of a video stream with it's appearance time (relative to the video recording)
+		 * The frame data is reference-counted and shared, without any copy, by all the consumers of the frame (operations, writing threads, display widgets ...) : it must be considered as immutable. A consumer that needs to draw on a frame must call makeFrameWritable() first.
 		 */
 		struct TimeCodedFrame {
 
 			/**
-			 * The time of the frame
+			 * The time of the frame, in microseconds
 			 */
 			unsigned long long time;
 
@@ -20,6 +30,19 @@ namespace kocca {
 			 * The content of the frame
 			 */
 			cv::Mat frame;
+
+			/**
+			 * The factor the frame has been downscaled by for display, relatively to its recorded resolution : 1 for a full resolution frame, 2, 4 or 8 for a frame decoded at a reduced scale, more for a proxy (see operations::SequenceReading::setDisplaySize())
+			 */
+			double downscale;
+
+			/**
+			 * Constructor
+			 */
+			TimeCodedFrame() {
+				time = 0;
+				downscale = 1;
+			}
 		};
 	} // namespace datalib
 } // namespace kocca
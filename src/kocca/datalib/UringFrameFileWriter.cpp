@@ -0,0 +1,278 @@
+#include "UringFrameFileWriter.h"
+
+#ifdef KOCCA_WITH_IO_URING
+
+#include "../Exceptions.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace kocca {
+	namespace datalib {
+		/**
+		 * @throws FileWritingException
+		 */
+		UringFrameFileWriter::UringFrameFileWriter(bool _directIO, int _fsyncBatchSize) {
+			directIO = _directIO;
+			fsyncBatchSize = (_fsyncBatchSize > 0) ? _fsyncBatchSize : 0;
+			unsyncedFilesCount = 0;
+			pendingWritesCount = 0;
+
+			int result = io_uring_queue_init(QUEUE_DEPTH, &ring, 0);
+
+			if(result < 0) {
+				std::ostringstream errMsg;
+				errMsg << "Failed to create io_uring instance: " << strerror(-result);
+				throw FileWritingException(errMsg.str().c_str());
+			}
+
+			isRunning = true;
+			completionThread = new std::thread(&UringFrameFileWriter::completionThreadLoop, this);
+		}
+
+		UringFrameFileWriter::~UringFrameFileWriter() {
+			try {
+				flush();
+			}
+			catch(std::exception& e) {
+				// we do nothing
+			}
+
+			// a NOP request without any PendingWrite wakes the completion thread up, so it can see that it must stop
+			isRunning = false;
+			submission_mutex.lock();
+			struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+
+			if(sqe != NULL) {
+				io_uring_prep_nop(sqe);
+				io_uring_sqe_set_data(sqe, NULL);
+				io_uring_submit(&ring);
+			}
+
+			submission_mutex.unlock();
+			completionThread->join();
+			delete completionThread;
+			io_uring_queue_exit(&ring);
+
+			for(std::map<dev_t, int>::iterator it = syncFds.begin(); it != syncFds.end(); it++)
+				close(it->second);
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void UringFrameFileWriter::writeFile(const boost::filesystem::path& filePath, const unsigned char* data, size_t size, int tag) {
+			std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+			throwPendingError();
+
+			// back-pressure : we don't submit more writes than the queue can hold
+			while(pendingWritesCount >= QUEUE_DEPTH)
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+			// the content is copied before the file is created, so a failed allocation doesn't leave an empty or zero-filled frame behind
+			void* buffer = NULL;
+			size_t alignedSize = ((size + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+
+			if((alignedSize > 0) && (posix_memalign(&buffer, ALIGNMENT, alignedSize) != 0)) {
+				std::ostringstream errMsg;
+				errMsg << "Failed to allocate the write buffer of frame file " << filePath.string();
+				throw FileWritingException(errMsg.str().c_str());
+			}
+
+			// the flag is read once : another thread may turn it off in between, and the written size must match the way this file is opened
+			bool fileDirectIO = directIO;
+			int flags = O_WRONLY | O_CREAT | O_TRUNC;
+			int fd = open(filePath.c_str(), flags | (fileDirectIO ? O_DIRECT : 0), 0644);
+
+			if((fd < 0) && fileDirectIO && (errno == EINVAL)) {
+				// the filesystem doesn't support O_DIRECT (ex : tmpfs)
+				directIO = false;
+				fileDirectIO = false;
+				fd = open(filePath.c_str(), flags, 0644);
+			}
+
+			if(fd < 0) {
+				free(buffer);
+				std::ostringstream errMsg;
+				errMsg << "Failed to open frame file " << filePath.string() << ": " << strerror(errno);
+				throw FileWritingException(errMsg.str().c_str());
+			}
+
+			// an empty file is complete once created, like with the buffered writer
+			if(size == 0) {
+				addSyncFileSystem(fd, filePath.string());
+				close(fd);
+
+				if(listener != NULL)
+					listener->onFileWritten(tag, 0, (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count());
+
+				return;
+			}
+
+			PendingWrite* write = new PendingWrite();
+			write->fd = fd;
+			write->buffer = buffer;
+			write->size = size;
+			write->writtenSize = fileDirectIO ? alignedSize : size;
+			write->filePath = filePath.string();
+			write->tag = tag;
+			write->startTime = startTime;
+
+			memcpy(write->buffer, data, size);
+			memset((unsigned char*)write->buffer + size, 0, alignedSize - size);
+
+			// preallocating the whole extent lets the filesystem lay the file out contiguously
+			posix_fallocate(fd, 0, alignedSize);
+
+			pendingWritesCount++;
+			submission_mutex.lock();
+			struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+
+			while(sqe == NULL) {
+				io_uring_submit(&ring);
+				submission_mutex.unlock();
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+				submission_mutex.lock();
+				sqe = io_uring_get_sqe(&ring);
+			}
+
+			io_uring_prep_write(sqe, fd, write->buffer, (unsigned int)write->writtenSize, 0);
+			io_uring_sqe_set_data(sqe, write);
+			io_uring_submit(&ring);
+			submission_mutex.unlock();
+		}
+
+		void UringFrameFileWriter::completionThreadLoop() {
+			while(isRunning || (pendingWritesCount > 0)) {
+				struct io_uring_cqe* cqe = NULL;
+
+				if(io_uring_wait_cqe(&ring, &cqe) < 0)
+					continue;
+
+				PendingWrite* write = (PendingWrite*)io_uring_cqe_get_data(cqe);
+				int result = cqe->res;
+				io_uring_cqe_seen(&ring, cqe);
+
+				if(write == NULL)
+					continue;
+
+				if(result < 0) {
+					std::ostringstream errMsg;
+					errMsg << "Failed to write frame file " << write->filePath << ": " << strerror(-result);
+					setError(errMsg.str());
+				}
+				else if((size_t)result < write->writtenSize) {
+					std::ostringstream errMsg;
+					errMsg << "Failed to write frame file " << write->filePath << ": only " << result << " bytes out of " << write->writtenSize << " were written";
+					setError(errMsg.str());
+				}
+				else if(ftruncate(write->fd, write->size) != 0) {
+					// the file has been preallocated (and written with its padding with O_DIRECT) : it is cut back to its actual size
+					setError(std::string("Failed to truncate frame file ") + write->filePath);
+				}
+				else if(listener != NULL) {
+					// the latency covers the copy, the submission and the write itself, like the time spent in the buffered writer's writeFile()
+					listener->onFileWritten(write->tag, write->size, (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - write->startTime).count());
+				}
+
+				// the filesystems are registered even without fsyncBatchSize, in case a flush asks for a sync
+				addSyncFileSystem(write->fd, write->filePath);
+
+				if(fsyncBatchSize > 0) {
+					unsyncedFilesCount++;
+
+					if(unsyncedFilesCount >= fsyncBatchSize) {
+						syncFileSystems();
+						unsyncedFilesCount = 0;
+					}
+				}
+
+				close(write->fd);
+				free(write->buffer);
+				delete write;
+				pendingWritesCount--;
+			}
+		}
+
+		void UringFrameFileWriter::addSyncFileSystem(int fd, const std::string& filePath) {
+			struct stat fileStatus;
+
+			if(fstat(fd, &fileStatus) != 0)
+				return;
+
+			error_mutex.lock();
+
+			if(syncFds.find(fileStatus.st_dev) == syncFds.end()) {
+				int folderFd = open(boost::filesystem::path(filePath).parent_path().c_str(), O_RDONLY | O_DIRECTORY);
+
+				if(folderFd >= 0)
+					syncFds[fileStatus.st_dev] = folderFd;
+			}
+
+			error_mutex.unlock();
+		}
+
+		void UringFrameFileWriter::syncFileSystems() {
+			error_mutex.lock();
+			std::vector<int> fds;
+
+			for(std::map<dev_t, int>::iterator it = syncFds.begin(); it != syncFds.end(); it++)
+				fds.push_back(it->second);
+
+			error_mutex.unlock();
+
+			// one syncfs() per filesystem flushes all the files of the batch at once, instead of one fsync() per file
+			for(int i = 0; i < fds.size(); i++) {
+				if(syncfs(fds.at(i)) != 0)
+					setError(std::string("Failed to sync frame files: ") + strerror(errno));
+			}
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void UringFrameFileWriter::flush(bool sync) {
+			while(pendingWritesCount > 0)
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+			if((fsyncBatchSize > 0) || sync)
+				syncFileSystems();
+
+			throwPendingError();
+		}
+
+		void UringFrameFileWriter::setError(const std::string& message) {
+			error_mutex.lock();
+
+			if(error.empty())
+				error = message;
+
+			error_mutex.unlock();
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void UringFrameFileWriter::throwPendingError() {
+			error_mutex.lock();
+			std::string message = error;
+			error.clear();
+			error_mutex.unlock();
+
+			if(!message.empty())
+				throw FileWritingException(message.c_str());
+		}
+
+		const char* UringFrameFileWriter::getName() {
+			return("io_uring");
+		}
+	} // namespace datalib
+} // namespace kocca
+
+#endif // KOCCA_WITH_IO_URING
@@ -0,0 +1,180 @@
+#ifndef KOCCA_DATALIB_URING_FRAME_FILE_WRITER_H
+#define KOCCA_DATALIB_URING_FRAME_FILE_WRITER_H
+
+#ifdef KOCCA_WITH_IO_URING
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <liburing.h>
+#include <sys/types.h>
+
+#include "FrameFileWriter.h"
+
+namespace kocca {
+	namespace datalib {
+
+		/**
+		 * A Linux frame files writer that submits the writes through io_uring, so the recording threads don't wait for the disk.
+		 * Each file is preallocated to its aligned size, then written in a single request from an aligned copy of its content. With O_DIRECT, the page cache is bypassed (which keeps it from growing and competing with the recording during long takes) and the files are truncated back to their actual size once written.
+		 * A completion thread reaps the finished writes, closes their files and, every fsyncBatchSize files, syncs the filesystems written to (the folders of a stream may be on several disks). They are synced by the flushes that ask for it too.
+		 */
+		class UringFrameFileWriter : public FrameFileWriter {
+		public:
+
+			/**
+			 * The number of entries of the submission queue, which is also the maximum number of writes in flight.
+			 */
+			static const unsigned int QUEUE_DEPTH = 64;
+
+			/**
+			 * The alignment of the buffers and sizes of the writes, as required by O_DIRECT on most devices.
+			 */
+			static const size_t ALIGNMENT = 4096;
+
+		protected:
+
+			/**
+			 * A write submitted to the ring and not completed yet.
+			 */
+			struct PendingWrite {
+				int fd; /**< The file descriptor of the file */
+				void* buffer; /**< The aligned copy of the content, freed once written */
+				size_t size; /**< The actual size of the content */
+				size_t writtenSize; /**< The size submitted (the aligned size with O_DIRECT) */
+				std::string filePath; /**< The path of the file, for error messages */
+				int tag; /**< The tag passed back to the listener */
+				std::chrono::steady_clock::time_point startTime; /**< The time writeFile() was called at, to measure the latency up to the completion */
+			};
+
+			/**
+			 * The io_uring instance.
+			 */
+			struct io_uring ring;
+
+			/**
+			 * A lock to serialize the submissions, as io_uring submission queues are not thread-safe.
+			 */
+			std::mutex submission_mutex;
+
+			/**
+			 * Whether or not the files are opened with O_DIRECT. It is turned off if the filesystem doesn't support it.
+			 */
+			std::atomic<bool> directIO;
+
+			/**
+			 * The number of files after which the filesystems are synced, or 0 to never sync.
+			 */
+			int fsyncBatchSize;
+
+			/**
+			 * The number of completed files since the latest sync.
+			 */
+			int unsyncedFilesCount;
+
+			/**
+			 * The number of writes submitted and not completed yet.
+			 */
+			std::atomic<unsigned int> pendingWritesCount;
+
+			/**
+			 * A file descriptor of a folder of each filesystem written to, indexed by the device of the filesystem, used to sync it.
+			 */
+			std::map<dev_t, int> syncFds;
+
+			/**
+			 * The message of the first write error, reported (once) by the next call to writeFile() or flush().
+			 */
+			std::string error;
+
+			/**
+			 * A lock to prevent access conflicts to error and syncFds.
+			 */
+			std::mutex error_mutex;
+
+			/**
+			 * Whether or not the completion thread should keep running.
+			 */
+			std::atomic<bool> isRunning;
+
+			/**
+			 * The thread that reaps the completions of the ring.
+			 */
+			std::thread* completionThread;
+
+			/**
+			 * Implementation of the completion thread.
+			 */
+			void completionThreadLoop();
+
+			/**
+			 * Stores an error, if there isn't one already.
+			 * @param message the error message
+			 */
+			void setError(const std::string& message);
+
+			/**
+			 * Throws the stored error, if any, and clears it.
+			 * @throws FileWritingException
+			 */
+			void throwPendingError();
+
+			/**
+			 * Registers the filesystem of a written file in syncFds, if it isn't already.
+			 * @param fd the file descriptor of the file
+			 * @param filePath the path of the file
+			 */
+			void addSyncFileSystem(int fd, const std::string& filePath);
+
+			/**
+			 * Syncs all the filesystems written to (see syncFds).
+			 */
+			void syncFileSystems();
+
+		public:
+
+			/**
+			 * Constructor.
+			 * @param _directIO whether the files should be opened with O_DIRECT
+			 * @param _fsyncBatchSize the number of files after which the filesystems are synced, or 0 to never sync
+			 * @throws FileWritingException if the io_uring instance couldn't be created (ex : kernel older than 5.1)
+			 */
+			UringFrameFileWriter(bool _directIO, int _fsyncBatchSize);
+
+			/**
+			 * Destructor. Waits for the pending writes.
+			 */
+			~UringFrameFileWriter();
+
+			/**
+			 * Submits the write of a file, and returns without waiting for its completion, which is reported to the listener by the completion thread.
+			 * @param filePath the path of the file
+			 * @param data the content of the file, which is copied
+			 * @param size the size of the content, in bytes
+			 * @param tag a value passed back to the listener once the file is written
+			 * @throws FileWritingException if the copy of the content couldn't be allocated (the file isn't created then), if the file couldn't be opened, or if a previous write failed
+			 */
+			void writeFile(const boost::filesystem::path& filePath, const unsigned char* data, size_t size, int tag = 0);
+
+			/**
+			 * Waits for all the pending writes, then syncs the filesystems written to if fsyncBatchSize is not 0 or if asked to.
+			 * @param sync whether or not the files must be made durable
+			 * @throws FileWritingException if any pending write failed
+			 */
+			void flush(bool sync = false);
+
+			/**
+			 * Gets the name of the backend ("io_uring").
+			 */
+			const char* getName();
+		};
+	} // namespace datalib
+} // namespace kocca
+
+#endif // KOCCA_WITH_IO_URING
+
+#endif // KOCCA_DATALIB_URING_FRAME_FILE_WRITER_H
@@ -127,6 +127,10 @@ namespace kocca {
 		 */
 		bool Calibration::processColorImageFrame(kocca::datalib::TimeCodedFrame tcFrame) {
 			bool processed = false;
+
+			// the chessboard detection doesn't support the BGRA layout of the captured frames, which are shared with the recording and must not be modified
+			if (tcFrame.frame.channels() == 4)
+				cv::cvtColor(tcFrame.frame, tcFrame.frame, CV_BGRA2RGB);
 			unsigned long long currentTime = getMSTime();
 
 			if (currentTime >= unFreezeTime) {
@@ -224,6 +228,9 @@ namespace kocca {
 		}
 
 		void Calibration::processFrameIntrinsic(cv::Mat& frame) {
+			// the frame is shared with other consumers, and we're going to draw on it
+			kocca::datalib::makeFrameWritable(frame);
+
 			int currentTime = getMSTime();
 			int countownSinceTime = (calibrationPausedTime != 0)?calibrationPausedTime:currentTime;
 			int timeSinceLastPic = countownSinceTime - lastPicTime;
@@ -301,6 +308,9 @@ namespace kocca {
 		}
 
 		void Calibration::processFrameExtrinsic(cv::Mat& frame) {
+			// the frame is shared with other consumers, and we're going to draw on it
+			kocca::datalib::makeFrameWritable(frame);
+
 			if (currentCalibrationStep == 4) {
 				formatFrame(frame);
 
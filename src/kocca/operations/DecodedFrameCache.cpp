@@ -0,0 +1,99 @@
+#include "DecodedFrameCache.h"
+
+namespace kocca {
+	namespace operations {
+		DecodedFrameCache::DecodedFrameCache(unsigned long long _maxSize) {
+			maxSize = _maxSize;
+			usedSize = 0;
+			hitsCount = 0;
+			missesCount = 0;
+		}
+
+		void DecodedFrameCache::evict() {
+			while((usedSize > maxSize) && !frames.empty()) {
+				usedSize -= frames.back().size;
+				framesIndex.erase(frames.back().key);
+				frames.pop_back();
+			}
+		}
+
+		bool DecodedFrameCache::get(PlaybackStreamType stream, int rank, kocca::datalib::TimeCodedFrame& tcFrame) {
+			cache_mutex.lock();
+			std::map<FrameKey, std::list<CachedFrame>::iterator>::iterator it = framesIndex.find(FrameKey(stream, rank));
+			bool isCached = (it != framesIndex.end());
+
+			if(isCached) {
+				frames.splice(frames.begin(), frames, it->second);
+				tcFrame = it->second->tcFrame;
+				hitsCount++;
+			}
+			else
+				missesCount++;
+
+			cache_mutex.unlock();
+			return(isCached);
+		}
+
+		void DecodedFrameCache::put(PlaybackStreamType stream, int rank, const kocca::datalib::TimeCodedFrame& tcFrame) {
+			CachedFrame cachedFrame;
+			cachedFrame.key = FrameKey(stream, rank);
+			cachedFrame.tcFrame = tcFrame;
+			cachedFrame.size = tcFrame.frame.total() * tcFrame.frame.elemSize();
+
+			cache_mutex.lock();
+			std::map<FrameKey, std::list<CachedFrame>::iterator>::iterator it = framesIndex.find(cachedFrame.key);
+
+			if(it != framesIndex.end()) {
+				usedSize -= it->second->size;
+				frames.erase(it->second);
+			}
+
+			frames.push_front(cachedFrame);
+			framesIndex[cachedFrame.key] = frames.begin();
+			usedSize += cachedFrame.size;
+			evict();
+			cache_mutex.unlock();
+		}
+
+		void DecodedFrameCache::clear() {
+			cache_mutex.lock();
+			frames.clear();
+			framesIndex.clear();
+			usedSize = 0;
+			cache_mutex.unlock();
+		}
+
+		unsigned long long DecodedFrameCache::getMaxSize() {
+			return(maxSize);
+		}
+
+		unsigned long long DecodedFrameCache::getUsedSize() {
+			cache_mutex.lock();
+			unsigned long long size = usedSize;
+			cache_mutex.unlock();
+			return(size);
+		}
+
+		unsigned long long DecodedFrameCache::getHitsCount() {
+			cache_mutex.lock();
+			unsigned long long count = hitsCount;
+			cache_mutex.unlock();
+			return(count);
+		}
+
+		unsigned long long DecodedFrameCache::getMissesCount() {
+			cache_mutex.lock();
+			unsigned long long count = missesCount;
+			cache_mutex.unlock();
+			return(count);
+		}
+
+		double DecodedFrameCache::getHitRate() {
+			cache_mutex.lock();
+			unsigned long long lookupsCount = hitsCount + missesCount;
+			double hitRate = (lookupsCount > 0) ? (hitsCount / (double)lookupsCount) : 0;
+			cache_mutex.unlock();
+			return(hitRate);
+		}
+	} // namespace operations
+} // namespace kocca
@@ -0,0 +1,134 @@
+#ifndef KOCCA_OPERATIONS_DECODED_FRAME_CACHE_H
+#define KOCCA_OPERATIONS_DECODED_FRAME_CACHE_H
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "../datalib/TimeCodedFrame.h"
+
+namespace kocca {
+	namespace operations {
+
+		/**
+		 * The image streams of a sequence being read.
+		 */
+		enum PlaybackStreamType {
+			PLAYBACK_STREAM_COLOR, /**< Color image stream */
+			PLAYBACK_STREAM_INFRARED, /**< Infrared stream */
+			PLAYBACK_STREAM_DEPTH, /**< Depth stream */
+			PLAYBACK_STREAMS_COUNT /**< The number of image streams (not a stream) */
+		};
+
+		/**
+		 * A least recently used cache of decoded frames, keyed by stream and rank in the stream, within a budget of bytes.
+		 * It keeps the frames recently decoded or shown while reading a sequence, whether they were prefetched for the playback or decoded on demand when stepping or seeking, so scrubbing back over them doesn't decode them again.
+		 * Frames can be put and got from several threads at the same time.
+		 */
+		class DecodedFrameCache {
+		protected:
+
+			/**
+			 * The key of a cached frame : its stream and its rank in the stream.
+			 */
+			typedef std::pair<int, int> FrameKey;
+
+			/**
+			 * A cached frame, with its key and its size in bytes.
+			 */
+			struct CachedFrame {
+				FrameKey key;
+				kocca::datalib::TimeCodedFrame tcFrame;
+				unsigned long long size;
+			};
+
+			/**
+			 * The cached frames, from the most recently used to the least recently used.
+			 */
+			std::list<CachedFrame> frames;
+
+			/**
+			 * The position of each cached frame in the frames list, by key.
+			 */
+			std::map<FrameKey, std::list<CachedFrame>::iterator> framesIndex;
+
+			/**
+			 * The budget of the cache, and the size of the cached frames, in bytes.
+			 */
+			unsigned long long maxSize, usedSize;
+
+			/**
+			 * The number of lookups that found their frame in the cache, and of those that didn't.
+			 */
+			unsigned long long hitsCount, missesCount;
+
+			/**
+			 * A lock to prevent threads access conflicts to the cache.
+			 */
+			std::mutex cache_mutex;
+
+			/**
+			 * Removes the least recently used frames until the cached frames fit in the budget. cache_mutex must be locked.
+			 */
+			void evict();
+
+		public:
+
+			/**
+			 * Constructor.
+			 * @param _maxSize the budget of the cache, in bytes
+			 */
+			DecodedFrameCache(unsigned long long _maxSize);
+
+			/**
+			 * Gets a frame from the cache, and makes it the most recently used one.
+			 * @param stream the stream of the frame
+			 * @param rank the rank of the frame in its stream
+			 * @param tcFrame receives the frame, if it is cached
+			 * @return true if the frame is cached
+			 */
+			bool get(PlaybackStreamType stream, int rank, kocca::datalib::TimeCodedFrame& tcFrame);
+
+			/**
+			 * Puts a frame in the cache as the most recently used one, replacing the cached one with the same key if there's one, and evicts the least recently used frames to stay within the budget.
+			 * @param stream the stream of the frame
+			 * @param rank the rank of the frame in its stream
+			 * @param tcFrame the decoded frame. Its pixels are shared with the cache, not copied.
+			 */
+			void put(PlaybackStreamType stream, int rank, const kocca::datalib::TimeCodedFrame& tcFrame);
+
+			/**
+			 * Removes all the frames from the cache.
+			 */
+			void clear();
+
+			/**
+			 * Gets the budget of the cache, in bytes.
+			 */
+			unsigned long long getMaxSize();
+
+			/**
+			 * Gets the size of the cached frames, in bytes.
+			 */
+			unsigned long long getUsedSize();
+
+			/**
+			 * Gets the number of lookups that found their frame in the cache.
+			 */
+			unsigned long long getHitsCount();
+
+			/**
+			 * Gets the number of lookups that didn't find their frame in the cache.
+			 */
+			unsigned long long getMissesCount();
+
+			/**
+			 * Gets the ratio of the lookups that found their frame in the cache, from 0 to 1, or 0 if there hasn't been any lookup yet.
+			 */
+			double getHitRate();
+		};
+	} // namespace operations
+} // namespace kocca
+
+#endif // KOCCA_OPERATIONS_DECODED_FRAME_CACHE_H
@@ -2,12 +2,16 @@
 
 namespace kocca {
 	namespace operations {
-		Monitoring::Monitoring() {
+		Monitoring::Monitoring(PreRollBuffer* _preRollBuffer) {
 			type = KOCCA_MONITORING_OPERATION;
 			skippedMocapFramesCount = 0;
+			preRollBuffer = _preRollBuffer;
 		}
 
 		bool Monitoring::processDepthFrame(kocca::datalib::TimeCodedFrame tcFrame) {
+			if(preRollBuffer != NULL)
+				preRollBuffer->pushDepthFrame(tcFrame);
+
 			if(onDepthFrameOutput != NULL) {
 				onDepthFrameOutput(tcFrame);
 				return(true);
@@ -17,6 +21,9 @@ namespace kocca {
 		}
 
 		bool Monitoring::processColorImageFrame(kocca::datalib::TimeCodedFrame tcFrame) {
+			if(preRollBuffer != NULL)
+				preRollBuffer->pushColorImageFrame(tcFrame);
+
 			if(onColorImageFrameOutput != NULL) {
 				onColorImageFrameOutput(tcFrame);
 				return(true);
@@ -26,6 +33,9 @@ namespace kocca {
 		}
 
 		bool Monitoring::processIRImageFrame(kocca::datalib::TimeCodedFrame tcFrame) {
+			if(preRollBuffer != NULL)
+				preRollBuffer->pushIRImageFrame(tcFrame);
+
 			if (onIRImageFrameOutput != NULL) {
 				onIRImageFrameOutput(tcFrame);
 				return(true);
@@ -35,6 +45,9 @@ namespace kocca {
 		}
 
 		bool Monitoring::processMarkersFrame(kocca::datalib::MocapMarkerFrame markerFrame) {
+			if(preRollBuffer != NULL)
+				preRollBuffer->pushMarkersFrame(markerFrame);
+
 			if(onMarkersFrameOutput != NULL) {
 				if(skippedMocapFramesCount >= 3) {
 					skippedMocapFramesCount = 0;
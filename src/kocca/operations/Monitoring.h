@@ -2,6 +2,7 @@
 #define KOCCA_OPERATIONS_MONITORING_H
 
 #include "Operation.h"
+#include "PreRollBuffer.h"
 
 #include <atomic>
 
@@ -19,12 +20,18 @@ namespace kocca {
 			 */
 			int skippedMocapFramesCount;
 
+			/**
+			 * The buffer where the incoming frames are kept for the pre-roll of the next recording, or NULL if there's no pre-roll.
+			 */
+			PreRollBuffer* preRollBuffer;
+
 		public:
 
 			/**
 			 * Constructor
+			 * @param _preRollBuffer the buffer where the incoming frames should be kept for the pre-roll of the next recording, or NULL
 			 */
-			Monitoring();
+			Monitoring(PreRollBuffer* _preRollBuffer = NULL);
 
 			/**
 			 * Processes an image frame of the depth stream, through the operation.
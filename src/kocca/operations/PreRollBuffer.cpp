@@ -0,0 +1,315 @@
+#include "PreRollBuffer.h"
+#include "../datalib/InfraredFrameCodec.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+namespace kocca {
+	namespace operations {
+		namespace {
+			/**
+			 * The maximum frame rates we size the rings for : 30 fps for each of the 3 Kinect streams, and the highest Optitrack frame rate.
+			 */
+			const unsigned long long MAX_IMAGE_FRAMES_PER_SECOND = 3 * 30;
+			const unsigned long long MAX_MARKERS_FRAMES_PER_SECOND = 360;
+		}
+
+		PreRollBuffer::PreRollBuffer(unsigned long long _duration, size_t _arenaSize, int jpegQuality, int jpegChromaSubsampling, bool jpegFastDCT) : jpegEncoder(jpegQuality, jpegChromaSubsampling, jpegFastDCT), markersFrames(((_duration * MAX_MARKERS_FRAMES_PER_SECOND) / 1000) + 1, kocca::datalib::MocapMarkerFrame(0)) {
+			duration = _duration * 1000;
+			arenaSize = _arenaSize;
+			arena = (unsigned char*)malloc(arenaSize);
+
+			if(arena == NULL)
+				arenaSize = 0;
+
+			// twice the expected number of frames, so the ring of indexes never limits the duration before the arena does
+			frames.resize((((_duration * MAX_IMAGE_FRAMES_PER_SECOND) / 1000) + 1) * 2);
+
+			depthFormatParams.push_back(CV_IMWRITE_PNG_COMPRESSION);
+			depthFormatParams.push_back(0);
+
+			encodedFramesCount = 0;
+			encodingTime = 0;
+			skippedFramesCount = 0;
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++)
+				receivedFramesCount[i] = 0;
+
+			clear();
+		}
+
+		PreRollBuffer::~PreRollBuffer() {
+			free(arena);
+		}
+
+		void PreRollBuffer::pushColorImageFrame(const kocca::datalib::TimeCodedFrame& tcFrame) {
+			if(isFrozen || !streamProfiles[RECORDED_STREAM_COLOR].keepsFrame(receivedFramesCount[RECORDED_STREAM_COLOR].fetch_add(1)))
+				return;
+
+			if(jpegEncoder_mutex.try_lock()) {
+				try {
+					std::chrono::high_resolution_clock::time_point encodingStartTime = std::chrono::high_resolution_clock::now();
+					jpegEncoder.encode(streamProfiles[RECORDED_STREAM_COLOR].apply(tcFrame.frame, profiledFrames[RECORDED_STREAM_COLOR]));
+					encodingTime.fetch_add(RecordingStatistics::getElapsedMicroseconds(encodingStartTime), std::memory_order_relaxed);
+					encodedFramesCount.fetch_add(1, std::memory_order_relaxed);
+					pushEncodedFrame(RECORDED_STREAM_COLOR, tcFrame.time, jpegEncoder.getEncodedData(), jpegEncoder.getEncodedSize());
+				}
+				catch(std::exception& e) {
+					skippedFramesCount.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				jpegEncoder_mutex.unlock();
+			}
+			else
+				skippedFramesCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void PreRollBuffer::pushIRImageFrame(const kocca::datalib::TimeCodedFrame& tcFrame) {
+			if(isFrozen || !streamProfiles[RECORDED_STREAM_INFRARED].keepsFrame(receivedFramesCount[RECORDED_STREAM_INFRARED].fetch_add(1)))
+				return;
+
+			if(infraredEncoder_mutex.try_lock()) {
+				try {
+					std::chrono::high_resolution_clock::time_point encodingStartTime = std::chrono::high_resolution_clock::now();
+					kocca::datalib::InfraredFrameCodec::encode(streamProfiles[RECORDED_STREAM_INFRARED].apply(tcFrame.frame, profiledFrames[RECORDED_STREAM_INFRARED]), infraredEncodingBuffer);
+					encodingTime.fetch_add(RecordingStatistics::getElapsedMicroseconds(encodingStartTime), std::memory_order_relaxed);
+					encodedFramesCount.fetch_add(1, std::memory_order_relaxed);
+					pushEncodedFrame(RECORDED_STREAM_INFRARED, tcFrame.time, infraredEncodingBuffer.data(), infraredEncodingBuffer.size());
+				}
+				catch(std::exception& e) {
+					skippedFramesCount.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				infraredEncoder_mutex.unlock();
+			}
+			else
+				skippedFramesCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void PreRollBuffer::pushDepthFrame(const kocca::datalib::TimeCodedFrame& tcFrame) {
+			if(isFrozen || !streamProfiles[RECORDED_STREAM_DEPTH].keepsFrame(receivedFramesCount[RECORDED_STREAM_DEPTH].fetch_add(1)))
+				return;
+
+			if(depthEncoder_mutex.try_lock()) {
+				try {
+					std::chrono::high_resolution_clock::time_point encodingStartTime = std::chrono::high_resolution_clock::now();
+
+					if(cv::imencode(".png", streamProfiles[RECORDED_STREAM_DEPTH].apply(tcFrame.frame, profiledFrames[RECORDED_STREAM_DEPTH], cv::INTER_NEAREST), depthEncodingBuffer, depthFormatParams)) {
+						encodingTime.fetch_add(RecordingStatistics::getElapsedMicroseconds(encodingStartTime), std::memory_order_relaxed);
+						encodedFramesCount.fetch_add(1, std::memory_order_relaxed);
+						pushEncodedFrame(RECORDED_STREAM_DEPTH, tcFrame.time, depthEncodingBuffer.data(), depthEncodingBuffer.size());
+					}
+					else
+						skippedFramesCount.fetch_add(1, std::memory_order_relaxed);
+				}
+				catch(std::exception& e) {
+					skippedFramesCount.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				depthEncoder_mutex.unlock();
+			}
+			else
+				skippedFramesCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void PreRollBuffer::pushMarkersFrame(const kocca::datalib::MocapMarkerFrame& markerFrame) {
+			buffer_mutex.lock();
+
+			if(!isFrozen) {
+				if(markersFramesCount == markersFrames.size()) {
+					firstMarkersFrame = (firstMarkersFrame + 1) % markersFrames.size();
+					markersFramesCount--;
+				}
+
+				// the slot is assigned rather than replaced : its markers vector and their names are copied into the storage they already have, which only grows if the frame has more markers (or longer names) than the ones the slot held
+				markersFrames[(firstMarkersFrame + markersFramesCount) % markersFrames.size()] = markerFrame;
+				markersFramesCount++;
+
+				if((unsigned long long)markerFrame.time > latestTime)
+					latestTime = markerFrame.time;
+
+				evictExpiredFrames();
+			}
+
+			buffer_mutex.unlock();
+		}
+
+		void PreRollBuffer::pushEncodedFrame(RecordedStreamType stream, unsigned long long time, const unsigned char* data, size_t size) {
+			buffer_mutex.lock();
+
+			if(isFrozen || (size == 0) || (size > arenaSize)) {
+				if(!isFrozen)
+					skippedFramesCount.fetch_add(1, std::memory_order_relaxed);
+
+				buffer_mutex.unlock();
+				return;
+			}
+
+			if(framesCount == frames.size())
+				evictOldestFrame();
+
+			// the frames are stored in the order they arrived : the free space is after the newest frame, up to the oldest one (possibly wrapping around the end of the arena)
+			size_t offset;
+
+			while(true) {
+				if(framesCount == 0) {
+					offset = 0;
+					break;
+				}
+
+				size_t oldestOffset = frames[firstFrame].offset;
+
+				if(writeOffset > oldestOffset) {
+					if((writeOffset + size) <= arenaSize) {
+						offset = writeOffset;
+						break;
+					}
+					else if(size <= oldestOffset) {
+						offset = 0;
+						break;
+					}
+				}
+				else if((writeOffset + size) <= oldestOffset) {
+					offset = writeOffset;
+					break;
+				}
+
+				evictOldestFrame();
+			}
+
+			memcpy(arena + offset, data, size);
+			writeOffset = offset + size;
+
+			PreRollFrame& frame = frames[(firstFrame + framesCount) % frames.size()];
+			frame.stream = stream;
+			frame.time = time;
+			frame.offset = offset;
+			frame.size = size;
+			framesCount++;
+
+			if(time > latestTime)
+				latestTime = time;
+
+			evictExpiredFrames();
+			buffer_mutex.unlock();
+		}
+
+		void PreRollBuffer::evictExpiredFrames() {
+			if(latestTime < duration)
+				return;
+
+			unsigned long long oldestAllowedTime = latestTime - duration;
+
+			while((framesCount > 0) && (frames[firstFrame].time < oldestAllowedTime))
+				evictOldestFrame();
+
+			while((markersFramesCount > 0) && ((unsigned long long)markersFrames[firstMarkersFrame].time < oldestAllowedTime)) {
+				firstMarkersFrame = (firstMarkersFrame + 1) % markersFrames.size();
+				markersFramesCount--;
+			}
+		}
+
+		void PreRollBuffer::evictOldestFrame() {
+			firstFrame = (firstFrame + 1) % frames.size();
+			framesCount--;
+
+			if(framesCount == 0)
+				writeOffset = 0;
+		}
+
+		void PreRollBuffer::freeze() {
+			buffer_mutex.lock();
+			isFrozen = true;
+			buffer_mutex.unlock();
+		}
+
+		void PreRollBuffer::setStreamProfile(RecordedStreamType stream, const kocca::datalib::StreamProfile& profile) {
+			streamProfiles[stream] = profile;
+		}
+
+		void PreRollBuffer::clear() {
+			buffer_mutex.lock();
+			writeOffset = 0;
+			firstFrame = 0;
+			framesCount = 0;
+			firstMarkersFrame = 0;
+			markersFramesCount = 0;
+			latestTime = 0;
+			isFrozen = false;
+			buffer_mutex.unlock();
+		}
+
+		bool PreRollBuffer::isEmpty() {
+			buffer_mutex.lock();
+			bool empty = (framesCount == 0) && (markersFramesCount == 0);
+			buffer_mutex.unlock();
+			return(empty);
+		}
+
+		unsigned long long PreRollBuffer::getOldestTime() {
+			buffer_mutex.lock();
+			unsigned long long oldestTime = 0;
+
+			if(framesCount > 0)
+				oldestTime = frames[firstFrame].time;
+
+			if((markersFramesCount > 0) && ((oldestTime == 0) || ((unsigned long long)markersFrames[firstMarkersFrame].time < oldestTime)))
+				oldestTime = markersFrames[firstMarkersFrame].time;
+
+			buffer_mutex.unlock();
+			return(oldestTime);
+		}
+
+		size_t PreRollBuffer::getFramesCount() {
+			return(framesCount);
+		}
+
+		const PreRollFrame& PreRollBuffer::getFrame(size_t rank) {
+			return(frames[(firstFrame + rank) % frames.size()]);
+		}
+
+		const unsigned char* PreRollBuffer::getFrameData(const PreRollFrame& frame) {
+			return(arena + frame.offset);
+		}
+
+		size_t PreRollBuffer::getMarkersFramesCount() {
+			return(markersFramesCount);
+		}
+
+		const kocca::datalib::MocapMarkerFrame& PreRollBuffer::getMarkersFrame(size_t rank) {
+			return(markersFrames[(firstMarkersFrame + rank) % markersFrames.size()]);
+		}
+
+		size_t PreRollBuffer::getUsedBytesCount() {
+			buffer_mutex.lock();
+			size_t usedBytesCount = 0;
+
+			for(size_t i = 0; i < framesCount; i++)
+				usedBytesCount += frames[(firstFrame + i) % frames.size()].size;
+
+			buffer_mutex.unlock();
+			return(usedBytesCount);
+		}
+
+		size_t PreRollBuffer::getArenaSize() {
+			return(arenaSize);
+		}
+
+		unsigned long long PreRollBuffer::getDuration() {
+			return(duration);
+		}
+
+		double PreRollBuffer::getMeanEncodingTime() {
+			unsigned long long framesNumber = encodedFramesCount.load(std::memory_order_relaxed);
+
+			if(framesNumber > 0)
+				return((encodingTime.load(std::memory_order_relaxed) / (double)framesNumber) / 1000.0);
+			else
+				return(0);
+		}
+
+		unsigned long long PreRollBuffer::getSkippedFramesCount() {
+			return(skippedFramesCount.load(std::memory_order_relaxed));
+		}
+	} // namespace operations
+} // namespace kocca
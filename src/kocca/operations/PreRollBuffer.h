@@ -0,0 +1,276 @@
+#ifndef KOCCA_OPERATIONS_PRE_ROLL_BUFFER_H
+#define KOCCA_OPERATIONS_PRE_ROLL_BUFFER_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "../datalib/TimeCodedFrame.h"
+#include "../datalib/MocapMarkerFrame.h"
+#include "../datalib/JpegFrameEncoder.h"
+#include "../datalib/StreamProfile.h"
+#include "RecordingStatistics.h"
+
+namespace kocca {
+	namespace operations {
+
+		/**
+		 * An encoded frame stored in a PreRollBuffer.
+		 */
+		struct PreRollFrame {
+			RecordedStreamType stream; /**< The stream of the frame */
+			unsigned long long time; /**< The (absolute) time of the frame, in microseconds */
+			size_t offset; /**< The offset of the encoded frame in the arena */
+			size_t size; /**< The size of the encoded frame, in bytes */
+		};
+
+		/**
+		 * Keeps the latest seconds of frames and mocap markers frames received while monitoring, so a recording can start with the action that happened just before the record button was pressed (and while the recording was being prepared).
+		 * The image frames are encoded as they arrive (the same way they are recorded) and copied into an arena : a single memory block, allocated once, that is used as a ring. Their indexes and the markers frames are stored in rings of slots that are also allocated once. The profiled frames, the encoding buffers and the markers of the slots are reused from one frame to the next, so once they have grown to the size of the frames, the buffer itself allocates nothing per frame (a slot only grows when a markers frame has more markers, or longer names, than the frames it held before). OpenCV's PNG encoder still allocates its own state for each depth frame. The oldest frames are evicted when they get older than the pre-roll duration, or when there's not enough room left for the new ones.
+		 * Frames can be pushed from several threads at the same time. They are encoded synchronously by the thread that pushes them, before the monitoring displays them : if the encoder of a stream is still busy with a previous frame when a frame arrives, the frame is skipped rather than queued behind it.
+		 */
+		class PreRollBuffer {
+		protected:
+
+			/**
+			 * The duration of the pre-roll, in microseconds.
+			 */
+			unsigned long long duration;
+
+			/**
+			 * The memory block where the encoded frames are stored.
+			 */
+			unsigned char* arena;
+
+			/**
+			 * The size of the arena, in bytes.
+			 */
+			size_t arenaSize;
+
+			/**
+			 * The offset in the arena where the next encoded frame will be stored (unless it has to wrap around to the beginning of the arena).
+			 */
+			size_t writeOffset;
+
+			/**
+			 * The ring of the encoded frames, from the oldest to the newest starting at firstFrame.
+			 */
+			std::vector<PreRollFrame> frames;
+
+			/**
+			 * The rank in frames of the oldest frame, and the number of frames stored.
+			 */
+			size_t firstFrame, framesCount;
+
+			/**
+			 * The ring of the markers frames, from the oldest to the newest starting at firstMarkersFrame. Its slots are reused, so the markers vectors keep their capacity.
+			 */
+			std::vector<kocca::datalib::MocapMarkerFrame> markersFrames;
+
+			/**
+			 * The rank in markersFrames of the oldest markers frame, and the number of markers frames stored.
+			 */
+			size_t firstMarkersFrame, markersFramesCount;
+
+			/**
+			 * The time of the newest frame or markers frame, in microseconds.
+			 */
+			unsigned long long latestTime;
+
+			/**
+			 * Whether or not the buffer is frozen : it then ignores the incoming frames, so its content can be read.
+			 */
+			std::atomic<bool> isFrozen;
+
+			/**
+			 * A lock to prevent access conflicts to the arena and the rings.
+			 */
+			std::mutex buffer_mutex;
+
+			/**
+			 * The encoder of the color image frames, and its lock.
+			 */
+			kocca::datalib::JpegFrameEncoder jpegEncoder;
+			std::mutex jpegEncoder_mutex;
+
+			/**
+			 * The encoding buffers of the infrared and depth frames (reused from one frame to the next), and their locks.
+			 */
+			std::vector<unsigned char> infraredEncodingBuffer, depthEncodingBuffer;
+			std::mutex infraredEncoder_mutex, depthEncoder_mutex;
+
+			/**
+			 * The frames of each stream with its recording profile applied, indexed by RecordedStreamType, reused from one frame to the next. Each one is protected by the encoder lock of its stream.
+			 */
+			cv::Mat profiledFrames[RECORDED_STREAMS_COUNT];
+
+			/**
+			 * The PNG compression parameters of the depth frames, the same as the recorded ones.
+			 */
+			std::vector<int> depthFormatParams;
+
+			/**
+			 * The number of frames encoded and the total time spent encoding them, in microseconds, to report the cost of the pre-roll.
+			 */
+			std::atomic<unsigned long long> encodedFramesCount, encodingTime;
+
+			/**
+			 * The number of frames that were skipped because their encoder was busy, or because they didn't fit in the arena.
+			 */
+			std::atomic<unsigned long long> skippedFramesCount;
+
+			/**
+			 * The recording profile of each stream, indexed by RecordedStreamType, so the pre-roll frames have the same geometry and rate as the recorded ones.
+			 */
+			kocca::datalib::StreamProfile streamProfiles[RECORDED_STREAMS_COUNT];
+
+			/**
+			 * The number of frames received by each stream, to apply the decimation of its profile.
+			 */
+			std::atomic<unsigned long long> receivedFramesCount[RECORDED_STREAMS_COUNT];
+
+			/**
+			 * Copies an encoded frame into the arena, evicting the oldest frames as needed.
+			 * @param stream the stream of the frame
+			 * @param time the time of the frame, in microseconds
+			 * @param data the encoded frame
+			 * @param size the size of the encoded frame, in bytes
+			 */
+			void pushEncodedFrame(RecordedStreamType stream, unsigned long long time, const unsigned char* data, size_t size);
+
+			/**
+			 * Evicts the frames and markers frames that are older than the pre-roll duration. The buffer_mutex must be locked by the caller.
+			 */
+			void evictExpiredFrames();
+
+			/**
+			 * Evicts the oldest encoded frame. The buffer_mutex must be locked by the caller.
+			 */
+			void evictOldestFrame();
+
+		public:
+
+			/**
+			 * Constructor. Allocates the arena and the rings.
+			 * @param _duration the duration of the pre-roll, in milliseconds
+			 * @param _arenaSize the size of the arena, in bytes : the memory cap of the encoded frames
+			 * @param jpegQuality the JPEG quality of the color image frames
+			 * @param jpegChromaSubsampling the chroma subsampling of the color image frames, as one of TurboJPEG's TJSAMP_XXX values
+			 * @param jpegFastDCT whether or not the color image frames are encoded with the fastest DCT algorithm
+			 */
+			PreRollBuffer(unsigned long long _duration, size_t _arenaSize, int jpegQuality, int jpegChromaSubsampling, bool jpegFastDCT);
+
+			/**
+			 * Destructor.
+			 */
+			~PreRollBuffer();
+
+			/**
+			 * Encodes and stores a color image frame, on the calling thread. The frame is skipped if the encoder of its stream is busy.
+			 * @param tcFrame the frame, with its absolute time
+			 */
+			void pushColorImageFrame(const kocca::datalib::TimeCodedFrame& tcFrame);
+
+			/**
+			 * Encodes and stores an infrared frame, on the calling thread. The frame is skipped if the encoder of its stream is busy.
+			 * @param tcFrame the frame, with its absolute time
+			 */
+			void pushIRImageFrame(const kocca::datalib::TimeCodedFrame& tcFrame);
+
+			/**
+			 * Encodes and stores a depth frame, on the calling thread. The frame is skipped if the encoder of its stream is busy.
+			 * @param tcFrame the frame, with its absolute time
+			 */
+			void pushDepthFrame(const kocca::datalib::TimeCodedFrame& tcFrame);
+
+			/**
+			 * Stores a mocap markers frame.
+			 * @param markerFrame the frame, with its absolute time
+			 */
+			void pushMarkersFrame(const kocca::datalib::MocapMarkerFrame& markerFrame);
+
+			/**
+			 * Stops storing the incoming frames, so the content of the buffer can be read safely.
+			 */
+			void freeze();
+
+			/**
+			 * Sets the recording profile of a stream (see SequenceRecording::getStreamProfileSetting()). It must be set before frames of the stream are pushed.
+			 * @param stream the stream
+			 * @param profile the recording profile of the stream
+			 */
+			void setStreamProfile(RecordedStreamType stream, const kocca::datalib::StreamProfile& profile);
+
+			/**
+			 * Forgets all the stored frames, and starts storing the incoming frames again.
+			 */
+			void clear();
+
+			/**
+			 * Checks if the buffer has any frame or markers frame.
+			 */
+			bool isEmpty();
+
+			/**
+			 * Gets the time of the oldest frame or markers frame, in microseconds.
+			 * @return the time of the oldest frame, or 0 if the buffer is empty
+			 */
+			unsigned long long getOldestTime();
+
+			/**
+			 * Gets the number of encoded frames stored.
+			 */
+			size_t getFramesCount();
+
+			/**
+			 * Gets an encoded frame, from the oldest to the newest. The buffer should be frozen.
+			 * @param rank the rank of the frame, from 0 (the oldest) to getFramesCount() - 1
+			 */
+			const PreRollFrame& getFrame(size_t rank);
+
+			/**
+			 * Gets the encoded data of a frame. It stays valid until the buffer is cleared.
+			 * @param frame the frame, as returned by getFrame()
+			 */
+			const unsigned char* getFrameData(const PreRollFrame& frame);
+
+			/**
+			 * Gets the number of markers frames stored.
+			 */
+			size_t getMarkersFramesCount();
+
+			/**
+			 * Gets a markers frame, from the oldest to the newest. The buffer should be frozen.
+			 * @param rank the rank of the frame, from 0 (the oldest) to getMarkersFramesCount() - 1
+			 */
+			const kocca::datalib::MocapMarkerFrame& getMarkersFrame(size_t rank);
+
+			/**
+			 * Gets the size of the encoded frames stored, in bytes.
+			 */
+			size_t getUsedBytesCount();
+
+			/**
+			 * Gets the size of the arena (the memory cap of the encoded frames), in bytes.
+			 */
+			size_t getArenaSize();
+
+			/**
+			 * Gets the duration of the pre-roll, in microseconds.
+			 */
+			unsigned long long getDuration();
+
+			/**
+			 * Gets the mean time spent encoding a frame, in milliseconds.
+			 */
+			double getMeanEncodingTime();
+
+			/**
+			 * Gets the number of frames skipped because their encoder was busy or because they didn't fit in the arena.
+			 */
+			unsigned long long getSkippedFramesCount();
+		};
+	} // namespace operations
+} // namespace kocca
+
+#endif // KOCCA_OPERATIONS_PRE_ROLL_BUFFER_H
@@ -0,0 +1,271 @@
+#include "RecordingPreflight.h"
+#include "SequenceRecording.h"
+#include "../utils.h"
+#include "../Exceptions.h"
+#include "../Settings.h"
+#include "../datalib/InfraredFrameCodec.h"
+#include "../datalib/JpegFrameEncoder.h"
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace kocca {
+	namespace operations {
+		RecordingPreflight::RecordingPreflight(boost::filesystem::path _benchmarkDirectory) {
+			benchmarkDirectory = _benchmarkDirectory;
+			cancelled = false;
+
+			jpegQuality = (int)Settings::getInt("recording.jpeg_quality", 100);
+			jpegChromaSubsampling = kocca::datalib::JpegFrameEncoder::parseChromaSubsampling(Settings::getString("recording.jpeg_chroma_subsampling", "420"));
+			jpegFastDCT = Settings::getBool("recording.jpeg_fast_dct", false);
+
+			// as many threads as the writing pool can grow to
+			int coresNumber = (int)std::thread::hardware_concurrency();
+			threadsNumber = (int)Settings::getInt("recording.writing_threads_max", (coresNumber > 0) ? coresNumber : 8);
+
+			if(threadsNumber < 1)
+				threadsNumber = 1;
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+				streamProfiles[i] = SequenceRecording::getStreamProfileSetting((RecordedStreamType)i);
+				encodedFrameSizes[i] = 0;
+				frameCosts[i] = 0;
+			}
+
+			sustainableFrameRate = 0;
+			requiredThroughput = 0;
+			writeThroughput = 0;
+			freeSpace = 0;
+		}
+
+		cv::Mat RecordingPreflight::createSyntheticFrame(RecordedStreamType stream) {
+			// the resolutions of the Kinect v2 sensors
+			int width = (stream == RECORDED_STREAM_COLOR) ? 1920 : 512;
+			int height = (stream == RECORDED_STREAM_COLOR) ? 1080 : 424;
+			cv::Mat frame(height, width, (stream == RECORDED_STREAM_COLOR) ? CV_8UC4 : CV_16UC1);
+
+			// a fixed seed, so successive benchmarks encode the same frames
+			unsigned int noise = 12345;
+
+			for(int y = 0; y < height; y++) {
+				if(stream == RECORDED_STREAM_COLOR) {
+					unsigned char* row = frame.ptr<unsigned char>(y);
+
+					for(int x = 0; x < width; x++) {
+						for(int c = 0; c < 3; c++) {
+							noise = (noise * 1103515245) + 12345;
+							int value = (((x * (c + 1)) + (y * (3 - c))) / 8) + (int)((noise >> 16) % 17) - 8;
+							row[(x * 4) + c] = (unsigned char)((value < 0) ? 0 : ((value > 255) ? 255 : value));
+						}
+
+						row[(x * 4) + 3] = 255;
+					}
+				}
+				else {
+					unsigned short* row = frame.ptr<unsigned short>(y);
+
+					for(int x = 0; x < width; x++) {
+						noise = (noise * 1103515245) + 12345;
+
+						// depth values in millimeters from 500 to 4500, infrared intensities up to 8000, with the noise level of each sensor
+						if(stream == RECORDED_STREAM_DEPTH)
+							row[x] = (unsigned short)(500 + ((x + y) * 4) + ((noise >> 16) % 9) - 4);
+						else
+							row[x] = (unsigned short)(1000 + ((x * y) % 7000) + ((noise >> 16) % 129));
+					}
+				}
+			}
+
+			return(frame);
+		}
+
+		void RecordingPreflight::benchmarkThreadLoop(int threadIndex, const cv::Mat* frames, kocca::datalib::FrameFileWriter* frameFileWriter, unsigned long long endTime) {
+			kocca::datalib::JpegFrameEncoder encoder(jpegQuality, jpegChromaSubsampling, jpegFastDCT);
+			std::vector<unsigned char> encodedFrame;
+			std::vector<int> depthFormatParams;
+			depthFormatParams.push_back(CV_IMWRITE_PNG_COMPRESSION);
+			depthFormatParams.push_back(0);
+
+			try {
+				for(unsigned long long period = 0; (getMSTime() < endTime) && !cancelled; period++) {
+					for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+						if(!streamProfiles[i].keepsFrame(period))
+							continue;
+
+						std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+						const unsigned char* encodedData;
+						size_t encodedSize;
+
+						if(i == RECORDED_STREAM_COLOR) {
+							encoder.encode(frames[i]);
+							encodedData = encoder.getEncodedData();
+							encodedSize = encoder.getEncodedSize();
+						}
+						else {
+							if(i == RECORDED_STREAM_INFRARED)
+								kocca::datalib::InfraredFrameCodec::encode(frames[i], encodedFrame);
+							else if(!cv::imencode(".png", frames[i], encodedFrame, depthFormatParams))
+								throw FileWritingException("Failed to encode a depth frame");
+
+							encodedData = encodedFrame.data();
+							encodedSize = encodedFrame.size();
+						}
+
+						std::ostringstream frameFileName;
+						frameFileName << kocca::datalib::Sequence::STREAM_FOLDER_NAMES[i] << "_" << threadIndex << "_" << period << SequenceRecording::getFrameFileExtension((RecordedStreamType)i);
+						frameFileWriter->writeFile(benchmarkDirectory / frameFileName.str(), encodedData, encodedSize);
+
+						busyTimes[i].fetch_add(RecordingStatistics::getElapsedMicroseconds(startTime));
+						writtenBytesCounts[i].fetch_add(encodedSize);
+						writtenFramesCounts[i]++;
+					}
+
+					writtenPeriodsCount++;
+				}
+			}
+			catch(std::exception& e) {
+				errorMessage_mutex.lock();
+
+				if(errorMessage.empty())
+					errorMessage = e.what();
+
+				errorMessage_mutex.unlock();
+			}
+		}
+
+		/**
+		 * @throws TempFolderNotAvailableException
+		 * @throws FileWritingException
+		 */
+		void RecordingPreflight::run(unsigned long long duration) {
+			try {
+				// the files are not sorted into stream folders, so a benchmark interrupted by a crash is never taken for a sequence to recover
+				boost::filesystem::remove_all(benchmarkDirectory);
+				boost::filesystem::create_directories(benchmarkDirectory);
+			}
+			catch(boost::filesystem::filesystem_error fse) {
+				std::ostringstream errMsg;
+				errMsg << "Unable to create recording preflight folder " << benchmarkDirectory.string() << " : " << fse.what();
+				throw TempFolderNotAvailableException(errMsg.str().c_str());
+			}
+
+			cv::Mat frames[RECORDED_STREAMS_COUNT];
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+				frames[i] = streamProfiles[i].apply(createSyntheticFrame((RecordedStreamType)i), (i == RECORDED_STREAM_DEPTH) ? cv::INTER_NEAREST : cv::INTER_AREA);
+				writtenBytesCounts[i] = 0;
+				writtenFramesCounts[i] = 0;
+				busyTimes[i] = 0;
+			}
+
+			writtenPeriodsCount = 0;
+			errorMessage.clear();
+
+			kocca::datalib::FrameFileWriter* frameFileWriter = kocca::datalib::FrameFileWriter::create(Settings::getString("recording.writer_backend", "buffered"), Settings::getBool("recording.direct_io", false), (int)Settings::getInt("recording.fsync_batch", 0));
+			unsigned long long startTime = getMSTime();
+			std::vector<std::thread*> benchmarkThreads;
+
+			for(int i = 0; i < threadsNumber; i++)
+				benchmarkThreads.push_back(new std::thread(&RecordingPreflight::benchmarkThreadLoop, this, i, frames, frameFileWriter, startTime + duration));
+
+			for(int i = 0; i < benchmarkThreads.size(); i++) {
+				benchmarkThreads.at(i)->join();
+				delete benchmarkThreads.at(i);
+			}
+
+			try {
+				// the writes still in flight are part of the benchmark
+				frameFileWriter->flush();
+			}
+			catch(std::exception& e) {
+				if(errorMessage.empty())
+					errorMessage = e.what();
+			}
+
+			delete frameFileWriter;
+
+			double elapsedTime = (getMSTime() - startTime) / 1000.0;
+
+			boost::system::error_code ec;
+			boost::filesystem::remove_all(benchmarkDirectory, ec);
+
+			boost::filesystem::space_info spaceInfo = boost::filesystem::space(benchmarkDirectory.parent_path(), ec);
+			freeSpace = ec ? 0 : spaceInfo.available;
+
+			if(!errorMessage.empty()) {
+				std::ostringstream errMsg;
+				errMsg << "Recording preflight failed : " << errorMessage;
+				throw FileWritingException(errMsg.str().c_str());
+			}
+
+			unsigned long long writtenBytesCount = 0;
+			requiredThroughput = 0;
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+				if(writtenFramesCounts[i] > 0) {
+					encodedFrameSizes[i] = writtenBytesCounts[i] / (double)writtenFramesCounts[i];
+					frameCosts[i] = (busyTimes[i] / (double)writtenFramesCounts[i]) / 1000.0;
+				}
+
+				writtenBytesCount += writtenBytesCounts[i];
+				requiredThroughput += ((SENSOR_FRAME_RATE / (double)streamProfiles[i].getDecimation()) * encodedFrameSizes[i]) / 1000000.0;
+			}
+
+			writeThroughput = (elapsedTime > 0) ? ((writtenBytesCount / 1000000.0) / elapsedTime) : 0;
+			sustainableFrameRate = (elapsedTime > 0) ? (writtenPeriodsCount / elapsedTime) : 0;
+		}
+
+		void RecordingPreflight::cancel() {
+			cancelled = true;
+		}
+
+		bool RecordingPreflight::isCancelled() {
+			return(cancelled);
+		}
+
+		bool RecordingPreflight::isSustainable() {
+			return(sustainableFrameRate >= SENSOR_FRAME_RATE);
+		}
+
+		double RecordingPreflight::getSustainableFrameRate() {
+			return(sustainableFrameRate);
+		}
+
+		double RecordingPreflight::getRequiredThroughput() {
+			return(requiredThroughput);
+		}
+
+		double RecordingPreflight::getWriteThroughput() {
+			return(writeThroughput);
+		}
+
+		unsigned long long RecordingPreflight::getFreeSpace() {
+			return(freeSpace);
+		}
+
+		double RecordingPreflight::getRecordingTime() {
+			if(requiredThroughput > 0)
+				return((freeSpace / 1000000.0) / requiredThroughput);
+			else
+				return(-1);
+		}
+
+		std::string RecordingPreflight::getReport() {
+			std::ostringstream report;
+			report << std::fixed << std::setprecision(1);
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+				report << "Recording preflight : " << kocca::datalib::Sequence::STREAM_FOLDER_NAMES[i] << " " << (encodedFrameSizes[i] / 1000.0) << " KB and "
+					<< frameCosts[i] << " ms per frame, " << (SENSOR_FRAME_RATE / (double)streamProfiles[i].getDecimation()) << " frames per second" << std::endl;
+			}
+
+			report << "Recording preflight : " << sustainableFrameRate << " frames per second sustained by " << threadsNumber << " threads (" << SENSOR_FRAME_RATE << " needed), "
+				<< writeThroughput << " MB/s written (" << requiredThroughput << " MB/s needed), " << (freeSpace / 1000000000.0) << " GB free ("
+				<< (int)(getRecordingTime() / 60) << " minutes of recording)";
+
+			return(report.str());
+		}
+	} // namespace operations
+} // namespace kocca
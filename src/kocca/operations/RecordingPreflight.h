@@ -0,0 +1,172 @@
+#ifndef KOCCA_OPERATIONS_RECORDING_PREFLIGHT_H
+#define KOCCA_OPERATIONS_RECORDING_PREFLIGHT_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+#include "boost/filesystem.hpp"
+#include "../datalib/FrameFileWriter.h"
+#include "../datalib/StreamProfile.h"
+#include "RecordingStatistics.h"
+
+namespace kocca {
+	namespace operations {
+
+		/**
+		 * Checks, before a take, whether the target disk and the writing threads can sustain the recording at the current settings, and how long a take fits in the free space.
+		 * It runs a short synthetic benchmark : sensor-like frames of each stream (with their recording profiles applied) are encoded with the same encoders and settings as SequenceRecording, and written by the same frame files writer into a benchmark folder on the target disk (which is removed afterwards), from as many threads as the writing pool can grow to. Mocap markers are kept in memory while recording, so they are not part of the benchmark.
+		 * The benchmark keeps all the cores busy : it can be cancelled from another thread, typically when a take starts.
+		 */
+		class RecordingPreflight {
+		public:
+
+			/**
+			 * The frame rate of the Kinect streams, in frames per second.
+			 */
+			static const int SENSOR_FRAME_RATE = 30;
+
+		protected:
+
+			/**
+			 * The folder the benchmark writes into.
+			 */
+			boost::filesystem::path benchmarkDirectory;
+
+			/**
+			 * Whether or not the benchmark has been cancelled.
+			 */
+			std::atomic<bool> cancelled;
+
+			/**
+			 * The recording profile of each stream, indexed by RecordedStreamType.
+			 */
+			kocca::datalib::StreamProfile streamProfiles[RECORDED_STREAMS_COUNT];
+
+			/**
+			 * The number of threads that encode and write the frames during the benchmark.
+			 */
+			int threadsNumber;
+
+			/**
+			 * The JPEG settings of the color image frames (see SequenceRecording::jpegQuality, SequenceRecording::jpegChromaSubsampling and SequenceRecording::jpegFastDCT).
+			 */
+			int jpegQuality, jpegChromaSubsampling;
+			bool jpegFastDCT;
+
+			/**
+			 * The mean size of the encoded frames of each stream, in bytes, and the mean time spent encoding and writing one of them, in milliseconds.
+			 */
+			double encodedFrameSizes[RECORDED_STREAMS_COUNT];
+			double frameCosts[RECORDED_STREAMS_COUNT];
+
+			/**
+			 * The number of sensor frame periods written per second during the benchmark : each period, a frame of each stream is written (unless its decimation discards it), like a recording would.
+			 */
+			double sustainableFrameRate;
+
+			/**
+			 * The throughput the recording needs at the sensors' frame rate, and the write throughput measured during the benchmark, in megabytes per second.
+			 */
+			double requiredThroughput, writeThroughput;
+
+			/**
+			 * The free space of the target disk, in bytes.
+			 */
+			unsigned long long freeSpace;
+
+			/**
+			 * The number of sensor frame periods written so far by all the benchmark threads, and the encoded bytes and the time spent per stream.
+			 */
+			std::atomic<unsigned long long> writtenPeriodsCount;
+			std::atomic<unsigned long long> writtenBytesCounts[RECORDED_STREAMS_COUNT];
+			std::atomic<unsigned long long> writtenFramesCounts[RECORDED_STREAMS_COUNT];
+			std::atomic<unsigned long long> busyTimes[RECORDED_STREAMS_COUNT];
+
+			/**
+			 * The message of the first error that happened in a benchmark thread, empty if none did, and a lock to protect it from threads access conflicts.
+			 */
+			std::string errorMessage;
+			std::mutex errorMessage_mutex;
+
+			/**
+			 * Builds a synthetic frame of a stream, at the sensor's resolution : a smooth gradient with sensor-like noise, so it is neither easier nor much harder to compress than actual footage.
+			 * @param stream the stream of the frame
+			 */
+			static cv::Mat createSyntheticFrame(RecordedStreamType stream);
+
+			/**
+			 * Implementation of the benchmark threads, that encode and write the synthetic frames until the end of the benchmark, or until it is cancelled.
+			 * @param threadIndex the index of the thread, to name its files
+			 * @param frames the synthetic frames of each stream, with their profiles applied
+			 * @param frameFileWriter the writer of the frames files
+			 * @param endTime the local system time at which the benchmark ends, in milliseconds
+			 */
+			void benchmarkThreadLoop(int threadIndex, const cv::Mat* frames, kocca::datalib::FrameFileWriter* frameFileWriter, unsigned long long endTime);
+
+		public:
+
+			/**
+			 * Constructor. The encoders, the writer backend, the stream profiles and the number of threads are read from the same "recording.*" settings as SequenceRecording.
+			 * @param _benchmarkDirectory the folder the benchmark writes into, on the disk the recording will write to. It is created, then removed with all its content : it must not be one of the sequences folders.
+			 */
+			RecordingPreflight(boost::filesystem::path _benchmarkDirectory);
+
+			/**
+			 * Runs the benchmark. It blocks for its whole duration, unless it is cancelled.
+			 * @param duration the duration of the benchmark, in milliseconds
+			 * @throws TempFolderNotAvailableException if the benchmark folder couldn't be created
+			 * @throws FileWritingException if a frame couldn't be encoded or written
+			 */
+			void run(unsigned long long duration = 2000);
+
+			/**
+			 * Cancels the benchmark : run() returns as soon as the frames being written are, and its results are meaningless. It can be called from any thread.
+			 */
+			void cancel();
+
+			/**
+			 * Whether or not the benchmark has been cancelled.
+			 */
+			bool isCancelled();
+
+			/**
+			 * Whether or not the recording can be sustained : the benchmark wrote at least as many frames per second as the sensors deliver.
+			 */
+			bool isSustainable();
+
+			/**
+			 * Gets the number of sensor frame periods written per second during the benchmark (see isSustainable()).
+			 */
+			double getSustainableFrameRate();
+
+			/**
+			 * Gets the throughput the recording needs at the sensors' frame rate, in megabytes per second.
+			 */
+			double getRequiredThroughput();
+
+			/**
+			 * Gets the write throughput measured during the benchmark, in megabytes per second.
+			 */
+			double getWriteThroughput();
+
+			/**
+			 * Gets the free space of the target disk, in bytes.
+			 */
+			unsigned long long getFreeSpace();
+
+			/**
+			 * Gets the estimated recording time that fits in the free space, in seconds.
+			 */
+			double getRecordingTime();
+
+			/**
+			 * Gets a human readable report of the benchmark, one line per stream and a summary line.
+			 */
+			std::string getReport();
+		};
+	} // namespace operations
+} // namespace kocca
+
+#endif // KOCCA_OPERATIONS_RECORDING_PREFLIGHT_H
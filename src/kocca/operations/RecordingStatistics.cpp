@@ -0,0 +1,397 @@
+#include "RecordingStatistics.h"
+#include "../utils.h"
+#include "../datalib/Sequence.h"
+#include <cmath>
+#include <iostream>
+
+namespace kocca {
+	namespace operations {
+		namespace {
+			/**
+			 * The weight of the latest measure in the smoothed rates of the estimation.
+			 */
+			const double ESTIMATE_SMOOTHING = 0.3;
+		}
+
+		LatencyHistogram::LatencyHistogram() {
+			for(int i = 0; i < BUCKETS_COUNT; i++)
+				buckets[i] = 0;
+
+			count = 0;
+			total = 0;
+		}
+
+		void LatencyHistogram::add(unsigned long long latency) {
+			int bucket = 0;
+
+			while((bucket < (BUCKETS_COUNT - 1)) && ((latency >> (bucket + 1)) != 0))
+				bucket++;
+
+			buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+			total.fetch_add(latency, std::memory_order_relaxed);
+			count.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		unsigned long long LatencyHistogram::getCount() {
+			return(count.load(std::memory_order_relaxed));
+		}
+
+		double LatencyHistogram::getMean() {
+			unsigned long long latenciesCount = count.load(std::memory_order_relaxed);
+
+			if(latenciesCount > 0)
+				return((total.load(std::memory_order_relaxed) / (double)latenciesCount) / 1000.0);
+			else
+				return(0);
+		}
+
+		double LatencyHistogram::getPercentile(double percentile) {
+			unsigned long long bucketsCounts[BUCKETS_COUNT];
+			unsigned long long latenciesCount = 0;
+
+			// the buckets are copied first, so the result is consistent even if latencies are added meanwhile
+			for(int i = 0; i < BUCKETS_COUNT; i++) {
+				bucketsCounts[i] = buckets[i].load(std::memory_order_relaxed);
+				latenciesCount += bucketsCounts[i];
+			}
+
+			if(latenciesCount == 0)
+				return(0);
+
+			unsigned long long rank = (unsigned long long)(percentile * latenciesCount);
+			unsigned long long cumulatedCount = 0;
+			int bucket = 0;
+
+			for(; bucket < (BUCKETS_COUNT - 1); bucket++) {
+				cumulatedCount += bucketsCounts[bucket];
+
+				if(cumulatedCount > rank)
+					break;
+			}
+
+			return((1ULL << (bucket + 1)) / 1000.0);
+		}
+
+		RecordingStatistics::RecordingStatistics() {
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+				streams[i].enqueuedFramesCount = 0;
+				streams[i].writtenFramesCount = 0;
+				streams[i].droppedFramesCount = 0;
+				streams[i].writtenBytesCount = 0;
+				streams[i].queuedFramesCount = 0;
+				streams[i].queuedBytesCount = 0;
+			}
+
+			startTime = getMSTime();
+			dumpingThread = NULL;
+			isDumping = false;
+			writingThreadsCount = 0;
+			dumpInterval = 1000;
+			imagesClockSynchronizer = NULL;
+			markersClockSynchronizer = NULL;
+
+			estimate.incomingThroughput = 0;
+			estimate.writeThroughput = 0;
+			estimate.sustainableThroughput = 0;
+			estimate.freeSpace = 0;
+			estimate.remainingTime = -1;
+			estimate.buffersGrowthRate = 0;
+			estimate.buffersOverflowTime = -1;
+			benchmarkThroughput = 0;
+			estimateTime = 0;
+		}
+
+		RecordingStatistics::~RecordingStatistics() {
+			stopDumping();
+		}
+
+		void RecordingStatistics::start() {
+			startTime = getMSTime();
+
+			estimate_mutex.lock();
+			estimateTime = 0;
+			estimate_mutex.unlock();
+		}
+
+		void RecordingStatistics::onFrameEnqueued(RecordedStreamType stream, size_t frameSize) {
+			streams[stream].enqueuedFramesCount.fetch_add(1, std::memory_order_relaxed);
+			streams[stream].queuedFramesCount.fetch_add(1, std::memory_order_relaxed);
+			streams[stream].queuedBytesCount.fetch_add(frameSize, std::memory_order_relaxed);
+		}
+
+		void RecordingStatistics::onFrameDequeued(RecordedStreamType stream, size_t frameSize) {
+			streams[stream].queuedFramesCount.fetch_sub(1, std::memory_order_relaxed);
+			streams[stream].queuedBytesCount.fetch_sub(frameSize, std::memory_order_relaxed);
+		}
+
+		void RecordingStatistics::onFrameEncoded(RecordedStreamType stream, unsigned long long encodingLatency) {
+			streams[stream].encodingLatency.add(encodingLatency);
+		}
+
+		void RecordingStatistics::onFrameWritten(RecordedStreamType stream, size_t encodedSize, unsigned long long writingLatency) {
+			streams[stream].writtenFramesCount.fetch_add(1, std::memory_order_relaxed);
+			streams[stream].writtenBytesCount.fetch_add(encodedSize, std::memory_order_relaxed);
+			streams[stream].writingLatency.add(writingLatency);
+		}
+
+		void RecordingStatistics::onFrameDropped(RecordedStreamType stream) {
+			streams[stream].droppedFramesCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void RecordingStatistics::setClockSynchronizers(ClockSynchronizer* _imagesClockSynchronizer, ClockSynchronizer* _markersClockSynchronizer) {
+			imagesClockSynchronizer = _imagesClockSynchronizer;
+			markersClockSynchronizer = _markersClockSynchronizer;
+		}
+
+		unsigned long long RecordingStatistics::getQueuedBytesCount() {
+			long long queuedBytesCount = 0;
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++)
+				queuedBytesCount += streams[i].queuedBytesCount.load(std::memory_order_relaxed);
+
+			return((queuedBytesCount > 0) ? queuedBytesCount : 0);
+		}
+
+		long long RecordingStatistics::getQueuedFramesCount(RecordedStreamType stream) {
+			long long queuedFramesCount = streams[stream].queuedFramesCount.load(std::memory_order_relaxed);
+			return((queuedFramesCount > 0) ? queuedFramesCount : 0);
+		}
+
+		double RecordingStatistics::getMeanFrameCost(RecordedStreamType stream) {
+			return(streams[stream].encodingLatency.getMean() + streams[stream].writingLatency.getMean());
+		}
+
+		void RecordingStatistics::setWritingThreadsCount(int _writingThreadsCount) {
+			writingThreadsCount = _writingThreadsCount;
+		}
+
+		void RecordingStatistics::setBenchmarkThroughput(double throughput) {
+			estimate_mutex.lock();
+			benchmarkThroughput = throughput;
+			estimate_mutex.unlock();
+		}
+
+		void RecordingStatistics::updateEstimate(unsigned long long freeSpace, unsigned long long maxQueuedBytesCount) {
+			unsigned long long now = getMSTime();
+			unsigned long long enqueuedFramesCounts[RECORDED_STREAMS_COUNT];
+			unsigned long long writtenBytesCount = 0;
+			unsigned long long queuedBytesCount = getQueuedBytesCount();
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+				enqueuedFramesCounts[i] = streams[i].enqueuedFramesCount.load(std::memory_order_relaxed);
+				writtenBytesCount += streams[i].writtenBytesCount.load(std::memory_order_relaxed);
+			}
+
+			estimate_mutex.lock();
+			estimate.freeSpace = freeSpace;
+
+			if((estimateTime > 0) && (now > estimateTime)) {
+				double duration = (now - estimateTime) / 1000.0;
+				double incomingThroughput = 0;
+
+				for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+					// the incoming frames are not encoded yet : they are counted at the mean encoded size of the frames of their stream
+					unsigned long long writtenFramesCount = streams[i].writtenFramesCount.load(std::memory_order_relaxed);
+
+					if(writtenFramesCount > 0) {
+						double meanEncodedSize = streams[i].writtenBytesCount.load(std::memory_order_relaxed) / (double)writtenFramesCount;
+						incomingThroughput += ((enqueuedFramesCounts[i] - estimateEnqueuedFramesCounts[i]) * meanEncodedSize / 1000000.0) / duration;
+					}
+				}
+
+				double writeThroughput = ((writtenBytesCount - estimateWrittenBytesCount) / 1000000.0) / duration;
+				double buffersGrowthRate = (((double)queuedBytesCount - (double)estimateQueuedBytesCount) / 1000000.0) / duration;
+
+				estimate.incomingThroughput += ESTIMATE_SMOOTHING * (incomingThroughput - estimate.incomingThroughput);
+				estimate.writeThroughput += ESTIMATE_SMOOTHING * (writeThroughput - estimate.writeThroughput);
+				estimate.buffersGrowthRate += ESTIMATE_SMOOTHING * (buffersGrowthRate - estimate.buffersGrowthRate);
+
+				if((estimate.buffersGrowthRate > 0) && (queuedBytesCount > 0))
+					estimate.sustainableThroughput = estimate.writeThroughput;
+				else
+					estimate.sustainableThroughput = (estimate.writeThroughput > benchmarkThroughput) ? estimate.writeThroughput : benchmarkThroughput;
+
+				if(estimate.incomingThroughput > 0)
+					estimate.remainingTime = (freeSpace / 1000000.0) / estimate.incomingThroughput;
+				else
+					estimate.remainingTime = -1;
+
+				if((estimate.buffersGrowthRate > 0) && (queuedBytesCount < maxQueuedBytesCount))
+					estimate.buffersOverflowTime = ((maxQueuedBytesCount - queuedBytesCount) / 1000000.0) / estimate.buffersGrowthRate;
+				else if(estimate.buffersGrowthRate > 0)
+					estimate.buffersOverflowTime = 0;
+				else
+					estimate.buffersOverflowTime = -1;
+			}
+			else {
+				// the first update only sets the starting point of the rates
+				estimate.incomingThroughput = 0;
+				estimate.writeThroughput = 0;
+				estimate.sustainableThroughput = benchmarkThroughput;
+				estimate.remainingTime = -1;
+				estimate.buffersGrowthRate = 0;
+				estimate.buffersOverflowTime = -1;
+			}
+
+			estimateTime = now;
+			estimateWrittenBytesCount = writtenBytesCount;
+			estimateQueuedBytesCount = queuedBytesCount;
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++)
+				estimateEnqueuedFramesCounts[i] = enqueuedFramesCounts[i];
+
+			estimate_mutex.unlock();
+		}
+
+		RecordingEstimate RecordingStatistics::getEstimate() {
+			estimate_mutex.lock();
+			RecordingEstimate currentEstimate = estimate;
+			estimate_mutex.unlock();
+			return(currentEstimate);
+		}
+
+		StreamStatisticsSnapshot RecordingStatistics::getSnapshot(RecordedStreamType stream, const StreamStatisticsSnapshot* previousSnapshot) {
+			StreamStatistics& statistics = streams[stream];
+			StreamStatisticsSnapshot snapshot;
+
+			snapshot.time = getMSTime() - startTime;
+			snapshot.enqueuedFramesCount = statistics.enqueuedFramesCount.load(std::memory_order_relaxed);
+			snapshot.writtenFramesCount = statistics.writtenFramesCount.load(std::memory_order_relaxed);
+			snapshot.droppedFramesCount = statistics.droppedFramesCount.load(std::memory_order_relaxed);
+			snapshot.writtenBytesCount = statistics.writtenBytesCount.load(std::memory_order_relaxed);
+			snapshot.queuedFramesCount = statistics.queuedFramesCount.load(std::memory_order_relaxed);
+			snapshot.queuedBytesCount = statistics.queuedBytesCount.load(std::memory_order_relaxed);
+
+			unsigned long long sinceTime = 0, sinceEnqueuedFramesCount = 0, sinceWrittenFramesCount = 0, sinceWrittenBytesCount = 0;
+
+			if(previousSnapshot != NULL) {
+				sinceTime = previousSnapshot->time;
+				sinceEnqueuedFramesCount = previousSnapshot->enqueuedFramesCount;
+				sinceWrittenFramesCount = previousSnapshot->writtenFramesCount;
+				sinceWrittenBytesCount = previousSnapshot->writtenBytesCount;
+			}
+
+			if(snapshot.time > sinceTime) {
+				double duration = (snapshot.time - sinceTime) / 1000.0;
+				snapshot.enqueueRate = (snapshot.enqueuedFramesCount - sinceEnqueuedFramesCount) / duration;
+				snapshot.writeRate = (snapshot.writtenFramesCount - sinceWrittenFramesCount) / duration;
+				snapshot.writeThroughput = ((snapshot.writtenBytesCount - sinceWrittenBytesCount) / 1000000.0) / duration;
+			}
+			else {
+				snapshot.enqueueRate = 0;
+				snapshot.writeRate = 0;
+				snapshot.writeThroughput = 0;
+			}
+
+			snapshot.encodingLatencyMean = statistics.encodingLatency.getMean();
+			snapshot.encodingLatencyP50 = statistics.encodingLatency.getPercentile(0.5);
+			snapshot.encodingLatencyP99 = statistics.encodingLatency.getPercentile(0.99);
+			snapshot.writingLatencyMean = statistics.writingLatency.getMean();
+			snapshot.writingLatencyP50 = statistics.writingLatency.getPercentile(0.5);
+			snapshot.writingLatencyP99 = statistics.writingLatency.getPercentile(0.99);
+
+			snapshot.clockDrift = 0;
+			snapshot.clockCorrection = 0;
+			snapshot.clockError = 0;
+
+			if((imagesClockSynchronizer != NULL) && (imagesClockSynchronizer->getSamplesCount() > 0)) {
+				snapshot.clockDrift = imagesClockSynchronizer->getDrift();
+				snapshot.clockCorrection = imagesClockSynchronizer->getMeanCorrection();
+				snapshot.clockError = imagesClockSynchronizer->getFitError();
+			}
+
+			double markersClockError = 0;
+
+			if((markersClockSynchronizer != NULL) && (markersClockSynchronizer->getSamplesCount() > 0))
+				markersClockError = markersClockSynchronizer->getFitError();
+
+			snapshot.combinedClockError = std::sqrt((snapshot.clockError * snapshot.clockError) + (markersClockError * markersClockError));
+
+			return(snapshot);
+		}
+
+		bool RecordingStatistics::startDumping(boost::filesystem::path filePath, unsigned long long interval) {
+			stopDumping();
+
+			dumpFile.open(filePath.string(), std::ios::out | std::ios::trunc);
+
+			if(!dumpFile.is_open()) {
+				std::cerr << "Failed to create recording statistics file " << filePath.string() << std::endl;
+				return(false);
+			}
+
+			dumpFile << "time_ms,stream,enqueued_frames,written_frames,dropped_frames,queued_frames,queued_bytes,written_bytes,"
+				<< "enqueue_rate_fps,write_rate_fps,write_throughput_MBps,"
+				<< "encoding_latency_mean_ms,encoding_latency_p50_ms,encoding_latency_p99_ms,"
+				<< "writing_latency_mean_ms,writing_latency_p50_ms,writing_latency_p99_ms,"
+				<< "clock_drift_ppm,clock_correction_ms,clock_error_ms,combined_clock_error_ms,writing_threads,"
+				<< "incoming_throughput_MBps,sustainable_throughput_MBps,remaining_time_s,buffers_overflow_s" << std::endl;
+
+			dumpInterval = (interval > 0) ? interval : 1000;
+			isDumping = true;
+			dumpingThread = new std::thread(&RecordingStatistics::dumpingThreadLoop, this);
+			return(true);
+		}
+
+		void RecordingStatistics::stopDumping() {
+			if(dumpingThread != NULL) {
+				dumping_mutex.lock();
+				isDumping = false;
+				dumping_mutex.unlock();
+				dumping_condition.notify_all();
+
+				dumpingThread->join();
+				delete dumpingThread;
+				dumpingThread = NULL;
+				dumpFile.close();
+			}
+		}
+
+		void RecordingStatistics::dumpingThreadLoop() {
+			StreamStatisticsSnapshot previousSnapshots[RECORDED_STREAMS_COUNT];
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++)
+				previousSnapshots[i] = getSnapshot((RecordedStreamType)i);
+
+			std::chrono::steady_clock::time_point nextDumpTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(dumpInterval);
+			std::unique_lock<std::mutex> lock(dumping_mutex);
+
+			while(isDumping) {
+				if(dumping_condition.wait_until(lock, nextDumpTime) == std::cv_status::timeout) {
+					lock.unlock();
+					dump(previousSnapshots);
+					lock.lock();
+					nextDumpTime += std::chrono::milliseconds(dumpInterval);
+				}
+			}
+
+			lock.unlock();
+
+			// last dump, with the final state of the recording
+			dump(previousSnapshots);
+		}
+
+		void RecordingStatistics::dump(StreamStatisticsSnapshot* previousSnapshots) {
+			RecordingEstimate currentEstimate = getEstimate();
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+				StreamStatisticsSnapshot snapshot = getSnapshot((RecordedStreamType)i, &(previousSnapshots[i]));
+
+				dumpFile << snapshot.time << "," << kocca::datalib::Sequence::STREAM_FOLDER_NAMES[i] << ","
+					<< snapshot.enqueuedFramesCount << "," << snapshot.writtenFramesCount << "," << snapshot.droppedFramesCount << ","
+					<< snapshot.queuedFramesCount << "," << snapshot.queuedBytesCount << "," << snapshot.writtenBytesCount << ","
+					<< snapshot.enqueueRate << "," << snapshot.writeRate << "," << snapshot.writeThroughput << ","
+					<< snapshot.encodingLatencyMean << "," << snapshot.encodingLatencyP50 << "," << snapshot.encodingLatencyP99 << ","
+					<< snapshot.writingLatencyMean << "," << snapshot.writingLatencyP50 << "," << snapshot.writingLatencyP99 << ","
+					<< snapshot.clockDrift << "," << snapshot.clockCorrection << "," << snapshot.clockError << "," << snapshot.combinedClockError << "," << writingThreadsCount << ","
+					<< currentEstimate.incomingThroughput << "," << currentEstimate.sustainableThroughput << "," << currentEstimate.remainingTime << "," << currentEstimate.buffersOverflowTime << std::endl;
+
+				previousSnapshots[i] = snapshot;
+			}
+		}
+
+		unsigned long long RecordingStatistics::getElapsedMicroseconds(std::chrono::high_resolution_clock::time_point since) {
+			return((unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - since).count());
+		}
+	} // namespace operations
+} // namespace kocca
@@ -0,0 +1,481 @@
+#ifndef KOCCA_OPERATIONS_RECORDING_STATISTICS_H
+#define KOCCA_OPERATIONS_RECORDING_STATISTICS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include "boost/filesystem.hpp"
+#include "../ClockSynchronizer.h"
+
+namespace kocca {
+	namespace operations {
+
+		/**
+		 * The recorded image streams whose writing is monitored by RecordingStatistics.
+		 */
+		enum RecordedStreamType {
+			RECORDED_STREAM_COLOR, /**< Color image stream */
+			RECORDED_STREAM_INFRARED, /**< Infrared stream */
+			RECORDED_STREAM_DEPTH, /**< Depth stream */
+			RECORDED_STREAMS_COUNT /**< The number of recorded streams (not a stream) */
+		};
+
+		/**
+		 * A histogram of latencies, that can be updated and read from several threads at the same time without any lock.
+		 * Bucket i counts the latencies from 2^i to 2^(i+1) microseconds (the first bucket also counts latencies below 1 microsecond, the last one counts all the latencies above its lower bound).
+		 */
+		class LatencyHistogram {
+		public:
+
+			/**
+			 * The number of buckets of the histogram. The last one starts at about 8 seconds.
+			 */
+			static const int BUCKETS_COUNT = 24;
+
+		protected:
+
+			/**
+			 * The number of latencies counted in each bucket.
+			 */
+			std::atomic<unsigned long long> buckets[BUCKETS_COUNT];
+
+			/**
+			 * The total number of latencies counted.
+			 */
+			std::atomic<unsigned long long> count;
+
+			/**
+			 * The sum of all the latencies counted, in microseconds.
+			 */
+			std::atomic<unsigned long long> total;
+
+		public:
+
+			/**
+			 * Constructor.
+			 */
+			LatencyHistogram();
+
+			/**
+			 * Counts a latency.
+			 * @param latency the latency, in microseconds
+			 */
+			void add(unsigned long long latency);
+
+			/**
+			 * Gets the number of latencies counted.
+			 */
+			unsigned long long getCount();
+
+			/**
+			 * Gets the mean of the latencies counted.
+			 * @return the mean latency in milliseconds, or 0 if no latency has been counted yet
+			 */
+			double getMean();
+
+			/**
+			 * Gets an estimation of a percentile of the latencies counted : the upper bound of the bucket where the percentile lies.
+			 * @param percentile the percentile, from 0 to 1 (ex : 0.99 for the 99th percentile)
+			 * @return the estimated percentile in milliseconds, or 0 if no latency has been counted yet
+			 */
+			double getPercentile(double percentile);
+		};
+
+		/**
+		 * The live statistics of the writing of a recorded stream. All the counters are atomics, so they can be updated by the recording threads and read by any other thread without any lock.
+		 */
+		struct StreamStatistics {
+
+			/**
+			 * The number of frames pushed into the stream's recording buffer.
+			 */
+			std::atomic<unsigned long long> enqueuedFramesCount;
+
+			/**
+			 * The number of frames written to the filesystem (or the archive).
+			 */
+			std::atomic<unsigned long long> writtenFramesCount;
+
+			/**
+			 * The number of frames that were received while recording but will never be written : rejected because the buffers were full, or failed to be encoded or written.
+			 */
+			std::atomic<unsigned long long> droppedFramesCount;
+
+			/**
+			 * The total size of the encoded frames written, in bytes.
+			 */
+			std::atomic<unsigned long long> writtenBytesCount;
+
+			/**
+			 * The number of frames currently waiting in the stream's recording buffer.
+			 */
+			std::atomic<long long> queuedFramesCount;
+
+			/**
+			 * The size of the frames currently waiting in the stream's recording buffer (uncompressed), in bytes.
+			 */
+			std::atomic<long long> queuedBytesCount;
+
+			/**
+			 * The time spent encoding each frame.
+			 */
+			LatencyHistogram encodingLatency;
+
+			/**
+			 * The time spent writing each encoded frame.
+			 */
+			LatencyHistogram writingLatency;
+		};
+
+		/**
+		 * A snapshot of the statistics of a recorded stream, with the rates and latencies computed from the raw counters.
+		 */
+		struct StreamStatisticsSnapshot {
+
+			/**
+			 * The time of the snapshot, in milliseconds since the beginning of the recording.
+			 */
+			unsigned long long time;
+
+			/**
+			 * See StreamStatistics::enqueuedFramesCount
+			 */
+			unsigned long long enqueuedFramesCount;
+
+			/**
+			 * See StreamStatistics::writtenFramesCount
+			 */
+			unsigned long long writtenFramesCount;
+
+			/**
+			 * See StreamStatistics::droppedFramesCount
+			 */
+			unsigned long long droppedFramesCount;
+
+			/**
+			 * See StreamStatistics::writtenBytesCount
+			 */
+			unsigned long long writtenBytesCount;
+
+			/**
+			 * See StreamStatistics::queuedFramesCount
+			 */
+			long long queuedFramesCount;
+
+			/**
+			 * See StreamStatistics::queuedBytesCount
+			 */
+			long long queuedBytesCount;
+
+			/**
+			 * The rate at which frames are pushed into the recording buffer, in frames per second.
+			 */
+			double enqueueRate;
+
+			/**
+			 * The rate at which frames are written, in frames per second.
+			 */
+			double writeRate;
+
+			/**
+			 * The rate at which encoded data is written, in megabytes per second.
+			 */
+			double writeThroughput;
+
+			/**
+			 * The mean, median and 99th percentile of the encoding latency, in milliseconds.
+			 */
+			double encodingLatencyMean, encodingLatencyP50, encodingLatencyP99;
+
+			/**
+			 * The mean, median and 99th percentile of the writing latency, in milliseconds.
+			 */
+			double writingLatencyMean, writingLatencyP50, writingLatencyP99;
+
+			/**
+			 * The drift of the clock of the stream's device relative to the host clock, in parts per million (0 if the stream's clock is not synchronized).
+			 */
+			double clockDrift;
+
+			/**
+			 * The mean correction applied to the arrival times of the stream's frames, in milliseconds (see ClockSynchronizer::getMeanCorrection()).
+			 */
+			double clockCorrection;
+
+			/**
+			 * The estimated error of the corrected times of the stream's frames, in milliseconds (see ClockSynchronizer::getFitError()).
+			 */
+			double clockError;
+
+			/**
+			 * The combined fit error of the stream's clock and of the mocap markers clock, in milliseconds : the root sum square of their arrival jitter around their fits (see ClockSynchronizer::getFitError()). It bounds how well the two streams can be aligned, but it isn't a measure of their actual offset, which would take an event seen by both.
+			 */
+			double combinedClockError;
+		};
+
+		/**
+		 * An estimation of how long the recording can go on, from the measured rates and the free space of the target disk.
+		 */
+		struct RecordingEstimate {
+
+			/**
+			 * The rate at which the streams produce encoded data, in megabytes per second : the throughput the recording needs.
+			 */
+			double incomingThroughput;
+
+			/**
+			 * The rate at which encoded data is actually written, in megabytes per second.
+			 */
+			double writeThroughput;
+
+			/**
+			 * The estimated highest throughput the recording can sustain, in megabytes per second : the measured write throughput while the buffers are growing (the writers are saturated), the highest of the measured and benchmarked ones otherwise. 0 if unknown.
+			 */
+			double sustainableThroughput;
+
+			/**
+			 * The free space of the target disk, in bytes.
+			 */
+			unsigned long long freeSpace;
+
+			/**
+			 * The estimated recording time left before the target disk is full, in seconds, or -1 if unknown.
+			 */
+			double remainingTime;
+
+			/**
+			 * The rate at which the recording buffers grow (negative if they shrink), in megabytes per second.
+			 */
+			double buffersGrowthRate;
+
+			/**
+			 * The estimated time before the recording buffers reach their maximum size, in seconds, or -1 if they are not growing.
+			 */
+			double buffersOverflowTime;
+		};
+
+		/**
+		 * Collects the statistics of a recording : for each recorded stream, the frames going through the recording buffer and the time spent encoding and writing them.
+		 * The statistics are updated by the recording threads and can be read at any time (typically by the UI) without any lock. They can also be dumped periodically to a CSV file, to size disks and writing threads from actual data.
+		 */
+		class RecordingStatistics {
+		protected:
+
+			/**
+			 * The statistics of each recorded stream, indexed by RecordedStreamType.
+			 */
+			StreamStatistics streams[RECORDED_STREAMS_COUNT];
+
+			/**
+			 * The local system time at which the statistics started to be collected, in milliseconds.
+			 */
+			std::atomic<unsigned long long> startTime;
+
+			/**
+			 * The thread that periodically dumps the statistics to the CSV file, or NULL if they are not dumped.
+			 */
+			std::thread* dumpingThread;
+
+			/**
+			 * Whether or not the dumping thread should keep running.
+			 */
+			std::atomic<bool> isDumping;
+
+			/**
+			 * Wakes the dumping thread up when it is stopped, so it doesn't wait for the next dump.
+			 */
+			std::mutex dumping_mutex;
+			std::condition_variable dumping_condition;
+
+			/**
+			 * The CSV file where the statistics are dumped.
+			 */
+			std::ofstream dumpFile;
+
+			/**
+			 * The interval between two dumps of the statistics, in milliseconds.
+			 */
+			unsigned long long dumpInterval;
+
+			/**
+			 * The clock synchronizer of the Kinect, which timestamps all the image streams, or NULL if unknown.
+			 */
+			ClockSynchronizer* imagesClockSynchronizer;
+
+			/**
+			 * The clock synchronizer of the mocap system, which timestamps the markers frames, or NULL if unknown.
+			 */
+			ClockSynchronizer* markersClockSynchronizer;
+
+			/**
+			 * The current number of threads of the recording's writing pool.
+			 */
+			std::atomic<int> writingThreadsCount;
+
+			/**
+			 * The latest estimation of the recording, and the write throughput measured by a benchmark of the target disk before the recording (in megabytes per second, 0 if unknown).
+			 */
+			RecordingEstimate estimate;
+			double benchmarkThroughput;
+
+			/**
+			 * The counters at the time of the latest estimation, to compute the rates since then.
+			 */
+			unsigned long long estimateTime;
+			unsigned long long estimateEnqueuedFramesCounts[RECORDED_STREAMS_COUNT];
+			unsigned long long estimateWrittenBytesCount;
+			unsigned long long estimateQueuedBytesCount;
+
+			/**
+			 * A lock to protect the estimation from threads access conflicts.
+			 */
+			std::mutex estimate_mutex;
+
+			/**
+			 * Implementation of the dumping thread. It writes the statistics of all the streams every dumpInterval milliseconds, and a last time when it is stopped.
+			 */
+			void dumpingThreadLoop();
+
+			/**
+			 * Writes a CSV line per stream in the dump file, with the statistics since the previous snapshots.
+			 * @param previousSnapshots the previous snapshots of each stream, which are then replaced by the new ones
+			 */
+			void dump(StreamStatisticsSnapshot* previousSnapshots);
+
+		public:
+
+			/**
+			 * Constructor.
+			 */
+			RecordingStatistics();
+
+			/**
+			 * Destructor. Stops dumping the statistics if needed.
+			 */
+			~RecordingStatistics();
+
+			/**
+			 * Sets the beginning of the statistics collection, from which the rates are computed.
+			 */
+			void start();
+
+			/**
+			 * Counts a frame pushed into the recording buffer of a stream.
+			 * @param stream the stream of the frame
+			 * @param frameSize the size of the (uncompressed) frame, in bytes
+			 */
+			void onFrameEnqueued(RecordedStreamType stream, size_t frameSize);
+
+			/**
+			 * Counts a frame removed from the recording buffer of a stream, to be written.
+			 * @param stream the stream of the frame
+			 * @param frameSize the size of the (uncompressed) frame, in bytes
+			 */
+			void onFrameDequeued(RecordedStreamType stream, size_t frameSize);
+
+			/**
+			 * Counts the encoding of a frame.
+			 * @param stream the stream of the frame
+			 * @param encodingLatency the time spent encoding the frame, in microseconds
+			 */
+			void onFrameEncoded(RecordedStreamType stream, unsigned long long encodingLatency);
+
+			/**
+			 * Counts a frame written to the filesystem (or the archive). With an asynchronous writer, it is called by the writer's completion thread.
+			 * @param stream the stream of the frame
+			 * @param encodedSize the size of the encoded frame, in bytes
+			 * @param writingLatency the time from the submission of the encoded frame to the completion of its write, in microseconds
+			 */
+			void onFrameWritten(RecordedStreamType stream, size_t encodedSize, unsigned long long writingLatency);
+
+			/**
+			 * Counts a frame that will never be written.
+			 * @param stream the stream of the frame
+			 */
+			void onFrameDropped(RecordedStreamType stream);
+
+			/**
+			 * Sets the clock synchronizers that timestamp the recorded frames, to report their clock statistics along with the writing ones.
+			 * @param _imagesClockSynchronizer the clock synchronizer of the Kinect, or NULL
+			 * @param _markersClockSynchronizer the clock synchronizer of the mocap system, or NULL
+			 */
+			void setClockSynchronizers(ClockSynchronizer* _imagesClockSynchronizer, ClockSynchronizer* _markersClockSynchronizer);
+
+			/**
+			 * Gets the total size of the frames currently waiting in the recording buffers of all the streams.
+			 * @return the size of the queued frames (uncompressed), in bytes
+			 */
+			unsigned long long getQueuedBytesCount();
+
+			/**
+			 * Gets the number of frames currently waiting in the recording buffer of a stream.
+			 * @param stream the stream
+			 */
+			long long getQueuedFramesCount(RecordedStreamType stream);
+
+			/**
+			 * Gets the mean time spent encoding and writing a frame of a stream, which is the cost of a frame for a writing thread.
+			 * @param stream the stream
+			 * @return the mean cost in milliseconds, or 0 if no frame has been written yet
+			 */
+			double getMeanFrameCost(RecordedStreamType stream);
+
+			/**
+			 * Sets the current number of threads of the writing pool, to report it along with the statistics of the streams.
+			 * @param _writingThreadsCount the number of threads
+			 */
+			void setWritingThreadsCount(int _writingThreadsCount);
+
+			/**
+			 * Sets the write throughput of the target disk measured before the recording (see RecordingPreflight), which the sustainable throughput can't be estimated below until the writers are saturated.
+			 * @param throughput the benchmarked throughput, in megabytes per second
+			 */
+			void setBenchmarkThroughput(double throughput);
+
+			/**
+			 * Updates the estimation of the recording from the rates measured since the previous update. The rates are smoothed over the successive updates, which are expected about once per second.
+			 * @param freeSpace the free space of the target disk, in bytes
+			 * @param maxQueuedBytesCount the maximum size of the recording buffers, in bytes
+			 */
+			void updateEstimate(unsigned long long freeSpace, unsigned long long maxQueuedBytesCount);
+
+			/**
+			 * Gets the latest estimation of the recording (see updateEstimate()).
+			 */
+			RecordingEstimate getEstimate();
+
+			/**
+			 * Gets a snapshot of the statistics of a stream.
+			 * @param stream the stream to get the statistics of
+			 * @param previousSnapshot if not NULL, the rates are computed since this snapshot. Otherwise, they are computed since the beginning of the recording.
+			 * @return the snapshot
+			 */
+			StreamStatisticsSnapshot getSnapshot(RecordedStreamType stream, const StreamStatisticsSnapshot* previousSnapshot = NULL);
+
+			/**
+			 * Starts dumping the statistics periodically to a CSV file, from a separate thread.
+			 * @param filePath the path of the CSV file. It is overwritten if it already exists.
+			 * @param interval the interval between two dumps, in milliseconds
+			 * @return true if the dumping started, false if the file couldn't be created
+			 */
+			bool startDumping(boost::filesystem::path filePath, unsigned long long interval);
+
+			/**
+			 * Stops dumping the statistics, after a last dump. This has no effect if they are not being dumped.
+			 */
+			void stopDumping();
+
+			/**
+			 * Gets the time elapsed since a time point, to measure latencies.
+			 * @param since the time point to measure from
+			 * @return the elapsed time, in microseconds
+			 */
+			static unsigned long long getElapsedMicroseconds(std::chrono::high_resolution_clock::time_point since);
+		};
+	} // namespace operations
+} // namespace kocca
+
+#endif // KOCCA_OPERATIONS_RECORDING_STATISTICS_H
@@ -2,9 +2,39 @@
 #include "../utils.h"
 #include "../datalib/FramePath.h"
 #include "../Exceptions.h"
+#include "../Settings.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
 
 namespace kocca {
 	namespace operations {
+		namespace {
+			/**
+			 * The range of the playback rate, in either direction.
+			 */
+			const double MIN_PLAYBACK_RATE = 0.1;
+			const double MAX_PLAYBACK_RATE = 16;
+
+			/**
+			 * The playback rates stepped through by stepPlaybackRate(), in either direction.
+			 */
+			const double PLAYBACK_RATE_STEPS[] = {0.125, 0.25, 0.5, 1, 2, 4, 8, 16};
+			const int PLAYBACK_RATE_STEPS_COUNT = sizeof(PLAYBACK_RATE_STEPS) / sizeof(PLAYBACK_RATE_STEPS[0]);
+
+			/**
+			 * The part of the prefetch window kept behind the playhead, relative to the part ahead of it.
+			 */
+			const double TRAILING_WINDOW_RATIO = 0.25;
+
+			/**
+			 * The largest factor the JPEG frames can be downscaled by while they are decoded.
+			 */
+			const int MAX_DECODING_REDUCTION = 8;
+		}
+
 		/**
 		 * @throws EmptySequenceException
 		 */
@@ -16,20 +46,67 @@ namespace kocca {
 			playHeadPosition = 0;
 			onChangePlayheadPosition = NULL;
 			onUpdateBufferEndingPoint = NULL;
-			framesBufferMaxSize = maxBuffersSize;
-			lastOutputImageFrameTime = -1;
-			lastOutputIRFrameTime = -1;
-			lastOutputDepthFrameTime = -1;
-			imageFramesBufferingThread = NULL;
-			irFramesBufferingThread = NULL;
-			depthFramesBufferingThread = NULL;
+			buffersMaxSize = (unsigned long long)(Settings::getDouble("playback.buffers_size", maxBuffersSize) * 1000000);
+			peakBuffersUsedSize = 0;
+			logsStatistics = Settings::getBool("debug.statistics_logs", false);
+			lookAheadTime = (long long)(Settings::getDouble("playback.lookahead_time", 2) * 1000000);
+			frameCache = new DecodedFrameCache((unsigned long long)(Settings::getDouble("playback.cache_size", 512) * 1000000));
 			playingThread = NULL;
+			seekingThread = NULL;
+			seekingIsActive = true;
+			requestedSeekPosition = -1;
+			seekRequestTime = 0;
+			seekIsPending = false;
+			requestedSeeksCount = 0;
+			supersededSeeksCount = 0;
+			lastSeekLatency = 0;
+			meanSeekLatency = 0;
+			maxSeekLatency = 0;
+			proxies = NULL;
+			proxiesGenerationThread = NULL;
+			startPlayingTime = 0;
+			startPlayingPosition = 0;
+			playbackRate = 1;
+
+			for(int i = 0; i < PLAYBACK_STREAMS_COUNT; i++) {
+				lastOutputFrameTimes[i] = -1;
+				proxyIsOutput[i] = false;
+				buffersUsedSizes[i] = 0;
+				meanFrameSizes[i] = 0;
+				frameRates[i] = 0;
+				meanDecodingTimes[i] = 0;
+				decodingReductions[i] = 1;
+			}
+
+			setPlaybackRate(Settings::getDouble("playback.rate", 1));
 
 			if(_sequence->hasRecordedData()) {
 				sequence = _sequence;
-				imageFramesBufferingThread = new std::thread(&SequenceReading::imageBufferingLoop, this);
-				irFramesBufferingThread = new std::thread(&SequenceReading::irBufferingLoop, this);
-				depthFramesBufferingThread = new std::thread(&SequenceReading::depthBufferingLoop, this);
+				framesLists[PLAYBACK_STREAM_COLOR] = sequence->getImageFramesList();
+				framesLists[PLAYBACK_STREAM_INFRARED] = sequence->getIRFramesList();
+				framesLists[PLAYBACK_STREAM_DEPTH] = sequence->getDepthFramesList();
+
+				for(int i = 0; i < PLAYBACK_STREAMS_COUNT; i++) {
+					if((framesLists[i].size() > 1) && (framesLists[i].back().time > framesLists[i].front().time))
+						frameRates[i] = ((framesLists[i].size() - 1) * 1000000.0) / (framesLists[i].back().time - framesLists[i].front().time);
+				}
+
+				// the decoding threads are shared by the streams, so the one that is the most behind the playhead gets the most of them
+				int coresNumber = (int)std::thread::hardware_concurrency();
+				int decodingThreadsNumber = (int)Settings::getInt("playback.decoding_threads", (coresNumber > 2) ? (coresNumber / 2) : 2);
+
+				if(decodingThreadsNumber < 1)
+					decodingThreadsNumber = 1;
+
+				for(int i = 0; i < decodingThreadsNumber; i++)
+					decodingThreads.push_back(new std::thread(&SequenceReading::decodingThreadLoop, this));
+
+				seekingThread = new std::thread(&SequenceReading::seekingLoop, this);
+
+				if(Settings::getBool("playback.proxies", true)) {
+					proxies = new kocca::datalib::SequenceProxies(sequence, (int)Settings::getInt("playback.proxy_width", 480));
+					proxiesGenerationThread = new std::thread(&SequenceReading::proxiesGenerationLoop, this);
+				}
 			}
 			else
 				throw EmptySequenceException("No recorded data found in sequence");
@@ -59,33 +136,17 @@ namespace kocca {
 			if(position > sequence->getDuration()) {
 				position = sequence->getDuration();
 				stop();
-		
+
 				if(onStopAtTheEnd != NULL)
 					onStopAtTheEnd();
 			}
 			else {
+				prefetch_mutex.lock();
 				playHeadPosition = position;
+				purgeDecodedFrames();
+				prefetch_mutex.unlock();
 
-				imageFramesBuffer_mutex.lock();
-	
-				if((position < imageFramesBuffer.getStartingPoint()) || (position > imageFramesBuffer.getEndingPoint()))
-					imageFramesBuffer.clear();
-
-				imageFramesBuffer_mutex.unlock();
-
-				irFramesBuffer_mutex.lock();
-
-				if ((position < irFramesBuffer.getStartingPoint()) || (position > irFramesBuffer.getEndingPoint()))
-					irFramesBuffer.clear();
-
-				irFramesBuffer_mutex.unlock();
-
-				depthFramesBuffer_mutex.lock();
-
-				if((position < depthFramesBuffer.getStartingPoint()) || (position > depthFramesBuffer.getEndingPoint()))
-					depthFramesBuffer.clear();
-
-				depthFramesBuffer_mutex.unlock();
+				prefetch_condition.notify_all();
 			}
 
 			outputImageFrame();
@@ -99,6 +160,70 @@ namespace kocca {
 			return true;
 		}
 
+		void SequenceReading::seek(unsigned long long position) {
+			seeking_mutex.lock();
+
+			// the previous request hasn't been carried out yet : it is replaced
+			if(requestedSeekPosition >= 0)
+				supersededSeeksCount++;
+
+			requestedSeekPosition = (long long)position;
+			seekRequestTime = getUSTime();
+			requestedSeeksCount++;
+			seekIsPending = true;
+			seeking_mutex.unlock();
+
+			seeking_condition.notify_all();
+		}
+
+		unsigned long long SequenceReading::getLastSeekLatency() {
+			seeking_mutex.lock();
+			unsigned long long latency = lastSeekLatency;
+			seeking_mutex.unlock();
+			return(latency);
+		}
+
+		double SequenceReading::getMeanSeekLatency() {
+			seeking_mutex.lock();
+			double latency = meanSeekLatency;
+			seeking_mutex.unlock();
+			return(latency);
+		}
+
+		void SequenceReading::seekingLoop() {
+			std::unique_lock<std::mutex> lock(seeking_mutex);
+
+			while(seekingIsActive) {
+				if(requestedSeekPosition < 0) {
+					seeking_condition.wait(lock);
+					continue;
+				}
+
+				unsigned long long position = (unsigned long long)requestedSeekPosition;
+				unsigned long long requestTime = seekRequestTime;
+				requestedSeekPosition = -1;
+				seekIsPending = false;
+				lock.unlock();
+
+				setPlayHeadPosition(position);
+				unsigned long long latency = getUSTime() - requestTime;
+
+				lock.lock();
+
+				// a seek requested while the frames were output may have stopped them from being decoded
+				if(requestedSeekPosition >= 0)
+					supersededSeeksCount++;
+				else {
+					unsigned long long seeksCount = requestedSeeksCount - supersededSeeksCount;
+					lastSeekLatency = latency;
+					meanSeekLatency = ((meanSeekLatency * (seeksCount - 1)) + latency) / seeksCount;
+
+					if(latency > maxSeekLatency)
+						maxSeekLatency = latency;
+				}
+			}
+		}
+
 		/**
 		 * @throws NoPreviousEventException
 		 */
@@ -136,92 +261,640 @@ namespace kocca {
 				outputIRFrame();
 				outputDepthFrame();
 				outputMarkersFrame();
-				std::this_thread::sleep_for(std::chrono::milliseconds(refreshPeriod));
+
+				// sleeping until the next frame is due, rather than for a fixed period, keeps the frames on time whatever the output took
+				prefetch_mutex.lock();
+				long long sleepingTime = getNextFrameDeadline() - (long long)getUSTime();
+				prefetch_mutex.unlock();
+
+				if(sleepingTime > (refreshPeriod * 1000LL))
+					sleepingTime = refreshPeriod * 1000LL;
+
+				if(sleepingTime > 0)
+					std::this_thread::sleep_for(std::chrono::microseconds(sleepingTime));
+			}
+
+			for(int i = 0; logsStatistics && (i < PLAYBACK_STREAMS_COUNT); i++) {
+				if(!framesLists[i].empty()) {
+					prefetch_mutex.lock();
+					unsigned long long skippedFramesCount = skippedFramesCounts[i];
+					prefetch_mutex.unlock();
+
+					std::cout << "Playback : " << kocca::datalib::Sequence::STREAM_FOLDER_NAMES[i] << " stream shown at " << getRealizedFrameRate((PlaybackStreamType)i) << " fps out of " << getRequestedFrameRate((PlaybackStreamType)i)
+						<< " fps requested (x" << playbackRate << "), " << skippedFramesCount << " frames skipped" << std::endl;
+				}
 			}
 		}
 
 		void SequenceReading::startPlaying() {
 			if(!playing) {
-				startPlayingTime = getMSTime();
+				// the previous playing thread may have ended by itself, at the end of the sequence
+				if(playingThread != NULL) {
+					if(playingThread->joinable())
+						playingThread->join();
+
+					delete playingThread;
+				}
+
+				prefetch_mutex.lock();
+				startPlayingTime = getUSTime();
 				playing = true;
 				startPlayingPosition = playHeadPosition;
+				outputFramesCountingStartTime = startPlayingTime;
+
+				for(int i = 0; i < PLAYBACK_STREAMS_COUNT; i++) {
+					outputFramesCounts[i] = 0;
+					skippedFramesCounts[i] = 0;
+					lastSkippedFrameRanks[i] = -1;
+				}
+
+				// the frames that aren't to be shown at the playback rate make room for the ones that are
+				purgeDecodedFrames();
+				prefetch_mutex.unlock();
+
+				prefetch_condition.notify_all();
 				playingThread = new std::thread(&SequenceReading::playingLoop, this);
 			}
 		}
 
 		void SequenceReading::stop() {
 			playing = false;
-			
+
 			if((playingThread != NULL) && (playingThread->joinable()))
 				playingThread->join();
+
+			// the frames skipped while playing are prefetched again, for stepping frame by frame
+			prefetch_mutex.lock();
+			purgeDecodedFrames();
+			prefetch_mutex.unlock();
+
+			prefetch_condition.notify_all();
 		}
 
 		int SequenceReading::getRefreshPeriod() {
 			return refreshPeriod;
 		}
 
+		void SequenceReading::stepPlaybackRate(bool faster) {
+			double rate = getPlaybackRate();
+			double speed = std::fabs(rate);
+
+			// a rate off the steps (see the playback.rate setting) goes to the nearest step in the requested direction
+			int step = faster ? 0 : (PLAYBACK_RATE_STEPS_COUNT - 1);
+
+			if(faster) {
+				while((step < (PLAYBACK_RATE_STEPS_COUNT - 1)) && (PLAYBACK_RATE_STEPS[step] <= speed))
+					step++;
+			}
+			else {
+				while((step > 0) && (PLAYBACK_RATE_STEPS[step] >= speed))
+					step--;
+			}
+
+			setPlaybackRate((rate < 0) ? -PLAYBACK_RATE_STEPS[step] : PLAYBACK_RATE_STEPS[step]);
+		}
+
+		void SequenceReading::setPlaybackRate(double rate) {
+			// the sign of the rate is the direction of the playback
+			double speed = std::fabs(rate);
+
+			if(speed < MIN_PLAYBACK_RATE)
+				speed = MIN_PLAYBACK_RATE;
+			else if(speed > MAX_PLAYBACK_RATE)
+				speed = MAX_PLAYBACK_RATE;
+
+			rate = (rate < 0) ? -speed : speed;
+
+			prefetch_mutex.lock();
+			long long now = (long long)getUSTime();
+
+			// the playhead goes on from where it is at the new rate, instead of jumping
+			if(playing) {
+				startPlayingPosition += (long long)((now - startPlayingTime) * playbackRate);
+				startPlayingTime = now;
+			}
+
+			playbackRate = rate;
+			outputFramesCountingStartTime = now;
+
+			for(int i = 0; i < PLAYBACK_STREAMS_COUNT; i++) {
+				outputFramesCounts[i] = 0;
+				skippedFramesCounts[i] = 0;
+				lastSkippedFrameRanks[i] = -1;
+			}
+
+			// the prefetch window and the frame strides follow the rate
+			purgeDecodedFrames();
+			prefetch_mutex.unlock();
+
+			prefetch_condition.notify_all();
+		}
+
+		double SequenceReading::getPlaybackRate() {
+			return(playbackRate);
+		}
+
+		void SequenceReading::setDisplaySize(PlaybackStreamType stream, int width, int height) {
+			prefetch_mutex.lock();
+			displaySizes[stream] = cv::Size(width, height);
+			updateDecodingReduction(stream);
+			prefetch_mutex.unlock();
+		}
+
+		int SequenceReading::getDecodingReduction(PlaybackStreamType stream) {
+			return(decodingReductions[stream]);
+		}
+
+		void SequenceReading::updateDecodingReduction(PlaybackStreamType stream) {
+			int reduction = 1;
+
+			if((stream == PLAYBACK_STREAM_COLOR) && (frameSizes[stream].width > 0) && (displaySizes[stream].width > 0) && (displaySizes[stream].height > 0)) {
+				// the frame is fit in the widget : once halved again, it must still be at least as large as the widget along one of its dimensions
+				while((reduction < MAX_DECODING_REDUCTION) && ((frameSizes[stream].width >= (reduction * 2 * displaySizes[stream].width)) || (frameSizes[stream].height >= (reduction * 2 * displaySizes[stream].height))))
+					reduction *= 2;
+			}
+
+			int previousReduction = decodingReductions[stream];
+			decodingReductions[stream] = reduction;
+
+			if(reduction < previousReduction) {
+				std::map<int, kocca::datalib::TimeCodedFrame>::iterator it = decodedFrames[stream].begin();
+
+				while(it != decodedFrames[stream].end()) {
+					if(hasDecodingResolution(stream, it->second))
+						++it;
+					else {
+						buffersUsedSizes[stream] -= it->second.frame.total() * it->second.frame.elemSize();
+						it = decodedFrames[stream].erase(it);
+					}
+				}
+
+				// like a proxy, the output frame is replaced as soon as it is decoded again
+				proxyIsOutput[stream] = true;
+				prefetch_condition.notify_all();
+			}
+		}
+
+		bool SequenceReading::hasDecodingResolution(PlaybackStreamType stream, const kocca::datalib::TimeCodedFrame& tcFrame) {
+			return(tcFrame.frame.empty() || (tcFrame.downscale <= decodingReductions[stream]));
+		}
+
+		double SequenceReading::getRequestedFrameRate(PlaybackStreamType stream) {
+			prefetch_mutex.lock();
+			double frameRate = (frameRates[stream] * std::fabs(playbackRate)) / getFrameStride(stream);
+			prefetch_mutex.unlock();
+			return(frameRate);
+		}
+
+		double SequenceReading::getRealizedFrameRate(PlaybackStreamType stream) {
+			prefetch_mutex.lock();
+			long long elapsedTime = (long long)getUSTime() - outputFramesCountingStartTime;
+			double frameRate = (elapsedTime > 0) ? ((outputFramesCounts[stream] * 1000000.0) / elapsedTime) : 0;
+			prefetch_mutex.unlock();
+			return(frameRate);
+		}
+
+		std::string SequenceReading::getPlaybackStatus(PlaybackStreamType stream) {
+			std::ostringstream status;
+			status << std::fixed << std::setprecision(1);
+
+			if(playing)
+				status << getRealizedFrameRate(stream) << " / " << getRequestedFrameRate(stream) << " fps";
+
+			if((frameCache->getHitsCount() + frameCache->getMissesCount()) > 0) {
+				if(status.tellp() > 0)
+					status << ", ";
+
+				status << "cache " << (int)(frameCache->getHitRate() * 100) << "% hits";
+			}
+
+			if(status.tellp() > 0)
+				status << ", ";
+
+			status << "buffers " << (getBuffersUsedSize() / 1000000) << " / " << (getBuffersMaxSize() / 1000000) << " MB";
+
+			seeking_mutex.lock();
+			unsigned long long latency = lastSeekLatency;
+			double meanLatency = meanSeekLatency;
+			seeking_mutex.unlock();
+
+			// a seek carried out takes at least the time to output its frames : the latency is only 0 until the first one
+			if(latency > 0)
+				status << ", seek " << (latency / 1000) << " ms (mean " << (unsigned long long)(meanLatency / 1000) << " ms)";
+
+			return(status.str());
+		}
+
 		kocca::datalib::Sequence* SequenceReading::getSequence() {
 			return sequence;
 		}
 
-		void SequenceReading::outputImageFrame(bool force) {
-			if((onColorImageFrameOutput != NULL) && !sequence->getImageFramesList().empty()) {
-				try {
-					imageFramesBuffer_mutex.lock();
-					kocca::datalib::TimeCodedFrame outputFrame = imageFramesBuffer.getFrameAtTime(playHeadPosition);
-					imageFramesBuffer_mutex.unlock();
+		DecodedFrameCache* SequenceReading::getFrameCache() {
+			return frameCache;
+		}
 
-					if(force || (outputFrame.time != lastOutputImageFrameTime)) {
-						onColorImageFrameOutput(outputFrame);
-						lastOutputImageFrameTime = outputFrame.time;
-					}
+		unsigned long long SequenceReading::getBuffersUsedSize() {
+			unsigned long long usedSize = 0;
+
+			prefetch_mutex.lock();
+
+			for(int i = 0; i < PLAYBACK_STREAMS_COUNT; i++)
+				usedSize += buffersUsedSizes[i];
+
+			prefetch_mutex.unlock();
+			return(usedSize);
+		}
+
+		unsigned long long SequenceReading::getBuffersUsedSize(PlaybackStreamType stream) {
+			prefetch_mutex.lock();
+			unsigned long long usedSize = buffersUsedSizes[stream];
+			prefetch_mutex.unlock();
+			return(usedSize);
+		}
+
+		unsigned long long SequenceReading::getBuffersMaxSize() {
+			return(buffersMaxSize);
+		}
+
+		long long SequenceReading::getPrefetchHorizon() {
+			prefetch_mutex.lock();
+			long long horizon = computePrefetchHorizon();
+			prefetch_mutex.unlock();
+			return(horizon);
+		}
+
+		long long SequenceReading::computePrefetchHorizon() {
+			// the streams share the budget in proportion to their bytes per second, so they are all buffered up to the same time
+			double bytesPerSecond = 0;
+
+			for(int i = 0; i < PLAYBACK_STREAMS_COUNT; i++)
+				bytesPerSecond += (meanFrameSizes[i] * frameRates[i]) / getFrameStride((PlaybackStreamType)i);
+
+			// the look-ahead window is a duration of playback, so it covers more of the sequence at higher rates
+			long long rateLookAheadTime = (long long)(lookAheadTime * std::fabs(playbackRate));
+
+			if(bytesPerSecond <= 0)
+				return(rateLookAheadTime);
+
+			// the frames kept behind the playhead take their share of the budget
+			long long horizon = (long long)((buffersMaxSize / (bytesPerSecond * (1 + TRAILING_WINDOW_RATIO))) * 1000000);
+			return((horizon < rateLookAheadTime) ? horizon : rateLookAheadTime);
+		}
+
+		int SequenceReading::getFrameStride(PlaybackStreamType stream) {
+			if(!playing)
+				return(1);
+
+			int stride = (int)((frameRates[stream] * std::fabs(playbackRate) * refreshPeriod) / 1000);
+			return((stride > 1) ? stride : 1);
+		}
+
+		int SequenceReading::getShownFrameRank(PlaybackStreamType stream, int stride) {
+			// while playing at a high rate, the frame shown at the playhead may be before the visible one
+			return((getFrameRankAtTime(stream, playHeadPosition) / stride) * stride);
+		}
+
+		int SequenceReading::getNextShownFrameRank(PlaybackStreamType stream, int rank, int stride) {
+			int nextRank = ((rank / stride) + 1) * stride;
+			return((nextRank < framesLists[stream].size()) ? nextRank : (int)framesLists[stream].size());
+		}
+
+		int SequenceReading::getPreviousShownFrameRank(int rank, int stride) {
+			int previousRank = ((rank % stride) == 0) ? (rank - stride) : ((rank / stride) * stride);
+			return((previousRank >= 0) ? previousRank : -1);
+		}
+
+		long long SequenceReading::getNextFrameDeadline() {
+			long long deadline = -1;
+
+			for(int i = 0; i < PLAYBACK_STREAMS_COUNT; i++) {
+				if(framesLists[i].empty())
+					continue;
+
+				int stride = getFrameStride((PlaybackStreamType)i);
+				long long frameTime;
+
+				// forwards, the next frame is shown when the playhead reaches it ; backwards, the shown frame is left as soon as the playhead goes before it
+				if(playbackRate >= 0) {
+					int nextRank = getNextShownFrameRank((PlaybackStreamType)i, getFrameRankAtTime((PlaybackStreamType)i, playHeadPosition), stride);
+
+					if(nextRank >= framesLists[i].size())
+						continue;
+
+					frameTime = framesLists[i].at(nextRank).time;
 				}
-				catch(FrameNotInBufferException& e) {
-					imageFramesBuffer_mutex.unlock();
-					kocca::datalib::TimeCodedFrame outputFrame = sequence->getImageFrameByTime(playHeadPosition);
-					onColorImageFrameOutput(outputFrame);
+				else {
+					frameTime = framesLists[i].at(getShownFrameRank((PlaybackStreamType)i, stride)).time - 1;
+
+					if(frameTime >= playHeadPosition)
+						continue;
 				}
+
+				long long frameDeadline = startPlayingTime + (long long)((frameTime - startPlayingPosition) / playbackRate);
+
+				if((deadline < 0) || (frameDeadline < deadline))
+					deadline = frameDeadline;
 			}
+
+			return((deadline >= 0) ? deadline : startPlayingTime);
 		}
 
-		void SequenceReading::outputIRFrame(bool force) {
-			if ((onIRImageFrameOutput != NULL) && !sequence->getIRFramesList().empty()) {
-				try {
-					irFramesBuffer_mutex.lock();
-					kocca::datalib::TimeCodedFrame outputFrame = irFramesBuffer.getFrameAtTime(playHeadPosition);
-					irFramesBuffer_mutex.unlock();
+		int SequenceReading::getFrameRankAtTime(PlaybackStreamType stream, long long time) {
+			const std::vector<kocca::datalib::FramePath>& framesList = framesLists[stream];
+
+			if(framesList.empty())
+				return(-1);
+
+			// the last frame not after time
+			int first = kocca::datalib::FramePath::getFirstFrameRank(framesList, time, true);
+			return((first > 0) ? (first - 1) : 0);
+		}
+
+		bool SequenceReading::isInPrefetchWindow(PlaybackStreamType stream, int rank) {
+			int stride = getFrameStride(stream);
+			int shownFrameRank = getShownFrameRank(stream, stride);
+
+			if(rank == shownFrameRank)
+				return(true);
+
+			if((rank % stride) != 0)
+				return(false);
+
+			// the window leads in the direction of the playback, and trails a little behind the playhead, so stepping back doesn't decode the frames again
+			long long frameTime = framesLists[stream].at(rank).time;
+			long long horizon = computePrefetchHorizon();
+			long long trailingHorizon = (long long)(horizon * TRAILING_WINDOW_RATIO);
+
+			if(playbackRate >= 0)
+				return((rank > shownFrameRank) ? (frameTime <= (playHeadPosition + horizon)) : (frameTime >= (playHeadPosition - trailingHorizon)));
+			else
+				return((rank < shownFrameRank) ? (frameTime >= (playHeadPosition - horizon)) : (frameTime <= (playHeadPosition + trailingHorizon)));
+		}
+
+		bool SequenceReading::isLateFrame(PlaybackStreamType stream, int rank, int stride) {
+			long long decodedPosition = (long long)(meanDecodingTimes[stream] * playbackRate);
+
+			// forwards, a frame is left when the next one is due ; backwards, when the playhead goes before it
+			if(playbackRate >= 0) {
+				int nextRank = getNextShownFrameRank(stream, rank, stride);
+				return((nextRank < framesLists[stream].size()) && (framesLists[stream].at(nextRank).time <= (playHeadPosition + decodedPosition)));
+			}
+			else
+				return(framesLists[stream].at(rank).time > (playHeadPosition + decodedPosition));
+		}
+
+		bool SequenceReading::pickNextFrame(PlaybackStreamType& stream, int& rank) {
+			long long nearestDistance = -1;
+			unsigned long long usedSize = 0;
+
+			for(int i = 0; i < PLAYBACK_STREAMS_COUNT; i++)
+				usedSize += buffersUsedSizes[i] + (unsigned long long)(decodingFrames[i].size() * meanFrameSizes[i]);
+
+			if(usedSize >= buffersMaxSize)
+				return(false);
+
+			for(int i = 0; i < PLAYBACK_STREAMS_COUNT; i++) {
+				if(framesLists[i].empty())
+					continue;
+
+				int stride = getFrameStride((PlaybackStreamType)i);
+				int shownFrameRank = getShownFrameRank((PlaybackStreamType)i, stride);
+
+				// the first frame of the window that is neither decoded nor being decoded, searched in the direction of the playback, then the other way while not playing (the frames behind the playhead won't be shown while playing)
+				for(int direction = 0; direction < (playing ? 1 : 2); direction++) {
+					bool isForwards = ((playbackRate >= 0) == (direction == 0));
+
+					for(int j = shownFrameRank; (j >= 0) && (j < framesLists[i].size()) && isInPrefetchWindow((PlaybackStreamType)i, j); j = isForwards ? getNextShownFrameRank((PlaybackStreamType)i, j, stride) : getPreviousShownFrameRank(j, stride)) {
+						if((decodedFrames[i].count(j) == 0) && (decodingFrames[i].count(j) == 0)) {
+							// a frame that would be decoded after it is due to be replaced would never be shown
+							if(playing && isLateFrame((PlaybackStreamType)i, j, stride)) {
+								if((lastSkippedFrameRanks[i] < 0) || ((playbackRate >= 0) ? (j > lastSkippedFrameRanks[i]) : (j < lastSkippedFrameRanks[i]))) {
+									skippedFramesCounts[i]++;
+									lastSkippedFrameRanks[i] = j;
+								}
+
+								continue;
+							}
+
+							long long distance = framesLists[i].at(j).time - playHeadPosition;
+
+							if(distance < 0)
+								distance = -distance;
+
+							if((nearestDistance < 0) || (distance < nearestDistance)) {
+								nearestDistance = distance;
+								stream = (PlaybackStreamType)i;
+								rank = j;
+							}
+
+							break;
+						}
+					}
+				}
+			}
 
-					if (force || (outputFrame.time != lastOutputIRFrameTime)) {
-						onIRImageFrameOutput(outputFrame);
-						lastOutputIRFrameTime = outputFrame.time;
+			return(nearestDistance >= 0);
+		}
+
+		void SequenceReading::purgeDecodedFrames() {
+			for(int i = 0; i < PLAYBACK_STREAMS_COUNT; i++) {
+				std::map<int, kocca::datalib::TimeCodedFrame>::iterator it = decodedFrames[i].begin();
+
+				while(it != decodedFrames[i].end()) {
+					if(isInPrefetchWindow((PlaybackStreamType)i, it->first))
+						++it;
+					else {
+						buffersUsedSizes[i] -= it->second.frame.total() * it->second.frame.elemSize();
+						it = decodedFrames[i].erase(it);
 					}
 				}
-				catch (FrameNotInBufferException& e) {
-					irFramesBuffer_mutex.unlock();
-					kocca::datalib::TimeCodedFrame outputFrame = sequence->getIRFrameByTime(playHeadPosition);
-					onIRImageFrameOutput(outputFrame);
+			}
+		}
+
+		void SequenceReading::addDecodedFrame(PlaybackStreamType stream, int rank, const kocca::datalib::TimeCodedFrame& tcFrame) {
+			unsigned long long frameSize = tcFrame.frame.total() * tcFrame.frame.elemSize();
+			decodedFrames[stream][rank] = tcFrame;
+			buffersUsedSizes[stream] += frameSize;
+
+			if(frameSize > 0)
+				meanFrameSizes[stream] = (meanFrameSizes[stream] > 0) ? ((meanFrameSizes[stream] * 0.9) + (frameSize * 0.1)) : frameSize;
+
+			unsigned long long usedSize = 0;
+
+			for(int i = 0; i < PLAYBACK_STREAMS_COUNT; i++)
+				usedSize += buffersUsedSizes[i];
+
+			if(usedSize > peakBuffersUsedSize)
+				peakBuffersUsedSize = usedSize;
+		}
+
+		kocca::datalib::TimeCodedFrame SequenceReading::decodeFrame(PlaybackStreamType stream, const kocca::datalib::FramePath& framePath) {
+			kocca::datalib::TimeCodedFrame tcFrame;
+			tcFrame.time = framePath.time;
+			int reduction = decodingReductions[stream];
+
+			if(stream == PLAYBACK_STREAM_COLOR) {
+				// libjpeg scales the frame down in the DCT domain, skipping most of the decoding work
+				int imreadFlags = cv::IMREAD_ANYCOLOR;
+
+				if(reduction == 2)
+					imreadFlags = cv::IMREAD_REDUCED_COLOR_2;
+				else if(reduction == 4)
+					imreadFlags = cv::IMREAD_REDUCED_COLOR_4;
+				else if(reduction == 8)
+					imreadFlags = cv::IMREAD_REDUCED_COLOR_8;
+
+				cv::Mat cvFrame = sequence->readImageFrame(framePath, imreadFlags);
+				cv::cvtColor(cvFrame, cvFrame, CV_BGRA2RGB);
+				tcFrame.frame = cvFrame;
+				tcFrame.downscale = reduction;
+			}
+			else if(stream == PLAYBACK_STREAM_INFRARED)
+				tcFrame.frame = sequence->readIRFrame(framePath, true);
+			else
+				tcFrame.frame = sequence->readImageFrame(framePath, CV_LOAD_IMAGE_ANYDEPTH);
+
+			// the recorded size of the frames is known once one is decoded at full resolution
+			if((reduction == 1) && !tcFrame.frame.empty()) {
+				prefetch_mutex.lock();
+
+				if(frameSizes[stream].width == 0) {
+					frameSizes[stream] = cv::Size(tcFrame.frame.cols, tcFrame.frame.rows);
+					updateDecodingReduction(stream);
 				}
+
+				prefetch_mutex.unlock();
 			}
+
+			return(tcFrame);
 		}
 
-		void SequenceReading::outputDepthFrame(bool force) {
-			if((onDepthFrameOutput != NULL) && !sequence->getDepthFramesList().empty()) {
-				try {
-					depthFramesBuffer_mutex.lock();
-					kocca::datalib::TimeCodedFrame outputFrame = depthFramesBuffer.getFrameAtTime(playHeadPosition);
-					depthFramesBuffer_mutex.unlock();
+		bool SequenceReading::getFrameToOutput(PlaybackStreamType stream, bool force, kocca::datalib::TimeCodedFrame& tcFrame) {
+			prefetch_mutex.lock();
+			int rank = getFrameRankAtTime(stream, playHeadPosition);
+
+			if((rank < 0) || (!force && (framesLists[stream].at(rank).time == lastOutputFrameTimes[stream]))) {
+				prefetch_mutex.unlock();
+				return(false);
+			}
+
+			std::map<int, kocca::datalib::TimeCodedFrame>::iterator it = decodedFrames[stream].find(rank);
+			bool isPrefetched = (it != decodedFrames[stream].end());
 
-					if(force || (outputFrame.time != lastOutputDepthFrameTime)) {
-						onDepthFrameOutput(outputFrame);
-						lastOutputDepthFrameTime = outputFrame.time;
+			if(isPrefetched)
+				tcFrame = it->second;
+
+			kocca::datalib::FramePath framePath = framesLists[stream].at(rank);
+			bool isPlaying = playing;
+			proxyIsOutput[stream] = false;
+			prefetch_mutex.unlock();
+
+			// the frame isn't prefetched yet (ex : right after a seek), it is decoded right away unless it was recently
+			if(!isPrefetched && (!frameCache->get(stream, rank, tcFrame) || !hasDecodingResolution(stream, tcFrame))) {
+				tcFrame.frame.release();
+				tcFrame.downscale = 1;
+
+				if(isPlaying) {
+					// decoding it now would hold the playback up : the latest prefetched frame before it is shown instead, unless it already is, or unless it is still to come when playing backwards
+					prefetch_mutex.lock();
+					int oldestFrameRank = (playbackRate >= 0) ? 0 : getShownFrameRank(stream, getFrameStride(stream));
+					std::map<int, kocca::datalib::TimeCodedFrame>::iterator previousIt = decodedFrames[stream].upper_bound(rank);
+					bool hasPreviousFrame = (previousIt != decodedFrames[stream].begin());
+
+					if(hasPreviousFrame) {
+						--previousIt;
+						hasPreviousFrame = (previousIt->first >= oldestFrameRank) && (previousIt->second.time != lastOutputFrameTimes[stream]);
+
+						if(hasPreviousFrame)
+							tcFrame = previousIt->second;
 					}
+
+					prefetch_mutex.unlock();
+
+					if(!hasPreviousFrame)
+						return(false);
 				}
-				catch(FrameNotInBufferException& e) {
-					depthFramesBuffer_mutex.unlock();
-					kocca::datalib::TimeCodedFrame outputFrame = sequence->getDepthFrameByTime(playHeadPosition);
-					onDepthFrameOutput(outputFrame);
+				else {
+					// while scrubbing, the proxy is shown until the decoding threads get to the frame
+					if((proxies != NULL) && proxies->isAvailable(kocca::datalib::Sequence::STREAM_FOLDER_NAMES[stream])) {
+						try {
+							tcFrame.time = framePath.time;
+							tcFrame.frame = proxies->getProxy(kocca::datalib::Sequence::STREAM_FOLDER_NAMES[stream], rank);
+
+							prefetch_mutex.lock();
+
+							if(!tcFrame.frame.empty() && (frameSizes[stream].width > 0))
+								tcFrame.downscale = (double)frameSizes[stream].width / tcFrame.frame.cols;
+
+							prefetch_mutex.unlock();
+						}
+						catch(std::exception& e) {
+							std::cerr << e.what() << std::endl;
+						}
+					}
+
+					if(tcFrame.frame.empty()) {
+						// the frame would be replaced by those of the next seek right away
+						if(seekIsPending)
+							return(false);
+
+						tcFrame = decodeFrame(stream, framePath);
+						frameCache->put(stream, rank, tcFrame);
+					}
+					else {
+						prefetch_mutex.lock();
+
+						// a decoding thread may have got to the frame while the proxy was read : the decoded frame is output instead, as it wouldn't replace the proxy anymore
+						std::map<int, kocca::datalib::TimeCodedFrame>::iterator decodedIt = decodedFrames[stream].find(rank);
+
+						if(decodedIt != decodedFrames[stream].end())
+							tcFrame = decodedIt->second;
+						else
+							proxyIsOutput[stream] = true;
+
+						prefetch_mutex.unlock();
+					}
 				}
 			}
+
+			if(isPlaying) {
+				prefetch_mutex.lock();
+				outputFramesCounts[stream]++;
+				prefetch_mutex.unlock();
+			}
+
+			lastOutputFrameTimes[stream] = tcFrame.time;
+			return(true);
+		}
+
+		void SequenceReading::callFrameOutput(PlaybackStreamType stream, kocca::datalib::TimeCodedFrame& tcFrame) {
+			if((stream == PLAYBACK_STREAM_COLOR) && (onColorImageFrameOutput != NULL))
+				onColorImageFrameOutput(tcFrame);
+			else if((stream == PLAYBACK_STREAM_INFRARED) && (onIRImageFrameOutput != NULL))
+				onIRImageFrameOutput(tcFrame);
+			else if((stream == PLAYBACK_STREAM_DEPTH) && (onDepthFrameOutput != NULL))
+				onDepthFrameOutput(tcFrame);
+		}
+
+		void SequenceReading::outputImageFrame(bool force) {
+			kocca::datalib::TimeCodedFrame outputFrame;
+
+			if((onColorImageFrameOutput != NULL) && getFrameToOutput(PLAYBACK_STREAM_COLOR, force, outputFrame))
+				onColorImageFrameOutput(outputFrame);
+		}
+
+		void SequenceReading::outputIRFrame(bool force) {
+			kocca::datalib::TimeCodedFrame outputFrame;
+
+			if((onIRImageFrameOutput != NULL) && getFrameToOutput(PLAYBACK_STREAM_INFRARED, force, outputFrame))
+				onIRImageFrameOutput(outputFrame);
+		}
+
+		void SequenceReading::outputDepthFrame(bool force) {
+			kocca::datalib::TimeCodedFrame outputFrame;
+
+			if((onDepthFrameOutput != NULL) && getFrameToOutput(PLAYBACK_STREAM_DEPTH, force, outputFrame))
+				onDepthFrameOutput(outputFrame);
 		}
 
 		void SequenceReading::outputMarkersFrame() {
@@ -237,28 +910,29 @@ namespace kocca {
 		}
 
 		void SequenceReading::updatePlayHeadPosition() {
-			imageFramesBuffer_mutex.lock();
-			irFramesBuffer_mutex.lock();
-			depthFramesBuffer_mutex.lock();
+			prefetch_mutex.lock();
 
 			bool hasReachedEnd = false;
 
-			playHeadPosition = startPlayingPosition + (getMSTime() - startPlayingTime);
+			playHeadPosition = startPlayingPosition + (long long)(((long long)getUSTime() - startPlayingTime) * playbackRate);
 
-			if(playHeadPosition > sequence->getDuration()) {
+			if(playHeadPosition > (long long)sequence->getDuration()) {
 				playHeadPosition = sequence->getDuration();
-				stop();
+				playing = false;
+				hasReachedEnd = true;
+			}
+			else if(playHeadPosition < 0) {
+				// playing backwards, the playhead has reached the begining
+				playHeadPosition = 0;
+				playing = false;
 				hasReachedEnd = true;
 			}
-	
-			imageFramesBuffer.purgeBefore(playHeadPosition);
-			imageFramesBuffer_mutex.unlock();
 
-			irFramesBuffer.purgeBefore(playHeadPosition);
-			irFramesBuffer_mutex.unlock();
+			purgeDecodedFrames();
+			prefetch_mutex.unlock();
 
-			depthFramesBuffer.purgeBefore(playHeadPosition);
-			depthFramesBuffer_mutex.unlock();
+			// the frames that left the window made room for new ones
+			prefetch_condition.notify_all();
 
 			if(hasReachedEnd && (onStopAtTheEnd != NULL))
 				onStopAtTheEnd();
@@ -272,165 +946,158 @@ namespace kocca {
 		}
 
 		void SequenceReading::stopBuffering() {
+			prefetch_mutex.lock();
 			bufferingIsActive = false;
+			prefetch_mutex.unlock();
+
+			prefetch_condition.notify_all();
+
+			for(int i = 0; i < decodingThreads.size(); i++) {
+				if(decodingThreads.at(i)->joinable())
+					decodingThreads.at(i)->join();
+			}
 
-			if((imageFramesBufferingThread != NULL) && (imageFramesBufferingThread->joinable()))
-				imageFramesBufferingThread->join();
+			if((proxiesGenerationThread != NULL) && proxiesGenerationThread->joinable())
+				proxiesGenerationThread->join();
 
-			if ((irFramesBufferingThread != NULL) && (irFramesBufferingThread->joinable()))
-				irFramesBufferingThread->join();
+			seeking_mutex.lock();
+			seekingIsActive = false;
+			seeking_mutex.unlock();
 
-			if((depthFramesBufferingThread != NULL) && (depthFramesBufferingThread->joinable()))
-				depthFramesBufferingThread->join();
+			seeking_condition.notify_all();
+
+			if((seekingThread != NULL) && seekingThread->joinable())
+				seekingThread->join();
 		}
 
 		SequenceReading::~SequenceReading() {
 			stop();
 			stopBuffering();
-		}
 
-		void SequenceReading::updateBufferEndingPoint() {
-			if(onUpdateBufferEndingPoint != NULL) {
-				unsigned long long int bufferEndingPoint = 0;
+			for(int i = 0; i < decodingThreads.size(); i++)
+				delete decodingThreads.at(i);
 
-				imageFramesBuffer_mutex.lock();
-				irFramesBuffer_mutex.lock();
-				depthFramesBuffer_mutex.lock();
+			if(logsStatistics) {
+				std::cout << "Playback buffers : peak of " << (peakBuffersUsedSize / 1000000) << " MB used out of " << (buffersMaxSize / 1000000) << " MB, " << (computePrefetchHorizon() / 1000) << " ms prefetched" << std::endl;
+				std::cout << "Frames cache : " << (int)(frameCache->getHitRate() * 100) << "% hits (" << frameCache->getHitsCount() << " out of " << (frameCache->getHitsCount() + frameCache->getMissesCount()) << " lookups), "
+					<< (frameCache->getUsedSize() / 1000000) << " MB used out of " << (frameCache->getMaxSize() / 1000000) << " MB" << std::endl;
 
-				if((imageFramesBuffer.size() > 0) && (irFramesBuffer.size() > 0) && (depthFramesBuffer.size() > 0)) {
-					std::vector<unsigned long long> buffersEndingPoints;
-					buffersEndingPoints.push_back(imageFramesBuffer.back().time);
-					buffersEndingPoints.push_back(irFramesBuffer.back().time);
-					buffersEndingPoints.push_back(depthFramesBuffer.back().time);
-					std::sort(buffersEndingPoints.begin(), buffersEndingPoints.end());
-					bufferEndingPoint = buffersEndingPoints.back();
-				}
+				if(requestedSeeksCount > 0)
+					std::cout << "Seeking : " << requestedSeeksCount << " seeks requested, " << supersededSeeksCount << " superseded, " << (unsigned long long)(meanSeekLatency / 1000) << " ms mean and "
+						<< (maxSeekLatency / 1000) << " ms max from request to display" << std::endl;
+			}
 
-				imageFramesBuffer_mutex.unlock();
-				irFramesBuffer_mutex.unlock();
-				depthFramesBuffer_mutex.unlock();
+			if(seekingThread != NULL)
+				delete seekingThread;
 
-				onUpdateBufferEndingPoint(bufferEndingPoint);
-			}
+			delete frameCache;
+
+			if(proxiesGenerationThread != NULL)
+				delete proxiesGenerationThread;
+
+			if(proxies != NULL)
+				delete proxies;
 		}
 
-		/**
-		 * @throws InvalidSequenceRankException
-		 * @throws EmptySequenceStreamException
-		 */
-		void SequenceReading::imageBufferingLoop() {
-			while(bufferingIsActive) {
-				if(imageFramesBuffer_mutex.try_lock()) {
-					if((sequence->getImageFramesCount() > 0) && (imageFramesBuffer.size() < framesBufferMaxSize)) {
-						kocca::datalib::FramePath nextFramePath;
+		unsigned long long SequenceReading::getBufferEndingPoint() {
+			unsigned long long bufferEndingPoint = 0;
+			bool hasEndingPoint = false;
 
-						if(imageFramesBuffer.size() > 0) {
-							long long lastBufferedFrameTime = imageFramesBuffer.at(imageFramesBuffer.size() - 1).time;
+			// the streams are buffered up to their first frame that isn't decoded yet, and the slowest one sets the ending point
+			for(int i = 0; i < PLAYBACK_STREAMS_COUNT; i++) {
+				int rank = getFrameRankAtTime((PlaybackStreamType)i, playHeadPosition);
 
-							if(playHeadPosition > lastBufferedFrameTime)
-								lastBufferedFrameTime = playHeadPosition;
+				if(rank < 0)
+					continue;
 
-							int nextFrameRank = sequence->getImageFrameRank(lastBufferedFrameTime) + 1;
-				
-							if(nextFrameRank < sequence->getImageFramesCount())
-								nextFramePath = sequence->getImageFramePathByRank(nextFrameRank);
-						}
-						else
-							nextFramePath = sequence->getImageFramePathByTime(playHeadPosition);
-
-						if(!nextFramePath.path.empty()) {
-							kocca::datalib::TimeCodedFrame nextTimeCodedFrame;
-							nextTimeCodedFrame.time = nextFramePath.time;
-							cv::Mat cvFrame = cv::imread(nextFramePath.path, cv::IMREAD_ANYCOLOR);
-							cv::cvtColor(cvFrame, cvFrame, CV_BGRA2RGB);
-							nextTimeCodedFrame.frame = cvFrame;
-							imageFramesBuffer.push_back(nextTimeCodedFrame);
-						}
-					}
+				unsigned long long streamEndingPoint = playHeadPosition;
 
-					imageFramesBuffer_mutex.unlock();
+				for(; (rank < framesLists[i].size()) && (decodedFrames[i].count(rank) > 0); rank++)
+					streamEndingPoint = framesLists[i].at(rank).time;
 
-					if (onUpdateBufferEndingPoint != NULL)
-						updateBufferEndingPoint();
+				if(!hasEndingPoint || (streamEndingPoint < bufferEndingPoint)) {
+					bufferEndingPoint = streamEndingPoint;
+					hasEndingPoint = true;
 				}
-				
-				std::this_thread::sleep_for(std::chrono::milliseconds(10));
 			}
+
+			return(bufferEndingPoint);
 		}
 
-		/**
-		* @throws InvalidSequenceRankException
-		* @throws EmptySequenceStreamException
-		*/
-		void SequenceReading::irBufferingLoop() {
-			while (bufferingIsActive) {
-				if (irFramesBuffer_mutex.try_lock()) {
-					if ((sequence->getIRFramesCount() > 0) && (irFramesBuffer.size() < framesBufferMaxSize)) {
-						kocca::datalib::FramePath nextFramePath;
+		void SequenceReading::proxiesGenerationLoop() {
+			try {
+				unsigned long long startTime = getMSTime();
+				proxies->generate(bufferingIsActive);
 
-						if (irFramesBuffer.size() > 0) {
-							long long lastBufferedFrameTime = irFramesBuffer.at(irFramesBuffer.size() - 1).time;
+				if(bufferingIsActive && logsStatistics)
+					std::cout << "Proxies : available after " << (getMSTime() - startTime) << " ms" << std::endl;
+			}
+			catch(std::exception& e) {
+				std::cerr << "Proxies generation failed : " << e.what() << std::endl;
+			}
+		}
 
-							if (playHeadPosition > lastBufferedFrameTime)
-								lastBufferedFrameTime = playHeadPosition;
+		void SequenceReading::decodingThreadLoop() {
+			std::unique_lock<std::mutex> lock(prefetch_mutex);
 
-							int nextFrameRank = sequence->getIRFrameRank(lastBufferedFrameTime) + 1;
+			while(bufferingIsActive) {
+				PlaybackStreamType stream;
+				int rank;
 
-							if (nextFrameRank < sequence->getIRFramesCount())
-								nextFramePath = sequence->getIRFramePathByRank(nextFrameRank);
-						}
-						else
-							nextFramePath = sequence->getIRFramePathByTime(playHeadPosition);
+				if(!pickNextFrame(stream, rank)) {
+					// the window is full : nothing to do until the playhead moves
+					prefetch_condition.wait(lock);
+					continue;
+				}
 
-						if (!nextFramePath.path.empty()) {
-							kocca::datalib::TimeCodedFrame nextTimeCodedFrame;
-							nextTimeCodedFrame.time = nextFramePath.time;
-							nextTimeCodedFrame.frame = cv::imread(nextFramePath.path, cv::IMREAD_GRAYSCALE);
-							irFramesBuffer.push_back(nextTimeCodedFrame);
-						}
+				kocca::datalib::TimeCodedFrame tcFrame;
+
+				// the frames seen before a seek, or behind the playhead, are taken from the cache, unless they were decoded for a smaller widget
+				if(!frameCache->get(stream, rank, tcFrame) || !hasDecodingResolution(stream, tcFrame)) {
+					decodingFrames[stream].insert(rank);
+					kocca::datalib::FramePath framePath = framesLists[stream].at(rank);
+					lock.unlock();
+					unsigned long long decodingStartTime = getUSTime();
+
+					try {
+						tcFrame = decodeFrame(stream, framePath);
+					}
+					catch(std::exception& e) {
+						// the frame is kept empty, so it isn't decoded again and again
+						std::cerr << "Unable to decode frame " << framePath.path << " : " << e.what() << std::endl;
+						tcFrame.time = framePath.time;
 					}
 
-					irFramesBuffer_mutex.unlock();
+					double decodingTime = (double)(getUSTime() - decodingStartTime);
+					frameCache->put(stream, rank, tcFrame);
 
-					if (onUpdateBufferEndingPoint != NULL)
-						updateBufferEndingPoint();
+					lock.lock();
+					decodingFrames[stream].erase(rank);
+					meanDecodingTimes[stream] = (meanDecodingTimes[stream] > 0) ? ((meanDecodingTimes[stream] * 0.9) + (decodingTime * 0.1)) : decodingTime;
 				}
 
-				std::this_thread::sleep_for(std::chrono::milliseconds(10));
-			}
-		}
+				// the decoding reduction may have been lowered while the frame was decoded : it is dropped, to be decoded again at the new one
+				if(!hasDecodingResolution(stream, tcFrame))
+					continue;
 
-		void SequenceReading::depthBufferingLoop() {
-			while(bufferingIsActive) {
-				if(depthFramesBuffer_mutex.try_lock()) {
-					if((sequence->getDepthFramesCount() > 0) && (depthFramesBuffer.size() < framesBufferMaxSize)) {
-						kocca::datalib::FramePath nextFramePath;
-			
-						if(depthFramesBuffer.size() > 0) {
-							long long lastBufferedFrameTime = depthFramesBuffer.at(depthFramesBuffer.size() - 1).time;
-							int nextFrameRank = sequence->getDepthFrameRank(lastBufferedFrameTime) + 1;
-				
-							if(nextFrameRank < sequence->getDepthFramesCount())
-								nextFramePath = sequence->getDepthFramePathByRank(nextFrameRank);
-						}
-						else
-							nextFramePath = sequence->getDepthFramePathByTime(playHeadPosition);
+				// the playhead may have moved away while the frame was decoded
+				if(isInPrefetchWindow(stream, rank))
+					addDecodedFrame(stream, rank, tcFrame);
 
-						if(!nextFramePath.path.empty()) {
-							kocca::datalib::TimeCodedFrame nextTimeCodedFrame;
-							nextTimeCodedFrame.time = nextFramePath.time;
-							nextTimeCodedFrame.frame = cv::imread(nextFramePath.path, CV_LOAD_IMAGE_ANYDEPTH);
-							depthFramesBuffer.push_back(nextTimeCodedFrame);
-						}
-					}
-		
-					depthFramesBuffer_mutex.unlock();
+				// the proxy shown while scrubbing is replaced as soon as the playhead settles long enough for its frame to be decoded
+				if(proxyIsOutput[stream] && (rank == getFrameRankAtTime(stream, playHeadPosition))) {
+					proxyIsOutput[stream] = false;
+					lock.unlock();
+					callFrameOutput(stream, tcFrame);
+					lock.lock();
+				}
 
-					if(onUpdateBufferEndingPoint != NULL)
-						updateBufferEndingPoint();
+				if(onUpdateBufferEndingPoint != NULL) {
+					unsigned long long bufferEndingPoint = getBufferEndingPoint();
+					lock.unlock();
+					onUpdateBufferEndingPoint(bufferEndingPoint);
+					lock.lock();
 				}
-				
-				std::this_thread::sleep_for(std::chrono::milliseconds(10));
 			}
 		}
 	} // namespace operations
@@ -4,10 +4,16 @@
 #include <mutex>
 #include <thread>
 #include <atomic>
+#include <condition_variable>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "Operation.h"
 #include "../datalib/Sequence.h"
-#include "TimeCodedFrameBuffer.h"
+#include "../datalib/SequenceProxies.h"
+#include "DecodedFrameCache.h"
 
 namespace kocca {
 	namespace operations {
@@ -22,10 +28,11 @@ namespace kocca {
 			 * Constructor.
 			 * @param _sequence a pointer to the sequence object we want to read
 			 * @param _refreshPeriod The time (in milliseconds) of pause between each data output during playing. Note that modifying this setting won't affect the sequence duration nor it's playing speed : it's only a balance between fluidity and resource consumption.
-			 * @param maxBuffersSize The maximum size (in Mega octets) of reading buffer for each image stream. Setting this too low might cause lags if the hard drive brandwidth is insufficient, setting it too high will increase memory usage. 
+			 * @param maxBuffersSize The maximum size (in Mega octets) of the reading buffers of all the image streams together, unless the "playback.buffers_size" setting overrides it. It is shared by the streams in proportion to their bytes per second, so they are all buffered up to the same time. Setting this too low might cause lags if the hard drive brandwidth is insufficient, setting it too high will increase memory usage.
+			 * The number of decoding threads, the duration of the look-ahead window, the budget of the decoded frames cache and the initial playback rate are read from the "playback.decoding_threads", "playback.lookahead_time", "playback.cache_size" and "playback.rate" settings. Unless the "playback.proxies" setting is false, the proxies of the sequence are generated in the background (see SequenceProxies).
 			 * @throws EmptySequenceException if the sequence object contains no readable data
 			 */
-			SequenceReading(kocca::datalib::Sequence* _sequence, int _refreshPeriod = 30, int maxBuffersSize = 100);
+			SequenceReading(kocca::datalib::Sequence* _sequence, int _refreshPeriod = 30, int maxBuffersSize = 1000);
 
 			/**
 			 * Processes an image frame of the depth stream, through the operation.
@@ -56,16 +63,32 @@ namespace kocca {
 			bool processMarkersFrame(kocca::datalib::MocapMarkerFrame markerFrame);
 
 			/**
-			 * Gets the position of the playhead, in milliseconds within the sequence time.
+			 * Gets the position of the playhead, in microseconds within the sequence time.
 			 */
 			unsigned long long getPlayHeadPosition();
 
 			/**
 			 * Sets the position of the playhead.
-			 * @param position the new position of the playhead, in milliseconds within the sequence time.
+			 * @param position the new position of the playhead, in microseconds within the sequence time.
 			 */
 			bool setPlayHeadPosition(unsigned long long position);
 
+			/**
+			 * Requests the playhead to be moved, without waiting for the frames at the new position to be decoded and output : it is moved by the seekingThread, one seek at a time, and the seeks requested meanwhile are coalesced, only the latest one being carried out. The frames of a seek that is superseded before they are decoded aren't decoded at all. Meant for the time slider, that requests a seek at each move of its cursor.
+			 * @param position the new position of the playhead, in microseconds within the sequence time.
+			 */
+			void seek(unsigned long long position);
+
+			/**
+			 * Gets the time it took for the frames of the latest seek carried out (see seek()) to be output, from the time it was requested, in microseconds.
+			 */
+			unsigned long long getLastSeekLatency();
+
+			/**
+			 * Gets the mean time it took for the frames of the seeks carried out (see seek()) to be output, from the time they were requested, in microseconds.
+			 */
+			double getMeanSeekLatency();
+
 			/**
 			 * Moves the playhead to the time of the last frame (either an infrared, RGB, depth image frame or a MoCap markers frame) found before it's current position.
 			 */
@@ -106,6 +129,59 @@ namespace kocca {
 			 */
 			int getRefreshPeriod();
 
+			/**
+			 * Sets the playback rate, that can be changed while playing : the playhead goes on from its current position at the new rate.
+			 * Above 1, the frames of a stream that can't be shown within the refresh period are neither decoded nor shown. Below 1, each frame is shown for longer, down to frame by frame slow motion.
+			 * A negative rate plays the sequence backwards, the frames before the playhead being prefetched instead of those after it.
+			 * @param rate the duration of the sequence played per second, in seconds : 1 plays in real time, 0.5 at half speed, 2 at double speed, -1 backwards in real time... Its absolute value is clamped from 0.1 to 16.
+			 */
+			void setPlaybackRate(double rate);
+
+			/**
+			 * Sets the playback rate to the next step of a fixed ladder (0.125, 0.25, 0.5, 1, 2, 4, 8, 16), keeping its direction, so stepping back and forth always goes through real time.
+			 * @param faster true to step to the next faster rate, false to the next slower one
+			 */
+			void stepPlaybackRate(bool faster);
+
+			/**
+			 * Gets the playback rate, see setPlaybackRate().
+			 */
+			double getPlaybackRate();
+
+			/**
+			 * Sets the size of the largest widget the frames of an image stream are displayed in, so they aren't decoded larger than needed : the color frames, which are JPEG, are decoded at 1/2, 1/4 or 1/8 of their resolution, straight in the DCT domain, as long as they still fill the widget. The infrared and depth frames, that are much smaller and whose formats can't be decoded at a reduced scale, are always decoded at full resolution.
+			 * When the widget grows, the frames decoded at a lower resolution than it now needs are decoded again.
+			 * @param stream the stream
+			 * @param width the width of the widget, in pixels, or 0 to decode the frames at full resolution
+			 * @param height the height of the widget, in pixels
+			 */
+			void setDisplaySize(PlaybackStreamType stream, int width, int height);
+
+			/**
+			 * Gets the factor (1, 2, 4 or 8) the frames of an image stream are downscaled by when they are decoded, see setDisplaySize().
+			 * @param stream the stream
+			 */
+			int getDecodingReduction(PlaybackStreamType stream);
+
+			/**
+			 * Gets the number of frames per second of an image stream that should be shown while playing at the current playback rate : its frame rate times the playback rate, divided by the frame stride (see getFrameStride()).
+			 * @param stream the stream
+			 */
+			double getRequestedFrameRate(PlaybackStreamType stream);
+
+			/**
+			 * Gets the number of frames per second of an image stream that have actually been shown since the playing started, or since the playback rate last changed.
+			 * @param stream the stream
+			 */
+			double getRealizedFrameRate(PlaybackStreamType stream);
+
+			/**
+			 * Gets the performance of the playback, as displayed next to the frame time of the monitored stream : the frames per second of the stream shown out of the ones requested, while playing, the hit rate of the frames cache, once it has been looked up, the memory used by the prefetched frames out of the buffers budget and, once a seek has been carried out, the latency of the latest one and the mean one (see seek()).
+			 * @param stream the monitored stream
+			 * @return the status, or an empty string if there's nothing to report
+			 */
+			std::string getPlaybackStatus(PlaybackStreamType stream);
+
 			/**
 			 * Outputs the depth image frame corresponding to the current position of the playhead.
 			 * @param force Forces the ouptut of the frame, even if it has already been output.
@@ -135,19 +211,45 @@ namespace kocca {
 			kocca::datalib::Sequence* getSequence();
 
 			/**
-			 * Implementation for the imageFramesBufferingThread thread. It loads into memory the content of upcoming (=after current playhead position) color image frames.
+			 * Returns a pointer to the cache of the recently decoded frames, to get its hit rate.
+			 */
+			DecodedFrameCache* getFrameCache();
+
+			/**
+			 * Gets the size of the prefetched frames of all the image streams, in bytes.
+			 */
+			unsigned long long getBuffersUsedSize();
+
+			/**
+			 * Gets the size of the prefetched frames of an image stream, in bytes.
+			 * @param stream the stream
+			 */
+			unsigned long long getBuffersUsedSize(PlaybackStreamType stream);
+
+			/**
+			 * Gets the maximum size of the prefetched frames of all the image streams, in bytes.
+			 */
+			unsigned long long getBuffersMaxSize();
+
+			/**
+			 * Gets the time, in microseconds within the sequence's time, the image streams are prefetched up to ahead of the playhead, in the direction of the playback : the look-ahead window times the playback rate, shortened so the streams fit in the buffers budget.
+			 */
+			long long getPrefetchHorizon();
+
+			/**
+			 * Implementation for the decodingThreads threads. Each one decodes the frame picked by pickNextFrame() (unless it is in the frameCache), and waits for the playhead to move when there's none.
 			 */
-			void imageBufferingLoop();
+			void decodingThreadLoop();
 
 			/**
-			 * Implementation for the irFramesBufferingThread thread. It loads into memory the content of upcoming (=after current playhead position) infrared image frames.
+			 * Implementation for the proxiesGenerationThread thread. It opens the proxies of the sequence, generating them first if needed.
 			 */
-			void irBufferingLoop();
+			void proxiesGenerationLoop();
 
 			/**
-			 * Implementation for the depthFramesBufferingThread thread. It loads into memory the content of upcoming (=after current playhead position) depth image frames.
+			 * Implementation for the seekingThread thread. It moves the playhead to the latest position requested by seek(), and waits for the next request.
 			 */
-			void depthBufferingLoop();
+			void seekingLoop();
 
 			/**
 			 * Updates the position of the playhead.
@@ -161,7 +263,7 @@ namespace kocca {
 
 			/**
 			 * Callback function called every time the playhead's position changes, to notify it to other objects.
-			 * @param position the new position of the playhead, in milliseconds.
+			 * @param position the new position of the playhead, in microseconds.
 			 */
 			void (*onChangePlayheadPosition)(unsigned long long position);
 
@@ -215,77 +317,263 @@ namespace kocca {
 			std::atomic<bool> bufferingIsActive;
 
 			/**
-			 * The current position of the playhead, in milliseconds within the sequence's time.
+			 * The current position of the playhead, in microseconds within the sequence's time.
 			 * @todo use std::atomic<long long> type to prevent conflicts
 			 */
 			long long playHeadPosition;
 
 			/**
-			 * The local system time, in milliseconds, at which the playing began.
+			 * The local system time, in microseconds, at which the playing began.
 			 * @todo use std::atomic<long long> type to prevent conflicts
 			 */
 			long long startPlayingTime;
 
 			/**
-			 * The position, in milliseconds within the sequence's time, that the playhead was at, when the playing began.
+			 * The position, in microseconds within the sequence's time, that the playhead was at, when the playing began.
 			 * @todo use std::atomic<long long> type to prevent conflicts
 			 */
 			long long startPlayingPosition;
 
 			/**
-			 * The reading buffer for the color images frames.
+			 * The playback rate, see setPlaybackRate(). startPlayingTime and startPlayingPosition are moved to the current time and position when it changes, so the playhead position is always startPlayingPosition + (current time - startPlayingTime) * playbackRate.
+			 */
+			double playbackRate;
+
+			/**
+			 * The local system time, in microseconds, since which the shown frames are counted, and the number of frames of each image stream shown since then, indexed by PlaybackStreamType.
+			 */
+			long long outputFramesCountingStartTime;
+			unsigned long long outputFramesCounts[PLAYBACK_STREAMS_COUNT];
+
+			/**
+			 * The number of frames of each image stream whose decoding was skipped because they would have been decoded too late to be shown, and the rank of the latest one, indexed by PlaybackStreamType.
+			 */
+			unsigned long long skippedFramesCounts[PLAYBACK_STREAMS_COUNT];
+			int lastSkippedFrameRanks[PLAYBACK_STREAMS_COUNT];
+
+			/**
+			 * The mean time taken to decode a frame of each image stream, in microseconds, or 0 if none has been decoded yet, indexed by PlaybackStreamType.
+			 */
+			double meanDecodingTimes[PLAYBACK_STREAMS_COUNT];
+
+			/**
+			 * Whether or not the playback statistics (shown frame rates, buffers, frames cache, proxies and seeking) are printed to the console ("debug.statistics_logs" setting).
+			 */
+			bool logsStatistics;
+
+			/**
+			 * The frames of each image stream, sorted by time, indexed by PlaybackStreamType. They are copied from the sequence once, so they can be searched by time without locking it.
+			 */
+			std::vector<kocca::datalib::FramePath> framesLists[PLAYBACK_STREAMS_COUNT];
+
+			/**
+			 * The prefetched frames of each image stream, by rank in the stream, indexed by PlaybackStreamType.
+			 */
+			std::map<int, kocca::datalib::TimeCodedFrame> decodedFrames[PLAYBACK_STREAMS_COUNT];
+
+			/**
+			 * The recently decoded frames of all the image streams, whether they were prefetched or decoded on demand. Unlike decodedFrames, it keeps the frames behind the playhead and those left by a seek, so going back to them doesn't decode them again.
+			 */
+			DecodedFrameCache* frameCache;
+
+			/**
+			 * The low resolution proxies of the sequence's frames, shown while scrubbing in place of the frames that aren't decoded yet, or NULL if they are disabled.
+			 */
+			kocca::datalib::SequenceProxies* proxies;
+
+			/**
+			 * The thread that generates the proxies of the sequence.
+			 */
+			std::thread* proxiesGenerationThread;
+
+			/**
+			 * Whether or not the latest frame output for each image stream is a proxy, that must be replaced by the full resolution frame once it is decoded, indexed by PlaybackStreamType.
+			 */
+			bool proxyIsOutput[PLAYBACK_STREAMS_COUNT];
+
+			/**
+			 * The ranks of the frames of each image stream being decoded by the decoding threads, indexed by PlaybackStreamType.
+			 */
+			std::set<int> decodingFrames[PLAYBACK_STREAMS_COUNT];
+
+			/**
+			 * The maximum size of the prefetched frames of all the image streams, in bytes.
+			 */
+			unsigned long long buffersMaxSize;
+
+			/**
+			 * The size of the prefetched frames of each image stream, in bytes, indexed by PlaybackStreamType, and the peak of their total since the reading started.
+			 */
+			unsigned long long buffersUsedSizes[PLAYBACK_STREAMS_COUNT];
+			unsigned long long peakBuffersUsedSize;
+
+			/**
+			 * The mean size of the decoded frames of each image stream, in bytes, or 0 if none has been decoded yet, indexed by PlaybackStreamType.
+			 */
+			double meanFrameSizes[PLAYBACK_STREAMS_COUNT];
+
+			/**
+			 * The size of the largest widget each image stream is displayed in (see setDisplaySize()), and the recorded size of its frames (empty until one is decoded at full resolution), indexed by PlaybackStreamType. They are locked by prefetch_mutex.
+			 */
+			cv::Size displaySizes[PLAYBACK_STREAMS_COUNT];
+			cv::Size frameSizes[PLAYBACK_STREAMS_COUNT];
+
+			/**
+			 * The factor the frames of each image stream are downscaled by when they are decoded, see setDisplaySize(), indexed by PlaybackStreamType.
+			 */
+			std::atomic<int> decodingReductions[PLAYBACK_STREAMS_COUNT];
+
+			/**
+			 * The mean number of frames per second of each image stream, indexed by PlaybackStreamType.
+			 */
+			double frameRates[PLAYBACK_STREAMS_COUNT];
+
+			/**
+			 * The duration of the look-ahead window, in microseconds : the frames up to this time after the playhead are prefetched.
+			 */
+			long long lookAheadTime;
+
+			/**
+			 * Mutex to lock decodedFrames, decodingFrames and the playhead position against threads access conflicts.
+			 */
+			std::mutex prefetch_mutex;
+
+			/**
+			 * Wakes the decoding threads up when the playhead moves, or when the buffering stops.
+			 */
+			std::condition_variable prefetch_condition;
+
+			/**
+			 * The threads that decode the upcoming (=after current playhead position) images frames of all the streams, and load them into memory.
+			 */
+			std::vector<std::thread*> decodingThreads;
+
+			/**
+			 * Gets the rank of the frame of a stream visible at a given time : the latest one whose time is not after it, or the first one if there's none.
+			 * @param stream the stream
+			 * @param time the time, in microseconds within the sequence's time
+			 * @return the rank of the frame, or -1 if the stream has no frame
 			 */
-			TimeCodedFrameBuffer imageFramesBuffer;
+			int getFrameRankAtTime(PlaybackStreamType stream, long long time);
 
 			/**
-			 * The reading buffer for the infrared images frames.
+			 * Gets the frame stride of a stream : while playing, only one frame out of this number is decoded and shown, the ranks that are multiples of it, so the stream isn't shown faster than the refresh period at high playback rates. It is 1 when not playing. prefetch_mutex must be locked.
+			 * @param stream the stream
 			 */
-			TimeCodedFrameBuffer irFramesBuffer;
+			int getFrameStride(PlaybackStreamType stream);
 
 			/**
-			 * The reading buffer for the depth images frames.
+			 * Gets the rank of the frame of a stream shown at the playhead : the latest frame visible at the playhead whose rank is a multiple of the frame stride. prefetch_mutex must be locked.
+			 * @param stream the stream
+			 * @param stride the frame stride of the stream
+			 * @return the rank of the frame, or -1 if the stream has no frame
 			 */
-			TimeCodedFrameBuffer depthFramesBuffer;
+			int getShownFrameRank(PlaybackStreamType stream, int stride);
 
 			/**
-			 * The maximum size (in Mega octets) of reading buffer for each image stream.
+			 * Gets the rank of the next frame of a stream to be shown after a given one, according to the frame stride.
+			 * @param stream the stream
+			 * @param rank the rank of the given frame
+			 * @param stride the frame stride of the stream
+			 * @return the rank of the next frame, or the number of frames of the stream if there's none
 			 */
-			int framesBufferMaxSize;
+			int getNextShownFrameRank(PlaybackStreamType stream, int rank, int stride);
 
 			/**
-			 * Mutex to lock the color image buffer and prevent threads access conflicts.
+			 * Gets the rank of the previous frame to be shown before a given one, according to the frame stride.
+			 * @param rank the rank of the given frame
+			 * @param stride the frame stride of its stream
+			 * @return the rank of the previous frame, or -1 if there's none
 			 */
-			std::mutex imageFramesBuffer_mutex;
+			int getPreviousShownFrameRank(int rank, int stride);
 
 			/**
-			 * The thread that reads color images frames and loads their content into memory.
+			 * Whether or not a frame, if its decoding started now, would be decoded after it is due to be replaced, while playing : after the next frame is due when playing forwards, after the playhead goes before it when playing backwards. prefetch_mutex must be locked.
+			 * @param stream the stream of the frame
+			 * @param rank the rank of the frame in the stream
+			 * @param stride the frame stride of the stream
 			 */
-			std::thread* imageFramesBufferingThread;
+			bool isLateFrame(PlaybackStreamType stream, int rank, int stride);
 
 			/**
-			 * Mutex to lock the infrared image buffer and prevent threads access conflicts.
+			 * Gets the local system time, in microseconds, at which the shown frame of any image stream will be replaced, in the direction of the playback, or startPlayingTime if there's none. prefetch_mutex must be locked.
 			 */
-			std::mutex irFramesBuffer_mutex;
+			long long getNextFrameDeadline();
 
 			/**
-			 * The thread that reads infrared images frames and loads their content into memory.
+			 * Whether or not a frame is in the prefetch window of its stream : the frame shown at the playhead, and the frames to be shown (see getFrameStride()) up to the prefetch horizon (see getPrefetchHorizon()) in the direction of the playback, and up to a quarter of it the other way. prefetch_mutex must be locked.
+			 * @param stream the stream of the frame
+			 * @param rank the rank of the frame in the stream
 			 */
-			std::thread* irFramesBufferingThread;
+			bool isInPrefetchWindow(PlaybackStreamType stream, int rank);
 
 			/**
-			 * Mutex to lock the depth image buffer and prevent threads access conflicts.
+			 * Picks the next frame to decode among all the streams : the one nearest to the playhead that is in the prefetch window of its stream and is neither decoded nor being decoded, as long as the buffers budget isn't used up.
+			 * While playing, only the frames ahead of the playhead in the direction of the playback are picked, and the late ones (see isLateFrame()) are skipped. prefetch_mutex must be locked.
+			 * @param stream receives the stream of the frame
+			 * @param rank receives the rank of the frame in its stream
+			 * @return false if there's no frame to decode
 			 */
-			std::mutex depthFramesBuffer_mutex;
+			bool pickNextFrame(PlaybackStreamType& stream, int& rank);
 
 			/**
-			 * The thread that reads depth images frames and loads their content into memory.
+			 * Removes the prefetched frames that are out of the prefetch window, after the playhead has moved. prefetch_mutex must be locked.
 			 */
-			std::thread* depthFramesBufferingThread;
+			void purgeDecodedFrames();
 
 			/**
-			 * Calculates the end point (in milliseconds) of the buffers, then notifies it's new end position via a call to the  onUpdateBufferEndingPoint callback function.
+			 * Adds a decoded frame to the prefetched frames of its stream, and accounts for its size. prefetch_mutex must be locked.
+			 * @param stream the stream of the frame
+			 * @param rank the rank of the frame in its stream
+			 * @param tcFrame the decoded frame
 			 */
-			void updateBufferEndingPoint();
+			void addDecodedFrame(PlaybackStreamType stream, int rank, const kocca::datalib::TimeCodedFrame& tcFrame);
+
+			/**
+			 * Computes the prefetch horizon, see getPrefetchHorizon(). It follows the playback rate, and only the frames to be shown are accounted for in the buffers budget. prefetch_mutex must be locked.
+			 */
+			long long computePrefetchHorizon();
+
+			/**
+			 * Updates the decoding reduction of a stream from the size of its widget and of its frames, see setDisplaySize(). If it decreases, the prefetched frames decoded at a lower resolution are removed, and the output frame is replaced once decoded again. prefetch_mutex must be locked.
+			 * @param stream the stream
+			 */
+			void updateDecodingReduction(PlaybackStreamType stream);
+
+			/**
+			 * Whether or not a decoded frame has at least the resolution its stream is now decoded at : those decoded before its widget grew don't, and are decoded again.
+			 * @param stream the stream of the frame
+			 * @param tcFrame the decoded frame
+			 */
+			bool hasDecodingResolution(PlaybackStreamType stream, const kocca::datalib::TimeCodedFrame& tcFrame);
+
+			/**
+			 * Reads and decodes a frame, from its file or from the archive the sequence is read from, at the decoding reduction of its stream (see setDisplaySize()).
+			 * @param stream the stream of the frame
+			 * @param framePath the path and time of the frame
+			 */
+			kocca::datalib::TimeCodedFrame decodeFrame(PlaybackStreamType stream, const kocca::datalib::FramePath& framePath);
+
+			/**
+			 * Gets the frame of a stream visible at the playhead : the prefetched one if it is, or the cached one. Otherwise, while playing, the latest prefetched frame before it is returned, if it hasn't been output yet, rather than decoding it late ; while not playing, its proxy is returned (the decoding threads output the full resolution frame once they have decoded it), or it is decoded right away.
+			 * @param stream the stream
+			 * @param force whether or not the frame is returned even if it has already been output
+			 * @param tcFrame receives the frame
+			 * @return false if the stream has no frame, or if the frame has already been output and force is false
+			 */
+			bool getFrameToOutput(PlaybackStreamType stream, bool force, kocca::datalib::TimeCodedFrame& tcFrame);
+
+			/**
+			 * Calls the output callback of a stream, if it is set.
+			 * @param stream the stream of the frame
+			 * @param tcFrame the frame to output
+			 */
+			void callFrameOutput(PlaybackStreamType stream, kocca::datalib::TimeCodedFrame& tcFrame);
+
+			/**
+			 * Calculates the end point (in microseconds) of the buffers : the time up to which all the streams are prefetched without gap from the playhead. prefetch_mutex must be locked.
+			 */
+			unsigned long long getBufferEndingPoint();
 
 			/**
 			 * The threads that periodically updates the playhead position and outputs data when the sequence is playing.
@@ -293,22 +581,50 @@ namespace kocca {
 			std::thread* playingThread;
 
 			/**
-			 * Time of the color image frame that was the last to be output, or -1 if none has been output yet.
-			 * @todo use std::atomic<unsigned long long> type to prevent conflicts
+			 * The thread that carries out the seeks requested by seek().
 			 */
-			unsigned long long lastOutputImageFrameTime;
+			std::thread* seekingThread;
 
 			/**
-			 * Time of the infrared image frame that was the last to be output, or -1 if none has been output yet.
-			 * @todo use std::atomic<unsigned long long> type to prevent conflicts
+			 * Whether or not the seekingThread should keep running. It is locked by seeking_mutex.
+			 */
+			bool seekingIsActive;
+
+			/**
+			 * The position of the latest seek requested and not carried out yet, or -1 if there's none, and the time it was requested at, in microseconds on the local system clock. They are locked by seeking_mutex.
+			 */
+			long long requestedSeekPosition;
+			unsigned long long seekRequestTime;
+
+			/**
+			 * Whether or not a seek is requested and not carried out yet : the frames of the playhead position aren't decoded on demand then, as they are about to be replaced by those of the new position.
+			 */
+			std::atomic<bool> seekIsPending;
+
+			/**
+			 * The number of seeks requested, of those that were superseded by a later one before their frames were output, and the latest, mean and maximum latencies of the others (see getLastSeekLatency()). They are locked by seeking_mutex.
+			 */
+			unsigned long long requestedSeeksCount;
+			unsigned long long supersededSeeksCount;
+			unsigned long long lastSeekLatency;
+			double meanSeekLatency;
+			unsigned long long maxSeekLatency;
+
+			/**
+			 * Locks the seek requests and statistics.
+			 */
+			std::mutex seeking_mutex;
+
+			/**
+			 * Wakes the seekingThread up when a seek is requested, or when the buffering stops.
 			 */
-			unsigned long long lastOutputIRFrameTime;
+			std::condition_variable seeking_condition;
 
 			/**
-			 * Time of the depth image frame that was the last to be output, or -1 if none has been output yet.
+			 * Time of the frame of each image stream that was the last to be output, or -1 if none has been output yet, indexed by PlaybackStreamType.
 			 * @todo use std::atomic<unsigned long long> type to prevent conflicts
 			 */
-			unsigned long long lastOutputDepthFrameTime;
+			unsigned long long lastOutputFrameTimes[PLAYBACK_STREAMS_COUNT];
 		};
 	} // namespace operations
 } // namespace kocca
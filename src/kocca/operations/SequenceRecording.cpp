@@ -2,30 +2,96 @@
 #include "../utils.h"
 #include "boost/filesystem.hpp"
 #include "../Exceptions.h"
+#include "../datalib/InfraredFrameCodec.h"
+#include "../datalib/JpegFrameEncoder.h"
+#include "../datalib/SequenceArchiveReader.h"
+#include "../Settings.h"
+#include <iostream>
 
 namespace kocca {
 	namespace operations {
+		namespace {
+			/**
+			 * The period at which the writing pool is tuned, in milliseconds.
+			 */
+			const long long WRITING_POOL_TUNING_PERIOD = 500;
+
+			/**
+			 * The period at which the estimation of the recording is updated, in milliseconds.
+			 */
+			const std::chrono::milliseconds ESTIMATE_PERIOD(1000);
+		}
+
 		/**
 		 * @throws TempFolderNotAvailableException
+		 * @throws FileArchivingException
+		 * @throws FileWritingException
 		 */
-		SequenceRecording::SequenceRecording(kocca::datalib::Sequence* _sequence, uint64_t _maxBuffersSize, int _writingThreadsNumberPerBuffer) {
+		SequenceRecording::SequenceRecording(kocca::datalib::Sequence* _sequence, boost::filesystem::path archiveFilePath, uint64_t _maxBuffersSize, int _writingThreadsNumber, kocca::FolderReclaimer* _folderReclaimer) {
 			type = KOCCA_RECORDING_OPERATION;
 
 			maxBuffersSize = _maxBuffersSize;
-			writingThreadsNumberPerBuffer = _writingThreadsNumberPerBuffer;
+			folderReclaimer = _folderReclaimer;
+
+			jpegQuality = (int)Settings::getInt("recording.jpeg_quality", 100);
+			jpegChromaSubsampling = kocca::datalib::JpegFrameEncoder::parseChromaSubsampling(Settings::getString("recording.jpeg_chroma_subsampling", "420"));
+			jpegFastDCT = Settings::getBool("recording.jpeg_fast_dct", false);
+
+			// the writing pool may use all the cores : the capture and display threads mostly wait for the devices
+			int coresNumber = (int)std::thread::hardware_concurrency();
+			minWritingThreadsNumber = (int)Settings::getInt("recording.writing_threads_min", 2);
+			maxWritingThreadsNumber = (int)Settings::getInt("recording.writing_threads_max", (coresNumber > 0) ? coresNumber : 8);
+			initialWritingThreadsNumber = (int)Settings::getInt("recording.writing_threads", _writingThreadsNumber);
+
+			if(minWritingThreadsNumber < 1)
+				minWritingThreadsNumber = 1;
+
+			if(maxWritingThreadsNumber < minWritingThreadsNumber)
+				maxWritingThreadsNumber = minWritingThreadsNumber;
+
+			if(initialWritingThreadsNumber < minWritingThreadsNumber)
+				initialWritingThreadsNumber = minWritingThreadsNumber;
+			else if(initialWritingThreadsNumber > maxWritingThreadsNumber)
+				initialWritingThreadsNumber = maxWritingThreadsNumber;
+
+			activeWritingThreadsCount = 0;
+			peakWritingThreadsCount = 0;
+			retiringWritingThreadsCount = 0;
+			writingPoolGrowthsCount = 0;
+			writingPoolShrinksCount = 0;
+			writingBusyTime = 0;
+			latestWritingPoolTuningQueuedFrames = 0;
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+				streamPriorities[i] = Settings::getDouble((std::string("recording.") + kocca::datalib::Sequence::STREAM_FOLDER_NAMES[i] + "_priority").c_str(), 1);
+
+				if(streamPriorities[i] <= 0)
+					streamPriorities[i] = 1;
+			}
 
-			imageFormatParams.push_back(CV_IMWRITE_JPEG_QUALITY);
-			imageFormatParams.push_back(100);
+			encodedImageFramesCount = 0;
+			imageEncodingTime = 0;
+			statisticsDumpInterval = Settings::getInt("recording.statistics_interval", 1000);
+			logsStatistics = Settings::getBool("debug.statistics_logs", false);
 
-			infraredFormatParams.push_back(CV_IMWRITE_PNG_COMPRESSION);
-			infraredFormatParams.push_back(0);
+			estimatingThread = NULL;
+			onWarning = NULL;
+			buffersWarningTime = Settings::getDouble("recording.buffers_warning_time", 10);
+			diskWarningTime = Settings::getDouble("recording.disk_warning_time", 300);
+			buffersWarningIssued = false;
+			diskWarningIssued = false;
 
 			depthFormatParams.push_back(CV_IMWRITE_PNG_COMPRESSION);
 			depthFormatParams.push_back(0);	
 
-			bool isRecording = false;
+			isRecording = false;
 	
 			sequence = _sequence;
+			archiveWriter = NULL;
+			archiveIsFull = false;
+			frameFileWriter = NULL;
+			journal = NULL;
+			preRollCommittingThread = NULL;
 
 			skippedMocapFramesCount = 0;
 
@@ -34,9 +100,34 @@ namespace kocca {
 			latestDepthFrameTime = 0;
 			latestMarkersFrameTime = 0;
 
-			cleanAndPrepareTempFolder(sequence->getRootDirectory());
-
 			error = NULL;
+
+			// the metadata is written first, so that even an interrupted recording can be read back with the right time unit and frames geometry
+			sequence->getMetadata()->reset();
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+				streamProfiles[i] = getStreamProfileSetting((RecordedStreamType)i);
+				streamProfiles[i].writeToMetadata(sequence->getMetadata(), kocca::datalib::Sequence::STREAM_FOLDER_NAMES[i]);
+				receivedFramesCount[i] = 0;
+			}
+
+			writeWritingPoolMetadata();
+
+			if(archiveFilePath.empty()) {
+				cleanAndPrepareTempFolder(sequence->getRootDirectory());
+				prepareStreamDirectories();
+				sequence->writeMetadata();
+				frameFileWriter = kocca::datalib::FrameFileWriter::create(Settings::getString("recording.writer_backend", "buffered"), Settings::getBool("recording.direct_io", false), (int)Settings::getInt("recording.fsync_batch", 0));
+				frameFileWriter->setListener(this);
+
+				if(Settings::getBool("recording.journal", true))
+					journal = new kocca::datalib::RecordingJournal(sequence->getRootDirectory(), frameFileWriter, (int)Settings::getInt("recording.journal_batch", 256));
+			}
+			else {
+				archiveWriter = new kocca::datalib::SequenceArchiveWriter(archiveFilePath.string());
+				std::string metadataFileContent = sequence->getMetadata()->getFileContent();
+				archiveWriter->addFile(kocca::datalib::SequenceMetadata::FILE_NAME, metadataFileContent.c_str(), metadataFileContent.length(), true);
+			}
 		}
 
 		SequenceRecording::~SequenceRecording() {
@@ -51,24 +142,89 @@ namespace kocca {
 			}
 
 			// wait for the end of the threads that dumps files from buffers
-			for (int i = 0; i < imageBufferWritingThreads.size(); i++)
-				imageBufferWritingThreads.at(i)->join();
+			waitForWritingThreads();
+			statistics.stopDumping();
+
+			if(estimatingThread != NULL) {
+				if(estimatingThread->joinable())
+					estimatingThread->join();
+
+				delete estimatingThread;
+			}
+
+			if(archiveWriter != NULL)
+				delete archiveWriter;
+
+			if(preRollCommittingThread != NULL)
+				delete preRollCommittingThread;
 
-			for (int i = 0; i < infraredBufferWritingThreads.size(); i++)
-				infraredBufferWritingThreads.at(i)->join();
+			for(int i = 0; i < writingThreads.size(); i++)
+				delete writingThreads.at(i);
 
-			for (int i = 0; i < depthBufferWritingThreads.size(); i++)
-				depthBufferWritingThreads.at(i)->join();
+			// the journal is closed before the writer, as its last batch flushes it
+			if(journal != NULL)
+				delete journal;
+
+			if(frameFileWriter != NULL) {
+				try {
+					// the writer may still have writes in flight once the writing threads are over
+					frameFileWriter->flush();
+				}
+				catch(std::exception& e) {
+					std::cerr << e.what() << std::endl;
+				}
+
+				delete frameFileWriter;
+			}
+
+			if(logsStatistics && (encodedImageFramesCount > 0)) {
+				std::cout << "JPEG encoding : " << encodedImageFramesCount << " frames encoded, "
+					<< (imageEncodingTime / encodedImageFramesCount) << " ms per frame (" << getImageEncodingThroughput() << " frames per second per core)" << std::endl;
+			}
+
+			if(logsStatistics && !writingThreads.empty()) {
+				std::cout << "Writing pool : peak of " << peakWritingThreadsCount << " threads, grown " << writingPoolGrowthsCount << " times and shrunk " << writingPoolShrinksCount << " times. Mean cost per frame :";
+
+				for(int i = 0; i < RECORDED_STREAMS_COUNT; i++)
+					std::cout << " " << kocca::datalib::Sequence::STREAM_FOLDER_NAMES[i] << " " << statistics.getMeanFrameCost((RecordedStreamType)i) << " ms";
+
+				std::cout << std::endl;
+			}
 
 			// finally, sort sequence frames and recalculate its total length
 			sequence->updateDuration();
 		}
 
-		int SequenceRecording::getTotalBuffersSize() {
-			return (
-					(1920 * 1080 * 3 * imageBuffer.size())
-				+	(512 * 424 * 2 * infraredBuffer.size())
-				+	(512 * 424 * 2 * depthBuffer.size()));
+		void SequenceRecording::waitForWritingThreads() {
+			if((preRollCommittingThread != NULL) && preRollCommittingThread->joinable() && (preRollCommittingThread->get_id() != std::this_thread::get_id()))
+				preRollCommittingThread->join();
+
+			// the list is read one thread at a time, as the pool may still grow while we wait
+			for(size_t i = 0; ; i++) {
+				writingThreads_mutex.lock();
+
+				if(i >= writingThreads.size()) {
+					writingThreads_mutex.unlock();
+					break;
+				}
+
+				std::thread* writingThread = writingThreads.at(i);
+				writingThreads_mutex.unlock();
+
+				if(writingThread->joinable() && (writingThread->get_id() != std::this_thread::get_id()))
+					writingThread->join();
+			}
+		}
+
+		double SequenceRecording::getImageEncodingThroughput() {
+			imageEncodingStats_mutex.lock();
+			double throughput = (imageEncodingTime > 0) ? ((encodedImageFramesCount * 1000.0) / imageEncodingTime) : 0;
+			imageEncodingStats_mutex.unlock();
+			return(throughput);
+		}
+
+		uint64_t SequenceRecording::getTotalBuffersSize() {
+			return(statistics.getQueuedBytesCount());
 		}
 
 		/**
@@ -85,6 +241,10 @@ namespace kocca {
 
 					for(int i = 0; i < tempChilds.size(); i++)
 						if(boost::filesystem::exists(tempChilds.at(i))) {
+							// renaming the stale data aside is instant, whatever the number of files of the previous take
+							if(boost::filesystem::is_directory(tempChilds.at(i)) && (folderReclaimer != NULL) && folderReclaimer->reclaim(tempChilds.at(i), tempDirectory.parent_path()))
+								continue;
+
 							try {
 								if(boost::filesystem::is_directory(tempChilds.at(i))) {
 									if((tempChilds.at(i) == (tempDirectory / "image")) || (tempChilds.at(i) == (tempDirectory / "infrared")) || (tempChilds.at(i) == (tempDirectory / "depth"))) {
@@ -118,28 +278,66 @@ namespace kocca {
 				throw TempFolderNotAvailableException("Temporary recording path does not exists");
 		}
 
+		/**
+		 * @throws TempFolderNotAvailableException
+		 */
+		void SequenceRecording::prepareStreamDirectories() {
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+				const char* streamFolderName = kocca::datalib::Sequence::STREAM_FOLDER_NAMES[i];
+				std::vector<boost::filesystem::path> baseDirectories = kocca::datalib::SequenceMetadata::splitDirectoriesList(Settings::getString((std::string("recording.") + streamFolderName + "_directories").c_str(), ""));
+
+				streamDirectories[i].clear();
+				streamFramesCount[i] = 0;
+
+				for(int j = 0; j < baseDirectories.size(); j++) {
+					// the folder is named after the root directory, so several sequences can share the same directories
+					boost::filesystem::path streamDirectory = baseDirectories.at(j) / sequence->getRootDirectory().filename() / streamFolderName;
+
+					try {
+						if(boost::filesystem::exists(streamDirectory) && ((folderReclaimer == NULL) || !folderReclaimer->reclaim(streamDirectory, baseDirectories.at(j))))
+							boost::filesystem::remove_all(streamDirectory);
+
+						boost::filesystem::create_directories(streamDirectory);
+					}
+					catch(boost::filesystem::filesystem_error fse) {
+						std::ostringstream errMsg;
+						errMsg << "Unable to create recording folder " << streamDirectory.string() << " : " << fse.what();
+						throw TempFolderNotAvailableException(errMsg.str().c_str());
+					}
+
+					streamDirectories[i].push_back(streamDirectory);
+				}
+
+				sequence->getMetadata()->setStreamDirectories(streamFolderName, streamDirectories[i]);
+
+				if(streamDirectories[i].empty())
+					streamDirectories[i].push_back(sequence->getRootDirectory() / streamFolderName);
+			}
+		}
+
 		/**
 		 * @throws RecordBufferOverFlowException
 		 * @throws std::runtime_error
 		 */
 		bool SequenceRecording::processDepthFrame(kocca::datalib::TimeCodedFrame tcFrame) {
 			if(onDepthFrameOutput != NULL) {
-				kocca::datalib::TimeCodedFrame displayTCFrame;
-				displayTCFrame.frame = tcFrame.frame.clone();
-				displayTCFrame.time = tcFrame.time;
-
-				if (displayTCFrame.time > latestDepthFrameTime) {
-					latestDepthFrameTime = displayTCFrame.time;
-					onDepthFrameOutput(displayTCFrame);
+				// the displayed frame shares its data with the recorded one, it is never modified (see makeFrameWritable())
+				if (tcFrame.time > latestDepthFrameTime) {
+					latestDepthFrameTime = tcFrame.time;
+					onDepthFrameOutput(tcFrame);
 				}
 			}
 
 			if(isRecording) {
+				if(!applyStreamProfile(RECORDED_STREAM_DEPTH, tcFrame))
+					return false;
+
 				if(getTotalBuffersSize() < maxBuffersSize) {
 					tcFrame.time = getRelativeTime(tcFrame.time);
-					depthBuffer_mutex.lock();
-					depthBuffer.push_back(tcFrame);
-					depthBuffer_mutex.unlock();
+					buffers_mutex[RECORDED_STREAM_DEPTH].lock();
+					buffers[RECORDED_STREAM_DEPTH].push_back(tcFrame);
+					statistics.onFrameEnqueued(RECORDED_STREAM_DEPTH, tcFrame.frame.total() * tcFrame.frame.elemSize());
+					buffers_mutex[RECORDED_STREAM_DEPTH].unlock();
 					return true;
 				}
 				else {
@@ -150,14 +348,14 @@ namespace kocca {
 						// we do nothing, we keep throwing a RecordBufferOverFlowException (below)
 					}
 
+					statistics.onFrameDropped(RECORDED_STREAM_DEPTH);
 					throw RecordBufferOverFlowException("Recording buffers have reached maximum allowed size");
 				}
 			}
-			else if(error != NULL) {
-				throw error;
-			}
-			else
+			else {
+				throwPendingError();
 				return false;
+			}
 		}
 
 		/**
@@ -171,21 +369,21 @@ namespace kocca {
 				tcFrame.time = getRelativeTime(tcFrame.time);
 
 			if(onColorImageFrameOutput != NULL) {
-				kocca::datalib::TimeCodedFrame displayTCFrame;
-				displayTCFrame.frame = tcFrame.frame.clone();
-				displayTCFrame.time = tcFrame.time;
-
-				if (displayTCFrame.time > latestImageFrameTime) {
-					latestImageFrameTime = displayTCFrame.time;
-					onColorImageFrameOutput(displayTCFrame);
+				if (tcFrame.time > latestImageFrameTime) {
+					latestImageFrameTime = tcFrame.time;
+					onColorImageFrameOutput(tcFrame);
 				}
 			}
 
 			if(isRecording) {
+				if(!applyStreamProfile(RECORDED_STREAM_COLOR, tcFrame))
+					return false;
+
 				if(getTotalBuffersSize() < maxBuffersSize) {
-					imageBuffer_mutex.lock();
-					imageBuffer.push_back(tcFrame);
-					imageBuffer_mutex.unlock();
+					buffers_mutex[RECORDED_STREAM_COLOR].lock();
+					buffers[RECORDED_STREAM_COLOR].push_back(tcFrame);
+					statistics.onFrameEnqueued(RECORDED_STREAM_COLOR, tcFrame.frame.total() * tcFrame.frame.elemSize());
+					buffers_mutex[RECORDED_STREAM_COLOR].unlock();
 					return true;
 				}
 				else {
@@ -196,14 +394,14 @@ namespace kocca {
 						// we do nothing, we keep throwing a RecordBufferOverFlowException (below)
 					}
 
+					statistics.onFrameDropped(RECORDED_STREAM_COLOR);
 					throw RecordBufferOverFlowException("Recording buffers have reached maximum allowed size");
 				}
 			}
-			else if(error != NULL) {
-				throw error;
-			}
-			else
+			else {
+				throwPendingError();
 				return false;
+			}
 		}
 
 		bool  SequenceRecording::processIRImageFrame(kocca::datalib::TimeCodedFrame tcFrame) {
@@ -213,21 +411,21 @@ namespace kocca {
 				tcFrame.time = getRelativeTime(tcFrame.time);
 
 			if (onIRImageFrameOutput != NULL) {
-				kocca::datalib::TimeCodedFrame displayTCFrame;
-				displayTCFrame.frame = tcFrame.frame.clone();
-				displayTCFrame.time = tcFrame.time;
-
-				if (displayTCFrame.time > latestInfraredFrameTime) {
-					latestInfraredFrameTime = displayTCFrame.time;
-					onIRImageFrameOutput(displayTCFrame);
+				if (tcFrame.time > latestInfraredFrameTime) {
+					latestInfraredFrameTime = tcFrame.time;
+					onIRImageFrameOutput(tcFrame);
 				}
 			}
 
 			if (isRecording) {
+				if (!applyStreamProfile(RECORDED_STREAM_INFRARED, tcFrame))
+					return false;
+
 				if (getTotalBuffersSize() < maxBuffersSize) {
-					infraredBuffer_mutex.lock();
-					infraredBuffer.push_back(tcFrame);
-					infraredBuffer_mutex.unlock();
+					buffers_mutex[RECORDED_STREAM_INFRARED].lock();
+					buffers[RECORDED_STREAM_INFRARED].push_back(tcFrame);
+					statistics.onFrameEnqueued(RECORDED_STREAM_INFRARED, tcFrame.frame.total() * tcFrame.frame.elemSize());
+					buffers_mutex[RECORDED_STREAM_INFRARED].unlock();
 					return true;
 				}
 				else {
@@ -238,23 +436,20 @@ namespace kocca {
 						// we do nothing, we keep throwing a RecordBufferOverFlowException (below)
 					}
 
+					statistics.onFrameDropped(RECORDED_STREAM_INFRARED);
 					throw RecordBufferOverFlowException("Recording buffers have reached maximum allowed size");
 				}
 			}
-			else if (error != NULL) {
-				throw error;
-			}
-			else
+			else {
+				throwPendingError();
 				return false;
+			}
 		}
 
 		/**
 		 * @throws std::runtime_error
 		 */
 		bool SequenceRecording::processMarkersFrame(kocca::datalib::MocapMarkerFrame markerFrame) {
-			// @TODO : utiliser plutt le temps de la frame : data->fTimestamp
-			// -> multiplier par 1000 pour convertir en ms
-			// -> puis appliquer correction de latence mesure lorsque cette mesure sera implmente
 			markerFrame.time = getRelativeTime(markerFrame.time);
 
 			if(onMarkersFrameOutput != NULL) {
@@ -272,161 +467,669 @@ namespace kocca {
 			}
 
 			if(isRecording) {
-				sequence->addMarkerFrame(markerFrame);
+				try {
+					addMarkersFrameToSequence(markerFrame);
+				}
+				catch(std::exception& e) {
+					setError(std::runtime_error(e.what()));
+				}
+
 				return true;
 			}
-			else if(error != NULL) {
-				throw error;
-			}
-			else
+			else {
+				throwPendingError();
 				return false;
+			}
 		}
 
-		void SequenceRecording::startRecording() {
+		void SequenceRecording::startRecording(PreRollBuffer* preRollBuffer) {
+			startRecordingTime_mutex.lock();
 			startRecordingTime = -1;
+
+			if(preRollBuffer != NULL) {
+				// the sequence starts with the oldest frame of the pre-roll, so all the times are relative to it
+				preRollBuffer->freeze();
+
+				if(!preRollBuffer->isEmpty())
+					startRecordingTime = preRollBuffer->getOldestTime();
+			}
+
+			startRecordingTime_mutex.unlock();
+
+			if(preRollBuffer != NULL) {
+				// the markers frames are appended to the sequence as they arrive : the pre-roll ones must come first
+				for(size_t i = 0; i < preRollBuffer->getMarkersFramesCount(); i++) {
+					kocca::datalib::MocapMarkerFrame markerFrame = preRollBuffer->getMarkersFrame(i);
+					markerFrame.time = getRelativeTime(markerFrame.time);
+
+					try {
+						addMarkersFrameToSequence(markerFrame);
+					}
+					catch(std::exception& e) {
+						setError(std::runtime_error(e.what()));
+					}
+				}
+			}
+
+			statistics.start();
+
+			if(statisticsDumpInterval > 0)
+				statistics.startDumping(getStatisticsFilePath(), statisticsDumpInterval);
+
 			isRecording = true;
 
-			for(int i = 0; i < writingThreadsNumberPerBuffer; i++) {
-				std::thread* oneImageBufferWritingThread = new std::thread(&SequenceRecording::imageBufferWritingThreadLoop, this);
-				imageBufferWritingThreads.push_back(oneImageBufferWritingThread);
+			// the configuration of the writing pool is also in the metadata (see writeWritingPoolMetadata())
+			if(logsStatistics) {
+				std::cout << "Writing pool : " << initialWritingThreadsNumber << " threads (min " << minWritingThreadsNumber << ", max " << maxWritingThreadsNumber << "), priorities :";
+
+				for(int i = 0; i < RECORDED_STREAMS_COUNT; i++)
+					std::cout << " " << kocca::datalib::Sequence::STREAM_FOLDER_NAMES[i] << " " << streamPriorities[i];
 
-				std::thread* oneInfraredBufferWritingThread = new std::thread(&SequenceRecording::infraredBufferWritingThreadLoop, this);
-				infraredBufferWritingThreads.push_back(oneInfraredBufferWritingThread);
+				std::cout << std::endl;
+			}
+
+			latestWritingPoolTuningTime = std::chrono::steady_clock::now();
+
+			for(int i = 0; i < initialWritingThreadsNumber; i++)
+				startWritingThread();
+
+			estimatingThread = new std::thread(&SequenceRecording::estimatingThreadLoop, this);
+
+			if((preRollBuffer != NULL) && (preRollBuffer->getFramesCount() > 0))
+				preRollCommittingThread = new std::thread(&SequenceRecording::commitPreRollFrames, this, preRollBuffer);
+		}
+
+		void SequenceRecording::commitPreRollFrames(PreRollBuffer* preRollBuffer) {
+			for(size_t i = 0; i < preRollBuffer->getFramesCount(); i++) {
+				const PreRollFrame& frame = preRollBuffer->getFrame(i);
+
+				std::ostringstream frameFileName;
+				frameFileName << getRelativeTime(frame.time) << getFrameFileExtension(frame.stream);
 
-				std::thread* oneDepthBufferWritingThread = new std::thread(&SequenceRecording::depthBufferWritingThreadLoop, this);
-				depthBufferWritingThreads.push_back(oneDepthBufferWritingThread);
+				try {
+					boost::filesystem::path framePath = writeFrameData(frame.stream, frameFileName.str(), preRollBuffer->getFrameData(frame), frame.size, false);
+					addFrameToSequence(frame.stream, getRelativeTime(frame.time), framePath, preRollBuffer->getFrameData(frame), frame.size);
+				}
+				catch(std::exception& e) {
+					setError(std::runtime_error(e.what()));
+				}
 			}
+
+			if(logsStatistics)
+				std::cout << "Pre-roll : " << preRollBuffer->getFramesCount() << " frames and " << preRollBuffer->getMarkersFramesCount() << " markers frames committed, "
+					<< (preRollBuffer->getUsedBytesCount() / 1000000.0) << " MB used out of " << (preRollBuffer->getArenaSize() / 1000000.0) << " MB, "
+					<< preRollBuffer->getMeanEncodingTime() << " ms per encoded frame, " << preRollBuffer->getSkippedFramesCount() << " frames skipped" << std::endl;
 		}
 
 		/**
 		 * @throws KinectCalibrationFileExportException
+		 * @throws FileArchivingException
+		 * @throws FileWritingException
 		 */
 		void SequenceRecording::stop() {
-			isRecording = false;
-			sequence->writeCalibrationData();
-			sequence->writeMarkersData(); //@TODO : write markers data in a separate thread in order to avoid slowing call to stop()
+			stopEstimating();
+
+			if(archiveWriter != NULL) {
+				archiveFinalization_mutex.lock();
+
+				try {
+					// the frames remaining in the buffers must be in the archive before its central directory is written
+					waitForWritingThreads();
+
+					if(!archiveWriter->isFinalized()) {
+						if(!archiveIsFull && sequence->hasCalibrationData()) {
+							std::string calibrationFileContent(sequence->getCalibrationFile()->getFileContent());
+
+							if(!calibrationFileContent.empty() && !archiveWriter->tryAddFile("kinect_calibration_parameters.kcf", calibrationFileContent.c_str(), calibrationFileContent.length(), true))
+								fallBackToFolderRecording();
+						}
+
+						if(!archiveIsFull && sequence->markersSequence.hasData()) {
+							std::string markersCSVContent = sequence->markersSequence.getCSVContent();
+
+							if(!markersCSVContent.empty() && !archiveWriter->tryAddFile("markersData.csv", markersCSVContent.c_str(), markersCSVContent.length(), true))
+								fallBackToFolderRecording();
+						}
+
+						archiveWriter->finalize();
+
+						if(archiveIsFull)
+							moveArchivedFramesToFolder();
+					}
+				}
+				catch(std::exception& e) {
+					archiveFinalization_mutex.unlock();
+					throw;
+				}
+
+				archiveFinalization_mutex.unlock();
+			}
+
+			if((archiveWriter == NULL) || archiveIsFull) {
+				// the pre-roll frames are short to write, and they must be in the sequence's folders before it is read back
+				if((preRollCommittingThread != NULL) && preRollCommittingThread->joinable() && (preRollCommittingThread->get_id() != std::this_thread::get_id()))
+					preRollCommittingThread->join();
+
+				sequence->writeCalibrationData();
+				sequence->writeMarkersData(); //@TODO : write markers data in a separate thread in order to avoid slowing call to stop()
+			}
+
+			if(journal != NULL) {
+				// once all its frames are written and synced, a take that stopped cleanly no longer needs to be restored from its journal
+				waitForWritingThreads();
+
+				error_mutex.lock();
+				bool hasError = (error != NULL);
+				error_mutex.unlock();
+
+				if(!hasError)
+					journal->complete();
+			}
 		}
 
 		/**
+		 * @throws FileReadingException
 		 * @throws FileWritingException
+		 * @throws TempFolderNotAvailableException
+		 * @throws KinectCalibrationFileExportException
 		 */
-		void SequenceRecording::imageBufferWritingThreadLoop() {
-			imageBuffer_mutex.lock();
+		int SequenceRecording::recoverArchivedTake() {
+			if(archiveWriter == NULL)
+				return(0);
+
+			archiveFinalization_mutex.lock();
+			int recoveredFramesCount = 0;
+
+			try {
+				// the archive file must be closed before it is read, whether or not its central directory can still be written
+				try {
+					archiveWriter->finalize();
+				}
+				catch(std::exception& e) {
+					// the central directory is missing : the frames are recovered from the local headers
+				}
+
+				// once the archive filled up, the root directory already holds the frames recorded since, which must be kept
+				if(!archiveIsFull) {
+					cleanAndPrepareTempFolder(sequence->getRootDirectory());
+					prepareStreamDirectories();
+					sequence->writeMetadata();
+				}
 
-			while(isRecording || !imageBuffer.empty()) {
-				imageBuffer_mutex.unlock();
+				std::string archiveFilePath = archiveWriter->getArchiveFilePath();
+				recoveredFramesCount = kocca::datalib::SequenceArchiveReader::salvageFrames(archiveFilePath, sequence->getRootDirectory());
+				archiveIsFull = true;
 
-				if(imageBuffer_mutex.try_lock()) {
-					if (!imageBuffer.empty()) {
-						kocca::datalib::TimeCodedFrame tcFrame = imageBuffer.front();
-						imageBuffer.pop_front();
-						imageBuffer_mutex.unlock();
+				boost::system::error_code ec;
+				boost::filesystem::remove(archiveFilePath, ec);
+			}
+			catch(std::exception& e) {
+				archiveFinalization_mutex.unlock();
+				throw;
+			}
 
-						std::ostringstream imageFileName;
-						imageFileName << tcFrame.time << ".jpeg";
+			archiveFinalization_mutex.unlock();
 
-						boost::filesystem::path imageFramePath = sequence->getRootDirectory() / "image" / imageFileName.str();
+			if((preRollCommittingThread != NULL) && preRollCommittingThread->joinable() && (preRollCommittingThread->get_id() != std::this_thread::get_id()))
+				preRollCommittingThread->join();
 
-						cv::cvtColor(tcFrame.frame, tcFrame.frame, CV_BGRA2RGB);
+			sequence->writeCalibrationData();
+			sequence->writeMarkersData();
+			return(recoveredFramesCount);
+		}
 
-						if (cv::imwrite(imageFramePath.string(), tcFrame.frame, imageFormatParams)) {
-							sequence_mutex.lock();
-							sequence->addImageFrame(imageFramePath);
-							sequence_mutex.unlock();
-						}
-						else
-							throw FileWritingException("Failed to write an image frame");
-					}
-					else
-						imageBuffer_mutex.unlock();
+		boost::filesystem::path SequenceRecording::getStatisticsFilePath() {
+			if(archiveWriter != NULL) {
+				boost::filesystem::path archiveFilePath(archiveWriter->getArchiveFilePath());
+				return(archiveFilePath.parent_path() / (archiveFilePath.stem().string() + "_statistics.csv"));
+			}
+			else
+				return(sequence->getRootDirectory() / kocca::datalib::Sequence::STATISTICS_FILE_NAME);
+		}
+
+		RecordingStatistics* SequenceRecording::getStatistics() {
+			return(&statistics);
+		}
+
+		std::string SequenceRecording::getArchiveFilePath() {
+			if((archiveWriter != NULL) && !archiveIsFull)
+				return(archiveWriter->getArchiveFilePath());
+			else
+				return(std::string(""));
+		}
+
+		void SequenceRecording::writeWritingPoolMetadata() {
+			kocca::datalib::SequenceMetadata* metadata = sequence->getMetadata();
+			metadata->set("writing_threads", std::to_string(initialWritingThreadsNumber));
+			metadata->set("writing_threads_min", std::to_string(minWritingThreadsNumber));
+			metadata->set("writing_threads_max", std::to_string(maxWritingThreadsNumber));
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+				std::ostringstream priorityValue;
+				priorityValue << streamPriorities[i];
+				metadata->set((std::string(kocca::datalib::Sequence::STREAM_FOLDER_NAMES[i]) + "_priority").c_str(), priorityValue.str());
+			}
+		}
+
+		/**
+		 * @throws FileWritingException
+		 * @throws FileArchivingException
+		 */
+		boost::filesystem::path SequenceRecording::writeFrameData(RecordedStreamType stream, const std::string& frameFileName, const unsigned char* data, size_t size, bool countsWriting) {
+			if((archiveWriter != NULL) && !archiveIsFull) {
+				std::string archiveRelativePath = std::string(kocca::datalib::Sequence::STREAM_FOLDER_NAMES[stream]) + "/" + frameFileName;
+				std::chrono::high_resolution_clock::time_point writingStartTime = std::chrono::high_resolution_clock::now();
+
+				if(archiveWriter->tryAddFile(archiveRelativePath, data, size)) {
+					if(countsWriting)
+						statistics.onFrameWritten(stream, size, RecordingStatistics::getElapsedMicroseconds(writingStartTime));
+
+					return(sequence->getRootDirectory() / archiveRelativePath);
 				}
-		
-				if(isRecording)
-					usleep(10);
 
-				imageBuffer_mutex.lock();
+				// the take goes on as loose files rather than failing once the archive is full
+				fallBackToFolderRecording();
 			}
 
-			imageBuffer_mutex.unlock();
+			// round-robin over the stream's folders, so their disks share the write bandwidth of the stream
+			unsigned long long frameIndex = streamFramesCount[stream].fetch_add(1);
+			boost::filesystem::path framePath = streamDirectories[stream].at(frameIndex % streamDirectories[stream].size()) / frameFileName;
+			// the write is counted by onFileWritten() once complete, which an asynchronous writer reports from its completion thread
+			frameFileWriter->writeFile(framePath, data, size, countsWriting ? (int)stream : -1);
+			return(framePath);
+		}
+
+		void SequenceRecording::onFileWritten(int tag, size_t size, unsigned long long writingLatency) {
+			if(tag >= 0)
+				statistics.onFrameWritten((RecordedStreamType)tag, size, writingLatency);
 		}
 
 		/**
-		* @throws FileWritingException
-		*/
-		void SequenceRecording::infraredBufferWritingThreadLoop() {
-			infraredBuffer_mutex.lock();
+		 * @throws TempFolderNotAvailableException
+		 * @throws FileWritingException
+		 */
+		void SequenceRecording::fallBackToFolderRecording() {
+			archiveFallback_mutex.lock();
+
+			if(!archiveIsFull) {
+				try {
+					// the frames already in the archive aren't journaled, so there's no journal : an interrupted take is restored by scanning its folders
+					cleanAndPrepareTempFolder(sequence->getRootDirectory());
+					prepareStreamDirectories();
+					sequence->writeMetadata();
+					frameFileWriter = kocca::datalib::FrameFileWriter::create(Settings::getString("recording.writer_backend", "buffered"), Settings::getBool("recording.direct_io", false), (int)Settings::getInt("recording.fsync_batch", 0));
+					frameFileWriter->setListener(this);
+				}
+				catch(std::exception& e) {
+					archiveFallback_mutex.unlock();
+					throw;
+				}
 
-			while (isRecording || !infraredBuffer.empty()) {
-				infraredBuffer_mutex.unlock();
+				archiveIsFull = true;
+				issueWarning("The archive has reached the 4 GB / 65535 files limit of .ksa files : the recording goes on in the temp folder, and the sequence will have to be exported once it is over");
+			}
 
-				if (infraredBuffer_mutex.try_lock()) {
-					if (!infraredBuffer.empty()) {
-						kocca::datalib::TimeCodedFrame tcFrame = infraredBuffer.front();
-						infraredBuffer.pop_front();
-						infraredBuffer_mutex.unlock();
+			archiveFallback_mutex.unlock();
+		}
+
+		/**
+		 * @throws FileReadingException
+		 * @throws FileWritingException
+		 */
+		void SequenceRecording::moveArchivedFramesToFolder() {
+			std::string archiveFilePath = archiveWriter->getArchiveFilePath();
 
-						std::ostringstream infraredFileName;
-						infraredFileName << tcFrame.time << ".png";
+			{
+				kocca::datalib::SequenceArchiveReader archiveReader(archiveFilePath);
 
-						boost::filesystem::path infraredFramePath = sequence->getRootDirectory() / "infrared" / infraredFileName.str();
+				for(int i = 0; i < archiveReader.getEntriesCount(); i++) {
+					std::string entryName = archiveReader.getEntryName(i);
 
-						if (cv::imwrite(infraredFramePath.string(), tcFrame.frame, infraredFormatParams)) {
-							sequence_mutex.lock();
-							sequence->addIRFrame(infraredFramePath);
-							sequence_mutex.unlock();
-						}
-						else
-							throw FileWritingException("Failed to write an infrared frame");
+					// only the frames are extracted : the metadata, calibration and markers data are written again from the sequence
+					if(entryName.find('/') != std::string::npos) {
+						boost::filesystem::path framePath = sequence->getRootDirectory() / entryName;
+						boost::filesystem::create_directories(framePath.parent_path());
+						archiveReader.extractEntry(entryName, framePath);
 					}
-					else
-						infraredBuffer_mutex.unlock();
 				}
+			}
 
-				if (isRecording)
-					usleep(10);
+			boost::system::error_code ec;
+			boost::filesystem::remove(archiveFilePath, ec);
+		}
+
+		unsigned long long SequenceRecording::getTargetFreeSpace() {
+			std::vector<boost::filesystem::path> targetDirectories;
+
+			if((archiveWriter != NULL) && !archiveIsFull)
+				targetDirectories.push_back(boost::filesystem::path(archiveWriter->getArchiveFilePath()).parent_path());
+			else
+				for(int i = 0; i < RECORDED_STREAMS_COUNT; i++)
+					targetDirectories.insert(targetDirectories.end(), streamDirectories[i].begin(), streamDirectories[i].end());
+
+			// the disk that fills up first ends the recording
+			unsigned long long freeSpace = 0;
+			bool hasFreeSpace = false;
 
-				infraredBuffer_mutex.lock();
+			for(int i = 0; i < targetDirectories.size(); i++) {
+				boost::system::error_code ec;
+				boost::filesystem::space_info spaceInfo = boost::filesystem::space(targetDirectories.at(i), ec);
+
+				if(!ec && (!hasFreeSpace || (spaceInfo.available < freeSpace))) {
+					freeSpace = spaceInfo.available;
+					hasFreeSpace = true;
+				}
 			}
 
-			infraredBuffer_mutex.unlock();
+			return(freeSpace);
+		}
+
+		void SequenceRecording::issueWarning(const std::string& message) {
+			std::cerr << "Recording warning : " << message << std::endl;
+
+			if(onWarning != NULL)
+				onWarning(message);
 		}
 
-		void SequenceRecording::depthBufferWritingThreadLoop() {
-			depthBuffer_mutex.lock();
+		void SequenceRecording::stopEstimating() {
+			estimating_mutex.lock();
+			isRecording = false;
+			estimating_mutex.unlock();
+			estimating_condition.notify_all();
+		}
 
-			while(isRecording || !depthBuffer.empty()) {
-				depthBuffer_mutex.unlock();
+		void SequenceRecording::estimatingThreadLoop() {
+			std::chrono::steady_clock::time_point nextEstimateTime = std::chrono::steady_clock::now();
+			std::unique_lock<std::mutex> lock(estimating_mutex);
 
-				if(depthBuffer_mutex.try_lock()) {
-					if (!depthBuffer.empty()) {
-						cv::Mat frame = depthBuffer.front().frame;
-						unsigned long long frameTime = depthBuffer.front().time;
-						depthBuffer.pop_front();
-						depthBuffer_mutex.unlock();
-						std::ostringstream depthFileName;
-						depthFileName << frameTime << ".png";
+			while(isRecording) {
+				if(estimating_condition.wait_until(lock, nextEstimateTime) != std::cv_status::timeout)
+					continue;
 
-						boost::filesystem::path depthFramePath = sequence->getRootDirectory() / "depth" / depthFileName.str();
+				lock.unlock();
+				nextEstimateTime += ESTIMATE_PERIOD;
 
-						if (cv::imwrite(depthFramePath.string(), frame, depthFormatParams)) {
-							sequence_mutex.lock();
-							sequence->addDepthFrame(depthFramePath);
-							sequence_mutex.unlock();
-						}
-						else
-							throw FileWritingException("Failed to write a depth frame");
+				try {
+					// a slow take still gets its journal synced every period, whatever the size of the batches
+					if(journal != NULL)
+						journal->sync();
+				}
+				catch(std::exception& e) {
+					setError(std::runtime_error(e.what()));
+				}
+
+				statistics.updateEstimate(getTargetFreeSpace(), maxBuffersSize);
+				RecordingEstimate estimate = statistics.getEstimate();
+				unsigned long long queuedBytesCount = statistics.getQueuedBytesCount();
+
+				// the buffers warning is also issued past 80% of their maximum size, in case they fill up in bursts
+				bool buffersWillOverflow = ((estimate.buffersOverflowTime >= 0) && (estimate.buffersOverflowTime < buffersWarningTime)) || (queuedBytesCount > ((maxBuffersSize / 5) * 4));
+
+				if(buffersWillOverflow && !buffersWarningIssued) {
+					std::ostringstream message;
+					message << "the recording buffers are " << (int)((queuedBytesCount * 100) / maxBuffersSize) << "% full and growing by " << estimate.buffersGrowthRate << " MB/s : "
+						<< estimate.writeThroughput << " MB/s are written while " << estimate.incomingThroughput << " MB/s are needed. The recording will stop when they are full";
+
+					if(estimate.buffersOverflowTime >= 0)
+						message << ", in about " << (int)estimate.buffersOverflowTime << " seconds";
+
+					message << ".";
+					issueWarning(message.str());
+					buffersWarningIssued = true;
+				}
+				else if(buffersWarningIssued && (queuedBytesCount < (maxBuffersSize / 2)) && (estimate.buffersGrowthRate <= 0))
+					buffersWarningIssued = false;
+
+				if((estimate.remainingTime >= 0) && (estimate.remainingTime < diskWarningTime) && !diskWarningIssued) {
+					std::ostringstream message;
+					message << "the recording disk will be full in about " << (int)estimate.remainingTime << " seconds (" << (estimate.freeSpace / 1000000) << " MB free, "
+						<< estimate.incomingThroughput << " MB/s recorded).";
+					issueWarning(message.str());
+					diskWarningIssued = true;
+				}
+
+				lock.lock();
+			}
+		}
+
+		void SequenceRecording::startWritingThread() {
+			writingThreads_mutex.lock();
+			writingThreads.push_back(new std::thread(&SequenceRecording::writingThreadLoop, this));
+			int writingThreadsCount = ++activeWritingThreadsCount;
+			writingThreads_mutex.unlock();
+
+			if(writingThreadsCount > peakWritingThreadsCount)
+				peakWritingThreadsCount = writingThreadsCount;
+
+			statistics.setWritingThreadsCount(writingThreadsCount);
+		}
+
+		void SequenceRecording::tuneWritingPool() {
+			if(!writingPoolTuning_mutex.try_lock())
+				return;
+
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			long long elapsedTime = std::chrono::duration_cast<std::chrono::microseconds>(now - latestWritingPoolTuningTime).count();
+
+			if(isRecording && (elapsedTime >= (WRITING_POOL_TUNING_PERIOD * 1000))) {
+				long long queuedFramesCount = 0;
+				double backlogCost = 0;
+
+				for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+					long long streamQueuedFramesCount = statistics.getQueuedFramesCount((RecordedStreamType)i);
+					queuedFramesCount += streamQueuedFramesCount;
+					backlogCost += streamQueuedFramesCount * statistics.getMeanFrameCost((RecordedStreamType)i);
+				}
+
+				int writingThreadsCount = activeWritingThreadsCount - retiringWritingThreadsCount;
+				double busyRatio = (writingBusyTime.exchange(0) / (double)elapsedTime) / ((writingThreadsCount > 0) ? writingThreadsCount : 1);
+
+				// the time the backlog would take to drain with the current threads, in milliseconds
+				double drainTime = backlogCost / ((writingThreadsCount > 0) ? writingThreadsCount : 1);
+
+				if((drainTime > WRITING_POOL_TUNING_PERIOD) && (queuedFramesCount >= latestWritingPoolTuningQueuedFrames) && (writingThreadsCount < maxWritingThreadsNumber)) {
+					startWritingThread();
+					writingPoolGrowthsCount++;
+
+					if(logsStatistics)
+						std::cout << "Writing pool : grown to " << (writingThreadsCount + 1) << " threads (" << queuedFramesCount << " queued frames, " << drainTime << " ms to drain)" << std::endl;
+				}
+				else if((queuedFramesCount == 0) && (writingThreadsCount > minWritingThreadsNumber) && ((busyRatio * writingThreadsCount) / (writingThreadsCount - 1) < 0.8)) {
+					retiringWritingThreadsCount++;
+					writingPoolShrinksCount++;
+
+					if(logsStatistics)
+						std::cout << "Writing pool : shrunk to " << (writingThreadsCount - 1) << " threads (" << (int)(busyRatio * 100) << "% busy)" << std::endl;
+				}
+
+				latestWritingPoolTuningQueuedFrames = queuedFramesCount;
+				latestWritingPoolTuningTime = now;
+			}
+
+			writingPoolTuning_mutex.unlock();
+		}
+
+		bool SequenceRecording::popNextFrame(RecordedStreamType& stream, kocca::datalib::TimeCodedFrame& tcFrame) {
+			int nextStream = -1;
+			double highestBacklogCost = 0;
+
+			for(int i = 0; i < RECORDED_STREAMS_COUNT; i++) {
+				long long queuedFramesCount = statistics.getQueuedFramesCount((RecordedStreamType)i);
+
+				if(queuedFramesCount > 0) {
+					// the streams that haven't written any frame yet are assumed to cost 1 ms per frame
+					double frameCost = statistics.getMeanFrameCost((RecordedStreamType)i);
+					double backlogCost = queuedFramesCount * ((frameCost > 0) ? frameCost : 1) * streamPriorities[i];
+
+					if(backlogCost > highestBacklogCost) {
+						highestBacklogCost = backlogCost;
+						nextStream = i;
 					}
-					else
-						depthBuffer_mutex.unlock();
 				}
-		
-				if(isRecording)
+			}
+
+			if(nextStream < 0)
+				return(false);
+
+			stream = (RecordedStreamType)nextStream;
+			bool hasFrame = false;
+
+			buffers_mutex[stream].lock();
+
+			if(!buffers[stream].empty()) {
+				tcFrame = buffers[stream].front();
+				buffers[stream].pop_front();
+				hasFrame = true;
+			}
+
+			buffers_mutex[stream].unlock();
+
+			if(hasFrame)
+				statistics.onFrameDequeued(stream, tcFrame.frame.total() * tcFrame.frame.elemSize());
+
+			return(hasFrame);
+		}
+
+		bool SequenceRecording::buffersAreEmpty() {
+			bool empty = true;
+
+			for(int i = 0; (i < RECORDED_STREAMS_COUNT) && empty; i++) {
+				buffers_mutex[i].lock();
+				empty = buffers[i].empty();
+				buffers_mutex[i].unlock();
+			}
+
+			return(empty);
+		}
+
+		void SequenceRecording::writingThreadLoop() {
+			// each writing thread has its own encoder, whose compressor and output buffer are reused for all the frames it writes
+			kocca::datalib::JpegFrameEncoder encoder(jpegQuality, jpegChromaSubsampling, jpegFastDCT);
+
+			// the encoding buffer of the infrared and depth frames of this thread, whose memory is reused from one frame to the next
+			std::vector<unsigned char> encodedFrame;
+
+			while(isRecording || !buffersAreEmpty()) {
+				// once the recording is stopped, all the threads help draining the buffers
+				int retiringCount = retiringWritingThreadsCount;
+
+				if(isRecording && (retiringCount > 0) && retiringWritingThreadsCount.compare_exchange_strong(retiringCount, retiringCount - 1))
+					break;
+
+				tuneWritingPool();
+
+				RecordedStreamType stream;
+				kocca::datalib::TimeCodedFrame tcFrame;
+
+				if(popNextFrame(stream, tcFrame)) {
+					std::chrono::high_resolution_clock::time_point writingStartTime = std::chrono::high_resolution_clock::now();
+					writeFrame(stream, tcFrame, encoder, encodedFrame);
+					writingBusyTime.fetch_add(RecordingStatistics::getElapsedMicroseconds(writingStartTime));
+				}
+				else if(isRecording)
 					usleep(10);
+			}
+
+			statistics.setWritingThreadsCount(--activeWritingThreadsCount);
+
+			imageEncodingStats_mutex.lock();
+			encodedImageFramesCount += encoder.getEncodedFramesCount();
+			imageEncodingTime += encoder.getEncodingTime();
+			imageEncodingStats_mutex.unlock();
+		}
+
+		void SequenceRecording::writeFrame(RecordedStreamType stream, kocca::datalib::TimeCodedFrame& tcFrame, kocca::datalib::JpegFrameEncoder& encoder, std::vector<unsigned char>& encodedFrame) {
+			std::ostringstream frameFileName;
+			frameFileName << tcFrame.time << getFrameFileExtension(stream);
+
+			try {
+				std::chrono::high_resolution_clock::time_point encodingStartTime = std::chrono::high_resolution_clock::now();
+				const unsigned char* encodedData;
+				size_t encodedSize;
+
+				if(stream == RECORDED_STREAM_COLOR) {
+					encoder.encode(tcFrame.frame);
+					encodedData = encoder.getEncodedData();
+					encodedSize = encoder.getEncodedSize();
+				}
+				else {
+					if(stream == RECORDED_STREAM_INFRARED)
+						kocca::datalib::InfraredFrameCodec::encode(tcFrame.frame, encodedFrame);
+					else if(!cv::imencode(".png", tcFrame.frame, encodedFrame, depthFormatParams))
+						throw FileWritingException("Failed to encode a depth frame");
+
+					encodedData = encodedFrame.data();
+					encodedSize = encodedFrame.size();
+				}
 
-				depthBuffer_mutex.lock();
+				statistics.onFrameEncoded(stream, RecordingStatistics::getElapsedMicroseconds(encodingStartTime));
+
+				boost::filesystem::path framePath = writeFrameData(stream, frameFileName.str(), encodedData, encodedSize, true);
+
+				addFrameToSequence(stream, tcFrame.time, framePath, encodedData, encodedSize);
 			}
+			catch(std::exception& e) {
+				statistics.onFrameDropped(stream);
+				setError(std::runtime_error(e.what()));
+			}
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void SequenceRecording::addFrameToSequence(RecordedStreamType stream, unsigned long long time, const boost::filesystem::path& framePath, const unsigned char* data, size_t size) {
+			sequence_mutex.lock();
+
+			if(stream == RECORDED_STREAM_COLOR)
+				sequence->addImageFrame(framePath);
+			else if(stream == RECORDED_STREAM_INFRARED)
+				sequence->addIRFrame(framePath);
+			else
+				sequence->addDepthFrame(framePath);
+
+			sequence_mutex.unlock();
+
+			// with an asynchronous writer, the frame may be journaled before its file is complete : the journal flushes and syncs the writer before each batch, so a synced record never lists a frame that isn't on disk
+			if(journal != NULL)
+				journal->appendFrame(kocca::datalib::Sequence::STREAM_FOLDER_NAMES[stream], time, framePath, data, size);
+		}
+
+		/**
+		 * @throws FileWritingException
+		 */
+		void SequenceRecording::addMarkersFrameToSequence(kocca::datalib::MocapMarkerFrame& markerFrame) {
+			sequence->addMarkerFrame(markerFrame);
+
+			if(journal != NULL)
+				journal->appendMarkersFrame(markerFrame);
+		}
 
-			depthBuffer_mutex.unlock();
+		const char* SequenceRecording::getFrameFileExtension(RecordedStreamType stream) {
+			if(stream == RECORDED_STREAM_COLOR)
+				return(".jpeg");
+			else if(stream == RECORDED_STREAM_INFRARED)
+				return(kocca::datalib::InfraredFrameCodec::FILE_EXTENSION);
+			else
+				return(".png");
+		}
+
+		kocca::datalib::StreamProfile SequenceRecording::getStreamProfileSetting(RecordedStreamType stream) {
+			std::string settingPrefix = std::string("recording.") + kocca::datalib::Sequence::STREAM_FOLDER_NAMES[stream];
+
+			return(kocca::datalib::StreamProfile::parse(
+				Settings::getString((settingPrefix + "_scale").c_str(), ""),
+				Settings::getString((settingPrefix + "_roi").c_str(), ""),
+				Settings::getString((settingPrefix + "_decimation").c_str(), "")
+			));
+		}
+
+		bool SequenceRecording::applyStreamProfile(RecordedStreamType stream, kocca::datalib::TimeCodedFrame& tcFrame) {
+			if(!streamProfiles[stream].keepsFrame(receivedFramesCount[stream].fetch_add(1)))
+				return(false);
+
+			// depth maps are downscaled without interpolation, so no depth is made up on the edges of objects
+			tcFrame.frame = streamProfiles[stream].apply(tcFrame.frame, (stream == RECORDED_STREAM_DEPTH) ? cv::INTER_NEAREST : cv::INTER_AREA);
+			return(true);
 		}
 
 		unsigned long long SequenceRecording::getRelativeTime(unsigned long long time) {
@@ -441,14 +1144,30 @@ namespace kocca {
 		}
 
 		void SequenceRecording::setError(std::runtime_error re) {
-			try {
-				stop();
-			}
-			catch(std::exception& e) {
-				// we do nothing, we keep re as the exception that will be considered the source of problem
-			}
+			stopEstimating();
+			error_mutex.lock();
+
+			// we keep the first error as the one that will be considered the source of problem
+			if(error == NULL)
+				error = new std::runtime_error(re);
+
+			error_mutex.unlock();
+		}
+
+		/**
+		 * @throws std::runtime_error
+		 */
+		void SequenceRecording::throwPendingError() {
+			error_mutex.lock();
+			std::runtime_error* pendingError = error;
+			error = NULL;
+			error_mutex.unlock();
 
-			error = new std::runtime_error(re);
+			if(pendingError != NULL) {
+				std::runtime_error re(*pendingError);
+				delete pendingError;
+				throw re;
+			}
 		}
 	} // namespace operations
 } // namespace kocca
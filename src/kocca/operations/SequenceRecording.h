@@ -1,20 +1,31 @@
 #ifndef KOCCA_OPERATIONS_SEQUENCE_RECORDING_H
 #define KOCCA_OPERATIONS_SEQUENCE_RECORDING_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <thread>
 
 #include "Operation.h"
 #include "../datalib/Sequence.h"
+#include "../datalib/SequenceArchiveWriter.h"
+#include "../datalib/FrameFileWriter.h"
+#include "../datalib/RecordingJournal.h"
+#include "../datalib/JpegFrameEncoder.h"
+#include "../datalib/StreamProfile.h"
 #include "TimeCodedFrameBuffer.h"
+#include "RecordingStatistics.h"
+#include "PreRollBuffer.h"
+#include "../FolderReclaimer.h"
 
 namespace kocca {
 	namespace operations {
 
 		/**
-		 * SequenceRecording operation allows to record incoming data from Kinect and Mocap streams, and to write it on the filesystem as a Kocca Sequence folder.
+		 * SequenceRecording operation allows to record incoming data from Kinect and Mocap streams, and to write it on the filesystem as a Kocca Sequence folder, or straight into a .ksa sequence archive.
 		 */
-		class SequenceRecording: public Operation {
+		class SequenceRecording: public Operation, public kocca::datalib::FrameFileWriterListener {
 		protected:
 
 			/**
@@ -28,60 +39,146 @@ namespace kocca {
 			std::mutex sequence_mutex;
 
 			/**
-			 * The memory buffer where incoming color image frames are temporarily stored before they get written to the filesystem.
+			 * The archive the sequence is recorded into, or NULL if the sequence is recorded as loose files in its root directory.
 			 */
-			kocca::TimeCodedFrameBuffer imageBuffer;
+			kocca::datalib::SequenceArchiveWriter* archiveWriter;
 
 			/**
-			 * A lock to prevent access conflicts to the imageBuffer object. 
+			 * The storage backend that writes the frames files when the sequence is recorded as loose files, or NULL if it is recorded into an archive.
 			 */
-			std::mutex imageBuffer_mutex;
+			kocca::datalib::FrameFileWriter* frameFileWriter;
 
 			/**
-			 * Threads (there can be several at the same time) that write color image frames of the imageBuffer to the filesystem, then remove them from imageBuffer.
+			 * The journal of the frames written when the sequence is recorded as loose files, so an interrupted recording can be restored without scanning its folders, or NULL if the sequence is recorded into an archive or if the journal is disabled ("recording.journal" setting).
 			 */
-			std::vector<std::thread*> imageBufferWritingThreads;
+			kocca::datalib::RecordingJournal* journal;
 
 			/**
-			 * The memory buffer where incoming infrared image frames are temporarily stored before they get written to the filesystem.
+			 * The folders where the frames of each stream are written when the sequence is recorded as loose files, indexed by RecordedStreamType. The frames of a stream are spread over its folders in turn.
 			 */
-			kocca::TimeCodedFrameBuffer infraredBuffer;
+			std::vector<boost::filesystem::path> streamDirectories[RECORDED_STREAMS_COUNT];
 
 			/**
-			 * A lock to prevent access conflicts to the infraredBuffer object. 
+			 * The number of frames sent to each stream's folders so far, to pick the folder of the next frame.
 			 */
-			std::mutex infraredBuffer_mutex;
+			std::atomic<unsigned long long> streamFramesCount[RECORDED_STREAMS_COUNT];
 
 			/**
-			 * Threads (there can be several at the same time) that write infrared image frames of the infraredBuffer to the filesystem, then remove them from infraredBuffer.
+			 * The recording profile of each stream (region of interest, downscaling and decimation), indexed by RecordedStreamType. They are applied to the incoming frames before they get buffered.
 			 */
-			std::vector<std::thread*> infraredBufferWritingThreads;
+			kocca::datalib::StreamProfile streamProfiles[RECORDED_STREAMS_COUNT];
 
 			/**
-			 * The memory buffer where incoming depth image frames are temporarily stored before they get written to the filesystem.
+			 * The number of frames received by each stream since the recording started, to apply the decimation of its profile.
 			 */
-			kocca::TimeCodedFrameBuffer depthBuffer;
+			std::atomic<unsigned long long> receivedFramesCount[RECORDED_STREAMS_COUNT];
 
 			/**
-			 * A lock to prevent access conflicts to the depthBuffer object. 
+			 * A lock that serializes the calls to stop() when the sequence is recorded into an archive, so the archive gets finalized only once.
 			 */
-			std::mutex depthBuffer_mutex;
+			std::mutex archiveFinalization_mutex;
 
 			/**
-			 * Threads (there can be several at the same time) that write depth image frames of the depthBuffer to the filesystem, then remove them from depthBuffer.
+			 * Whether or not the archive has reached the limits of an archive without zip64 extensions (4 GB or 65535 files). The recording then goes on as loose files in the root directory of the sequence, and the frames already in the archive are moved there when the recording stops.
 			 */
-			std::vector<std::thread*> depthBufferWritingThreads;
+			std::atomic<bool> archiveIsFull;
 
 			/**
-			 * Number of working threads that write the content of each image buffer to the filesystem.
+			 * A lock that serializes the switch from the archive to the loose files, so it happens only once.
 			 */
-			int writingThreadsNumberPerBuffer;
+			std::mutex archiveFallback_mutex;
+
+			/**
+			 * The reclaimer the stale data of the temp folder is handed over to, or NULL to delete it synchronously.
+			 */
+			kocca::FolderReclaimer* folderReclaimer;
+
+			/**
+			 * The memory buffers where the incoming frames of each stream are temporarily stored before they get written to the filesystem, indexed by RecordedStreamType.
+			 */
+			kocca::TimeCodedFrameBuffer buffers[RECORDED_STREAMS_COUNT];
+
+			/**
+			 * Locks to prevent access conflicts to each of the buffers.
+			 */
+			std::mutex buffers_mutex[RECORDED_STREAMS_COUNT];
+
+			/**
+			 * The threads of the writing pool, shared by all the streams : each of them encodes and writes the frame of the buffer that needs it the most (see popNextFrame()). The threads that have retired stay in the list until they are joined.
+			 */
+			std::vector<std::thread*> writingThreads;
+
+			/**
+			 * A lock to prevent access conflicts to the writingThreads list, as threads are added to the pool while it is running.
+			 */
+			std::mutex writingThreads_mutex;
+
+			/**
+			 * The thread that writes the frames of the pre-roll at the beginning of the recording, or NULL if there's no pre-roll.
+			 */
+			std::thread* preRollCommittingThread;
+
+			/**
+			 * The number of threads of the writing pool when the recording starts ("recording.writing_threads" setting, defaults to the constructor's parameter).
+			 */
+			int initialWritingThreadsNumber;
+
+			/**
+			 * The bounds of the number of threads of the writing pool while recording ("recording.writing_threads_min" and "recording.writing_threads_max" settings). The maximum defaults to the number of cores.
+			 */
+			int minWritingThreadsNumber, maxWritingThreadsNumber;
+
+			/**
+			 * The number of threads of the writing pool that are running, and the highest number reached during the recording.
+			 */
+			std::atomic<int> activeWritingThreadsCount, peakWritingThreadsCount;
+
+			/**
+			 * The number of threads of the writing pool that have been asked to retire, and haven't yet.
+			 */
+			std::atomic<int> retiringWritingThreadsCount;
+
+			/**
+			 * The number of times the writing pool has been grown and shrunk.
+			 */
+			std::atomic<int> writingPoolGrowthsCount, writingPoolShrinksCount;
+
+			/**
+			 * The priority of each stream for the writing pool ("recording.<stream>_priority" settings, 1 by default), indexed by RecordedStreamType : a stream with a priority of 2 gets its backlog drained as if it was twice as large.
+			 */
+			double streamPriorities[RECORDED_STREAMS_COUNT];
+
+			/**
+			 * The time spent by the writing threads encoding and writing frames since the latest tuning of the pool, in microseconds.
+			 */
+			std::atomic<unsigned long long> writingBusyTime;
+
+			/**
+			 * The time of the latest tuning of the writing pool, and the total number of queued frames at that time.
+			 */
+			std::chrono::steady_clock::time_point latestWritingPoolTuningTime;
+			long long latestWritingPoolTuningQueuedFrames;
+
+			/**
+			 * A lock that makes sure that only one writing thread at a time tunes the pool.
+			 */
+			std::mutex writingPoolTuning_mutex;
 
 			/**
 			 * Whether or not the sequence is currently being recorded.
 			 */
 			bool isRecording;
 
+			/**
+			 * A lock that protects the end of the recording, as seen by the estimating thread.
+			 */
+			std::mutex estimating_mutex;
+
+			/**
+			 * A condition that wakes the estimating thread up when the recording ends, instead of waiting for its next estimate.
+			 */
+			std::condition_variable estimating_condition;
+
 			/**
 			 * The local system time at which the recording began.
 			 */
@@ -113,14 +210,34 @@ namespace kocca {
 			std::mutex startRecordingTime_mutex;
 
 			/**
-			 * Format/compression parameters for image stream
+			 * The JPEG quality of the color image frames, from 1 to 100 ("recording.jpeg_quality" setting).
+			 */
+			int jpegQuality;
+
+			/**
+			 * The JPEG chroma subsampling of the color image frames, as one of TurboJPEG's TJSAMP_XXX values ("recording.jpeg_chroma_subsampling" setting).
+			 */
+			int jpegChromaSubsampling;
+
+			/**
+			 * Whether or not the color image frames are encoded with the fast DCT algorithm ("recording.jpeg_fast_dct" setting).
+			 */
+			bool jpegFastDCT;
+
+			/**
+			 * Number of color image frames encoded by the writing threads that have finished.
+			 */
+			unsigned long long encodedImageFramesCount;
+
+			/**
+			 * Total time spent encoding color image frames by the writing threads that have finished, in milliseconds.
 			 */
-			std::vector<int> imageFormatParams;
+			double imageEncodingTime;
 
 			/**
-			 * Format/compression parameters for infrared stream
+			 * A lock to protect encodedImageFramesCount and imageEncodingTime from threads access conflicts.
 			 */
-			std::vector<int> infraredFormatParams;
+			std::mutex imageEncodingStats_mutex;
 
 			/**
 			 * Format/compression parameters for depth stream
@@ -128,15 +245,68 @@ namespace kocca {
 			std::vector<int> depthFormatParams;
 
 			/**
-			 * Gets the current total size (in bytes) of the three recording buffers.
+			 * Gets the measured JPEG encoding throughput of one core, from the writing threads that have finished.
+			 * @return the number of color image frames that one thread can encode per second, or 0 if no frame has been encoded yet
 			 */
-			int getTotalBuffersSize();
+			double getImageEncodingThroughput();
+
+			/**
+			 * Gets the current total size (in bytes) of the frames waiting in the three recording buffers.
+			 */
+			uint64_t getTotalBuffersSize();
+
+			/**
+			 * The live statistics of the recording.
+			 */
+			RecordingStatistics statistics;
+
+			/**
+			 * The interval between two dumps of the statistics to the CSV file, in milliseconds ("recording.statistics_interval" setting). 0 means that the statistics are not dumped.
+			 */
+			long long statisticsDumpInterval;
+
+			/**
+			 * Whether or not the writing pool, JPEG encoding and pre-roll statistics are printed to the console ("debug.statistics_logs" setting).
+			 */
+			bool logsStatistics;
+
+			/**
+			 * Gets the path of the CSV file where the statistics are dumped : next to the archive if the sequence is recorded into an archive, in the sequence's root directory otherwise, from where it is exported along with the sequence (see datalib::SequenceFile).
+			 */
+			boost::filesystem::path getStatisticsFilePath();
 
 			/**
 			 * The total maximum size (in bytes) allowed for the three buffers added.
 			 */
 			uint64_t maxBuffersSize;
 
+			/**
+			 * The thread that periodically updates the estimation of the recording (see RecordingStatistics::updateEstimate()) and issues the warnings, or NULL if the recording hasn't started.
+			 */
+			std::thread* estimatingThread;
+
+			/**
+			 * The warnings are issued when the buffers are estimated to reach maxBuffersSize within buffersWarningTime seconds ("recording.buffers_warning_time" setting), and when the target disk is estimated to be full within diskWarningTime seconds ("recording.disk_warning_time" setting).
+			 */
+			double buffersWarningTime, diskWarningTime;
+
+			/**
+			 * Whether or not the buffers and the disk warnings have been issued. The buffers warning is issued again once the buffers have drained.
+			 */
+			bool buffersWarningIssued, diskWarningIssued;
+
+			/**
+			 * Gets the free space of the disk the sequence is recorded to : the lowest one of the folders of the streams, or the one of the archive's folder.
+			 * @return the free space in bytes, or 0 if it is unknown
+			 */
+			unsigned long long getTargetFreeSpace();
+
+			/**
+			 * Issues a warning : it is written to the console and passed to onWarning.
+			 * @param message the warning message
+			 */
+			void issueWarning(const std::string& message);
+
 			/**
 			 * To save resources, 3 out of 4 MoCap frames are not output (but all of them are recorded of course !). This cycle-counts skipped frames up to 3, then reset to 0 and so on ...
 			 */
@@ -148,15 +318,146 @@ namespace kocca {
 			 */
 			std::runtime_error* error;
 
+			/**
+			 * A lock to protect error from threads access conflicts.
+			 */
+			std::mutex error_mutex;
+
+			/**
+			 * Sets the configuration of the writing pool in the sequence's metadata ("writing_threads", "writing_threads_min", "writing_threads_max" and "<stream>_priority" keys), so the performance of a recording can be reproduced. The metadata is written afterwards, with the streams profiles.
+			 */
+			void writeWritingPoolMetadata();
+
+			/**
+			 * Writes the encoded data of a frame, either into the archive (if the sequence is recorded into an archive) or into a file of one of the stream's folders (see streamDirectories).
+			 * @param stream the stream of the frame
+			 * @param frameFileName the file name of the frame
+			 * @param data the encoded data of the frame
+			 * @param size the size of the encoded data, in bytes
+			 * @param countsWriting whether the write of the frame is counted in the statistics once complete (the pre-roll frames aren't)
+			 * @return the path of the written frame, to be added to the sequence. A frame written into the archive gets the path it will have in the root directory if the archive fills up.
+			 * @throws FileWritingException if the frame file couldn't be written
+			 * @throws FileArchivingException if the frame couldn't be written into the archive
+			 */
+			boost::filesystem::path writeFrameData(RecordedStreamType stream, const std::string& frameFileName, const unsigned char* data, size_t size, bool countsWriting);
+
+			/**
+			 * Switches the recording from the archive, which is full, to loose files in the root directory of the sequence. Calling it again once it is done has no effect.
+			 * @throws TempFolderNotAvailableException if the folders of the streams couldn't be created
+			 * @throws FileWritingException if the metadata file couldn't be written
+			 */
+			void fallBackToFolderRecording();
+
+			/**
+			 * Extracts the frames of the finalized archive, once it is full, into the root directory of the sequence, then deletes the archive.
+			 * @throws FileReadingException if the archive couldn't be read
+			 * @throws FileWritingException if a frame file couldn't be written
+			 */
+			void moveArchivedFramesToFolder();
+
+			/**
+			 * Sets up the folders where the frames of each stream are written, from the "recording.<stream>_directories" settings : each stream can be spread over several directories (typically on different disks), in which case a folder is created for the sequence in each of them and listed in the sequence's metadata. Streams without any directory set are written into the sequence's root directory.
+			 * @throws TempFolderNotAvailableException if the folder of a stream couldn't be created
+			 */
+			void prepareStreamDirectories();
+
+			/**
+			 * Waits for the end of all the writing threads (except the calling thread itself, if it is one of them). They end once the recording is stopped and the buffers are empty.
+			 */
+			void waitForWritingThreads();
+
+			/**
+			 * Adds a thread to the writing pool.
+			 */
+			void startWritingThread();
+
+			/**
+			 * Adjusts the number of threads of the writing pool to the backlog of the buffers, at most once every tuning period. It is called by the writing threads themselves.
+			 * The pool grows (up to maxWritingThreadsNumber) when the backlog would take more than a tuning period to drain and doesn't decrease, and shrinks (down to minWritingThreadsNumber) when the buffers are empty and one thread less would still be busy less than 80% of the time.
+			 */
+			void tuneWritingPool();
+
+			/**
+			 * Takes the next frame to write out of the buffers : the one of the stream with the highest backlog cost (queued frames x mean cost of a frame x priority of the stream).
+			 * @param stream receives the stream of the frame
+			 * @param tcFrame receives the frame
+			 * @return false if there's no frame to write
+			 */
+			bool popNextFrame(RecordedStreamType& stream, kocca::datalib::TimeCodedFrame& tcFrame);
+
+			/**
+			 * Whether or not all the buffers are empty.
+			 */
+			bool buffersAreEmpty();
+
+			/**
+			 * Encodes a frame (JPEG for the color frames, InfraredFrameCodec for the infrared ones, PNG for the depth ones), writes it and adds it to the sequence.
+			 * An error while encoding or writing the frame is memorized with setError().
+			 * @param stream the stream of the frame
+			 * @param tcFrame the frame, with its time relative to the sequence
+			 * @param encoder the JPEG encoder of the calling thread
+			 * @param encodedFrame the encoding buffer of the calling thread
+			 */
+			void writeFrame(RecordedStreamType stream, kocca::datalib::TimeCodedFrame& tcFrame, kocca::datalib::JpegFrameEncoder& encoder, std::vector<unsigned char>& encodedFrame);
+
+			/**
+			 * Adds a written frame to the sequence, and appends it to the journal.
+			 * @param stream the stream of the frame
+			 * @param time the time of the frame, relative to the sequence
+			 * @param framePath the path of the frame, as returned by writeFrameData()
+			 * @param data the encoded content of the frame
+			 * @param size the size of the encoded content, in bytes
+			 * @throws FileWritingException if the journal couldn't be written
+			 */
+			void addFrameToSequence(RecordedStreamType stream, unsigned long long time, const boost::filesystem::path& framePath, const unsigned char* data, size_t size);
+
+			/**
+			 * Adds a markers frame to the sequence, and appends it to the journal.
+			 * @param markerFrame the markers frame, with its time relative to the sequence
+			 * @throws FileWritingException if the journal couldn't be written
+			 */
+			void addMarkersFrameToSequence(kocca::datalib::MocapMarkerFrame& markerFrame);
+
+			/**
+			 * Re-throws (only once) the error memorized by setError(), if there is one.
+			 * @throws std::runtime_error the memorized error
+			 */
+			void throwPendingError();
+
+			/**
+			 * Applies the profile of a stream to an incoming frame : the frame is either discarded by the decimation, or cropped and downscaled.
+			 * @param stream the stream of the frame
+			 * @param tcFrame the frame, which is replaced by the recorded one
+			 * @return false if the frame is discarded by the decimation
+			 */
+			bool applyStreamProfile(RecordedStreamType stream, kocca::datalib::TimeCodedFrame& tcFrame);
+
 		public:
 
+			/**
+			 * Gets the extension of the frames files of a stream, with its leading dot.
+			 * @param stream the stream
+			 */
+			static const char* getFrameFileExtension(RecordedStreamType stream);
+
+			/**
+			 * Gets the recording profile of a stream from the "recording.<stream>_scale", "recording.<stream>_roi" and "recording.<stream>_decimation" settings.
+			 * @param stream the stream
+			 */
+			static kocca::datalib::StreamProfile getStreamProfileSetting(RecordedStreamType stream);
+
 			/**
 			 * Constructor.
 			 * @param _sequence 
+			 * @param archiveFilePath the path of the .ksa archive to record the sequence into. If empty, the sequence is recorded as loose files in its root directory (which must then be an existing temp folder).
 			 * @param _maxBuffersSize 
-			 * @param _writingThreadsNumberPerBuffer 
+			 * @param _writingThreadsNumber the number of threads of the writing pool when the recording starts, unless the "recording.writing_threads" setting is set
+			 * @param _folderReclaimer if not NULL, the stale data of the temp folder is renamed aside and deleted in the background by this reclaimer, so the recording starts right away
+			 * @throws TempFolderNotAvailableException if the sequence is not recorded into an archive and its root directory is not available
+			 * @throws FileArchivingException if the archive file couldn't be created
+			 * @throws FileWritingException if the metadata file couldn't be written in the root directory
 			 */
-			SequenceRecording(kocca::datalib::Sequence* _sequence, uint64_t _maxBuffersSize = 1500000000, int _writingThreadsNumberPerBuffer = 4);
+			SequenceRecording(kocca::datalib::Sequence* _sequence, boost::filesystem::path archiveFilePath = boost::filesystem::path(), uint64_t _maxBuffersSize = 1500000000, int _writingThreadsNumber = 4, kocca::FolderReclaimer* _folderReclaimer = NULL);
 
 			/**
 			 * Destructor.
@@ -165,11 +466,25 @@ namespace kocca {
 
 			/**
 			 * Converts an absolute local system timestamp to a time relative to the sequence.
-			 * @param time the local system timestamp, in milliseconds
-			 * @return the time in the sequence, in milliseconds
+			 * @param time the local system timestamp, in microseconds
+			 * @return the time in the sequence, in microseconds
 			 */
 			unsigned long long getRelativeTime(unsigned long long time);
 
+			/**
+			 * Writes the encoded frames of a pre-roll buffer into the sequence, with their times relative to the sequence. Implementation of the preRollCommittingThread.
+			 * @param preRollBuffer the frozen pre-roll buffer
+			 */
+			void commitPreRollFrames(PreRollBuffer* preRollBuffer);
+
+			/**
+			 * Counts the write of a frame file in the statistics once it is complete. Implementation of FrameFileWriterListener, called by frameFileWriter.
+			 * @param tag the stream of the frame, or -1 if its write isn't counted
+			 * @param size the size of the frame file, in bytes
+			 * @param writingLatency the time from the submission of the frame file to the completion of its write, in microseconds
+			 */
+			void onFileWritten(int tag, size_t size, unsigned long long writingLatency);
+
 			/**
 			 * Processes an image frame of the depth stream, through the operation.
 			 * @param tcFrame the frame to process
@@ -203,41 +518,74 @@ namespace kocca {
 
 			/**
 			 * Starts the recording.
+			 * @param preRollBuffer if not NULL, the frames received before the recording started : it is frozen, and the sequence starts with its oldest frame. Its markers frames are added to the sequence right away, and its encoded frames are written from a separate thread (see commitPreRollFrames()). It must not be cleared until the recording is stopped.
 			 */
-			void startRecording();
+			void startRecording(PreRollBuffer* preRollBuffer = NULL);
 
 			/**
 			 * Stops the recording.
+			 * If the sequence is recorded into an archive, this waits for the frames remaining in the buffers to be written, then appends the calibration and MoCap markers data and finalizes the archive : it is complete when this returns.
+			 * If the archive filled up during the recording, its frames are moved to the root directory of the sequence instead, and the sequence is left as loose files, to be exported.
+			 * If the sequence is recorded as loose files with a journal, this waits for the frames remaining in the buffers to be written and synced, then deletes the journal, unless an error happened during the recording.
+			 * @throws KinectCalibrationFileExportException if the calibration data couldn't be written
+			 * @throws FileArchivingException if the archive couldn't be completed
+			 * @throws FileWritingException if the frames files couldn't be synced
 			 */
 			void stop();
 
 			/**
-			 * Implementation for color image buffer writing threads, that write color image frames of the imageBuffer to the filesystem, then remove them from imageBuffer.
-			 * @throws FileWritingException if an error happens during the call to cv::imwrite()
+			 * Recovers a take whose archive couldn't be completed by stop() : the frames written into the archive so far are extracted into the root directory of the sequence, the calibration and MoCap markers data are written next to them, and the unusable archive is deleted. The sequence is then left as loose files, to be exported, and getArchiveFilePath() returns an empty string.
+			 * @return the number of frames recovered from the archive
+			 * @throws FileReadingException if the archive couldn't be read
+			 * @throws FileWritingException if the frames or the metadata couldn't be written
+			 * @throws TempFolderNotAvailableException if the folders of the streams couldn't be created
+			 * @throws KinectCalibrationFileExportException if the calibration data couldn't be written
+			 */
+			int recoverArchivedTake();
+
+			/**
+			 * Gets the live statistics of the recording. They can be read from any thread, without any lock.
+			 */
+			RecordingStatistics* getStatistics();
+
+			/**
+			 * Gets the path of the archive the sequence is recorded into.
+			 * @return the path of the archive, or an empty string if the sequence is recorded as loose files in its root directory, or if the archive filled up and the recording went on as loose files
+			 */
+			std::string getArchiveFilePath();
+
+			/**
+			 * Callback function that will - if defined - be called from the estimatingThread when the recording is likely to stop soon : because the buffers will reach their maximum size, or because the target disk will be full.
+			 */
+			void (*onWarning)(std::string message);
+
+			/**
+			 * Implementation of the estimatingThread, which runs until the recording is stopped.
 			 */
-			void imageBufferWritingThreadLoop();
+			void estimatingThreadLoop();
 
 			/**
-			 * Implementation for infrared image buffer writing threads, that write infrared image frames of the infraredBuffer to the filesystem, then remove them from infraredBuffer.
-			 * @throws FileWritingException if an error happens during the call to cv::imwrite()
+			 * Marks the recording as stopped and wakes the estimating thread up, so that it ends without waiting for its next estimate.
 			 */
-			void infraredBufferWritingThreadLoop();
+			void stopEstimating();
 
 			/**
-			 * Implementation for depth image buffer writing threads, that write depth image frames of the depthBuffer to the filesystem, then remove them from depthBuffer.
-			 * @throws FileWritingException if an error happens during the call to cv::imwrite()
+			 * Implementation for the threads of the writing pool, that take the frames out of the buffers (see popNextFrame()), then encode and write them to the filesystem (or the archive) until the recording is stopped and the buffers are empty, or until they are asked to retire.
+			 * Each thread has its own JPEG encoder and encoding buffer, reused from one frame to the next.
 			 */
-			void depthBufferWritingThreadLoop();
+			void writingThreadLoop();
 
 			/**
 			 * Prepares an EXISTING folder to receive the sequence data during recording. After calling this function, the temp folder should cointain 3 sub-folders ("image", "infrared", and "depth") and nothing else.
+			 * The stale content of the folder is handed over to the folderReclaimer (renamed aside into the folder's parent), or deleted right away if there's no reclaimer or if it can't be renamed.
 			 * @param tempDirectory the path where the recorded sequence data will be written.
 			 * @throws TempFolderNotAvailableException if sequenceFolderPath doesn't exists or if it is not a directory.
 			 */
 			void cleanAndPrepareTempFolder(boost::filesystem::path tempDirectory);
 
 			/**
-			 * Stops the recording and memorizes a runtime error that happened in a separate thread, so we can re-throw it later.
+			 * Stops the recording and memorizes a runtime error that happened in a separate thread, so we can re-throw it later. Only the first error is memorized.
+			 * It doesn't call stop(), as it is called from the buffer writing threads that stop() waits for : stop() is expected to be called once the error has been re-thrown.
 			 * @param re the runtime error to memorize
 			 */
 			void setError(std::runtime_error re);
@@ -14,7 +14,7 @@ namespace kocca {
 
 		/**
 		 * Get the frame that should be visible at the time specified as a parameter.
-		 * @param time the time for wich we want the corresponding frame, in milliseconds
+		 * @param time the time for wich we want the corresponding frame, in microseconds
 		 * @return the frame visible at time
 		 * @throws OutOfSequenceException
 		 */
@@ -22,17 +22,17 @@ namespace kocca {
 
 		/**
 		 * Delete all frames whose time is before the one specified as a parameter.
-		 * @param time the time before when we want to purge the buffer, in milliseconds 
+		 * @param time the time before when we want to purge the buffer, in microseconds 
 		 */
 		void purgeBefore(long long time);
 
 		/**
-		 * Gets the time (in milliseconds) associated with the FIRST frame stored in the buffer, of 0 if there isn't any.
+		 * Gets the time (in microseconds) associated with the FIRST frame stored in the buffer, of 0 if there isn't any.
 		 */
 		unsigned long long getStartingPoint();
 
 		/**
-		 * Gets the time (in milliseconds) associated with the LAST frame stored in the buffer, of 0 if there isn't any.
+		 * Gets the time (in microseconds) associated with the LAST frame stored in the buffer, of 0 if there isn't any.
 		 */
 		unsigned long long getEndingPoint();
 	};
@@ -0,0 +1,146 @@
+#include "WriterBenchmark.h"
+#include "../utils.h"
+#include "../Exceptions.h"
+#include <sstream>
+#include <thread>
+
+namespace kocca {
+	namespace operations {
+		const char* WriterBenchmark::DIRECTORY_NAME = "kocca_writer_benchmark";
+
+		WriterBenchmark::WriterBenchmark(const std::vector<boost::filesystem::path>& targetDirectories, int _threadsNumber) {
+			for(int i = 0; i < targetDirectories.size(); i++)
+				benchmarkDirectories.push_back(targetDirectories.at(i) / DIRECTORY_NAME);
+
+			threadsNumber = (_threadsNumber > 0) ? _threadsNumber : 1;
+			writingLatency = NULL;
+			writeThroughput = 0;
+		}
+
+		WriterBenchmark::~WriterBenchmark() {
+			if(writingLatency != NULL)
+				delete writingLatency;
+		}
+
+		void WriterBenchmark::benchmarkThreadLoop(const unsigned char* data, kocca::datalib::FrameFileWriter* frameFileWriter, unsigned long long endTime) {
+			try {
+				while(getMSTime() < endTime) {
+					unsigned long long fileIndex = submittedFilesCount.fetch_add(1);
+
+					std::ostringstream fileName;
+					fileName << fileIndex << ".bin";
+					frameFileWriter->writeFile(benchmarkDirectories.at(fileIndex % benchmarkDirectories.size()) / fileName.str(), data, FILE_SIZE);
+				}
+			}
+			catch(std::exception& e) {
+				errorMessage_mutex.lock();
+
+				if(errorMessage.empty())
+					errorMessage = e.what();
+
+				errorMessage_mutex.unlock();
+			}
+		}
+
+		/**
+		 * @throws TempFolderNotAvailableException
+		 * @throws FileWritingException
+		 */
+		void WriterBenchmark::run(kocca::datalib::FrameFileWriter* frameFileWriter, unsigned long long duration) {
+			for(int i = 0; i < benchmarkDirectories.size(); i++) {
+				try {
+					boost::filesystem::remove_all(benchmarkDirectories.at(i));
+					boost::filesystem::create_directories(benchmarkDirectories.at(i));
+				}
+				catch(boost::filesystem::filesystem_error fse) {
+					std::ostringstream errMsg;
+					errMsg << "Unable to create writer benchmark folder " << benchmarkDirectories.at(i).string() << " : " << fse.what();
+					throw TempFolderNotAvailableException(errMsg.str().c_str());
+				}
+			}
+
+			// the content doesn't matter to the writers, but it isn't all zeros in case the filesystem compresses or deduplicates
+			std::vector<unsigned char> data(FILE_SIZE);
+			unsigned int noise = 12345;
+
+			for(size_t i = 0; i < data.size(); i++) {
+				noise = (noise * 1103515245) + 12345;
+				data[i] = (unsigned char)(noise >> 16);
+			}
+
+			if(writingLatency != NULL)
+				delete writingLatency;
+
+			writingLatency = new LatencyHistogram();
+			maxWritingLatency = 0;
+			submittedFilesCount = 0;
+			writtenFilesCount = 0;
+			writtenBytesCount = 0;
+			errorMessage.clear();
+
+			frameFileWriter->setListener(this);
+			unsigned long long startTime = getMSTime();
+			std::vector<std::thread*> benchmarkThreads;
+
+			for(int i = 0; i < threadsNumber; i++)
+				benchmarkThreads.push_back(new std::thread(&WriterBenchmark::benchmarkThreadLoop, this, data.data(), frameFileWriter, startTime + duration));
+
+			for(int i = 0; i < benchmarkThreads.size(); i++) {
+				benchmarkThreads.at(i)->join();
+				delete benchmarkThreads.at(i);
+			}
+
+			try {
+				// the writes still in flight are part of the benchmark
+				frameFileWriter->flush();
+			}
+			catch(std::exception& e) {
+				if(errorMessage.empty())
+					errorMessage = e.what();
+			}
+
+			double elapsedTime = (getMSTime() - startTime) / 1000.0;
+
+			boost::system::error_code ec;
+
+			for(int i = 0; i < benchmarkDirectories.size(); i++)
+				boost::filesystem::remove_all(benchmarkDirectories.at(i), ec);
+
+			if(!errorMessage.empty()) {
+				std::ostringstream errMsg;
+				errMsg << "Writer benchmark failed : " << errorMessage;
+				throw FileWritingException(errMsg.str().c_str());
+			}
+
+			writeThroughput = (elapsedTime > 0) ? ((writtenBytesCount / 1000000.0) / elapsedTime) : 0;
+		}
+
+		void WriterBenchmark::onFileWritten(int tag, size_t size, unsigned long long latency) {
+			writtenFilesCount++;
+			writtenBytesCount.fetch_add(size);
+			writingLatency->add(latency);
+
+			unsigned long long maxLatency = maxWritingLatency.load();
+
+			while((latency > maxLatency) && !maxWritingLatency.compare_exchange_weak(maxLatency, latency)) {
+				// maxLatency has been reloaded, the exchange is tried again
+			}
+		}
+
+		unsigned long long WriterBenchmark::getWrittenFilesCount() {
+			return(writtenFilesCount);
+		}
+
+		double WriterBenchmark::getWriteThroughput() {
+			return(writeThroughput);
+		}
+
+		double WriterBenchmark::getLatencyPercentile(double percentile) {
+			return((writingLatency != NULL) ? writingLatency->getPercentile(percentile) : 0);
+		}
+
+		double WriterBenchmark::getMaxLatency() {
+			return(maxWritingLatency / 1000.0);
+		}
+	} // namespace operations
+} // namespace kocca
@@ -0,0 +1,137 @@
+#ifndef KOCCA_OPERATIONS_WRITER_BENCHMARK_H
+#define KOCCA_OPERATIONS_WRITER_BENCHMARK_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem.hpp"
+#include "../datalib/FrameFileWriter.h"
+#include "RecordingStatistics.h"
+
+namespace kocca {
+	namespace operations {
+
+		/**
+		 * Compares the frame files writers on the same disks : it writes frame-sized files for a fixed duration, from several threads and in turn into a benchmark folder of each target folder (like a stream spread over several folders, see SequenceRecording::streamDirectories), and measures the sustained throughput and the latency of the writes up to their completion (see FrameFileWriterListener).
+		 * Unlike RecordingPreflight, the files aren't encoded frames : the encoding doesn't weigh on the measures, so they only reflect the writer and the disks.
+		 */
+		class WriterBenchmark: public kocca::datalib::FrameFileWriterListener {
+		public:
+
+			/**
+			 * The size of the written files, in bytes : about the size of a PNG depth frame.
+			 */
+			static const size_t FILE_SIZE = 262144;
+
+			/**
+			 * The name of the benchmark folder created in each target folder.
+			 */
+			static const char* DIRECTORY_NAME;
+
+		protected:
+
+			/**
+			 * The benchmark folders, one per target folder.
+			 */
+			std::vector<boost::filesystem::path> benchmarkDirectories;
+
+			/**
+			 * The number of threads that write the files.
+			 */
+			int threadsNumber;
+
+			/**
+			 * The number of files submitted so far by all the benchmark threads, which also numbers them.
+			 */
+			std::atomic<unsigned long long> submittedFilesCount;
+
+			/**
+			 * The number of files and bytes whose write is complete.
+			 */
+			std::atomic<unsigned long long> writtenFilesCount;
+			std::atomic<unsigned long long> writtenBytesCount;
+
+			/**
+			 * The latencies of the completed writes, and the longest one, in microseconds.
+			 */
+			LatencyHistogram* writingLatency;
+			std::atomic<unsigned long long> maxWritingLatency;
+
+			/**
+			 * The write throughput measured by the last run, in megabytes per second.
+			 */
+			double writeThroughput;
+
+			/**
+			 * The message of the first error that happened in a benchmark thread, empty if none did, and a lock to protect it from threads access conflicts.
+			 */
+			std::string errorMessage;
+			std::mutex errorMessage_mutex;
+
+			/**
+			 * Implementation of the benchmark threads, that write files until the end of the benchmark.
+			 * @param data the content of the files
+			 * @param frameFileWriter the writer of the files
+			 * @param endTime the local system time at which the benchmark ends, in milliseconds
+			 */
+			void benchmarkThreadLoop(const unsigned char* data, kocca::datalib::FrameFileWriter* frameFileWriter, unsigned long long endTime);
+
+		public:
+
+			/**
+			 * Constructor.
+			 * @param targetDirectories the folders to write into, typically on different disks. A benchmark folder is created in each of them, then removed with all its content.
+			 * @param _threadsNumber the number of threads that write the files
+			 */
+			WriterBenchmark(const std::vector<boost::filesystem::path>& targetDirectories, int _threadsNumber);
+
+			/**
+			 * Destructor.
+			 */
+			~WriterBenchmark();
+
+			/**
+			 * Runs the benchmark with a writer. It blocks for its whole duration.
+			 * @param frameFileWriter the writer to benchmark. Its listener is set to the benchmark.
+			 * @param duration the duration of the benchmark, in milliseconds. The writes still in flight at its end are waited for, and are part of the measures.
+			 * @throws TempFolderNotAvailableException if a benchmark folder couldn't be created
+			 * @throws FileWritingException if a file couldn't be written
+			 */
+			void run(kocca::datalib::FrameFileWriter* frameFileWriter, unsigned long long duration);
+
+			/**
+			 * Counts a completed write. Implementation of FrameFileWriterListener.
+			 * @param tag unused
+			 * @param size the size of the file, in bytes
+			 * @param latency the time from the submission of the file to the completion of its write, in microseconds
+			 */
+			void onFileWritten(int tag, size_t size, unsigned long long latency);
+
+			/**
+			 * Gets the number of files written by the last run.
+			 */
+			unsigned long long getWrittenFilesCount();
+
+			/**
+			 * Gets the write throughput sustained by the last run, from its start to the completion of its last write, in megabytes per second.
+			 */
+			double getWriteThroughput();
+
+			/**
+			 * Gets an estimation of a percentile of the writes latencies of the last run (see LatencyHistogram::getPercentile()).
+			 * @param percentile the percentile, from 0 to 1
+			 * @return the estimated percentile, in milliseconds
+			 */
+			double getLatencyPercentile(double percentile);
+
+			/**
+			 * Gets the longest write latency of the last run, in milliseconds.
+			 */
+			double getMaxLatency();
+		};
+	} // namespace operations
+} // namespace kocca
+
+#endif // KOCCA_OPERATIONS_WRITER_BENCHMARK_H
@@ -9,23 +9,36 @@
 
 #include <iostream>
 
+namespace kocca {
 #ifdef _WIN32
-	struct MSTime { long long tv_sec; long long tv_nsec; };
-
-	int clock_gettime(int, struct MSTime* spec) {
-		__int64 wintime;
-		GetSystemTimeAsFileTime((FILETIME*)&wintime);
-		spec->tv_sec = wintime / 10000000i64;           //seconds
-		spec->tv_nsec = wintime % 10000000i64 *100;      //nano-seconds
-		return 0;
+	namespace {
+		LARGE_INTEGER getPerformanceFrequency() {
+			LARGE_INTEGER frequency;
+			QueryPerformanceFrequency(&frequency);
+			return(frequency);
+		}
+	}
+
+	unsigned long long getUSTime() {
+		static const LARGE_INTEGER frequency = getPerformanceFrequency();
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+
+		// seconds and remainder are converted separately, so the multiplication can't overflow
+		unsigned long long seconds = counter.QuadPart / frequency.QuadPart;
+		unsigned long long remainder = counter.QuadPart % frequency.QuadPart;
+		return((seconds * 1000000) + ((remainder * 1000000) / frequency.QuadPart));
+	}
+#else
+	unsigned long long getUSTime() {
+		struct timespec top;
+		clock_gettime(CLOCK_MONOTONIC, &top);
+		return((top.tv_sec * 1000000ULL) + (top.tv_nsec / 1000));
 	}
 #endif
 
-namespace kocca {
 	unsigned long long getMSTime() {
-		struct MSTime top;
-		clock_gettime(0, &top);
-		return ((top.tv_sec * 1000) + (top.tv_nsec / 1000000));
+		return(getUSTime() / 1000);
 	}
 
 	boost::filesystem::path get_executable_path() {
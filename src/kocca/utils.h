@@ -7,8 +7,6 @@
 
 #ifdef _WIN32
 	#include <Windows.h>
-	struct MStime;
-	int clock_gettime(int, struct MSTime* spec);
 	#define usleep(n_microseconds)   Sleep(n_microseconds)
 	#define NOMINMAX
 #else
@@ -19,7 +17,12 @@
 namespace kocca {
 
 	/**
-	 * Gets a local system timestamp in MilliSeconds
+	 * Gets a local system timestamp in MicroSeconds, from a monotonic high-resolution clock (it never jumps backwards, unlike the wall clock). Its origin is arbitrary (usually the boot of the system), so it should only be used to measure durations or to timestamp frames.
+	 */
+	unsigned long long getUSTime();
+
+	/**
+	 * Gets a local system timestamp in MilliSeconds, from the same clock as getUSTime()
 	 */
 	unsigned long long getMSTime();
 
@@ -137,6 +137,8 @@ namespace kocca {
 
 			if (frame.channels() == 1)
 				cv::cvtColor(frame, frame, CV_GRAY2RGB);
+			else if (frame.channels() == 4) // live color frames are BGRA, as captured
+				cv::cvtColor(frame, frame, CV_BGRA2RGB);
 			
 			return frame;
 		}
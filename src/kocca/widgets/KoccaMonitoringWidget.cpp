@@ -1,15 +1,19 @@
 #include "KoccaMonitoringWidget.h"
 #include "../utils.h"
+#include "../datalib/TimeCodedFrame.h"
 #include <gdkmm/cursor.h>
 #include <gtkmm/window.h>
 #include <gdk/gdkkeysyms.h>
+#include <sstream>
 
 namespace kocca {
 	namespace widgets {
 		KoccaMonitoringWidget::KoccaMonitoringWidget(BaseObjectType* cobject, const Glib::RefPtr<Gtk::Builder>& builder): CvDrawingArea(cobject, builder) {
 			showRecordingIndications = false;
+			remainingRecordingTime = -1;
 			nextMocapMarkerFrame = NULL;
 			mappedMarkersCoordinates = NULL;
+			frameDownscale = 1;
 			extrinsicCalibrationParams = NULL;
 			intrinsicCalibrationParams = NULL;
 			hoveredMarkerId = "";
@@ -77,11 +81,12 @@ namespace kocca {
 					std::vector<cv::Point2d> projectedMarkers;
 					cv::projectPoints(rawMarkers, extrinsicCalibrationParams->getRotationVector(), extrinsicCalibrationParams->getTranslationVector(), intrinsicCalibrationParams->getProjectionMatrix(), intrinsicCalibrationParams->getDistortionVector(), projectedMarkers);
 
-					// for each marker, apply resize ratio, then add offsets(x & y)
+					// for each marker, map it to the frame (which may be a cropped or downscaled recording), apply resize ratio, then add offsets(x & y)
 					for (int i = 0; i < projectedMarkers.size(); i++) {
+						cv::Point2d frameMarker = frameGeometry.mapPoint(projectedMarkers.at(i), sensorFrameSize);
 						cv::Point2d marker;
-						marker.x = (double)offsetX + ((double)projectedMarkers.at(i).x * resizeRatio);
-						marker.y = (double)offsetY + ((double)projectedMarkers.at(i).y * resizeRatio);
+						marker.x = (double)offsetX + ((frameMarker.x / frameDownscale) * resizeRatio);
+						marker.y = (double)offsetY + ((frameMarker.y / frameDownscale) * resizeRatio);
 						mappedMarkersCoordinates->push_back(marker);
 					}
 				}
@@ -254,6 +259,13 @@ namespace kocca {
 
 		void KoccaMonitoringWidget::incrustTimeStamp(cv::Mat& frame) {
 			cv::putText(frame, kocca::format_timestamp(recordingTime), cv::Point(frame.cols - 120, 25), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 0, 0), 1);
+
+			if (remainingRecordingTime >= 0) {
+				// the remaining time is rounded to the minute, the estimation is not any more accurate than that
+				std::ostringstream remainingTimeText;
+				remainingTimeText << (long long)(remainingRecordingTime / 60) << " min left";
+				cv::putText(frame, remainingTimeText.str(), cv::Point(frame.cols - 120, 45), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 0, 0), 1);
+			}
 		}
 
 		cv::Mat KoccaMonitoringWidget::getDrawImage() {
@@ -270,6 +282,9 @@ namespace kocca {
 					std::vector<std::string> markersIDs = nextMocapMarkerFrame->getMarkerNames();
 					nextMocapMarkerFrame_mutex.unlock();
 
+					// the draw image may still share its data with the displayed frame, which we must not draw on
+					kocca::datalib::makeFrameWritable(drawImage);
+
 					for (int i = 0; i < imageMappedMarkers.size(); i++) {
 						cv::Scalar color;
 						std::string markerID = markersIDs.at(i);
@@ -289,6 +304,7 @@ namespace kocca {
 			}
 
 			if (showRecordingIndications) {
+				kocca::datalib::makeFrameWritable(drawImage);
 				incrustRecIndicator(drawImage);
 				incrustTimeStamp(drawImage);
 			}
@@ -306,6 +322,37 @@ namespace kocca {
 			drawEventDispatcher.emit();
 		}
 
+		void KoccaMonitoringWidget::setFrameGeometry(kocca::datalib::StreamProfile _frameGeometry, cv::Size _sensorFrameSize) {
+			mappedMarkersCoordinates_mutex.lock();
+			frameGeometry = _frameGeometry;
+			sensorFrameSize = _sensorFrameSize;
+
+			if(mappedMarkersCoordinates != NULL) {
+				delete mappedMarkersCoordinates;
+				mappedMarkersCoordinates = NULL;
+			}
+
+			mappedMarkersCoordinates_mutex.unlock();
+			drawEventDispatcher.emit();
+		}
+
+		void KoccaMonitoringWidget::setNextFrame(cv::Mat frame, double _frameDownscale) {
+			mappedMarkersCoordinates_mutex.lock();
+
+			// the markers are mapped again onto a frame decoded at another scale
+			if(_frameDownscale != frameDownscale) {
+				frameDownscale = _frameDownscale;
+
+				if(mappedMarkersCoordinates != NULL) {
+					delete mappedMarkersCoordinates;
+					mappedMarkersCoordinates = NULL;
+				}
+			}
+
+			mappedMarkersCoordinates_mutex.unlock();
+			CvDrawingArea::setNextFrame(frame);
+		}
+
 		void KoccaMonitoringWidget::invalidateLastFrame() {
 			nextMocapMarkerFrame_mutex.lock();
 
@@ -331,6 +378,7 @@ namespace kocca {
 		void KoccaMonitoringWidget::enterRecordingMode() {
 			showRecordingIndications = true;
 			recordingTime = 0;
+			remainingRecordingTime = -1;
 		}
 
 		void KoccaMonitoringWidget::exitRecordingMode() {
@@ -340,5 +388,9 @@ namespace kocca {
 		void KoccaMonitoringWidget::setRecordingTime(unsigned long long time) {
 			recordingTime = time;
 		}
+
+		void KoccaMonitoringWidget::setRemainingRecordingTime(double time) {
+			remainingRecordingTime = time;
+		}
 	} // namespace widgets
 } // namespace kocca
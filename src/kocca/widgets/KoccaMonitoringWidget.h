@@ -8,6 +8,7 @@
 #include <atomic>
 #include "../datalib/ExtrinsicCalibrationParametersSet.h"
 #include "../datalib/IntrinsicCalibrationParametersSet.h"
+#include "../datalib/StreamProfile.h"
 
 namespace kocca {
 	namespace widgets {
@@ -28,6 +29,11 @@ namespace kocca {
 			 */
 			std::atomic<unsigned long long> recordingTime;
 
+			/**
+			 * Estimated recording time left before the disk is full, in seconds, or a negative value if unknown
+			 */
+			std::atomic<double> remainingRecordingTime;
+
 			/**
 			 * Next MocapMarkerFrame to be projected and drawn when the widget refreshes it's display
 			 */
@@ -58,6 +64,21 @@ namespace kocca {
 			 */
 			kocca::datalib::IntrinsicCalibrationParametersSet* intrinsicCalibrationParams;
 
+			/**
+			 * The recording profile of the displayed frames, that maps the projected markers (in sensor coordinates) to the frames coordinates. It is locked by mappedMarkersCoordinates_mutex.
+			 */
+			kocca::datalib::StreamProfile frameGeometry;
+
+			/**
+			 * The size of the sensor's frames of the displayed stream, that the region of interest of frameGeometry is clipped to. It is locked by mappedMarkersCoordinates_mutex.
+			 */
+			cv::Size sensorFrameSize;
+
+			/**
+			 * The factor the displayed frame has been downscaled by relatively to its recorded resolution (see kocca::datalib::TimeCodedFrame::downscale), that maps the markers from the recorded frames coordinates to the displayed ones. It is locked by mappedMarkersCoordinates_mutex.
+			 */
+			double frameDownscale;
+
 			/**
 			 * IDs of the MocapMarkers that have been selected by the user
 			 */
@@ -175,6 +196,21 @@ namespace kocca {
 			 */
 			void setIntrinsicCalibrationParams(kocca::datalib::IntrinsicCalibrationParametersSet* _intrinsicCalibrationParams);
 
+			/**
+			 * Sets the geometry of the displayed frames relatively to the sensor's frames, for MocapMarkers projection : the recording profile of the stream for a sequence recorded with a region of interest or downscaled, the default profile for live frames.
+			 * @param _frameGeometry the recording profile of the displayed stream
+			 * @param _sensorFrameSize the size of the sensor's frames of the displayed stream
+			 */
+			void setFrameGeometry(kocca::datalib::StreamProfile _frameGeometry, cv::Size _sensorFrameSize);
+
+			/**
+			 * Sets the next frame to be displayed, along with the factor it has been downscaled by relatively to its recorded resolution, so the markers are mapped onto it.
+			 * @param frame the frame
+			 * @param _frameDownscale the downscale factor of the frame, 1 for a full resolution frame (see kocca::datalib::TimeCodedFrame::downscale)
+			 * @see CvDrawingArea::setNextFrame()
+			 */
+			void setNextFrame(cv::Mat frame, double _frameDownscale = 1);
+
 			/**
 			 * Sets the list of markers that are selected
 			 * @param _selectedMarkersIDs IDs of the markers that are selected
@@ -209,6 +245,12 @@ namespace kocca {
 			 * @param time the new elapsed recording time
 			 */
 			void setRecordingTime(unsigned long long time);
+
+			/**
+			 * Updates the estimated recording time left before the disk is full, which is incrusted under the elapsed time.
+			 * @param time the remaining time in seconds, or a negative value if unknown
+			 */
+			void setRemainingRecordingTime(double time);
 		};
 	} // namespace widgets
 } // namespace kocca
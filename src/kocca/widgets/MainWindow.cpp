@@ -512,6 +512,18 @@ namespace kocca {
 			return m_signal_shortcuts_PageDown_event;
 		}
 
+		sigc::signal<void> MainWindow::signal_shortcuts_Plus_event() {
+			return m_signal_shortcuts_Plus_event;
+		}
+
+		sigc::signal<void> MainWindow::signal_shortcuts_Minus_event() {
+			return m_signal_shortcuts_Minus_event;
+		}
+
+		sigc::signal<void> MainWindow::signal_shortcuts_R_event() {
+			return m_signal_shortcuts_R_event;
+		}
+
 		bool MainWindow::on_key_press_event_custom_handler(GdkEventKey* event) {
 			if(event->keyval == GDK_KEY_space) {
 				m_signal_shortcuts_Space_event.emit();
@@ -549,21 +561,50 @@ namespace kocca {
 				m_signal_shortcuts_PageDown_event.emit();
 				return true; // signal handled
 			}
+			else if(((event->keyval == GDK_KEY_plus) || (event->keyval == GDK_KEY_KP_Add)) && !isTextFieldFocused()) {
+				m_signal_shortcuts_Plus_event.emit();
+				return true; // signal handled
+			}
+			else if(((event->keyval == GDK_KEY_minus) || (event->keyval == GDK_KEY_KP_Subtract)) && !isTextFieldFocused()) {
+				m_signal_shortcuts_Minus_event.emit();
+				return true; // signal handled
+			}
+			else if((event->keyval == GDK_KEY_r) && !isTextFieldFocused()) {
+				m_signal_shortcuts_R_event.emit();
+				return true; // signal handled
+			}
 			else
 				return false; // allow propagation
 		}
 
-		void MainWindow::setMonitorFrameTime(unsigned long long _frameTime) {
+		bool MainWindow::isTextFieldFocused() {
+			return(dynamic_cast<Gtk::Entry*>(get_focus()) != NULL);
+		}
+
+		void MainWindow::setMonitorFrameTime(unsigned long long _frameTime, const std::string& status) {
 			if (monitorFrameTime != NULL)
 				delete monitorFrameTime;
 
 			monitorFrameTime = new unsigned long long(_frameTime);
+
+			monitorStatus_mutex.lock();
+			monitorStatus = status;
+			monitorStatus_mutex.unlock();
+
 			setMonitorFrameTimeEventDispatcher.emit();
 		}
 
 		void MainWindow::on_set_monitor_frame_time_event() {
 			std::ostringstream labelTextStream;
-			labelTextStream << "Frame time: " << *monitorFrameTime;
+			labelTextStream << "Frame time: " << *monitorFrameTime << " us";
+
+			monitorStatus_mutex.lock();
+
+			if(!monitorStatus.empty())
+				labelTextStream << "   " << monitorStatus;
+
+			monitorStatus_mutex.unlock();
+
 			monitorFrameLabel->set_label(labelTextStream.str());
 		}
 
@@ -578,7 +619,7 @@ namespace kocca {
 		void MainWindow::on_set_mocap_frame_time_event() {
 			if (mocapFrameTime != NULL) {
 				std::ostringstream labelTextStream;
-				labelTextStream << "Frame time: " << *mocapFrameTime;
+				labelTextStream << "Frame time: " << *mocapFrameTime << " us";
 				mocapMarkersFrameLabel->set_label(labelTextStream.str());
 			}
 		}
@@ -2,6 +2,8 @@
 #define KOCCA_WIDGETS_MAIN_WINDOW_H
 
 #include <atomic>
+#include <mutex>
+#include <string>
 
 #include <gtkmm.h>
 #include <gtkmm/window.h>
@@ -185,11 +187,22 @@ namespace kocca {
 			 */
 			bool on_key_press_event_custom_handler(GdkEventKey* event);
 
+			/**
+			 * Checks whether or not a text field (Gtk::Entry, or Gtk::SpinButton that derives from it) has the focus, in which case the single key shortcuts are left to it.
+			 */
+			bool isTextFieldFocused();
+
 			/**
 			 * The current frame time (in milliseconds) that must be displayed above the "monitor" widget.
 			 */
 			std::atomic<unsigned long long*> monitorFrameTime;
 
+			/**
+			 * The playback status displayed after the frame time (see operations::SequenceReading::getPlaybackStatus()), empty if there's none, and a lock to protect it from threads access conflicts.
+			 */
+			std::string monitorStatus;
+			std::mutex monitorStatus_mutex;
+
 			/**
 			 * Event dispatcher meant to be emitted when the value of monitorFrameTime is changed. This will schedule a call to on_set_monitor_frame_time_event() in Gtk's main loop.
 			 */
@@ -275,6 +288,21 @@ namespace kocca {
 			 */
 			sigc::signal<void> m_signal_shortcuts_PageDown_event;
 
+			/**
+			 * Event notification to trigger callback function when the user presses the "+" key.
+			 */
+			sigc::signal<void> m_signal_shortcuts_Plus_event;
+
+			/**
+			 * Event notification to trigger callback function when the user presses the "-" key.
+			 */
+			sigc::signal<void> m_signal_shortcuts_Minus_event;
+
+			/**
+			 * Event notification to trigger callback function when the user presses the "r" key.
+			 */
+			sigc::signal<void> m_signal_shortcuts_R_event;
+
 		public:
 
 			/**
@@ -584,13 +612,14 @@ namespace kocca {
 
 			/**
 			 * Sets the frame time for the currently monitored Kinect stream.
-			 * @param _frameTime the new frame time in milliseconds
+			 * @param _frameTime the new frame time in microseconds
+			 * @param status the playback status displayed after the frame time, or an empty string for none
 			 */
-			void setMonitorFrameTime(unsigned long long _frameTime);
+			void setMonitorFrameTime(unsigned long long _frameTime, const std::string& status = "");
 
 			/**
 			 * Sets the frame time for the mocap markers stream.
-			 * @param _mocapFrameTime the new frame time in milliseconds
+			 * @param _mocapFrameTime the new frame time in microseconds
 			 */
 			void setMocapFrameTime(unsigned long long _mocapFrameTime);
 
@@ -644,6 +673,21 @@ namespace kocca {
 			 * Gets m_signal_shortcuts_PageDown_event
 			 */
 			sigc::signal<void> signal_shortcuts_PageDown_event();
+
+			/**
+			 * Gets m_signal_shortcuts_Plus_event
+			 */
+			sigc::signal<void> signal_shortcuts_Plus_event();
+
+			/**
+			 * Gets m_signal_shortcuts_Minus_event
+			 */
+			sigc::signal<void> signal_shortcuts_Minus_event();
+
+			/**
+			 * Gets m_signal_shortcuts_R_event
+			 */
+			sigc::signal<void> signal_shortcuts_R_event();
 		};
 	} // namespace widgets
 } // namespace kocca
@@ -1,4 +1,5 @@
 #include "SelectableCvDrawingArea.h"
+#include "../datalib/TimeCodedFrame.h"
 
 namespace kocca {
 	namespace widgets {
@@ -31,6 +32,7 @@ namespace kocca {
 			cv::Mat drawImage = CvDrawingArea::getDrawImage();
 
 			if (selected) {
+				kocca::datalib::makeFrameWritable(drawImage);
 				cv::line(drawImage, cv::Point(0, 0), cv::Point(get_width()-1, 0), cv::Scalar(255, 0, 0), 2);
 				cv::line(drawImage, cv::Point(get_width()-1, 0), cv::Point(get_width()-1, get_height() - 1), cv::Scalar(255, 0, 0), 2);
 				cv::line(drawImage, cv::Point(get_width() - 1, get_height() - 1), cv::Point(0, get_height() - 1), cv::Scalar(255, 0, 0), 2);
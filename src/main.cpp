@@ -1,5 +1,8 @@
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 #include "kocca/Application.h"
 
 #ifdef WIN32
@@ -21,6 +24,13 @@ int main(int argc, char* argv[]) {
 	// returnCode is the program status code that will be returned at the end of it's execution. By default it's 0 (success).
 	int returnCode = 0;
 
+	// batch modes : the sequence is decoded, or the writers are benchmarked, without any user interface
+	if((argc > 2) && (strcmp(argv[1], "--benchmark-playback") == 0))
+		return(kocca::Application::benchmarkPlayback(argv[2]));
+
+	if((argc > 2) && (strcmp(argv[1], "--benchmark-writers") == 0))
+		return(kocca::Application::benchmarkWriters(std::vector<std::string>(argv + 2, argv + argc)));
+
 	try {
 		// we instantiate the Application class
 		kocca::Application koccaApplication(argc, argv);